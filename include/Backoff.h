@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// 指数退避：第n次失败后等待 min(base * 2^n, max)，实际取其 [1/2, 1] 之间的随机值，
+// 避免多台设备在同一时刻（如路由器重启后）一起重连。
+// 随机数由调用方提供，便于在不同平台上使用。
+class ExponentialBackoff {
+ public:
+  ExponentialBackoff(unsigned long baseMs, unsigned long maxMs) : baseMs_(baseMs), maxMs_(maxMs), failures_(0) {}
+
+  void reset() { failures_ = 0; }
+
+  // 记录一次失败，返回下次尝试前应等待的时间（毫秒）
+  unsigned long next(uint32_t random) {
+    unsigned long delayMs = baseMs_;
+    for (uint16_t i = 0; i < failures_ && delayMs < maxMs_; i++) {
+      delayMs *= 2;
+    }
+    if (delayMs > maxMs_) {
+      delayMs = maxMs_;
+    }
+    if (failures_ < UINT16_MAX) {
+      failures_++;
+    }
+    unsigned long half = delayMs / 2;
+    return half + (half > 0 ? random % (delayMs - half + 1) : 0);
+  }
+
+  // 连续失败次数
+  uint16_t failures() const { return failures_; }
+
+ private:
+  unsigned long baseMs_;
+  unsigned long maxMs_;
+  uint16_t failures_;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// 原地解析文本命令，不分配堆内存、不修改输入、不要求以'\0'结尾。
+//
+// 命令由空格、'?'、'&' 分隔为若干记号，第一个记号为命令名，其余为参数；
+// 参数可以是位置参数（如 "query 1 3600"）或 key=value 选项（如 "refresh?fmt=msgpack&since=5"）。
+// 输入长度和记号数量都有上限，解析耗时与输入长度成正比，可直接用于任意（包括恶意）输入。
+
+// 指向输入缓冲区中的一段文本
+struct CommandToken {
+  const char* text;
+  size_t length;
+
+  bool equals(const char* str) const {
+    size_t n = strlen(str);
+    return n == length && memcmp(text, str, n) == 0;
+  }
+
+  // 形如 key=value 时返回 true，并通过 value 返回等号之后的部分
+  bool keyValue(const char* key, CommandToken& value) const {
+    size_t n = strlen(key);
+    if (length <= n || memcmp(text, key, n) != 0 || text[n] != '=') {
+      return false;
+    }
+    value.text = text + n + 1;
+    value.length = length - n - 1;
+    return true;
+  }
+
+  // 十进制整数（可带符号），超出范围或含非数字字符时返回 false
+  bool toInt64(int64_t& out) const {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (text[i] == '-' || text[i] == '+')) {
+      negative = text[i] == '-';
+      i++;
+    }
+    if (i == length) {
+      return false;
+    }
+    uint64_t value = 0;
+    for (; i < length; i++) {
+      char c = text[i];
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      if (value > (UINT64_MAX - (c - '0')) / 10) {
+        return false;
+      }
+      value = value * 10 + (c - '0');
+    }
+    if (value > (uint64_t)INT64_MAX) {
+      return false;
+    }
+    out = negative ? -(int64_t)value : (int64_t)value;
+    return true;
+  }
+
+  bool toUInt64(uint64_t& out) const {
+    if (length > 0 && text[0] == '-') {
+      return false;
+    }
+    size_t i = (length > 0 && text[0] == '+') ? 1 : 0;
+    if (i == length) {
+      return false;
+    }
+    uint64_t value = 0;
+    for (; i < length; i++) {
+      char c = text[i];
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      if (value > (UINT64_MAX - (c - '0')) / 10) {
+        return false;
+      }
+      value = value * 10 + (c - '0');
+    }
+    out = value;
+    return true;
+  }
+
+  bool toLong(long& out, long minValue, long maxValue) const {
+    int64_t value;
+    if (!toInt64(value) || value < minValue || value > maxValue) {
+      return false;
+    }
+    out = (long)value;
+    return true;
+  }
+
+  // 十进制小数（如 "-12.5"），不支持指数形式
+  bool toFloat(float& out) const {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (text[i] == '-' || text[i] == '+')) {
+      negative = text[i] == '-';
+      i++;
+    }
+    float value = 0;
+    float scale = 1;
+    bool digits = false;
+    bool fraction = false;
+    for (; i < length; i++) {
+      char c = text[i];
+      if (c == '.' && !fraction) {
+        fraction = true;
+        continue;
+      }
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      digits = true;
+      if (fraction) {
+        scale /= 10;
+        value += (c - '0') * scale;
+      } else {
+        value = value * 10 + (c - '0');
+        if (value > 1e9f) {
+          return false;
+        }
+      }
+    }
+    if (!digits) {
+      return false;
+    }
+    out = negative ? -value : value;
+    return true;
+  }
+};
+
+template <int MaxTokens, size_t MaxLength>
+class CommandLine {
+ public:
+  CommandLine() : count_(0) {}
+
+  // 解析失败（空命令、超长、记号过多、含控制字符）时返回 false，此时不含任何记号
+  bool parse(const uint8_t* payload, size_t length) {
+    count_ = 0;
+    if (length == 0 || length > MaxLength) {
+      return false;
+    }
+    const char* text = (const char*)payload;
+    size_t i = 0;
+    while (i < length) {
+      char c = text[i];
+      if (isSeparator(c)) {
+        i++;
+        continue;
+      }
+      if ((uint8_t)c < 0x20 || c == 0x7f) {
+        // 允许消息末尾的换行
+        if ((c == '\r' || c == '\n') && onlyLineEnd(text + i, length - i)) {
+          break;
+        }
+        count_ = 0;
+        return false;
+      }
+      if (count_ == MaxTokens) {
+        count_ = 0;
+        return false;
+      }
+      size_t start = i;
+      while (i < length && !isSeparator(text[i]) && (uint8_t)text[i] >= 0x20 && text[i] != 0x7f) {
+        i++;
+      }
+      tokens_[count_].text = text + start;
+      tokens_[count_].length = i - start;
+      count_++;
+    }
+    return count_ > 0;
+  }
+
+  const CommandToken& name() const { return tokens_[0]; }
+
+  // 参数个数（不含命令名）
+  int argCount() const { return count_ > 0 ? count_ - 1 : 0; }
+
+  // 第index个参数（从0开始）
+  const CommandToken& arg(int index) const { return tokens_[index + 1]; }
+
+  // 查找 key=value 选项
+  bool option(const char* key, CommandToken& value) const {
+    for (int i = 1; i < count_; i++) {
+      if (tokens_[i].keyValue(key, value)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  static bool isSeparator(char c) { return c == ' ' || c == '?' || c == '&' || c == '\t'; }
+
+  static bool onlyLineEnd(const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      if (text[i] != '\r' && text[i] != '\n') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CommandToken tokens_[MaxTokens];
+  int count_;
+};
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <stdint.h>
+
+// 压缩时间序列（Gorilla风格），用于在内存中保存全速率读数。
+//
+// 编码：每个块以完整的首个时间戳和值开头，之后每个点写入
+//   时间戳：二阶差分（delta-of-delta），等间隔采样时多为0，只占1位；
+//   值：与上一个值的差（int16定点值，温度是随机游走，一阶差分即可）。
+// 差值经zigzag映射为无符号数后按前缀分档写入：
+//   0                -> '0'
+//   1..2^w1          -> '10'   + w1位
+//   ..2^w2           -> '110'  + w2位
+//   ..2^w3           -> '1110' + w3位
+//   其余             -> '1111' + w4位
+// 解码只能从块头顺序进行，写入只追加到链表末尾的块。
+//
+// 所有通道共享一个固定的块池，每个通道的块按时间顺序串成链表；
+// 池用尽时回收全局最旧的块（必然是某个通道链表的头），各通道保留的时长自动趋于一致，
+// 通道越少每个通道能保留的历史越长。
+
+namespace compressed_series {
+
+// 按位写入/读取（高位在前）
+class BitWriter {
+ public:
+  BitWriter(uint8_t* data, uint16_t bitPos) : data_(data), bitPos_(bitPos) {}
+
+  void write(uint32_t value, int bits) {
+    while (bits > 0) {
+      int byteIndex = bitPos_ >> 3;
+      int bitOffset = bitPos_ & 7;
+      int room = 8 - bitOffset;
+      int take = bits < room ? bits : room;
+      uint8_t chunk = (uint8_t)((value >> (bits - take)) & ((1u << take) - 1));
+      if (bitOffset == 0) {
+        data_[byteIndex] = 0;
+      }
+      data_[byteIndex] |= (uint8_t)(chunk << (room - take));
+      bitPos_ += take;
+      bits -= take;
+    }
+  }
+
+  uint16_t position() const { return bitPos_; }
+
+ private:
+  uint8_t* data_;
+  uint16_t bitPos_;
+};
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, uint16_t bitPos) : data_(data), bitPos_(bitPos) {}
+
+  uint32_t read(int bits) {
+    uint32_t value = 0;
+    while (bits > 0) {
+      int bitOffset = bitPos_ & 7;
+      int room = 8 - bitOffset;
+      int take = bits < room ? bits : room;
+      uint8_t chunk = (uint8_t)(data_[bitPos_ >> 3] >> (room - take)) & ((1u << take) - 1);
+      value = (value << take) | chunk;
+      bitPos_ += take;
+      bits -= take;
+    }
+    return value;
+  }
+
+  uint16_t position() const { return bitPos_; }
+
+ private:
+  const uint8_t* data_;
+  uint16_t bitPos_;
+};
+
+// 各档的数据位宽，最后一档必须能容纳任意差值
+struct VarWidths {
+  uint8_t w[4];
+};
+
+const VarWidths TIME_WIDTHS = {{2, 7, 12, 32}};
+const VarWidths VALUE_WIDTHS = {{2, 5, 8, 17}};
+
+inline uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+// 差值编码后的位数
+inline int varBits(int32_t delta, const VarWidths& widths) {
+  uint32_t zz = zigzag(delta);
+  if (zz == 0) {
+    return 1;
+  }
+  zz--;
+  for (int i = 0; i < 3; i++) {
+    if (zz < (1u << widths.w[i])) {
+      return i + 2 + widths.w[i];
+    }
+  }
+  return 4 + widths.w[3];
+}
+
+inline void writeVar(BitWriter& writer, int32_t delta, const VarWidths& widths) {
+  uint32_t zz = zigzag(delta);
+  if (zz == 0) {
+    writer.write(0, 1);
+    return;
+  }
+  zz--;
+  for (int i = 0; i < 3; i++) {
+    if (zz < (1u << widths.w[i])) {
+      // i+1个1后接一个0
+      writer.write(((1u << (i + 1)) - 1) << 1, i + 2);
+      writer.write(zz, widths.w[i]);
+      return;
+    }
+  }
+  writer.write(0xF, 4);
+  writer.write(zz, widths.w[3]);
+}
+
+inline int32_t readVar(BitReader& reader, const VarWidths& widths) {
+  int ones = 0;
+  while (ones < 4 && reader.read(1)) {
+    ones++;
+  }
+  if (ones == 0) {
+    return 0;
+  }
+  uint32_t zz = reader.read(widths.w[ones - 1]) + 1;
+  return unzigzag(zz);
+}
+
+}  // namespace compressed_series
+
+// 时间戳为调用方选择的单位（uint32，允许回绕），值为int16定点数
+template <int BlockBytes, int BlockCount, int Channels>
+class CompressedSeriesPool {
+ public:
+  static const uint16_t NO_BLOCK = 0xFFFF;
+
+  struct Block {
+    uint32_t firstTime;   // 块内第一个点的时间戳
+    int16_t firstValue;   // 块内第一个点的值
+    uint16_t count;       // 点数
+    uint16_t bitLength;   // data中已写入的位数（不含首个点）
+    uint16_t next;        // 同一通道的下一个块
+    uint32_t allocSeq;    // 分配序号，越小越旧
+    uint8_t data[BlockBytes];
+  };
+
+  // 顺序解码一个通道的全部点（从最旧到最新）
+  class Reader {
+   public:
+    Reader(const CompressedSeriesPool& pool, int channel)
+      : pool_(pool), block_(pool.chains_[channel].head), index_(0), bitPos_(0),
+        time_(0), delta_(0), value_(0) {}
+
+    bool next(uint32_t& time, int16_t& value) {
+      while (block_ != NO_BLOCK) {
+        const Block& block = pool_.blocks_[block_];
+        if (index_ < block.count) {
+          if (index_ == 0) {
+            time_ = block.firstTime;
+            value_ = block.firstValue;
+            delta_ = 0;
+            bitPos_ = 0;
+          } else {
+            compressed_series::BitReader reader(block.data, bitPos_);
+            delta_ += compressed_series::readVar(reader, compressed_series::TIME_WIDTHS);
+            time_ += (uint32_t)delta_;
+            value_ = (int16_t)(value_ + compressed_series::readVar(reader, compressed_series::VALUE_WIDTHS));
+            bitPos_ = reader.position();
+          }
+          index_++;
+          time = time_;
+          value = value_;
+          return true;
+        }
+        block_ = block.next;
+        index_ = 0;
+      }
+      return false;
+    }
+
+   private:
+    const CompressedSeriesPool& pool_;
+    uint16_t block_;
+    uint16_t index_;
+    uint16_t bitPos_;
+    uint32_t time_;
+    int32_t delta_;
+    int16_t value_;
+  };
+
+  CompressedSeriesPool() { clear(); }
+
+  void clear() {
+    // 空闲块借用next串成空闲链表
+    for (int i = 0; i < BlockCount; i++) {
+      blocks_[i].count = 0;
+      blocks_[i].next = i + 1 < BlockCount ? (uint16_t)(i + 1) : NO_BLOCK;
+    }
+    freeHead_ = BlockCount > 0 ? 0 : NO_BLOCK;
+    for (int c = 0; c < Channels; c++) {
+      resetChain(chains_[c]);
+    }
+    allocSeq_ = 0;
+  }
+
+  // 丢弃一个通道的全部数据，块归还空闲链表
+  void clearChannel(int channel) {
+    Chain& chain = chains_[channel];
+    uint16_t block = chain.head;
+    while (block != NO_BLOCK) {
+      uint16_t next = blocks_[block].next;
+      blocks_[block].next = freeHead_;
+      freeHead_ = block;
+      block = next;
+    }
+    resetChain(chain);
+  }
+
+  // 追加一个点
+  void append(int channel, uint32_t time, int16_t value) {
+    Chain& chain = chains_[channel];
+    if (chain.tail != NO_BLOCK) {
+      Block& tail = blocks_[chain.tail];
+      int32_t delta = (int32_t)(time - chain.lastTime);
+      int32_t deltaOfDelta = delta - chain.lastDelta;
+      int32_t valueDelta = (int32_t)value - chain.lastValue;
+      int bits = compressed_series::varBits(deltaOfDelta, compressed_series::TIME_WIDTHS) +
+                 compressed_series::varBits(valueDelta, compressed_series::VALUE_WIDTHS);
+      if (tail.bitLength + bits <= BlockBytes * 8) {
+        compressed_series::BitWriter writer(tail.data, tail.bitLength);
+        compressed_series::writeVar(writer, deltaOfDelta, compressed_series::TIME_WIDTHS);
+        compressed_series::writeVar(writer, valueDelta, compressed_series::VALUE_WIDTHS);
+        tail.bitLength = writer.position();
+        tail.count++;
+        chain.points++;
+        chain.lastTime = time;
+        chain.lastDelta = delta;
+        chain.lastValue = value;
+        return;
+      }
+    }
+
+    // 当前块已满（或尚无块），新块以完整的时间戳和值开头
+    uint16_t index = allocate(channel);
+    if (index == NO_BLOCK) {
+      return;
+    }
+    Block& block = blocks_[index];
+    block.firstTime = time;
+    block.firstValue = value;
+    block.count = 1;
+    block.bitLength = 0;
+    block.next = NO_BLOCK;
+    block.allocSeq = allocSeq_++;
+    if (chain.tail != NO_BLOCK) {
+      blocks_[chain.tail].next = index;
+    } else {
+      chain.head = index;
+    }
+    chain.tail = index;
+    chain.blocks++;
+    chain.points++;
+    chain.lastTime = time;
+    chain.lastDelta = 0;
+    chain.lastValue = value;
+  }
+
+  // 通道当前保存的点数
+  uint32_t points(int channel) const { return chains_[channel].points; }
+
+  // 通道占用的块数
+  int blocks(int channel) const { return chains_[channel].blocks; }
+
+  // 通道最旧的时间戳（无数据时返回0）
+  uint32_t oldestTime(int channel) const {
+    uint16_t head = chains_[channel].head;
+    return head != NO_BLOCK ? blocks_[head].firstTime : 0;
+  }
+
+  // 通道最新的时间戳（无数据时返回0）
+  uint32_t newestTime(int channel) const { return chains_[channel].lastTime; }
+
+  // 通道已写入的压缩数据位数（含每块首个点的完整编码）
+  uint32_t encodedBits(int channel) const {
+    uint32_t bits = 0;
+    for (uint16_t block = chains_[channel].head; block != NO_BLOCK; block = blocks_[block].next) {
+      bits += blocks_[block].bitLength + 48;
+    }
+    return bits;
+  }
+
+  int freeBlocks() const {
+    int count = 0;
+    for (uint16_t block = freeHead_; block != NO_BLOCK; block = blocks_[block].next) {
+      count++;
+    }
+    return count;
+  }
+
+  static int blockCount() { return BlockCount; }
+  static int blockBytes() { return BlockBytes; }
+
+ private:
+  struct Chain {
+    uint16_t head;       // 最旧的块
+    uint16_t tail;       // 正在写入的块
+    uint32_t points;
+    uint16_t blocks;
+    uint32_t lastTime;   // 编码器状态：上一个点的时间戳、时间差和值
+    int32_t lastDelta;
+    int16_t lastValue;
+  };
+
+  static void resetChain(Chain& chain) {
+    chain.head = NO_BLOCK;
+    chain.tail = NO_BLOCK;
+    chain.points = 0;
+    chain.blocks = 0;
+    chain.lastTime = 0;
+    chain.lastDelta = 0;
+    chain.lastValue = 0;
+  }
+
+  // 取一个空闲块；没有空闲块时回收全局最旧的块（某个通道链表的头）
+  uint16_t allocate(int channel) {
+    if (freeHead_ != NO_BLOCK) {
+      uint16_t index = freeHead_;
+      freeHead_ = blocks_[index].next;
+      return index;
+    }
+
+    int victim = -1;
+    for (int c = 0; c < Channels; c++) {
+      const Chain& chain = chains_[c];
+      // 不回收通道正在写入的最后一块
+      if (chain.head == NO_BLOCK || chain.head == chain.tail) {
+        continue;
+      }
+      if (victim < 0 || (int32_t)(blocks_[chain.head].allocSeq - blocks_[chains_[victim].head].allocSeq) < 0) {
+        victim = c;
+      }
+    }
+    if (victim < 0) {
+      // 池中只有各通道的末块，回收本通道的末块（丢弃其中全部点）
+      if (chains_[channel].tail == NO_BLOCK) {
+        return NO_BLOCK;
+      }
+      uint16_t index = chains_[channel].tail;
+      clearChannel(channel);
+      freeHead_ = blocks_[index].next;
+      return index;
+    }
+
+    Chain& chain = chains_[victim];
+    uint16_t index = chain.head;
+    chain.head = blocks_[index].next;
+    chain.points -= blocks_[index].count;
+    chain.blocks--;
+    return index;
+  }
+
+  Block blocks_[BlockCount];
+  Chain chains_[Channels];
+  uint16_t freeHead_;
+  uint32_t allocSeq_;
+};
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// 历史数据持久化格式
+// 段文件：HistSegmentHeader + 若干定长帧；同一段内传感器数量固定，帧长度固定，
+// 因此按帧序号可以直接定位，无需逐帧解析。
+#define HIST_SEGMENT_MAGIC 0x45534748   // "HGSE"
+#define HIST_SNAPSHOT_MAGIC 0x45534853  // "SHSE"
+#define HIST_FORMAT_VERSION 1
+
+struct HistSegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t sensorCount;   // 每帧的传感器数量
+  uint32_t firstSeq;      // 本段第一帧的序号
+};
+
+struct __attribute__((packed)) HistFrameHeader {
+  uint32_t seq;           // 帧序号（每个存储间隔加一）
+  uint32_t realTime;      // 写入时的真实时间（未同步时为0）
+};
+
+struct __attribute__((packed)) HistFrameEntry {
+  uint8_t address[8];     // 传感器序列号
+  int16_t sampleRaw;      // 12分钟历史样本（1/16°C）
+  int16_t minRaw;         // 12分钟汇总桶
+  int16_t maxRaw;
+  int16_t avgRaw;
+  uint16_t count;
+};
+
+struct HistSnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t sensorCount;
+  uint32_t seq;           // 快照包含到的帧序号
+  uint32_t entrySize;     // 每个传感器条目的字节数，布局变化时快照作废
+};
+
+#define HIST_FRAME_SIZE(sensorCount) (sizeof(HistFrameHeader) + (sensorCount) * sizeof(HistFrameEntry))
+
+// 历史帧的分段日志与快照存储，不涉及帧内容的含义。
+//
+// Fs/File 为文件系统类型：固件中为 fs::FS / fs::File（LittleFS），主机测试中为文件模拟的闪存。
+// 帧先攒在内存中，满 FlushFrames 帧后一次追加到当前段；段满 segmentSize 字节或传感器数量
+// 变化时新建段，最多保留 MaxSegments 段。快照先写临时文件再改名，断电时旧快照仍然完整。
+//
+// 断电可能留下不完整的帧：恢复时只统计完整的帧，末尾有残缺数据的段不再追加（否则之后的帧
+// 全部错位），下一帧写入新段；重放时校验帧头序号，错位的数据不会被当作历史读出。
+template <class Fs, class File, int MaxSensors, int MaxSegments, int FlushFrames>
+class HistoryStore {
+ public:
+  typedef void (*SnapshotFill)(int index, uint8_t* entry);
+  typedef void (*SnapshotApply)(const uint8_t* entry);
+
+  HistoryStore(Fs& fs, const char* dir, const char* snapshotFile, const char* snapshotTmp, uint32_t segmentSize)
+      : fs_(fs), dir_(dir), snapshotFile_(snapshotFile), snapshotTmp_(snapshotTmp), segmentSize_(segmentSize),
+        ready_(false), frameSeq_(0), snapshotSeq_(0), segmentFirstSeq_(0), segmentSensors_(0), segmentBytes_(0),
+        pendingFrames_(0), pendingSensors_(0), segmentCount_(0), writeFailures_(0) {}
+
+  // 文件系统挂载后调用
+  void begin() {
+    fs_.mkdir(dir_);
+    ready_ = true;
+  }
+
+  bool ready() const { return ready_; }
+  uint32_t frameSeq() const { return frameSeq_; }
+  uint32_t snapshotSeq() const { return snapshotSeq_; }
+  int pendingFrames() const { return pendingFrames_; }
+  int segmentCount() const { return segmentCount_; }
+  uint32_t writeFailures() const { return writeFailures_; }
+
+  // 追加一帧，返回待调用方填写的 sensorCount 个条目（帧头由存储填写）。
+  // 传感器数量变化或缓冲已满时先写出已有的帧
+  HistFrameEntry* addFrame(uint16_t sensorCount, uint32_t realTime) {
+    if (!ready_ || sensorCount == 0 || sensorCount > MaxSensors) {
+      return 0;
+    }
+    if (pendingFrames_ > 0 && (pendingSensors_ != sensorCount || pendingFrames_ >= FlushFrames)) {
+      flush();
+    }
+    pendingSensors_ = sensorCount;
+
+    uint8_t* frame = pending_ + pendingFrames_ * HIST_FRAME_SIZE(sensorCount);
+    HistFrameHeader header = {++frameSeq_, realTime};
+    memcpy(frame, &header, sizeof(header));
+    pendingFrames_++;
+    return (HistFrameEntry*)(frame + sizeof(header));
+  }
+
+  // 攒够 FlushFrames 帧时写入闪存
+  void commitFrames() {
+    if (pendingFrames_ >= FlushFrames) {
+      flush();
+    }
+  }
+
+  // 距上次快照已超过 frames 帧
+  bool snapshotDue(uint32_t frames) const { return frameSeq_ - snapshotSeq_ >= frames; }
+
+  // 将待写入的帧追加到当前段，返回是否完整写入
+  bool flush() {
+    if (!ready_ || pendingFrames_ == 0) {
+      return true;
+    }
+
+    size_t bytes = pendingFrames_ * HIST_FRAME_SIZE(pendingSensors_);
+    uint32_t firstSeq = frameSeq_ - pendingFrames_ + 1;
+    if (segmentSensors_ != pendingSensors_ || segmentBytes_ + bytes > segmentSize_) {
+      startSegment(firstSeq, pendingSensors_);
+    }
+
+    size_t written = 0;
+    if (segmentSensors_ != 0) {
+      char path[32];
+      File file = fs_.open(segmentPath(path, segmentFirstSeq_), "a");
+      written = file ? file.write(pending_, bytes) : 0;
+      if (file) {
+        file.close();
+      }
+    }
+    segmentBytes_ += written;
+    pendingFrames_ = 0;
+
+    if (written != bytes) {
+      // 写入失败或不完整，段内帧序号不再连续，下次写入新建段
+      segmentSensors_ = 0;
+      writeFailures_++;
+      return false;
+    }
+    return true;
+  }
+
+  // 保存快照：count 个 entrySize 字节的条目，依次由 fill 填入 entry 缓冲区。
+  // 临时文件完整写入后才改名替换旧快照
+  bool saveSnapshot(uint16_t count, uint8_t* entry, uint32_t entrySize, SnapshotFill fill) {
+    if (!ready_) {
+      return false;
+    }
+    flush();  // 快照之前的帧必须已经写入
+
+    File file = fs_.open(snapshotTmp_, "w");
+    if (!file) {
+      return false;
+    }
+    HistSnapshotHeader header = {HIST_SNAPSHOT_MAGIC, HIST_FORMAT_VERSION, count, frameSeq_, entrySize};
+    size_t expected = sizeof(header) + (size_t)count * entrySize;
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    for (int i = 0; i < count; i++) {
+      fill(i, entry);
+      written += file.write(entry, entrySize);
+    }
+    file.close();
+
+    if (written != expected || !fs_.rename(snapshotTmp_, snapshotFile_)) {
+      return false;
+    }
+    snapshotSeq_ = frameSeq_;
+    return true;
+  }
+
+  // 加载快照（需在 recover() 之后调用）：校验通过后才逐个交给 apply，
+  // 快照晚于日志中的最新帧时视为无效
+  bool loadSnapshot(uint8_t* entry, uint32_t entrySize, SnapshotApply apply) {
+    File file = fs_.open(snapshotFile_, "r");
+    if (!file) {
+      return false;
+    }
+
+    HistSnapshotHeader header;
+    bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                 header.magic == HIST_SNAPSHOT_MAGIC && header.version == HIST_FORMAT_VERSION &&
+                 header.entrySize == entrySize && header.seq <= frameSeq_ &&
+                 file.size() == sizeof(header) + (size_t)header.sensorCount * entrySize;
+    if (valid) {
+      for (int i = 0; i < header.sensorCount; i++) {
+        if (file.read(entry, entrySize) != entrySize) {
+          break;
+        }
+        apply(entry);
+      }
+      snapshotSeq_ = header.seq;
+    }
+    file.close();
+    return valid;
+  }
+
+  // 启动恢复：查找日志中最新的完整帧，返回其序号（无历史时为0）。
+  // 最新段完整且传感器数量与 sensorCount 相同时继续追加到该段
+  uint32_t recover(uint16_t sensorCount) {
+    segmentCount_ = listSegments(segments_, MaxSegments + 4);
+    segmentSensors_ = 0;
+    pendingFrames_ = 0;
+
+    uint32_t lastSeq = 0;
+    for (int s = segmentCount_ - 1; s >= 0; s--) {
+      char path[32];
+      File file = fs_.open(segmentPath(path, segments_[s]), "r");
+      if (!file) {
+        continue;
+      }
+      HistSegmentHeader header;
+      int frames = readSegmentHeader(file, header);
+      size_t size = file.size();
+      file.close();
+      if (frames <= 0) {
+        continue;
+      }
+      lastSeq = header.firstSeq + frames - 1;
+      size_t usedBytes = sizeof(header) + frames * HIST_FRAME_SIZE(header.sensorCount);
+      if (s == segmentCount_ - 1 && header.sensorCount == sensorCount && size == usedBytes) {
+        segmentFirstSeq_ = header.firstSeq;
+        segmentSensors_ = header.sensorCount;
+        segmentBytes_ = usedBytes;
+      }
+      break;
+    }
+
+    frameSeq_ = lastSeq;
+    snapshotSeq_ = lastSeq;  // 没有有效快照时从现在起计时，一天后再保存
+    return lastSeq;
+  }
+
+  // 按序号顺序读出 recover() 找到的段中从 startSeq 开始的帧。
+  // 帧数据读入存储的待写缓冲区，重放期间不能追加新帧
+  class Replay {
+   public:
+    Replay(HistoryStore& store, uint32_t startSeq)
+        : store_(store), startSeq_(startSeq), segment_(-1), file_(), sensorCount_(0), firstSeq_(0), frames_(0),
+          frame_(0), bytesRead_(0) {}
+    ~Replay() {
+      if (file_) {
+        file_.close();
+      }
+    }
+
+    bool next() {
+      while (true) {
+        if (file_ && frame_ < frames_) {
+          size_t frameSize = HIST_FRAME_SIZE(sensorCount_);
+          uint32_t seq = firstSeq_ + frame_;
+          if (file_.read(store_.pending_, frameSize) == frameSize && header().seq == seq) {
+            bytesRead_ += frameSize;
+            frame_++;
+            return true;
+          }
+          frame_ = frames_;  // 读取失败或序号错位，放弃本段剩余部分
+        }
+        if (!openSegment()) {
+          return false;
+        }
+      }
+    }
+
+    uint32_t seq() const { return firstSeq_ + frame_ - 1; }
+    uint16_t sensorCount() const { return sensorCount_; }
+    const HistFrameHeader& header() const { return *(const HistFrameHeader*)store_.pending_; }
+    const HistFrameEntry* entries() const {
+      return (const HistFrameEntry*)(store_.pending_ + sizeof(HistFrameHeader));
+    }
+    size_t bytesRead() const { return bytesRead_; }
+
+   private:
+    // 打开下一个包含 startSeq 之后帧的段，定长帧直接跳到起始帧
+    bool openSegment() {
+      if (file_) {
+        file_.close();
+      }
+      while (++segment_ < store_.segmentCount_) {
+        char path[32];
+        file_ = store_.fs_.open(store_.segmentPath(path, store_.segments_[segment_]), "r");
+        if (!file_) {
+          continue;
+        }
+        HistSegmentHeader header;
+        int frames = store_.readSegmentHeader(file_, header);
+        bytesRead_ += sizeof(header);
+        if (frames <= 0 || header.firstSeq + frames - 1 < startSeq_) {
+          file_.close();
+          continue;
+        }
+        sensorCount_ = header.sensorCount;
+        firstSeq_ = header.firstSeq;
+        frames_ = frames;
+        frame_ = startSeq_ > header.firstSeq ? startSeq_ - header.firstSeq : 0;
+        file_.seek(sizeof(header) + frame_ * HIST_FRAME_SIZE(sensorCount_));
+        return true;
+      }
+      return false;
+    }
+
+    HistoryStore& store_;
+    uint32_t startSeq_;
+    int segment_;
+    File file_;
+    uint16_t sensorCount_;
+    uint32_t firstSeq_;
+    uint32_t frames_;
+    uint32_t frame_;
+    size_t bytesRead_;
+  };
+
+ private:
+  // 段文件路径（文件名为首帧序号的16进制，按名称排序即按时间排序）
+  const char* segmentPath(char* path, uint32_t firstSeq) const {
+    snprintf(path, 32, "%s/%08lx.seg", dir_, (unsigned long)firstSeq);
+    return path;
+  }
+
+  // 列出所有段文件的首帧序号（升序），返回段数
+  int listSegments(uint32_t* firstSeqs, int maxSegments) {
+    int count = 0;
+    File dir = fs_.open(dir_, "r");
+    if (!dir || !dir.isDirectory()) {
+      return 0;
+    }
+
+    File file = dir.openNextFile();
+    while (file) {
+      const char* name = file.name();
+      const char* base = strrchr(name, '/');
+      base = base ? base + 1 : name;
+      unsigned long seq;
+      if (count < maxSegments && strlen(base) == 12 && strcmp(base + 8, ".seg") == 0 &&
+          sscanf(base, "%8lx", &seq) == 1) {
+        firstSeqs[count++] = seq;
+      }
+      file.close();
+      file = dir.openNextFile();
+    }
+    dir.close();
+
+    // 段数很少，插入排序即可
+    for (int i = 1; i < count; i++) {
+      uint32_t seq = firstSeqs[i];
+      int j = i - 1;
+      while (j >= 0 && firstSeqs[j] > seq) {
+        firstSeqs[j + 1] = firstSeqs[j];
+        j--;
+      }
+      firstSeqs[j + 1] = seq;
+    }
+    return count;
+  }
+
+  // 读取段头，返回段内完整帧的数量（段无效时返回-1，末尾不完整的帧被忽略）
+  int readSegmentHeader(File& file, HistSegmentHeader& header) {
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != HIST_SEGMENT_MAGIC ||
+        header.version != HIST_FORMAT_VERSION || header.sensorCount == 0 || header.sensorCount > MaxSensors) {
+      return -1;
+    }
+    return (file.size() - sizeof(header)) / HIST_FRAME_SIZE(header.sensorCount);
+  }
+
+  // 新建段文件，并删除超出数量上限的最旧段
+  void startSegment(uint32_t firstSeq, uint16_t sensorCount) {
+    HistSegmentHeader header = {HIST_SEGMENT_MAGIC, HIST_FORMAT_VERSION, sensorCount, firstSeq};
+    char path[32];
+    File file = fs_.open(segmentPath(path, firstSeq), "w");
+    if (!file) {
+      segmentSensors_ = 0;
+      return;
+    }
+    size_t written = file.write((const uint8_t*)&header, sizeof(header));
+    file.close();
+    if (written != sizeof(header)) {
+      segmentSensors_ = 0;
+      return;
+    }
+    segmentBytes_ = written;
+    segmentFirstSeq_ = firstSeq;
+    segmentSensors_ = sensorCount;
+
+    uint32_t segments[MaxSegments + 4];
+    int segmentCount = listSegments(segments, MaxSegments + 4);
+    for (int i = 0; i + MaxSegments < segmentCount; i++) {
+      fs_.remove(segmentPath(path, segments[i]));
+    }
+  }
+
+  Fs& fs_;
+  const char* dir_;
+  const char* snapshotFile_;
+  const char* snapshotTmp_;
+  uint32_t segmentSize_;
+  bool ready_;
+  uint32_t frameSeq_;         // 最新一帧的序号
+  uint32_t snapshotSeq_;      // 最近一次快照包含到的帧序号
+  uint32_t segmentFirstSeq_;  // 当前写入段的首帧序号
+  uint16_t segmentSensors_;   // 当前写入段的传感器数量（0表示需要新建段）
+  uint32_t segmentBytes_;     // 当前写入段的大小
+  uint8_t pending_[FlushFrames * HIST_FRAME_SIZE(MaxSensors)];  // 待写入的帧
+  int pendingFrames_;
+  uint16_t pendingSensors_;   // 待写入帧的传感器数量
+  uint32_t segments_[MaxSegments + 4];  // recover() 找到的段
+  int segmentCount_;
+  uint32_t writeFailures_;
+};
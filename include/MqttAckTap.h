@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+// 包装MQTT客户端使用的网络连接，原样转发所有读写，同时按MQTT报文格式解析读到的字节，
+// 从中取出 PUBACK 的报文标识符。PubSubClient 本身只支持 QoS0 发布并丢弃 PUBACK，
+// 由此可以在其之上实现 QoS1 发布的确认与重发，而无需修改库。
+class MqttAckTap : public Client {
+ public:
+  typedef void (*PubAckHandler)(uint16_t packetId);
+
+  explicit MqttAckTap(Client& inner) : inner_(inner), onPubAck_(NULL) { resetParser(); }
+
+  void onPubAck(PubAckHandler handler) { onPubAck_ = handler; }
+
+  // 新连接从报文边界开始解析
+  int connect(IPAddress ip, uint16_t port) override {
+    resetParser();
+    return inner_.connect(ip, port);
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    resetParser();
+    return inner_.connect(host, port);
+  }
+
+  size_t write(uint8_t value) override { return inner_.write(value); }
+  size_t write(const uint8_t* buffer, size_t size) override { return inner_.write(buffer, size); }
+  int available() override { return inner_.available(); }
+  int peek() override { return inner_.peek(); }
+  void flush() override { inner_.flush(); }
+  uint8_t connected() override { return inner_.connected(); }
+  operator bool() override { return (bool)inner_; }
+
+  void stop() override {
+    inner_.stop();
+    resetParser();
+  }
+
+  int read() override {
+    int value = inner_.read();
+    if (value >= 0) {
+      feed((uint8_t)value);
+    }
+    return value;
+  }
+
+  int read(uint8_t* buffer, size_t size) override {
+    int count = inner_.read(buffer, size);
+    for (int i = 0; i < count; i++) {
+      feed(buffer[i]);
+    }
+    return count;
+  }
+
+ private:
+  enum ParserState { PARSE_HEADER, PARSE_LENGTH, PARSE_BODY };
+
+  void resetParser() {
+    state_ = PARSE_HEADER;
+    type_ = 0;
+    remaining_ = 0;
+    lengthShift_ = 0;
+    bodyRead_ = 0;
+  }
+
+  void feed(uint8_t value) {
+    switch (state_) {
+      case PARSE_HEADER:
+        type_ = value >> 4;
+        remaining_ = 0;
+        lengthShift_ = 0;
+        state_ = PARSE_LENGTH;
+        break;
+      case PARSE_LENGTH:
+        remaining_ |= (uint32_t)(value & 0x7f) << lengthShift_;
+        lengthShift_ += 7;
+        if (value & 0x80) {
+          if (lengthShift_ > 21) {
+            resetParser();  // 剩余长度最多4字节，格式错误时从下一个字节重新同步
+          }
+          break;
+        }
+        bodyRead_ = 0;
+        if (remaining_ == 0) {
+          finishPacket();
+        } else {
+          state_ = PARSE_BODY;
+        }
+        break;
+      case PARSE_BODY:
+        if (bodyRead_ < sizeof(body_)) {
+          body_[bodyRead_] = value;
+        }
+        if (++bodyRead_ == remaining_) {
+          finishPacket();
+        }
+        break;
+    }
+  }
+
+  void finishPacket() {
+    // PUBACK：类型4，剩余长度2，内容为报文标识符
+    if (type_ == 4 && remaining_ == 2 && onPubAck_ != NULL) {
+      onPubAck_(((uint16_t)body_[0] << 8) | body_[1]);
+    }
+    state_ = PARSE_HEADER;
+  }
+
+  Client& inner_;
+  PubAckHandler onPubAck_;
+  ParserState state_;
+  uint8_t type_;
+  uint32_t remaining_;
+  uint8_t lengthShift_;
+  uint32_t bodyRead_;
+  uint8_t body_[2];
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// MQTT发送队列：固定数量的消息槽，不分配堆内存，只负责排队与确认状态，
+// 实际发送由调用方完成（nextToSend 取出消息，发送后调用 markSent）。
+//
+// 按入队顺序发送；QoS1 消息发送后保留在队列中直到 acknowledge()，
+// 超过重发间隔仍未确认时再次由 nextToSend 返回（此时应带 DUP 标志重发）。
+// 同时在途（已发送未确认）的 QoS1 消息数量不超过调用方给出的窗口。
+template <int Capacity, size_t TopicBytes, size_t PayloadBytes>
+class MqttOutbox {
+ public:
+  struct Message {
+    char topic[TopicBytes];
+    uint8_t payload[PayloadBytes];
+    uint16_t length;
+    uint8_t qos;
+    bool retain;
+    uint16_t packetId;    // 已发送的QoS1消息的报文标识符
+    uint8_t attempts;     // 已发送次数
+    unsigned long sentAt; // 最近一次发送的时间
+  };
+
+  MqttOutbox() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < Capacity; i++) {
+      state_[i] = SLOT_FREE;
+    }
+    size_ = 0;
+    inFlight_ = 0;
+    nextOrder_ = 0;
+    nextPacketId_ = 1;
+  }
+
+  // 入队，队列已满或主题/负载超出槽大小时返回 false
+  bool push(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) {
+    size_t topicLength = strlen(topic);
+    if (size_ == Capacity || topicLength >= TopicBytes || length > PayloadBytes) {
+      return false;
+    }
+    int slot = 0;
+    while (state_[slot] != SLOT_FREE) {
+      slot++;
+    }
+    Message& message = messages_[slot];
+    memcpy(message.topic, topic, topicLength + 1);
+    memcpy(message.payload, payload, length);
+    message.length = length;
+    message.qos = qos > 0 ? 1 : 0;
+    message.retain = retain;
+    message.packetId = 0;
+    message.attempts = 0;
+    message.sentAt = 0;
+    state_[slot] = SLOT_QUEUED;
+    order_[slot] = nextOrder_++;
+    size_++;
+    return true;
+  }
+
+  // 下一条需要发送的消息：优先重发已超时的在途消息，其次在窗口未满时发送最早入队的消息；
+  // 没有时返回 NULL。retransmit 返回是否为重发；QoS1 消息此时已分配报文标识符
+  Message* nextToSend(unsigned long now, int window, unsigned long retryMs, bool& retransmit) {
+    int oldest = -1;
+    for (int i = 0; i < Capacity; i++) {
+      if (state_[i] == SLOT_IN_FLIGHT && now - messages_[i].sentAt >= retryMs) {
+        retransmit = true;
+        return &messages_[i];
+      }
+      if (state_[i] == SLOT_QUEUED && (oldest < 0 || (int32_t)(order_[i] - order_[oldest]) < 0)) {
+        oldest = i;
+      }
+    }
+    if (oldest < 0 || (messages_[oldest].qos > 0 && inFlight_ >= window)) {
+      return NULL;
+    }
+    retransmit = false;
+    Message& message = messages_[oldest];
+    if (message.qos > 0 && message.packetId == 0) {
+      message.packetId = allocatePacketId();
+    }
+    return &message;
+  }
+
+  // 消息已写入连接：QoS0 消息移出队列，QoS1 消息进入在途状态等待确认
+  void markSent(Message& message, unsigned long now) {
+    int slot = &message - messages_;
+    if (message.qos == 0) {
+      release(slot);
+      return;
+    }
+    if (state_[slot] == SLOT_QUEUED) {
+      state_[slot] = SLOT_IN_FLIGHT;
+      inFlight_++;
+    }
+    message.attempts++;
+    message.sentAt = now;
+  }
+
+  // 丢弃一条消息（如多次重发仍未确认）
+  void drop(Message& message) { release(&message - messages_); }
+
+  // 收到 PUBACK，未找到对应的在途消息时返回 false
+  bool acknowledge(uint16_t packetId) {
+    for (int i = 0; i < Capacity; i++) {
+      if (state_[i] == SLOT_IN_FLIGHT && messages_[i].packetId == packetId) {
+        release(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 连接断开后，在途消息回到排队状态，重新连接后（新会话）作为新消息重发
+  void requeueInFlight() {
+    for (int i = 0; i < Capacity; i++) {
+      if (state_[i] == SLOT_IN_FLIGHT) {
+        state_[i] = SLOT_QUEUED;
+        messages_[i].packetId = 0;
+      }
+    }
+    inFlight_ = 0;
+  }
+
+  int size() const { return size_; }
+  int inFlight() const { return inFlight_; }
+  bool full() const { return size_ == Capacity; }
+
+ private:
+  enum SlotState : uint8_t { SLOT_FREE, SLOT_QUEUED, SLOT_IN_FLIGHT };
+
+  void release(int slot) {
+    if (state_[slot] == SLOT_IN_FLIGHT) {
+      inFlight_--;
+    }
+    if (state_[slot] != SLOT_FREE) {
+      size_--;
+    }
+    state_[slot] = SLOT_FREE;
+  }
+
+  // 报文标识符不能为0，也不能与队列中已分配的标识符重复
+  uint16_t allocatePacketId() {
+    for (;;) {
+      uint16_t id = nextPacketId_++;
+      if (nextPacketId_ == 0) {
+        nextPacketId_ = 1;
+      }
+      bool used = false;
+      for (int i = 0; i < Capacity; i++) {
+        if (state_[i] != SLOT_FREE && messages_[i].packetId == id) {
+          used = true;
+          break;
+        }
+      }
+      if (!used) {
+        return id;
+      }
+    }
+  }
+
+  Message messages_[Capacity];
+  SlotState state_[Capacity];
+  uint32_t order_[Capacity];  // 入队顺序
+  int size_;
+  int inFlight_;
+  uint32_t nextOrder_;
+  uint16_t nextPacketId_;
+};
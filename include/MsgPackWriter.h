@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+
+// MessagePack编码器，直接写入输出流（可配合 CountingPrint 计算长度、BufferedPrint 分块发送）。
+// 只实现负载需要的类型：map、array、str、int/uint、bool、nil，均选用最短的编码形式。
+// map/array 需要预先给出元素个数，随后依次写入元素（map为键、值交替）。
+class MsgPackWriter {
+ public:
+  explicit MsgPackWriter(Print& out) : out_(out) {}
+
+  void writeMap(uint16_t size) {
+    if (size < 16) {
+      writeByte(0x80 | size);
+    } else {
+      writeByte(0xde);
+      writeBE16(size);
+    }
+  }
+
+  void writeArray(uint16_t size) {
+    if (size < 16) {
+      writeByte(0x90 | size);
+    } else {
+      writeByte(0xdc);
+      writeBE16(size);
+    }
+  }
+
+  void writeString(const char* str) { writeString(str, strlen(str)); }
+
+  void writeString(const char* str, size_t length) {
+    if (length < 32) {
+      writeByte(0xa0 | length);
+    } else if (length < 256) {
+      writeByte(0xd9);
+      writeByte(length);
+    } else if (length < 65536) {
+      writeByte(0xda);
+      writeBE16(length);
+    } else {
+      writeByte(0xdb);
+      writeBE32(length);
+    }
+    out_.write((const uint8_t*)str, length);
+  }
+
+  void writeInt(int32_t value) {
+    if (value >= 0) {
+      // 非负数用无符号编码，128~255、32768~65535 比有符号编码各省一个字节
+      if (value < 128) {
+        writeByte(value);  // positive fixint
+      } else if (value < 256) {
+        writeByte(0xcc);
+        writeByte(value);
+      } else if (value < 65536) {
+        writeByte(0xcd);
+        writeBE16(value);
+      } else {
+        writeByte(0xce);
+        writeBE32(value);
+      }
+    } else if (value >= -32) {
+      writeByte((uint8_t)(int8_t)value);  // negative fixint
+    } else if (value >= -128) {
+      writeByte(0xd0);
+      writeByte((uint8_t)(int8_t)value);
+    } else if (value >= -32768) {
+      writeByte(0xd1);
+      writeBE16((uint16_t)(int16_t)value);
+    } else {
+      writeByte(0xd2);
+      writeBE32((uint32_t)value);
+    }
+  }
+
+  void writeUInt(uint64_t value) {
+    if (value <= 0x7fffffff) {
+      writeInt((int32_t)value);
+    } else if (value <= 0xffffffffULL) {
+      writeByte(0xce);
+      writeBE32((uint32_t)value);
+    } else {
+      writeByte(0xcf);
+      writeBE32((uint32_t)(value >> 32));
+      writeBE32((uint32_t)value);
+    }
+  }
+
+  void writeBool(bool value) { writeByte(value ? 0xc3 : 0xc2); }
+
+  void writeNil() { writeByte(0xc0); }
+
+ private:
+  void writeByte(uint8_t value) { out_.write(value); }
+
+  void writeBE16(uint16_t value) {
+    writeByte(value >> 8);
+    writeByte(value & 0xff);
+  }
+
+  void writeBE32(uint32_t value) {
+    writeBE16(value >> 16);
+    writeBE16(value & 0xffff);
+  }
+
+  Print& out_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <time.h>
+
+// 重复请求的负载缓存：不保存负载内容，只记录上次生成负载时的键、生成时间与长度。
+//
+// 负载由键（数据版本与请求参数）和生成时间完全决定，命中时用同一生成时间重新流式输出，
+// 得到与上次逐字节相同的内容，因此可以省去计算长度的一遍，直接写入带长度的报头。
+// 命中时负载中的时间为上次生成的时间。
+template <class Key>
+class PayloadCache {
+ public:
+  PayloadCache() : key_(), time_(0), length_(0), valid_(false) {}
+
+  // 键相同时返回上次的生成时间与长度
+  bool lookup(const Key& key, time_t& time, size_t& length) const {
+    if (!valid_ || !(key == key_)) {
+      return false;
+    }
+    time = time_;
+    length = length_;
+    return true;
+  }
+
+  void store(const Key& key, time_t time, size_t length) {
+    key_ = key;
+    time_ = time;
+    length_ = length;
+    valid_ = true;
+  }
+
+  // 输出与记录的长度不一致（不应发生）时作废，下次重新计算
+  void invalidate() { valid_ = false; }
+
+  bool valid() const { return valid_; }
+
+ private:
+  Key key_;
+  time_t time_;
+  size_t length_;
+  bool valid_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "StreamPrint.h"
+
+// 识别服务器回送的自己发布的消息。MQTT 3.1.1 没有 No Local 选项，发布主题与订阅主题相同时
+// 设备会收到自己发布的每条消息（JSON、MessagePack 或任意内容），不能靠负载的首字节区分。
+// 发布成功后记录负载的长度和哈希，收到的消息与某条记录相同时消耗该记录并忽略消息。
+// 记录在 timeoutMs 后过期（回送丢失或被服务器丢弃时不会一直占用），容量满时覆盖最旧的记录。
+template <int Capacity>
+class PublishEchoFilter {
+ public:
+  PublishEchoFilter() : next_(0) { clear(); }
+
+  void clear() {
+    for (int i = 0; i < Capacity; i++) {
+      entries_[i].used = false;
+    }
+  }
+
+  void record(size_t length, uint32_t hash, unsigned long now) {
+    Entry& entry = entries_[next_];
+    entry.length = length;
+    entry.hash = hash;
+    entry.at = now;
+    entry.used = true;
+    next_ = (next_ + 1) % Capacity;
+  }
+
+  // 收到的消息是否为尚未过期的自己发布的消息；是则消耗对应记录
+  bool consume(const uint8_t* payload, size_t length, unsigned long now, unsigned long timeoutMs) {
+    bool hashed = false;
+    uint32_t hash = 0;
+    for (int i = 0; i < Capacity; i++) {
+      Entry& entry = entries_[i];
+      if (!entry.used) {
+        continue;
+      }
+      if (now - entry.at > timeoutMs) {
+        entry.used = false;
+        continue;
+      }
+      if (entry.length != length) {
+        continue;
+      }
+      if (!hashed) {
+        hash = HashingPrint::update(HashingPrint::SEED, payload, length);
+        hashed = true;
+      }
+      if (entry.hash == hash) {
+        entry.used = false;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 尚未收到回送的记录数
+  int pending() const {
+    int count = 0;
+    for (int i = 0; i < Capacity; i++) {
+      count += entries_[i].used ? 1 : 0;
+    }
+    return count;
+  }
+
+ private:
+  struct Entry {
+    size_t length;
+    uint32_t hash;
+    unsigned long at;
+    bool used;
+  };
+
+  Entry entries_[Capacity];
+  int next_;
+};
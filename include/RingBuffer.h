@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+
+// 固定容量环形缓冲区，写满后覆盖最旧的元素。
+//
+// 下标访问、迭代器均按时间顺序（0为最旧），调用方无需关心写入位置，也无需复制数据；
+// 需要整段拷贝时可通过 segments() 取得按时间顺序排列的两段连续内存。
+// 物理位置（slot）接口供需要记住元素存放位置的增量算法使用。
+template <typename T, int Capacity>
+class RingBuffer {
+ public:
+  static const int CAPACITY = Capacity;
+
+  // 迭代器只保存逻辑下标，取值时换算物理位置（与下标访问相同），
+  // 递增与比较都只涉及一个整数
+  class const_iterator {
+   public:
+    const_iterator(const T* data, int head, int index) : data_(data), head_(head), index_(index) {}
+
+    const T& operator*() const {
+      int slot = head_ + index_;
+      return data_[slot >= Capacity ? slot - Capacity : slot];
+    }
+    const T* operator->() const { return &**this; }
+
+    const_iterator& operator++() {
+      index_++;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+    bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+   private:
+    const T* data_;
+    int head_;   // 最旧元素的物理位置
+    int index_;  // 当前元素的逻辑下标（0为最旧），到达end时为size()
+  };
+
+  RingBuffer() : head_(0), count_(0) {}
+
+  void clear() {
+    head_ = 0;
+    count_ = 0;
+  }
+
+  int size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  bool full() const { return count_ == Capacity; }
+
+  // 下一次写入的物理位置；缓冲区已满时即为最旧元素所在位置
+  int nextSlot() const {
+    int slot = head_ + count_;
+    return slot >= Capacity ? slot - Capacity : slot;
+  }
+
+  // 写入新元素，返回写入的物理位置
+  int push(const T& value) {
+    int slot = nextSlot();
+    data_[slot] = value;
+    if (count_ < Capacity) {
+      count_++;
+    } else if (++head_ == Capacity) {
+      head_ = 0;
+    }
+    return slot;
+  }
+
+  // 移除最旧的元素（缓冲区为空时不做任何事）
+  void pop() {
+    if (count_ == 0) {
+      return;
+    }
+    if (++head_ == Capacity) {
+      head_ = 0;
+    }
+    count_--;
+  }
+
+  // 按物理位置访问
+  const T& slot(int physical) const { return data_[physical]; }
+
+  // 按时间顺序访问，0为最旧，size()-1为最新
+  const T& operator[](int index) const {
+    int slot = head_ + index;
+    return data_[slot >= Capacity ? slot - Capacity : slot];
+  }
+
+  const T& oldest() const { return data_[head_]; }
+  const T& newest() const { return (*this)[count_ - 1]; }
+
+  const_iterator begin() const { return const_iterator(data_, head_, 0); }
+  const_iterator end() const { return const_iterator(data_, head_, count_); }
+
+  // 按时间顺序的两段连续内存：先 first[0..firstLen)，再 second[0..secondLen)
+  void segments(const T*& first, int& firstLen, const T*& second, int& secondLen) const {
+    first = &data_[head_];
+    second = data_;
+    if (head_ + count_ <= Capacity) {
+      firstLen = count_;
+      secondLen = 0;
+    } else {
+      firstLen = Capacity - head_;
+      secondLen = count_ - firstLen;
+    }
+  }
+
+ private:
+  T data_[Capacity];
+  int head_;   // 最旧元素的物理位置
+  int count_;  // 当前元素数量
+};
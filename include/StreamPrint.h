@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+
+// 只统计写入字节数的输出流，用于在真正发送前计算负载长度
+class CountingPrint : public Print {
+ public:
+  CountingPrint() : length_(0) {}
+
+  size_t write(uint8_t) override {
+    length_++;
+    return 1;
+  }
+
+  size_t write(const uint8_t*, size_t size) override {
+    length_ += size;
+    return size;
+  }
+
+  size_t length() const { return length_; }
+
+ private:
+  size_t length_;
+};
+
+// 写入调用方提供的固定缓冲区的输出流，超出容量的部分丢弃并记为溢出
+class FixedBufferPrint : public Print {
+ public:
+  FixedBufferPrint(uint8_t* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity), length_(0), overflowed_(false) {}
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t take = capacity_ - length_;
+    if (take < size) {
+      overflowed_ = true;
+    } else {
+      take = size;
+    }
+    memcpy(buffer_ + length_, data, take);
+    length_ += take;
+    return take;
+  }
+
+  size_t length() const { return length_; }
+
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  uint8_t* buffer_;
+  size_t capacity_;
+  size_t length_;
+  bool overflowed_;
+};
+
+// 带固定大小缓冲区的输出流：攒满 BufferSize 字节后一次性写入目标流，
+// 避免逐字节写入网络连接，内存占用与负载总长度无关。
+// 写完后必须调用 flush() 写出剩余数据。
+template <size_t BufferSize>
+class BufferedPrint : public Print {
+ public:
+  explicit BufferedPrint(Print& target) : target_(target), used_(0), written_(0), failed_(false) {}
+
+  size_t write(uint8_t value) override {
+    if (used_ == BufferSize) {
+      flush();
+    }
+    buffer_[used_++] = value;
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t remaining = size;
+    while (remaining > 0) {
+      if (used_ == BufferSize) {
+        flush();
+      }
+      size_t take = BufferSize - used_;
+      if (take > remaining) {
+        take = remaining;
+      }
+      memcpy(buffer_ + used_, data, take);
+      used_ += take;
+      data += take;
+      remaining -= take;
+    }
+    return size;
+  }
+
+  void flush() {
+    if (used_ == 0) {
+      return;
+    }
+    size_t sent = target_.write(buffer_, used_);
+    if (sent != used_) {
+      failed_ = true;
+    }
+    written_ += sent;
+    used_ = 0;
+  }
+
+  // 已写入目标流的字节数
+  size_t written() const { return written_; }
+
+  // 目标流是否曾写入不完整
+  bool failed() const { return failed_; }
+
+ private:
+  Print& target_;
+  uint8_t buffer_[BufferSize];
+  size_t used_;
+  size_t written_;
+  bool failed_;
+};
+
+// 转发到目标流的同时计算写入内容的 FNV-1a 哈希，用于识别服务器回送的自己发布的负载
+class HashingPrint : public Print {
+ public:
+  static const uint32_t SEED = 2166136261u;
+
+  explicit HashingPrint(Print& target) : target_(target), hash_(SEED) {}
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    size_t sent = target_.write(buffer, size);
+    hash_ = update(hash_, buffer, sent);
+    return sent;
+  }
+
+  uint32_t hash() const { return hash_; }
+
+  static uint32_t update(uint32_t hash, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+  }
+
+ private:
+  Print& target_;
+  uint32_t hash_;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stdint.h>
+
+// 协作式定时任务调度：任务按截止时间存放在固定容量的最小堆中，不分配堆内存。
+// run() 只执行已到期的任务，timeUntilNext() 给出距离最近一个截止时间的毫秒数，
+// 主循环可据此在空闲时让出CPU。
+//
+// 时间为 millis() 这样会回绕的32位毫秒计数，比较时取差值的符号，
+// 要求所有截止时间与当前时间相差不超过约24天。
+// 周期任务在执行前重新排入下一周期，任务函数中可以调用 schedule() 改为其他时间；
+// 单次任务执行后移出堆，再次 schedule() 即可重新启用。
+template <int Capacity>
+class TaskScheduler {
+ public:
+  typedef void (*TaskFunction)();
+
+  TaskScheduler() : count_(0), heapSize_(0) {}
+
+  // 注册周期任务，首次在 now + firstDelay 执行；任务已满时返回 -1
+  int every(unsigned long periodMs, TaskFunction function, unsigned long now, unsigned long firstDelay = 0) {
+    int id = add(function, periodMs);
+    if (id >= 0) {
+      schedule(id, firstDelay, now);
+    }
+    return id;
+  }
+
+  // 注册单次任务，注册时不排期，由 schedule() 启用
+  int once(TaskFunction function) { return add(function, 0); }
+
+  // 让任务在 now + delayMs 执行（已排期的任务改为新的时间）
+  void schedule(int id, unsigned long delayMs, unsigned long now) {
+    if (id < 0 || id >= count_) {
+      return;
+    }
+    tasks_[id].deadline = now + delayMs;
+    if (tasks_[id].heapIndex < 0) {
+      tasks_[id].heapIndex = heapSize_;
+      heap_[heapSize_++] = id;
+    }
+    siftUp(tasks_[id].heapIndex);
+    siftDown(tasks_[id].heapIndex);
+  }
+
+  // 取消排期（周期任务也会停止，直到再次 schedule()）
+  void cancel(int id) {
+    if (id < 0 || id >= count_ || tasks_[id].heapIndex < 0) {
+      return;
+    }
+    removeAt(tasks_[id].heapIndex);
+  }
+
+  bool scheduled(int id) const { return id >= 0 && id < count_ && tasks_[id].heapIndex >= 0; }
+
+  // 执行所有已到期的任务，返回执行的任务数。
+  // 先取出本轮到期的全部任务再依次执行，任务中把自己排到当前时间时留到下一轮，每个任务每轮最多执行一次
+  int run(unsigned long now) {
+    int due[Capacity];
+    int dueCount = 0;
+    while (heapSize_ > 0 && (long)(now - tasks_[heap_[0]].deadline) >= 0) {
+      int id = heap_[0];
+      Task& task = tasks_[id];
+      if (task.periodMs > 0) {
+        // 落后超过一个周期时不补执行，从现在起重新计时
+        unsigned long next = task.deadline + task.periodMs;
+        if ((long)(now - next) >= 0) {
+          next = now + task.periodMs;
+        }
+        task.deadline = next;
+        siftDown(0);
+      } else {
+        removeAt(0);
+      }
+      due[dueCount++] = id;
+    }
+    for (int i = 0; i < dueCount; i++) {
+      tasks_[due[i]].function();
+    }
+    return dueCount;
+  }
+
+  // 距离最近一个截止时间的毫秒数，已到期时为0，没有排期的任务时返回 idleMs
+  unsigned long timeUntilNext(unsigned long now, unsigned long idleMs) const {
+    if (heapSize_ == 0) {
+      return idleMs;
+    }
+    long remaining = (long)(tasks_[heap_[0]].deadline - now);
+    return remaining > 0 ? (unsigned long)remaining : 0;
+  }
+
+ private:
+  struct Task {
+    TaskFunction function;
+    unsigned long periodMs;  // 0 为单次任务
+    unsigned long deadline;
+    int heapIndex;           // 在堆中的位置，-1 表示未排期
+  };
+
+  int add(TaskFunction function, unsigned long periodMs) {
+    if (count_ == Capacity) {
+      return -1;
+    }
+    Task& task = tasks_[count_];
+    task.function = function;
+    task.periodMs = periodMs;
+    task.deadline = 0;
+    task.heapIndex = -1;
+    return count_++;
+  }
+
+  bool before(int a, int b) const { return (long)(tasks_[heap_[a]].deadline - tasks_[heap_[b]].deadline) < 0; }
+
+  void swap(int a, int b) {
+    int id = heap_[a];
+    heap_[a] = heap_[b];
+    heap_[b] = id;
+    tasks_[heap_[a]].heapIndex = a;
+    tasks_[heap_[b]].heapIndex = b;
+  }
+
+  void siftUp(int index) {
+    while (index > 0 && before(index, (index - 1) / 2)) {
+      swap(index, (index - 1) / 2);
+      index = (index - 1) / 2;
+    }
+  }
+
+  void siftDown(int index) {
+    for (;;) {
+      int smallest = index;
+      int left = index * 2 + 1;
+      if (left < heapSize_ && before(left, smallest)) {
+        smallest = left;
+      }
+      if (left + 1 < heapSize_ && before(left + 1, smallest)) {
+        smallest = left + 1;
+      }
+      if (smallest == index) {
+        return;
+      }
+      swap(index, smallest);
+      index = smallest;
+    }
+  }
+
+  void removeAt(int index) {
+    int id = heap_[index];
+    heapSize_--;
+    if (index != heapSize_) {
+      heap_[index] = heap_[heapSize_];
+      tasks_[heap_[index]].heapIndex = index;
+      siftUp(index);
+      siftDown(index);
+    }
+    tasks_[id].heapIndex = -1;
+  }
+
+  Task tasks_[Capacity];
+  int heap_[Capacity];
+  int count_;
+  int heapSize_;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include "RingBuffer.h"
+
+// 离线遥测缓存：内存环形队列 + 闪存溢出文件，保证按采集顺序补发。
+//
+// Entry 为定长的条目（按字节写入闪存，只在本次启动内有效）；Fs/File 为文件系统类型：
+// 固件中为 fs::FS / fs::File（LittleFS），主机测试中为内存模拟的文件系统。
+// 发布由调用方的 Send 回调完成，返回 false 表示发布失败（条目保留，之后重试）。
+//
+// 内存队列已满时最旧的条目追加到溢出文件（最多 spillMax 条），文件不可用或已满时丢弃；
+// 溢出文件中的条目总是早于内存队列中的条目，补发时先读文件再取队列。
+template <class Entry, int QueueSize, class Fs, class File>
+class TelemetrySpool {
+ public:
+  typedef bool (*Send)(const Entry& entry, unsigned long now);
+
+  TelemetrySpool(Fs& fs, const char* spillFile, uint32_t spillMax)
+      : fs_(fs), spillFile_(spillFile), spillMax_(spillMax), spillEnabled_(false), spillCount_(0), spillRead_(0),
+        dropped_(0) {}
+
+  // 文件系统挂载后调用，启用溢出文件。上次运行未补发的条目（采集时刻只在本次启动内有效）丢弃
+  void begin() {
+    if (fs_.exists(spillFile_)) {
+      fs_.remove(spillFile_);
+    }
+    spillEnabled_ = true;
+  }
+
+  uint32_t queued() const { return queue_.size(); }
+  uint32_t spilled() const { return spillCount_ - spillRead_; }
+  uint32_t dropped() const { return dropped_; }
+  bool empty() const { return queue_.empty() && spillRead_ >= spillCount_; }
+
+  // 新采集的条目：已连接且没有积压时直接发布，否则进入缓存（保持顺序）。
+  // 返回 false 表示缓存已满而丢弃了最旧的条目
+  bool submit(const Entry& entry, bool connected, Send send, unsigned long now) {
+    if (connected && empty() && send(entry, now)) {
+      return true;
+    }
+    return enqueue(entry);
+  }
+
+  // 条目进入缓存；内存队列已满时最旧的条目转存到闪存，无法转存时丢弃并返回 false
+  bool enqueue(const Entry& entry) {
+    bool kept = true;
+    if (queue_.full()) {
+      const Entry& oldest = queue_.oldest();
+      bool spilled = false;
+      if (spillEnabled_ && spillCount_ < spillMax_) {
+        File file = fs_.open(spillFile_, "a");
+        if (file) {
+          spilled = file.write((const uint8_t*)&oldest, sizeof(oldest)) == sizeof(oldest);
+          file.close();
+        }
+      }
+      if (spilled) {
+        spillCount_++;
+      } else {
+        dropped_++;
+        kept = false;
+      }
+    }
+    queue_.push(entry);  // 队列已满时覆盖最旧的条目
+    return kept;
+  }
+
+  // 补发一批：最多 batch 条，先补发闪存中的（较旧）条目，再补发内存队列；
+  // 发布失败时停止，下批重试。返回本批发布的条目数
+  int drain(int batch, Send send, unsigned long now) {
+    int sent = 0;
+    File file;
+    while (sent < batch) {
+      Entry entry;
+      if (spillRead_ < spillCount_) {
+        if (!file) {
+          file = fs_.open(spillFile_, "r");
+          if (file) {
+            file.seek(spillRead_ * sizeof(Entry));
+          }
+        }
+        if (!file || file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) {
+          // 缓存文件损坏或丢失，放弃其中剩余的条目
+          dropped_ += spillCount_ - spillRead_;
+          spillRead_ = spillCount_;
+        } else if (send(entry, now)) {
+          spillRead_++;
+          sent++;
+        } else {
+          break;
+        }
+      } else if (!queue_.empty() && send(queue_.oldest(), now)) {
+        queue_.pop();
+        sent++;
+      } else {
+        break;
+      }
+    }
+    if (file) {
+      file.close();
+    }
+
+    // 闪存缓存已全部补发，删除文件
+    if (spillCount_ > 0 && spillRead_ >= spillCount_) {
+      fs_.remove(spillFile_);
+      spillCount_ = 0;
+      spillRead_ = 0;
+    }
+    return sent;
+  }
+
+ private:
+  Fs& fs_;
+  const char* spillFile_;
+  uint32_t spillMax_;
+  bool spillEnabled_;
+  RingBuffer<Entry, QueueSize> queue_;
+  uint32_t spillCount_;  // 溢出文件中的条目数
+  uint32_t spillRead_;   // 溢出文件中已补发的条目数
+  uint32_t dropped_;     // 缓存已满或文件损坏而丢弃的条目数
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <math.h>
+
+#ifndef DEVICE_DISCONNECTED_C
+#define DEVICE_DISCONNECTED_C -127  // 与 DallasTemperature 的定义相同
+#endif
+
+// 遥测发布时机：死区判断、变化合并窗口、变化发布的最小间隔与定时全量发布。
+//
+// 每通道的上次发布值与待发布标记由调用方保存（传感器注册表），这里只保存时间状态：
+// 任一通道超出死区时打开合并窗口，窗口结束且距上次发布超过最小间隔时发布变化的通道，
+// 一轮分批读取中先后超出死区的通道合并为一条消息；距上次全量发布超过周期时发布全部通道。
+class TelemetryTrigger {
+ public:
+  enum Due { DUE_NONE, DUE_CHANGES, DUE_FULL };
+
+  TelemetryTrigger(unsigned long intervalMs, unsigned long coalesceMs, unsigned long minIntervalMs, float deadband)
+      : intervalMs_(intervalMs), coalesceMs_(coalesceMs), minIntervalMs_(minIntervalMs), deadband_(deadband),
+        lastTime_(0), lastFullTime_(0), windowStart_(0), windowOpen_(false), started_(false) {}
+
+  // 当前值相对上次发布值超出死区，或连接状态变化
+  bool changed(float current, float published) const {
+    bool currentValid = current != DEVICE_DISCONNECTED_C;
+    bool publishedValid = published != DEVICE_DISCONNECTED_C;
+    return currentValid != publishedValid || (currentValid && fabs(current - published) >= deadband_);
+  }
+
+  // 有通道需要发布，窗口未打开时从现在开始计时
+  void markChanged(unsigned long now) {
+    if (!windowOpen_) {
+      windowOpen_ = true;
+      windowStart_ = now;
+    }
+  }
+
+  // 现在是否应当发布，以及发布全部通道还是只发布变化的通道
+  Due due(unsigned long now) const {
+    if (!started_ || now - lastFullTime_ >= intervalMs_) {
+      return DUE_FULL;
+    }
+    if (windowOpen_ && now - windowStart_ >= coalesceMs_ && now - lastTime_ >= minIntervalMs_) {
+      return DUE_CHANGES;
+    }
+    return DUE_NONE;
+  }
+
+  // 已采集发布快照（直接发布或进入离线缓存），关闭合并窗口
+  void published(unsigned long now, bool full) {
+    windowOpen_ = false;
+    lastTime_ = now;
+    if (full) {
+      lastFullTime_ = now;
+      started_ = true;
+    }
+  }
+
+  bool windowOpen() const { return windowOpen_; }
+
+ private:
+  unsigned long intervalMs_;
+  unsigned long coalesceMs_;
+  unsigned long minIntervalMs_;
+  float deadband_;
+  unsigned long lastTime_;      // 上次发布时间
+  unsigned long lastFullTime_;  // 上次全量发布时间
+  unsigned long windowStart_;   // 当前合并窗口的开始时间
+  bool windowOpen_;             // 是否有待发布的变化
+  bool started_;                // 是否已进行过全量发布
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdint.h>
+
+// DS18B20 总线接口：固件中由 DallasTemperature 适配，主机测试中由模拟总线实现
+class TempSensorBus {
+ public:
+  virtual ~TempSensorBus() {}
+
+  // 向总线上所有传感器发出转换命令（Skip ROM + Convert T），不等待转换完成
+  virtual void requestConversion() = 0;
+
+  // 转换是否已完成（读时隙返回1）；寄生供电时总线始终读到1，不可用
+  virtual bool conversionComplete() = 0;
+
+  // 按缓存的序列号读取一个传感器（Match ROM + 读暂存器），失败返回 DEVICE_DISCONNECTED_C
+  virtual float readTemperature(const uint8_t* address) = 0;
+};
+
+// 非阻塞温度采集状态机：空闲 -> 发起转换 -> 等待转换完成 -> 分批读取。
+//
+// 每次 step() 只推进一步并立即返回：发起转换、查询一次完成状态都只占用一次总线操作；
+// 转换截止时间 = 分辨率对应的最长转换时间 + 余量，能查询完成状态时提前进入读取阶段。
+// 读取阶段按时间预算分批：按上一次读取的实际耗时预估，下一个读取会超出预算时留到下一次
+// step()（每次至少读一个传感器，保证推进）；读取耗时稳定时单次调用不超过预算，
+// 单个读取本身超过预算时每次调用只读一个。
+//
+// 读数通过 onReading() 注册的回调交给调用方，同一次 step() 中的读数使用相同的时间。
+class TempAcquisition {
+ public:
+  enum State {
+    IDLE,        // 空闲，等待下一个采集周期
+    CONVERTING,  // 已发出转换命令，等待转换完成
+    READING      // 转换完成，分批读取各传感器
+  };
+
+  enum Event {
+    NONE,      // 无状态变化或仍在进行中
+    STARTED,   // 本次调用发起了新一轮转换
+    FINISHED   // 本次调用读完了本轮所有传感器
+  };
+
+  typedef unsigned long (*Clock)();
+  typedef void (*ReadingHandler)(int index, float tempC, unsigned long readTime);
+
+  TempAcquisition(TempSensorBus& bus, Clock clock, unsigned long marginMs, unsigned long minPollMs,
+                  unsigned long readBudgetMs)
+      : bus_(bus), clock_(clock), handler_(0), marginMs_(marginMs), minPollMs_(minPollMs),
+        readBudgetMs_(readBudgetMs), conversionMs_(750), pollConversion_(true), state_(IDLE),
+        lastStart_(0), deadline_(0), readIndex_(0), readCostMs_(0) {}
+
+  // 按当前分辨率的最长转换时间（9位94ms ... 12位750ms）及能否查询完成状态设置
+  void configure(unsigned long conversionMs, bool pollConversion) {
+    conversionMs_ = conversionMs;
+    pollConversion_ = pollConversion;
+  }
+
+  void onReading(ReadingHandler handler) { handler_ = handler; }
+
+  // 下一轮转换从 now + intervalMs 开始（启动时已单独完成了一次转换）
+  void restart(unsigned long now) {
+    state_ = IDLE;
+    lastStart_ = now;
+  }
+
+  // 推进一步。addresses/count 为当前的传感器序列号，读取阶段中不应改变
+  Event step(unsigned long intervalMs, const uint8_t (*addresses)[8], int count) {
+    unsigned long now = clock_();
+    switch (state_) {
+      case IDLE:
+        if (now - lastStart_ < intervalMs) {
+          return NONE;
+        }
+        bus_.requestConversion();
+        lastStart_ = now;
+        deadline_ = now + conversionMs_ + marginMs_;
+        readIndex_ = 0;
+        state_ = CONVERTING;
+        return STARTED;
+
+      case CONVERTING:
+        // 寄生供电模式下无法查询转换状态，只能依赖截止时间
+        if ((long)(now - deadline_) < 0 &&
+            !(pollConversion_ && now - lastStart_ >= minPollMs_ && bus_.conversionComplete())) {
+          return NONE;
+        }
+        state_ = READING;  // 读取从下一次调用开始，本次只占用一次查询
+        return NONE;
+
+      case READING:
+        return readBatch(now, addresses, count);
+    }
+    return NONE;
+  }
+
+  // 距下一次需要调用 step() 的时间：空闲时等到下一轮，转换中每 minPollMs 查询一次
+  // （寄生供电时直接等到截止时间），读取中立即继续
+  unsigned long nextDelay(unsigned long now, unsigned long intervalMs) const {
+    if (state_ == IDLE) {
+      unsigned long elapsed = now - lastStart_;
+      return elapsed >= intervalMs ? 0 : intervalMs - elapsed;
+    }
+    if (state_ == CONVERTING) {
+      long untilDeadline = (long)(deadline_ - now);
+      unsigned long delayMs = untilDeadline <= 0 ? 0 : (unsigned long)untilDeadline;
+      if (pollConversion_ && delayMs > minPollMs_) {
+        delayMs = minPollMs_;
+      }
+      return delayMs;
+    }
+    return 0;
+  }
+
+  State state() const { return state_; }
+  unsigned long lastStart() const { return lastStart_; }
+  unsigned long conversionMs() const { return conversionMs_; }
+  bool pollConversion() const { return pollConversion_; }
+  unsigned long readCostMs() const { return readCostMs_; }
+
+ private:
+  Event readBatch(unsigned long readTime, const uint8_t (*addresses)[8], int count) {
+    unsigned long batchStart = clock_();
+    bool first = true;
+    while (readIndex_ < count) {
+      if (!first && clock_() - batchStart + readCostMs_ > readBudgetMs_) {
+        return NONE;  // 下一个读取会超出预算，留到下一次调用
+      }
+      unsigned long readStart = clock_();
+      float tempC = bus_.readTemperature(addresses[readIndex_]);
+      if (handler_ != 0) {
+        handler_(readIndex_, tempC, readTime);
+      }
+      readCostMs_ = clock_() - readStart;  // 含回调处理的耗时
+      readIndex_++;
+      first = false;
+    }
+    state_ = IDLE;
+    return FINISHED;
+  }
+
+  TempSensorBus& bus_;
+  Clock clock_;
+  ReadingHandler handler_;
+  unsigned long marginMs_;
+  unsigned long minPollMs_;
+  unsigned long readBudgetMs_;
+  unsigned long conversionMs_;
+  bool pollConversion_;
+  State state_;
+  unsigned long lastStart_;
+  unsigned long deadline_;
+  int readIndex_;
+  unsigned long readCostMs_;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "RingBuffer.h"
+
+#ifndef DEVICE_DISCONNECTED_C
+#define DEVICE_DISCONNECTED_C -127  // 与 DallasTemperature 的定义相同
+#endif
+
+// 历史样本定点格式：DS18B20读数量化为1/16°C，以int16存储
+#define TEMP_RAW_SCALE 16          // 每摄氏度的原始单位数
+#define TEMP_RAW_INVALID INT16_MIN // 未连接/缺失样本的哨兵值
+
+inline int16_t tempToRaw(float temp) {
+  if (temp == DEVICE_DISCONNECTED_C) {
+    return TEMP_RAW_INVALID;
+  }
+  return (int16_t)lroundf(temp * TEMP_RAW_SCALE);
+}
+
+inline float rawToTemp(int16_t raw) {
+  if (raw == TEMP_RAW_INVALID) {
+    return DEVICE_DISCONNECTED_C;
+  }
+  return (float)raw / TEMP_RAW_SCALE;
+}
+
+// 统计队列下标类型，记录数不超过256时使用单字节
+template <bool Small>
+struct RecordIndexType {
+  typedef uint8_t type;
+};
+template <>
+struct RecordIndexType<false> {
+  typedef uint16_t type;
+};
+
+// 温度记录结构，容量为 Capacity 个样本，样本间隔为 IntervalMs 毫秒
+// 样本存放在环形缓冲区中，tempAt/timestampAt 按时间顺序访问（0为最旧）。
+// 样本按 IntervalMs 等间隔存储，只保存最新样本的时间戳，其余样本的
+// 时间戳按间隔推算；缺失或未连接的样本以TEMP_RAW_INVALID占位，保证间隔不变。
+// 每个样本的历史数据占 2 字节（原格式为 4 字节温度 + 4 字节时间戳），另有两个统计
+// 队列下标（Capacity 不超过 256 时各 1 字节），合计每样本 4 字节。
+//
+// minTemp/maxTemp/avgTemp 为环形缓冲区窗口内的统计值，插入时增量维护：
+// 平均值使用整数运行和（1/16°C，无累计误差），最小/最大值使用单调队列，
+// 每次插入均摊O(1)，与记录数量无关。
+template <int Capacity, unsigned long IntervalMs>
+struct TempRecordT {
+  typedef typename RecordIndexType<(Capacity <= 256)>::type RecordIndex;
+  
+  RingBuffer<int16_t, Capacity> samples;  // 温度样本（1/16°C）
+  unsigned long lastTimestamp;   // 最新样本的时间戳（毫秒）
+  uint32_t lastSeq;  // 最新样本的序号，第index个样本的序号为 lastSeq - (count() - 1 - index)
+  float minTemp;    // 最小温度
+  float maxTemp;    // 最大温度
+  float avgTemp;    // 平均温度
+  unsigned long lastStatsUpdate;  // 上次统计数据更新时间（millis()，输出时换算为真实时间）
+  
+  // 增量统计状态
+  int32_t sumRaw;    // 窗口内有效温度之和（1/16°C）
+  int validCount;    // 窗口内有效温度数量
+  RecordIndex minQueue[Capacity];  // 单调递增队列（存放记录下标），队首为最小值
+  RecordIndex maxQueue[Capacity];  // 单调递减队列（存放记录下标），队首为最大值
+  int minHead, minCount;
+  int maxHead, maxCount;
+  
+  // 当前记录数量
+  int count() const {
+    return samples.size();
+  }
+  
+  // 读取第index个样本（按时间顺序）的温度，缺失样本返回DEVICE_DISCONNECTED_C
+  float tempAt(int index) const {
+    return rawToTemp(samples[index]);
+  }
+  
+  // 推算第index个样本（按时间顺序）的时间戳（毫秒）
+  unsigned long timestampAt(int index) const {
+    int age = samples.size() - 1 - index;
+    return lastTimestamp - (unsigned long)age * IntervalMs;
+  }
+  
+  // 第一个序号大于 seq 的样本下标（全部不大于时返回 count()）
+  int indexAfterSeq(uint32_t seq) const {
+    uint32_t newer = lastSeq - seq;
+    if ((int32_t)newer <= 0) {
+      return samples.size();
+    }
+    return newer >= (uint32_t)samples.size() ? 0 : samples.size() - (int)newer;
+  }
+  
+  void reset() {
+    samples.clear();
+    lastTimestamp = 0;
+    lastSeq = 0;
+    minTemp = DEVICE_DISCONNECTED_C;
+    maxTemp = DEVICE_DISCONNECTED_C;
+    avgTemp = DEVICE_DISCONNECTED_C;
+    lastStatsUpdate = 0;
+    sumRaw = 0;
+    validCount = 0;
+    minHead = minCount = 0;
+    maxHead = maxCount = 0;
+  }
+  
+  // 追加一条记录（写满后覆盖最旧的记录）并更新统计数据
+  // temp 为 DEVICE_DISCONNECTED_C 时写入缺失占位，seq 为该样本的序号（每次加一）
+  void push(float temp, unsigned long timestamp, uint32_t seq) {
+    int slot = samples.nextSlot();
+    int16_t raw = tempToRaw(temp);
+    
+    // 移出将被覆盖的最旧记录
+    if (samples.full()) {
+      int16_t oldRaw = samples.oldest();
+      if (oldRaw != TEMP_RAW_INVALID) {
+        sumRaw -= oldRaw;
+        validCount--;
+      }
+      // 最旧的记录只可能位于队首
+      if (minCount > 0 && minQueue[minHead] == slot) {
+        minHead = (minHead + 1) % Capacity;
+        minCount--;
+      }
+      if (maxCount > 0 && maxQueue[maxHead] == slot) {
+        maxHead = (maxHead + 1) % Capacity;
+        maxCount--;
+      }
+    }
+    
+    samples.push(raw);
+    lastTimestamp = timestamp;
+    lastSeq = seq;
+    
+    if (raw != TEMP_RAW_INVALID) {
+      sumRaw += raw;
+      validCount++;
+      
+      // 队尾中不可能再成为最小/最大值的记录出队
+      while (minCount > 0 && samples.slot(minQueue[(minHead + minCount - 1) % Capacity]) >= raw) {
+        minCount--;
+      }
+      minQueue[(minHead + minCount) % Capacity] = slot;
+      minCount++;
+      
+      while (maxCount > 0 && samples.slot(maxQueue[(maxHead + maxCount - 1) % Capacity]) <= raw) {
+        maxCount--;
+      }
+      maxQueue[(maxHead + maxCount) % Capacity] = slot;
+      maxCount++;
+    }
+    
+    if (validCount > 0) {
+      minTemp = rawToTemp(samples.slot(minQueue[minHead]));
+      maxTemp = rawToTemp(samples.slot(maxQueue[maxHead]));
+      avgTemp = (float)sumRaw / TEMP_RAW_SCALE / validCount;
+    } else {
+      minTemp = DEVICE_DISCONNECTED_C;
+      maxTemp = DEVICE_DISCONNECTED_C;
+      avgTemp = DEVICE_DISCONNECTED_C;
+    }
+  }
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdint.h>
+#include "TempRecord.h"
+
+// 温度数据的JSON输出：逐字段写入 Print，不构建JSON文档，内存占用与传感器数量和历史长度无关。
+// 格式与原先用 ArduinoJson 6 构建 DynamicJsonDocument 再序列化的结果逐字节相同
+// （字段顺序即插入顺序，无空白）；字符串字段均为固定格式（时间、序列号），无需转义。
+
+// 输出保留1位小数的温度数值（与ArduinoJson序列化 round(temp * 10) / 10.0 的结果一致，
+// 整数值不带小数部分，-0.0 输出为 0），无效数据输出0
+inline void printJsonTemp(Print& out, float temp) {
+  if (temp == DEVICE_DISCONNECTED_C) {
+    out.print('0');
+    return;
+  }
+  long tenths = lround(temp * 10);
+  if (tenths < 0) {
+    out.print('-');
+    tenths = -tenths;
+  }
+  out.print(tenths / 10);
+  if (tenths % 10 != 0) {
+    out.print('.');
+    out.print(tenths % 10);
+  }
+}
+
+// 当前温度字符串的内容：与 String(temp, 1) 相同的格式化方式（-0.04 为 "-0.0"），未连接为 null
+inline void printJsonCurrentTemp(Print& out, float temp) {
+  if (temp != DEVICE_DISCONNECTED_C) {
+    char tempStr[16];
+    dtostrf(temp, 3, 1, tempStr);
+    out.print(tempStr);
+  } else {
+    out.print("null");
+  }
+}
+
+// 文档开头：{"system_time":"...","time_synced":true,"seq":N[,"since":N]
+// 之后为各传感器对象（writeJsonSensor），最后由调用方输出 '}'
+inline void writeJsonHeader(Print& out, const char* systemTime, bool synced, uint64_t seq, bool delta,
+                            uint64_t since) {
+  out.print("{\"system_time\":\"");
+  out.print(systemTime);
+  out.print("\",\"time_synced\":");
+  out.print(synced ? "true" : "false");
+  out.print(",\"seq\":");
+  out.print((unsigned long long)seq);
+  if (delta) {
+    out.print(",\"since\":");
+    out.print((unsigned long long)since);
+  }
+}
+
+// 一个传感器对象：,"key":{"c_t":"28.5","last_time":"...","l_t":[...]}
+// l_t 为历史记录中下标 [start, end) 的样本，按时间顺序，无效数据使用0
+template <int Capacity, unsigned long IntervalMs>
+void writeJsonSensor(Print& out, const char* key, float currentTemp, const char* lastTime,
+                     const TempRecordT<Capacity, IntervalMs>& record, int start, int end) {
+  out.print(",\"");
+  out.print(key);
+  out.print("\":{\"c_t\":\"");
+  printJsonCurrentTemp(out, currentTemp);
+  out.print("\",\"last_time\":\"");
+  out.print(lastTime);
+  out.print("\",\"l_t\":[");
+  for (int j = start; j < end; j++) {
+    if (j > start) {
+      out.print(',');
+    }
+    printJsonTemp(out, record.tempAt(j));
+  }
+  out.print("]}");
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "MsgPackWriter.h"
+#include "TempRecord.h"
+
+// 温度数据的MessagePack输出，结构与 TemperatureJson.h 的JSON相同：
+// {"system_time": str, "time_synced": bool, "seq": uint, ["since": uint,] "T1-序列号": {"c_t": int|nil, "last_time": str, "l_t": [int|nil, ...]}, ...}
+// 温度均为整数，单位0.1°C（如285表示28.5°C），未连接/无效数据为nil
+
+// 文档开头：map头与公共字段，sensors 为随后 writeMsgPackSensor 的次数
+inline void writeMsgPackHeader(MsgPackWriter& writer, const char* systemTime, bool synced, uint64_t seq, bool delta,
+                               uint64_t since, int sensors) {
+  writer.writeMap(3 + (delta ? 1 : 0) + sensors);
+  writer.writeString("system_time");
+  writer.writeString(systemTime);
+  writer.writeString("time_synced");
+  writer.writeBool(synced);
+  writer.writeString("seq");
+  writer.writeUInt(seq);
+  if (delta) {
+    writer.writeString("since");
+    writer.writeUInt(since);
+  }
+}
+
+// 一个传感器：键与 {"c_t", "last_time", "l_t"}，l_t 为历史记录中下标 [start, end) 的样本
+template <int Capacity, unsigned long IntervalMs>
+void writeMsgPackSensor(MsgPackWriter& writer, const char* key, float currentTemp, const char* lastTime,
+                        const TempRecordT<Capacity, IntervalMs>& record, int start, int end) {
+  writer.writeString(key);
+  writer.writeMap(3);
+
+  writer.writeString("c_t");
+  if (currentTemp != DEVICE_DISCONNECTED_C) {
+    writer.writeInt(lroundf(currentTemp * 10));
+  } else {
+    writer.writeNil();
+  }
+
+  writer.writeString("last_time");
+  writer.writeString(lastTime);
+
+  writer.writeString("l_t");
+  writer.writeArray(end - start);
+  for (int j = start; j < end; j++) {
+    int16_t raw = record.samples[j];
+    if (raw != TEMP_RAW_INVALID) {
+      // 1/16°C 换算为 0.1°C
+      writer.writeInt(lroundf(rawToTemp(raw) * 10));
+    } else {
+      writer.writeNil();
+    }
+  }
+}
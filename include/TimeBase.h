@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+// 把32位毫秒计数（如 millis()，约49.7天回绕一次）扩展为64位单调时间。
+// 两次调用间隔不能超过一个回绕周期，主循环中每次调用即可满足。
+class MonotonicClock {
+ public:
+  MonotonicClock() : high_(0), last_(0) {}
+
+  uint64_t extend(uint32_t now) {
+    if (now < last_) {
+      high_ += (uint64_t)1 << 32;
+    }
+    last_ = now;
+    return high_ | now;
+  }
+
+ private:
+  uint64_t high_;
+  uint32_t last_;
+};
+
+// 由单调时间推算Unix时间（毫秒）：epoch = mono + offset。
+//
+// 每次同步给出一个 (单调时间, Unix时间) 样本。偏差不超过 stepThresholdMs 时，
+// offset 以不超过 slewPpm 的速率向新值靠拢（类似 adjtime），推算出的时间连续且单调递增；
+// 首次同步或偏差过大时直接跳变。
+class DisciplinedClock {
+ public:
+  DisciplinedClock(int64_t stepThresholdMs, uint32_t slewPpm)
+      : stepThresholdMs_(stepThresholdMs), slewPpm_(slewPpm), valid_(false), offset_(0), target_(0), since_(0) {}
+
+  bool valid() const { return valid_; }
+
+  // 同步样本：单调时间 monoMs 时的Unix时间为 epochMs。返回是否跳变
+  bool discipline(uint64_t monoMs, int64_t epochMs) {
+    int64_t sampleOffset = epochMs - (int64_t)monoMs;
+    int64_t current = offsetAt(monoMs);
+    int64_t error = sampleOffset - current;
+    if (!valid_ || error > stepThresholdMs_ || error < -stepThresholdMs_) {
+      offset_ = sampleOffset;
+      target_ = sampleOffset;
+      since_ = monoMs;
+      valid_ = true;
+      return true;
+    }
+    offset_ = current;
+    target_ = sampleOffset;
+    since_ = monoMs;
+    return false;
+  }
+
+  // 单调时间 monoMs 对应的Unix时间（毫秒），未同步时返回0
+  int64_t epochMillis(uint64_t monoMs) const { return valid_ ? (int64_t)monoMs + offsetAt(monoMs) : 0; }
+
+  // 尚未补偿完的偏差（毫秒）
+  int64_t pendingSlew(uint64_t monoMs) const { return target_ - offsetAt(monoMs); }
+
+ private:
+  int64_t offsetAt(uint64_t monoMs) const {
+    int64_t remaining = target_ - offset_;
+    if (remaining == 0 || monoMs <= since_) {
+      return offset_;
+    }
+    int64_t maxAdjust = (int64_t)((monoMs - since_) * slewPpm_ / 1000000);
+    if (remaining > maxAdjust) {
+      return offset_ + maxAdjust;
+    }
+    if (remaining < -maxAdjust) {
+      return offset_ - maxAdjust;
+    }
+    return target_;
+  }
+
+  int64_t stepThresholdMs_;
+  uint32_t slewPpm_;
+  bool valid_;
+  int64_t offset_;  // since_ 时刻的偏移
+  int64_t target_;  // 最近一次同步样本给出的偏移
+  uint64_t since_;
+};
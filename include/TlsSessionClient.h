@@ -0,0 +1,367 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/version.h>
+
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member  // mbedTLS 2.x 的结构体成员是公开的
+#endif
+
+// 基于mbedTLS的TLS客户端，在给定的TCP连接上收发加密数据。
+//
+// 与 WiFiClientSecure 不同，握手成功后保存TLS会话，下次连接时提交该会话请求恢复
+// （会话ID或会话票据），服务器同意时省去证书传输、证书解析和密钥交换，
+// 握手只需一个往返和对称运算；服务器不同意时自动进行完整握手。
+// 恢复握手失败时丢弃保存的会话，下次重新完整握手。
+//
+// 是否恢复由握手过程判断：恢复时服务器在 ServerHello 之后直接发送 ChangeCipherSpec，
+// 客户端状态机跳过 Certificate 状态。不能比较会话ID——提交票据时客户端使用新的随机会话ID。
+// 会话恢复按 TLS 1.2 的流程实现，mbedTLS 启用了 TLS 1.3 时限制最高版本为 TLS 1.2。
+//
+// 不做证书链验证，可选用 setFingerprint() 在完整握手后比对服务器证书的SHA-256指纹；
+// 恢复的会话来自已校验过的完整握手，不再比对。
+class TlsSessionClient : public Client {
+ public:
+  explicit TlsSessionClient(Client& transport)
+      : transport_(transport), timeoutMs_(5000), seeded_(false), sslReady_(false), connected_(false),
+        haveSession_(false), haveFingerprint_(false), fingerprintMismatch_(false), peeked_(-1), lastResumed_(false), lastHandshakeMs_(0),
+        lastHandshakeMinHeap_(0) {
+    mbedtls_ssl_init(&ssl_);
+    mbedtls_ssl_config_init(&conf_);
+    mbedtls_ctr_drbg_init(&drbg_);
+    mbedtls_entropy_init(&entropy_);
+    mbedtls_ssl_session_init(&session_);
+  }
+
+  ~TlsSessionClient() {
+    stop();
+    mbedtls_ssl_session_free(&session_);
+    mbedtls_ssl_config_free(&conf_);
+    mbedtls_ctr_drbg_free(&drbg_);
+    mbedtls_entropy_free(&entropy_);
+  }
+
+  // 握手及写入的超时（毫秒）
+  void setHandshakeTimeout(unsigned long timeoutMs) { timeoutMs_ = timeoutMs; }
+
+  // 服务器证书指纹，64个十六进制数字，可用':'或空格分隔；格式错误返回 false
+  bool setFingerprint(const char* hex) {
+    haveFingerprint_ = false;
+    int count = 0;
+    int high = -1;
+    for (const char* p = hex; *p != '\0'; p++) {
+      int value = hexValue(*p);
+      if (value < 0) {
+        if (*p == ':' || *p == ' ') {
+          continue;
+        }
+        return false;
+      }
+      if (high < 0) {
+        high = value;
+        continue;
+      }
+      if (count == (int)sizeof(fingerprint_)) {
+        return false;
+      }
+      fingerprint_[count++] = (uint8_t)((high << 4) | value);
+      high = -1;
+    }
+    haveFingerprint_ = count == (int)sizeof(fingerprint_) && high < 0;
+    return haveFingerprint_;
+  }
+
+  // 丢弃保存的会话，下次连接进行完整握手
+  void clearSession() {
+    mbedtls_ssl_session_free(&session_);
+    mbedtls_ssl_session_init(&session_);
+    haveSession_ = false;
+  }
+
+  bool hasSession() const { return haveSession_; }
+
+  // 最近一次握手是否恢复了会话，握手用时（不含TCP连接）及握手期间的最低可用堆（每个握手步骤后采样）
+  bool lastResumed() const { return lastResumed_; }
+  bool lastFingerprintMismatch() const { return fingerprintMismatch_; }
+  unsigned long lastHandshakeMs() const { return lastHandshakeMs_; }
+  uint32_t lastHandshakeMinHeap() const { return lastHandshakeMinHeap_; }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    stop();
+    if (!transport_.connect(ip, port)) {
+      return 0;
+    }
+    return handshake(NULL);
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    stop();
+    if (!transport_.connect(host, port)) {
+      return 0;
+    }
+    return handshake(host);
+  }
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (!connected_) {
+      return 0;
+    }
+    size_t written = 0;
+    unsigned long startTime = millis();
+    while (written < size) {
+      int ret = mbedtls_ssl_write(&ssl_, buffer + written, size - written);
+      if (ret > 0) {
+        written += ret;
+        continue;
+      }
+      if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+          millis() - startTime >= timeoutMs_) {
+        fail();
+        return written;
+      }
+      delay(1);
+    }
+    return written;
+  }
+
+  int available() override {
+    if (!connected_) {
+      return 0;
+    }
+    if (mbedtls_ssl_get_bytes_avail(&ssl_) == 0 && transport_.available() > 0) {
+      // 处理已到达的记录，解密后的数据留在mbedTLS的缓冲区中
+      int ret = mbedtls_ssl_read(&ssl_, NULL, 0);
+      if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        fail();
+        return 0;
+      }
+    }
+    return (int)mbedtls_ssl_get_bytes_avail(&ssl_) + (peeked_ >= 0 ? 1 : 0);
+  }
+
+  int read() override {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+  }
+
+  int read(uint8_t* buffer, size_t size) override {
+    if (size == 0) {
+      return 0;
+    }
+    int count = 0;
+    if (peeked_ >= 0) {
+      buffer[count++] = (uint8_t)peeked_;
+      peeked_ = -1;
+      if (size == 1) {
+        return count;
+      }
+    }
+    if (!connected_) {
+      return count > 0 ? count : -1;
+    }
+    int ret = mbedtls_ssl_read(&ssl_, buffer + count, size - count);
+    if (ret > 0) {
+      return count + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      fail();  // 服务器关闭（ret为0或close_notify）或出错
+    }
+    return count > 0 ? count : -1;
+  }
+
+  int peek() override {
+    if (peeked_ < 0) {
+      uint8_t value;
+      if (read(&value, 1) == 1) {
+        peeked_ = value;
+      }
+    }
+    return peeked_;
+  }
+
+  void flush() override { transport_.flush(); }
+
+  void stop() override {
+    if (connected_) {
+      mbedtls_ssl_close_notify(&ssl_);
+    }
+    connected_ = false;
+    peeked_ = -1;
+    transport_.stop();
+    if (sslReady_) {
+      mbedtls_ssl_free(&ssl_);
+      mbedtls_ssl_init(&ssl_);
+      sslReady_ = false;
+    }
+  }
+
+  uint8_t connected() override { return connected_ && (transport_.connected() || available() > 0); }
+  operator bool() override { return connected(); }
+
+ private:
+  static uint32_t freeHeap() {
+#if defined(ESP32)
+    return ESP.getFreeHeap();
+#else
+    return 0;
+#endif
+  }
+
+  static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  // mbedTLS的收发回调：没有数据时返回 WANT_READ，由调用方稍后重试
+  static int sendCallback(void* context, const unsigned char* buffer, size_t length) {
+    Client& transport = static_cast<TlsSessionClient*>(context)->transport_;
+    size_t written = transport.write(buffer, length);
+    if (written > 0) {
+      return (int)written;
+    }
+    return transport.connected() ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+  }
+
+  static int recvCallback(void* context, unsigned char* buffer, size_t length) {
+    Client& transport = static_cast<TlsSessionClient*>(context)->transport_;
+    if (transport.available() <= 0) {
+      return transport.connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int count = transport.read(buffer, length);
+    return count > 0 ? count : MBEDTLS_ERR_SSL_WANT_READ;
+  }
+
+  bool setupConfig() {
+    if (seeded_) {
+      return true;
+    }
+    static const unsigned char personalization[] = "TlsSessionClient";
+    if (mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_, personalization, sizeof(personalization)) != 0 ||
+        mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+      return false;
+    }
+    mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    mbedtls_ssl_conf_max_tls_version(&conf_, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+    seeded_ = true;
+    return true;
+  }
+
+  int handshake(const char* host) {
+    unsigned long startTime = millis();
+    lastResumed_ = false;
+    fingerprintMismatch_ = false;
+    if (!setupConfig() || mbedtls_ssl_setup(&ssl_, &conf_) != 0) {
+      transport_.stop();
+      return 0;
+    }
+    sslReady_ = true;
+    if (host != NULL) {
+      mbedtls_ssl_set_hostname(&ssl_, host);
+    }
+    mbedtls_ssl_set_bio(&ssl_, this, sendCallback, recvCallback, NULL);
+    bool offered = haveSession_ && mbedtls_ssl_set_session(&ssl_, &session_) == 0;
+
+    // 逐步推进握手，记录是否经过服务器证书状态（完整握手）及各步之后的可用堆
+    bool sawCertificate = false;
+    lastHandshakeMinHeap_ = freeHeap();
+    while (ssl_.MBEDTLS_PRIVATE(state) != MBEDTLS_SSL_HANDSHAKE_OVER) {
+      if (ssl_.MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+        sawCertificate = true;
+      }
+      int ret = mbedtls_ssl_handshake_step(&ssl_);
+      uint32_t heap = freeHeap();
+      if (heap < lastHandshakeMinHeap_) {
+        lastHandshakeMinHeap_ = heap;
+      }
+      if (ret == 0) {
+        continue;
+      }
+      if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+          millis() - startTime >= timeoutMs_) {
+        if (offered) {
+          clearSession();  // 可能是服务器不接受该会话，下次完整握手
+        }
+        stop();
+        return 0;
+      }
+      delay(1);
+    }
+    lastHandshakeMs_ = millis() - startTime;
+    lastResumed_ = offered && !sawCertificate;
+
+    mbedtls_ssl_session current;
+    mbedtls_ssl_session_init(&current);
+    bool gotSession = mbedtls_ssl_get_session(&ssl_, &current) == 0;
+
+    if (!lastResumed_ && haveFingerprint_ && !matchFingerprint()) {
+      fingerprintMismatch_ = true;
+      mbedtls_ssl_session_free(&current);
+      clearSession();
+      stop();
+      return 0;
+    }
+
+    // 保存本次会话供下次恢复
+    mbedtls_ssl_session_free(&session_);
+    session_ = current;
+    haveSession_ = gotSession;
+    connected_ = true;
+    return 1;
+  }
+
+  bool matchFingerprint() {
+    const mbedtls_x509_crt* certificate = mbedtls_ssl_get_peer_cert(&ssl_);
+    if (certificate == NULL) {
+      return false;
+    }
+    unsigned char digest[32];
+#if MBEDTLS_VERSION_MAJOR >= 3
+    mbedtls_sha256(certificate->raw.p, certificate->raw.len, digest, 0);
+#else
+    mbedtls_sha256_ret(certificate->raw.p, certificate->raw.len, digest, 0);
+#endif
+    return memcmp(digest, fingerprint_, sizeof(fingerprint_)) == 0;
+  }
+
+  // 连接异常：关闭连接，保留会话供下次恢复
+  void fail() {
+    connected_ = false;
+    transport_.stop();
+  }
+
+  Client& transport_;
+  unsigned long timeoutMs_;
+  bool seeded_;
+  bool sslReady_;
+  bool connected_;
+  bool haveSession_;
+  bool haveFingerprint_;
+  bool fingerprintMismatch_;
+  int peeked_;
+  bool lastResumed_;
+  unsigned long lastHandshakeMs_;
+  uint32_t lastHandshakeMinHeap_;
+  uint8_t fingerprint_[32];
+  mbedtls_ssl_context ssl_;
+  mbedtls_ssl_config conf_;
+  mbedtls_ctr_drbg_context drbg_;
+  mbedtls_entropy_context entropy_;
+  mbedtls_ssl_session session_;
+};
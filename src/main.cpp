@@ -10,12 +10,43 @@
 #include <esp_wifi.h>  // 添加ESP32 WiFi控制库
 #include <PubSubClient.h>  // 添加MQTT客户端库
 #include <ArduinoJson.h>   // 添加JSON库
-#include <WiFiClientSecure.h>  // 添加SSL客户端库
+#include <LittleFS.h>      // 历史数据持久化
+#include <Preferences.h>   // WiFi快速连接参数（NVS）
+#include <esp_sntp.h>      // SNTP同步完成回调
+#include "RingBuffer.h"
+#include "TempRecord.h"
+#include "TempAcquisition.h"
+#include "HistoryStore.h"
+#include "CompressedSeries.h"
+#include "StreamPrint.h"
+#include "TemperatureJson.h"
+#include "MsgPackWriter.h"
+#include "TemperatureMsgPack.h"
+#include "TelemetrySpool.h"
+#include "TelemetryTrigger.h"
+#include "CommandParser.h"
+#include "MqttAckTap.h"
+#include "MqttOutbox.h"
+#include "Backoff.h"
+#include "TimeBase.h"
+#include "TaskScheduler.h"
+#include "TlsSessionClient.h"
+#include "PublishEchoFilter.h"
+#include "PayloadCache.h"
 
 // WiFi连接参数
 #define WIFI_SSID "MTK_CHEETAH_AP_2.4G"      // 请修改为您的WiFi名称
 #define WIFI_PASSWORD ""  // 请修改为您的WiFi密码
 #define WIFI_TIMEOUT 10000           // WiFi连接超时时间（毫秒）
+#define WIFI_BACKOFF_MIN 1000        // 连接失败后首次重试的等待时间（毫秒），之后每次加倍
+#define WIFI_BACKOFF_MAX 60000       // 重试等待时间上限（毫秒）
+
+// WiFi快速连接：保存上次成功连接的AP（BSSID）和信道，下次直接关联，省去完整的信道扫描；
+// 快速连接超时后立即退回完整扫描。可选复用上次DHCP获得的地址，省去DHCP过程
+// （需确保路由器为本设备保留该地址）。参数保存在NVS中，断电后仍然有效。
+#define WIFI_FAST_CONNECT true       // 启用快速连接
+#define WIFI_FAST_TIMEOUT 3000       // 快速连接的超时时间（毫秒）
+#define WIFI_REUSE_IP false          // 快速连接时使用上次的IP地址（静态配置）
 
 // WiFi功率设置
 #define WIFI_POWER_DBM 8             // WiFi发射功率，单位dBm (范围: 0-20, 建议8-12)
@@ -34,30 +65,154 @@
 #define MQTT_PASSWORD "xxxxxx"             // MQTT密码（如果需要）
 #define MQTT_SUBSCRIBE_TOPIC "testtopic"  // 订阅主题
 #define MQTT_PUBLISH_TOPIC "testtopic"       // 发布主题
+#define MQTT_BUFFER_SIZE 1024        // MQTT客户端缓冲区（接收命令及非流式发布），温度数据流式发送不受此限制
+#define MQTT_STREAM_CHUNK 256        // 流式发布时每次写入连接的字节数
+#define MQTT_RESPONSE_TOPIC "testtopic/response"  // 命令应答主题
+#define MQTT_TLS_TIMEOUT 5           // TLS握手超时（秒）
+// 服务器证书的SHA-256指纹（如 "AB:CD:EF:..."，可用 openssl x509 -noout -fingerprint -sha256 获得）。
+// 设置后握手完成时只比对指纹，不做证书链验证；为空时不校验服务器身份（不安全）
+#define MQTT_TLS_FINGERPRINT ""
+#define MQTT_SOCKET_TIMEOUT 3        // 等待CONNACK等服务器应答的超时（秒）
+#define MQTT_BACKOFF_MIN 2000        // 连接失败后首次重试的等待时间（毫秒），之后每次加倍
+#define MQTT_BACKOFF_MAX 120000      // 重试等待时间上限（毫秒）
+#define MQTT_CONNECT_TASK_STACK 8192 // 后台连接任务的栈大小（字节），TLS握手需要较大的栈
+
+// MQTT发送队列：命令应答、单传感器主题等小消息先进入队列，每次loop限量发送；
+// QoS1 消息收到 PUBACK 前保留在队列中，超时未确认时带 DUP 标志重发，同时在途的数量不超过窗口。
+// 温度数据、历史查询等大负载仍直接流式发布（QoS0）。
+#define MQTT_OUTBOX_SIZE 16          // 队列容量（条）
+#define MQTT_OUTBOX_TOPIC 64         // 单条消息的主题最大长度（字节，含结尾）
+#define MQTT_OUTBOX_PAYLOAD 192      // 单条消息的负载最大长度（字节）
+#define MQTT_INFLIGHT_WINDOW 4       // 同时在途（未确认）的QoS1消息数
+#define MQTT_RETRY_MS 5000           // QoS1消息未确认时的重发间隔（毫秒）
+#define MQTT_MAX_ATTEMPTS 5          // QoS1消息最多发送次数，超过后丢弃
+#define MQTT_SEND_BATCH 4            // 每次loop最多发送的消息数
+#define MQTT_COMMAND_MAX_LENGTH 128  // 命令最大长度（字节），超长的消息不作为命令处理
+#define MQTT_COMMAND_MAX_TOKENS 8    // 命令最多包含的记号数（命令名+参数）
+#define MQTT_ECHO_SLOTS 4            // 记录的自己发布到订阅主题上的消息数（用于忽略服务器回送）
+#define MQTT_ECHO_TIMEOUT 30000      // 等待服务器回送自己发布的消息的时间（毫秒）
+
+// 定时遥测配置：无需 refresh 请求，主动发布当前温度
+// 温度相对上次发布的值变化超过死区时记为变化，第一个变化出现后等待合并窗口，
+// 窗口内变化的所有传感器合并为一条消息；另按固定周期发布全部传感器作为心跳。
+#define TELEMETRY_ENABLE true
+#define TELEMETRY_TOPIC "testtopic/telemetry"  // 遥测发布主题
+#define TELEMETRY_INTERVAL 300000     // 全量发布周期（毫秒）
+#define TELEMETRY_DEADBAND 0.3        // 变化死区（°C）
+#define TELEMETRY_COALESCE_MS 2000    // 变化合并窗口（毫秒），覆盖一轮分批读取
+#define TELEMETRY_MIN_INTERVAL 10000  // 两次变化发布的最小间隔（毫秒）
+
+// 单传感器保留主题：每个传感器在 <SENSOR_TOPIC_BASE>/<序列号>/ 下有 current、stats、alarm 三个主题，
+// 以 retain 标志发布且只在内容变化时发布，订阅者连接后立即从服务器得到最新状态，无需发送 refresh。
+#define SENSOR_TOPICS_ENABLE true
+#define SENSOR_TOPIC_BASE "testtopic/sensors"  // 单传感器主题前缀
+#define SENSOR_TOPIC_BATCH 4           // 每次loop最多发布的保留消息数
+
+// 遥测离线缓存：MQTT未连接（或发布失败）时遥测进入内存队列，队列满时最旧的条目转存到闪存，
+// 重新连接后按批限速补发（先闪存后内存，保持时间顺序），不阻塞采集与显示。
+#define TELEMETRY_QUEUE_SIZE 64        // 内存队列条目数（每条约48字节）
+#define TELEMETRY_SPILL_ENABLE true    // 内存队列满时转存到闪存（需要LittleFS）
+#define TELEMETRY_SPILL_FILE "/hist/outbox.bin"
+#define TELEMETRY_SPILL_MAX 1024       // 闪存中最多缓存的条目数，超出后丢弃新条目
+#define TELEMETRY_DRAIN_BATCH 4        // 每批补发的条目数
+#define TELEMETRY_DRAIN_INTERVAL 200   // 两批补发之间的最小间隔（毫秒）
+
+// 历史数据持久化配置（LittleFS）
+// 每个存储间隔写入一帧（所有传感器的12分钟样本和汇总桶），按段文件追加写入，
+// 超出段数上限时删除最旧的段；小时/天层每天保存一次快照，启动时只需重放快照之后
+// 以及最近 MAX_RECORDS 个间隔的帧。
+#define HIST_PERSIST_ENABLE true       // 启用历史数据持久化
+#define HIST_DIR "/hist"               // 历史数据目录
+#define HIST_SNAPSHOT_FILE "/hist/snapshot.bin"
+#define HIST_SNAPSHOT_TMP "/hist/snapshot.tmp"
+#define HIST_SEGMENT_SIZE 65536        // 单个段文件的最大字节数
+#define HIST_MAX_SEGMENTS 16           // 最多保留的段数（共约1MB）
+#define HIST_FLUSH_FRAMES 5            // 攒够多少帧写入一次闪存（5帧=1小时，断电最多丢失这部分）
 
 // NTP时间同步配置
 #define NTP_SERVER "pool.ntp.org"     // NTP服务器
 #define NTP_GMT_OFFSET 8              // 时区偏移（小时），中国为UTC+8
 #define NTP_DAYLIGHT_OFFSET 0         // 夏令时偏移（小时）
 #define NTP_UPDATE_INTERVAL 3600000   // NTP更新时间间隔（毫秒），1小时更新一次
+#define NTP_STEP_THRESHOLD 2000       // 与NTP时间偏差超过该值（毫秒）时直接跳变，否则缓慢调整
+#define NTP_SLEW_PPM 500              // 缓慢调整的最大速率（百万分之一），1秒偏差约33分钟补偿完
 
-// WiFi连接状态
+// WiFi/MQTT连接状态（由 serviceConnectivity() 状态机维护）
 bool wifiConnected = false;
-unsigned long wifiConnectStartTime = 0;
-int wifiConnectAttempts = 0;
-const int MAX_WIFI_ATTEMPTS = 5;
-
-// MQTT连接状态
 bool mqttConnected = false;
-unsigned long mqttConnectStartTime = 0;
-int mqttConnectAttempts = 0;
-const int MAX_MQTT_ATTEMPTS = 5;
+unsigned long mqttConnectStartTime = 0;  // 本次MQTT连接开始的时间
 bool mqttDataRequested = false;  // 标记是否需要发送数据
 
+// 温度数据负载格式（按请求选择）
+enum PayloadFormat {
+  PAYLOAD_JSON,     // JSON（默认，兼容原格式）
+  PAYLOAD_MSGPACK   // MessagePack，温度为int16（0.1°C）
+};
+PayloadFormat mqttDataFormat = PAYLOAD_JSON;  // 待发送数据的格式
+bool mqttDataDelta = false;      // 是否只发送序号之后的样本（refresh since=<seq>）
+uint32_t mqttDataSince = 0;      // 增量请求的起始序号（本次启动内的序号）
+int mqttDataSensor = -1;         // 只发送指定传感器（refresh sensor=<n>），-1 表示全部
+
+// 温度数据负载缓存：负载内容由数据版本、请求参数和生成时间决定，前两者都未变化时沿用上次的
+// 生成时间与长度重新流式输出，省去计算长度的一遍（见 PayloadCache.h）。数据版本在写入存储间隔、
+// 当前温度（按0.1°C）变化、传感器接入/断开以及时间同步时加一；负载中的 system_time 为首次生成的时间。
+struct PayloadKey {
+  uint32_t version;
+  PayloadFormat format;
+  bool delta;
+  uint32_t since;
+  int sensor;
+  
+  bool operator==(const PayloadKey &other) const {
+    return version == other.version && format == other.format && delta == other.delta &&
+           since == other.since && sensor == other.sensor;
+  }
+};
+uint32_t payloadDataVersion = 1;          // 温度数据版本
+PayloadCache<PayloadKey> payloadCache;    // 上次生成负载的键、时间与长度
+
+// MQTT命令：原地解析，按命令表分派；回调中只修改状态，应答在loop中发布
+typedef CommandLine<MQTT_COMMAND_MAX_TOKENS, MQTT_COMMAND_MAX_LENGTH> MqttCommandLine;
+typedef bool (*MqttCommandHandler)(const MqttCommandLine &command, char *message, size_t messageSize);
+struct MqttCommand {
+  const char *name;
+  uint8_t minArgs;
+  uint8_t maxArgs;
+  MqttCommandHandler handler;
+  const char *usage;
+};
+
+// 历史样本序号：每个存储间隔加一（所有传感器共用），在负载中以
+// (启动会话号 << 32) | 序号 的形式发布，重启后会话号改变，旧序号不会被误认为有效
+uint32_t tempSampleSeq = 0;      // 最新存储间隔的序号
+uint32_t bootSession = 0;        // 启动会话号（启动时随机生成，21位，保证发布的序号不超过2^53）
+
+// 定时遥测状态
+TelemetryTrigger telemetryTrigger(TELEMETRY_INTERVAL, TELEMETRY_COALESCE_MS, TELEMETRY_MIN_INTERVAL, TELEMETRY_DEADBAND);
+
+// 单传感器保留主题状态
+enum SensorTopic {
+  SENSOR_TOPIC_CURRENT = 1 << 0,  // 当前温度
+  SENSOR_TOPIC_STATS = 1 << 1,    // 48小时统计（每个存储间隔更新）
+  SENSOR_TOPIC_ALARM = 1 << 2     // 报警状态
+};
+enum SensorAlarmState {
+  SENSOR_ALARM_NORMAL,
+  SENSOR_ALARM_HIGH,
+  SENSOR_ALARM_LOW
+};
+const char* const SENSOR_ALARM_LABELS[] = {"normal", "high", "low"};
+int sensorTopicCursor = 0;                 // 下一个检查的传感器（轮询，分摊到多次loop）
+
 // 时间同步状态
 bool timeSynced = false;         // 时间是否已同步
-unsigned long lastNTPUpdate = 0; // 上次NTP更新时间
-time_t lastRealTime = 0;         // 上次获取的真实时间
+MonotonicClock monotonicClock;   // 由 millis() 扩展的64位单调时钟
+DisciplinedClock wallClock(NTP_STEP_THRESHOLD, NTP_SLEW_PPM);  // 由单调时钟和NTP偏移推算的真实时间
+// SNTP回调（在网络任务中执行）只记录收到的时间，由主循环中的 syncTime() 处理
+portMUX_TYPE ntpSampleMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool ntpSamplePending = false;
+struct timeval ntpSampleTime;    // NTP给出的Unix时间
+uint32_t ntpSampleMillis = 0;    // 收到时的 millis()
 
 // 类型定义
 typedef uint8_t DeviceAddress[8];  // 添加DeviceAddress类型定义
@@ -105,9 +260,16 @@ typedef uint8_t DeviceAddress[8];  // 添加DeviceAddress类型定义
 #define OVERVIEW_SENSOR_SIZE 1  // 传感器编号字体大小
 
 // 温度记录相关定义
-#define MAX_RECORDS 120  // 保持120个数据点
+#define MAX_SENSORS 16   // 传感器最大数量（注册表容量）
+#define MAX_RECORDS 240  // 保持240个数据点（12分钟间隔共48小时，每点4字节，与原格式120点的960字节相同）
 #define TEMP_UPDATE_INTERVAL 5000  // 温度显示更新间隔（1秒）
+#define TEMP_UPDATE_INTERVAL_MIN 2000    // 可通过命令设置的最小读取间隔（毫秒），保证一天的读数数量不超过汇总桶的16位计数
+#define TEMP_UPDATE_INTERVAL_MAX 300000  // 可通过命令设置的最大读取间隔（毫秒）
 #define TEMP_STORE_INTERVAL 720000  // 温度存储间隔（12分钟，单位：毫秒）
+#define TEMP_CONVERSION_MARGIN_MS 20  // 转换截止时间余量（毫秒）
+#define TEMP_CONVERSION_MIN_MS 10     // 发起转换后最早开始查询完成状态的时间（毫秒）
+#define TEMP_READ_BUDGET_MS 20        // 单次loop读取传感器的时间预算（毫秒）
+#define SENSOR_RESCAN_INTERVAL 60000  // 后台重新扫描总线的间隔（毫秒）
 // #define TEMP_STORE_INTERVAL 5000  // 温度存储间隔（12分钟，单位：毫秒）
 
 #define TEMP_MIN 10.0  // 最小温度刻度
@@ -121,6 +283,19 @@ typedef uint8_t DeviceAddress[8];  // 添加DeviceAddress类型定义
 #define TEMP_ALARM_LOW 10.0   // 低温报警阈值
 #define ALARM_BLINK_INTERVAL 500  // 报警闪烁间隔（毫秒）
 
+// 定时任务间隔（毫秒），由 loop() 中的任务调度器按截止时间执行
+#define BUTTON_TICK_INTERVAL 10      // 按键扫描间隔
+#define STATUS_ICON_INTERVAL 500     // WiFi/MQTT状态图标检查间隔
+#define POWER_CHECK_INTERVAL 30000   // 电源状态检查间隔
+#define SYSTEM_INFO_INTERVAL 10000   // 系统信息打印间隔
+#define SCREEN_WAKE_DELAY 120        // 屏幕退出睡眠后到开启显示的等待时间
+#define LOOP_IDLE_MAX_MS 10          // 没有到期任务时loop最长让出CPU的时间
+
+// 可通过MQTT命令在运行时修改的参数，重启后恢复为上面的默认值
+unsigned long tempUpdateInterval = TEMP_UPDATE_INTERVAL;  // 温度读取间隔（毫秒）
+float alarmHighTemp = TEMP_ALARM_HIGH;  // 高温报警阈值
+float alarmLowTemp = TEMP_ALARM_LOW;    // 低温报警阈值
+
 // #define TFT_BL 5
 
 // 显示模式枚举
@@ -130,19 +305,265 @@ enum DisplayMode {
   MODE_GRAPH        // 图表模式
 };
 
-// 温度记录结构
-struct TempRecord {
-  float temps[MAX_RECORDS];  // 温度数组
-  unsigned long timestamps[MAX_RECORDS];  // 使用 unsigned long 存储时间戳（毫秒）
-  int recordCount;  // 当前记录数量
-  int currentIndex;  // 当前写入位置
-  float minTemp;    // 最小温度
-  float maxTemp;    // 最大温度
-  float avgTemp;    // 平均温度
-  unsigned long lastStatsUpdate;  // 上次统计数据更新时间
-  time_t lastRealTime;  // 最后一次更新时的真实时间戳
+// 温度记录：MAX_RECORDS 个按存储间隔排列的样本及其统计（见 TempRecord.h）
+typedef TempRecordT<MAX_RECORDS, TEMP_STORE_INTERVAL> TempRecord;
+
+// 多分辨率汇总历史：原始读数 -> 12分钟 -> 1小时 -> 1天
+// 原始层保存最近的每次读数；其余各层每个桶保存该时段读数的最小/最大/平均值和数量，
+// 读数到达时增量累计，上一层的桶结束时并入下一层，内存占用固定。
+#define ROLLUP_RAW_RECORDS 60       // 原始读数层容量（按5秒读数约5分钟）
+#define ROLLUP_FINE_RECORDS 120     // 12分钟层容量（24小时）
+#define ROLLUP_HOURLY_RECORDS 168   // 小时层容量（7天）
+#define ROLLUP_DAILY_RECORDS 31     // 天层容量（31天）
+#define ROLLUP_HOUR_MS 3600000UL
+#define ROLLUP_DAY_MS 86400000UL
+
+// 全速率读数历史（压缩存储）：每次读数（TEMP_UPDATE_INTERVAL）都按压缩格式写入共享块池，
+// 池满后回收最旧的块。稳定温度下约3~5位/点，即每通道每天约6~11KB，
+// 48KB的池在4通道时约可保存1~2天，通道越少保存越久。
+#define FULLRATE_BLOCK_BYTES 240     // 每块压缩数据字节数（另有16字节块头）
+#define FULLRATE_POOL_BLOCKS 192     // 块池大小（共约48KB）
+#define FULLRATE_TIME_UNIT_MS 100    // 时间戳单位（毫秒），读数间隔的抖动在此精度下多为0
+
+// 汇总层级
+enum RollupTierId {
+  TIER_RAW,      // 原始读数
+  TIER_FINE,     // 12分钟（TEMP_STORE_INTERVAL）
+  TIER_HOURLY,   // 1小时
+  TIER_DAILY,    // 1天
+  TIER_COUNT
+};
+#define TIER_FULLRATE TIER_COUNT  // 查询结果来自全速率压缩历史（只作为 queryHistory 返回的层级）
+
+// 已完成的汇总桶，count 为 0 表示该时段没有有效读数
+// count 为16位：天层一个桶最多 ROLLUP_DAY_MS / TEMP_UPDATE_INTERVAL_MIN 个读数
+static_assert(ROLLUP_DAY_MS / TEMP_UPDATE_INTERVAL_MIN <= UINT16_MAX, "最小读取间隔过短，天层读数数量超出16位计数");
+struct RollupBucket {
+  int16_t minRaw;
+  int16_t maxRaw;
+  int16_t avgRaw;
+  uint16_t count;
+};
+
+// 正在累计的汇总桶（保留精确的和，并入下一层时不损失精度）
+struct RollupAccumulator {
+  int32_t sumRaw;
+  int16_t minRaw;
+  int16_t maxRaw;
+  uint16_t count;
+  
+  void reset() {
+    sumRaw = 0;
+    minRaw = INT16_MAX;
+    maxRaw = INT16_MIN;
+    count = 0;
+  }
+  
+  void add(int16_t raw) {
+    sumRaw += raw;
+    minRaw = min(minRaw, raw);
+    maxRaw = max(maxRaw, raw);
+    count++;
+  }
+  
+  // 并入一个已完成的桶（按平均值和数量还原和）
+  void mergeBucket(const RollupBucket &bucket) {
+    if (bucket.count == 0) {
+      return;
+    }
+    sumRaw += (int32_t)bucket.avgRaw * bucket.count;
+    minRaw = min(minRaw, bucket.minRaw);
+    maxRaw = max(maxRaw, bucket.maxRaw);
+    count += bucket.count;
+  }
+  
+  void merge(const RollupAccumulator &other) {
+    if (other.count == 0) {
+      return;
+    }
+    sumRaw += other.sumRaw;
+    minRaw = min(minRaw, other.minRaw);
+    maxRaw = max(maxRaw, other.maxRaw);
+    count += other.count;
+  }
+  
+  RollupBucket toBucket() const {
+    RollupBucket bucket;
+    if (count > 0) {
+      bucket.minRaw = minRaw;
+      bucket.maxRaw = maxRaw;
+      bucket.avgRaw = (int16_t)(sumRaw / count);
+    } else {
+      bucket.minRaw = bucket.maxRaw = bucket.avgRaw = TEMP_RAW_INVALID;
+    }
+    bucket.count = count;
+    return bucket;
+  }
+};
+
+// 单个汇总层：已完成的桶 + 当前正在累计的桶
+template <int Capacity>
+struct RollupTier {
+  RingBuffer<RollupBucket, Capacity> buckets;
+  RollupAccumulator pending;
+  int pendingParts;            // 当前桶已并入的下级桶数量
+  unsigned long lastCloseTime; // 最新一个已完成桶的结束时间（毫秒）
+  
+  void reset() {
+    buckets.clear();
+    pending.reset();
+    pendingParts = 0;
+    lastCloseTime = 0;
+  }
+  
+  // 结束当前桶，返回其累计值供并入下一层
+  RollupAccumulator close(unsigned long closeTime) {
+    RollupAccumulator closed = pending;
+    buckets.push(pending.toBucket());
+    pending.reset();
+    pendingParts = 0;
+    lastCloseTime = closeTime;
+    return closed;
+  }
+};
+
+// 单个传感器的多分辨率历史
+struct TempRollup {
+  RingBuffer<int16_t, ROLLUP_RAW_RECORDS> raw;  // 最近的原始读数（1/16°C）
+  RingBuffer<uint32_t, ROLLUP_RAW_RECORDS> rawTimes;  // 各原始读数的时间（毫秒），读取间隔可在运行时修改，不能由周期倒推
+  unsigned long lastRawTime;                    // 最新原始读数的时间（毫秒）
+  RollupTier<ROLLUP_FINE_RECORDS> fine;
+  RollupTier<ROLLUP_HOURLY_RECORDS> hourly;
+  RollupTier<ROLLUP_DAILY_RECORDS> daily;
+  
+  void reset() {
+    raw.clear();
+    rawTimes.clear();
+    lastRawTime = 0;
+    fine.reset();
+    hourly.reset();
+    daily.reset();
+  }
+  
+  // 每次读数调用（未连接时写入缺失占位，只进入原始层）
+  void addReading(float temp, unsigned long timestamp) {
+    int16_t value = tempToRaw(temp);
+    raw.push(value);
+    rawTimes.push(timestamp);
+    lastRawTime = timestamp;
+    if (value != TEMP_RAW_INVALID) {
+      fine.pending.add(value);
+    }
+  }
+  
+  // 每个存储间隔结束时调用，逐层向上并入
+  void closeInterval(unsigned long closeTime) {
+    RollupAccumulator closed = fine.close(closeTime);
+    
+    hourly.pending.merge(closed);
+    if (++hourly.pendingParts < (int)(ROLLUP_HOUR_MS / TEMP_STORE_INTERVAL)) {
+      return;
+    }
+    closed = hourly.close(closeTime);
+    
+    daily.pending.merge(closed);
+    if (++daily.pendingParts < (int)(ROLLUP_DAY_MS / ROLLUP_HOUR_MS)) {
+      return;
+    }
+    daily.close(closeTime);
+  }
+  
+  // 从持久化记录恢复一个12分钟桶
+  // cascade 为 false 时只恢复12分钟层（小时/天层已由快照恢复）
+  void restoreInterval(const RollupBucket &bucket, unsigned long closeTime, bool cascade) {
+    if (!cascade) {
+      fine.buckets.push(bucket);
+      fine.lastCloseTime = closeTime;
+      return;
+    }
+    fine.pending.reset();
+    fine.pending.mergeBucket(bucket);
+    closeInterval(closeTime);
+  }
+  
+  // 各层每个点/桶代表的时长（毫秒），原始层为当前的读取间隔（只用于选择层级和步长）
+  static unsigned long tierPeriod(int tier) {
+    switch (tier) {
+      case TIER_RAW: return tempUpdateInterval;
+      case TIER_FINE: return TEMP_STORE_INTERVAL;
+      case TIER_HOURLY: return ROLLUP_HOUR_MS;
+      default: return ROLLUP_DAY_MS;
+    }
+  }
+  
+  // 各层最多能覆盖的时长（毫秒）
+  static unsigned long tierSpan(int tier) {
+    switch (tier) {
+      case TIER_RAW: return tierPeriod(tier) * ROLLUP_RAW_RECORDS;
+      case TIER_FINE: return tierPeriod(tier) * ROLLUP_FINE_RECORDS;
+      case TIER_HOURLY: return tierPeriod(tier) * ROLLUP_HOURLY_RECORDS;
+      default: return tierPeriod(tier) * ROLLUP_DAILY_RECORDS;
+    }
+  }
+  
+  // 选择能覆盖所请求时长的最细层级
+  static int tierForSpan(unsigned long spanMs) {
+    for (int tier = TIER_RAW; tier < TIER_DAILY; tier++) {
+      if (tierSpan(tier) >= spanMs) {
+        return tier;
+      }
+    }
+    return TIER_DAILY;
+  }
+  
+  // 指定层级的点数
+  int count(int tier) const {
+    switch (tier) {
+      case TIER_RAW: return raw.size();
+      case TIER_FINE: return fine.buckets.size();
+      case TIER_HOURLY: return hourly.buckets.size();
+      default: return daily.buckets.size();
+    }
+  }
+  
+  // 指定层级第index个点（按时间顺序）的时间（毫秒），汇总层为桶的结束时间
+  // 原始层使用记录的时间；汇总层按固定周期排列，由最新一个桶的时间倒推
+  unsigned long timeAt(int tier, int index) const {
+    unsigned long newest;
+    switch (tier) {
+      case TIER_RAW: return rawTimes[index];
+      case TIER_FINE: newest = fine.lastCloseTime; break;
+      case TIER_HOURLY: newest = hourly.lastCloseTime; break;
+      default: newest = daily.lastCloseTime; break;
+    }
+    return newest - (unsigned long)(count(tier) - 1 - index) * tierPeriod(tier);
+  }
+  
+  // 单个读数作为桶：最小/最大/平均值均为读数本身
+  static RollupBucket readingBucket(int16_t value) {
+    RollupBucket bucket = {value, value, value, (uint16_t)(value != TEMP_RAW_INVALID)};
+    return bucket;
+  }
+  
+  // 指定层级第index个点（按时间顺序）
+  RollupBucket bucketAt(int tier, int index) const {
+    switch (tier) {
+      case TIER_RAW: return readingBucket(raw[index]);
+      case TIER_FINE: return fine.buckets[index];
+      case TIER_HOURLY: return hourly.buckets[index];
+      default: return daily.buckets[index];
+    }
+  }
+};
+
+// 历史查询结果中的一个点：age 为距查询时刻的毫秒数，bucket 为该步长内的汇总值
+struct HistoryPoint {
+  unsigned long age;
+  RollupBucket bucket;
 };
 
+#define HISTORY_QUERY_MAX_POINTS 120  // 单次查询最多返回的点数（不小于GRAPH_WIDTH）
+
 // 图表状态结构
 struct GraphState {
   float lastMinTemp;
@@ -154,26 +575,144 @@ struct GraphState {
   char lastTimeLabels[5][8];  // 存储时间标签文本
 };
 
-// 报警状态结构
-struct AlarmState {
-  bool highAlarm;
-  bool lowAlarm;
-  unsigned long lastBlinkTime;
-  bool blinkState;
-};
-
 // 添加显示状态结构
 struct DisplayState {
   bool needsRedraw;  // 是否需要重绘
   int lastSelectedSensor;  // 上次选择的传感器
   DisplayMode lastMode;  // 上次的显示模式
-  float lastTemps[16];  // 上次显示的温度值
-  bool lastAlarmStates[16][2];  // 上次的报警状态 [传感器][高温/低温]
+};
+
+// 传感器注册表：容量由模板参数决定，按字段分组存放（结构数组），
+// 报警检查、概览差异比较、JSON生成等遍历只访问连续的同类数据。
+//
+// 每通道内存占用 = sizeof(TempRecord) + sizeof(TempRollup) + 39 字节
+//   addresses 8 + currentTemps 4 + displayedTemps 4 + publishedTemps 4 + lastBlinkTime 4
+//   + highAlarm/lowAlarm/blinkState/displayedHighAlarm/displayedLowAlarm/telemetryDirty 6
+//   + retainedTenths 2 + retainedStatsSeq 4 + retainedAlarm/retainedTopics 2
+//   + 扫描标记 rescanFound 1
+// 当前 TempRecord 约 1KB（240 个样本，每样本 4 字节），TempRollup 约 3.0KB（原始层 6 字节/点（读数+时间），
+// 其余各层 8 字节/桶），即每通道约 4.1KB，16 通道约 66KB。
+template <int Capacity>
+struct SensorRegistry {
+  static const int CAPACITY = Capacity;
+  
+  int count;                             // 当前传感器数量
+  DeviceAddress addresses[Capacity];     // 传感器序列号
+  float currentTemps[Capacity];          // 当前温度值缓存
+  TempRecord records[Capacity];          // 历史记录与统计数据
+  TempRollup rollups[Capacity];          // 多分辨率汇总历史
+  
+  // 报警状态
+  bool highAlarm[Capacity];
+  bool lowAlarm[Capacity];
+  bool blinkState[Capacity];
+  unsigned long lastBlinkTime[Capacity];
+  
+  // 上次显示的内容（用于局部刷新）
+  float displayedTemps[Capacity];
+  bool displayedHighAlarm[Capacity];
+  bool displayedLowAlarm[Capacity];
+  
+  // 遥测：上次发布的温度，以及超出死区尚未发布的标记
+  float publishedTemps[Capacity];
+  bool telemetryDirty[Capacity];
+  
+  // 单传感器保留主题：上次发布的内容，以及本次连接中已发布的主题（SENSOR_TOPIC_* 位）
+  int16_t retainedTenths[Capacity];    // current 的温度（0.1°C，未连接为INT16_MIN）
+  uint32_t retainedStatsSeq[Capacity]; // stats 对应的样本序号
+  uint8_t retainedAlarm[Capacity];     // alarm 状态（SensorAlarmState）
+  uint8_t retainedTopics[Capacity];
+  
+  bool full() const {
+    return count >= Capacity;
+  }
+  
+  // 按序列号查找传感器索引，未找到返回-1
+  int find(const DeviceAddress address) const {
+    for (int i = 0; i < count; i++) {
+      if (memcmp(addresses[i], address, sizeof(DeviceAddress)) == 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  
+  // 追加传感器并初始化该通道的全部状态，已满返回-1
+  int add(const DeviceAddress address) {
+    if (full()) {
+      return -1;
+    }
+    int index = count++;
+    memcpy(addresses[index], address, sizeof(DeviceAddress));
+    resetChannel(index);
+    return index;
+  }
+  
+  void resetChannel(int index) {
+    currentTemps[index] = DEVICE_DISCONNECTED_C;
+    
+    records[index].reset();
+    rollups[index].reset();
+    
+    highAlarm[index] = false;
+    lowAlarm[index] = false;
+    blinkState[index] = false;
+    lastBlinkTime[index] = 0;
+    
+    displayedTemps[index] = 0;
+    displayedHighAlarm[index] = false;
+    displayedLowAlarm[index] = false;
+    
+    publishedTemps[index] = DEVICE_DISCONNECTED_C;
+    telemetryDirty[index] = false;
+    
+    retainedTenths[index] = INT16_MIN;
+    retainedStatsSeq[index] = 0;
+    retainedAlarm[index] = 0;
+    retainedTopics[index] = 0;
+  }
 };
 
 // 全局变量定义
 int selectedSensor = -1;      // 当前选择的传感器，-1表示显示所有
-int totalSensors = 0;         // 总传感器数量
+SensorRegistry<MAX_SENSORS> sensorRegistry;  // 所有传感器的数据
+CompressedSeriesPool<FULLRATE_BLOCK_BYTES, FULLRATE_POOL_BLOCKS, MAX_SENSORS> fullRateHistory;  // 全速率读数历史
+
+// 小时/天层快照的条目（格式见 HistoryStore.h）
+struct HistSnapshotEntry {
+  uint8_t address[8];
+  RollupTier<ROLLUP_HOURLY_RECORDS> hourly;
+  RollupTier<ROLLUP_DAILY_RECORDS> daily;
+};
+
+// 历史帧的分段日志与快照（LittleFS）
+typedef HistoryStore<fs::FS, File, MAX_SENSORS, HIST_MAX_SEGMENTS, HIST_FLUSH_FRAMES> HistStore;
+HistStore historyStore(LittleFS, HIST_DIR, HIST_SNAPSHOT_FILE, HIST_SNAPSHOT_TMP, HIST_SEGMENT_SIZE);
+
+// 遥测条目：采集时刻的快照，直接发布或进入离线缓存，补发时再序列化
+struct TelemetryEntry {
+  uint32_t capturedAt;    // 采集时的 millis()
+  uint32_t realTime;      // 采集时的真实时间（未同步时为0）
+  uint32_t seq;           // 采集时的样本序号
+  uint8_t full;           // 是否为全量发布
+  uint8_t sensorMask[(MAX_SENSORS + 7) / 8];  // 包含的传感器（每通道一位）
+  int16_t raw[MAX_SENSORS];  // 温度（1/16°C），未连接为TEMP_RAW_INVALID
+  
+  void include(int sensor) { sensorMask[sensor / 8] |= 1 << (sensor % 8); }
+  bool includes(int sensor) const { return sensorMask[sensor / 8] & (1 << (sensor % 8)); }
+};
+
+// 离线缓存：内存队列 + 闪存溢出文件
+TelemetrySpool<TelemetryEntry, TELEMETRY_QUEUE_SIZE, fs::FS, File> telemetrySpool(LittleFS, TELEMETRY_SPILL_FILE,
+                                                                                   TELEMETRY_SPILL_MAX);
+
+// 历史查询（MQTT query 命令与图表共用结果缓冲区，二者均在loop中顺序执行）
+HistoryPoint historyPoints[HISTORY_QUERY_MAX_POINTS];
+bool historyQueryRequested = false;  // 是否有待回复的查询
+int historyQuerySensor = 0;          // 待回复查询的传感器索引
+unsigned long historyQueryFrom = 0;  // 待回复查询的起点（距现在的毫秒数）
+unsigned long historyQueryTo = 0;    // 待回复查询的终点（距现在的毫秒数）
+unsigned long historyQueryStep = 0;  // 待回复查询的步长（毫秒，0表示按时间跨度自动选择）
 
 // 函数前向声明
 void drawGraphBackground(int sensorIndex);
@@ -185,29 +724,55 @@ void onButton1Click();
 void onButton2Click();
 void onButton3Click();
 void onButton4Click();
+void onButton1LongPress();
+int queryHistory(int sensorIndex, unsigned long now, unsigned long fromAge, unsigned long toAge,
+                 unsigned long &step, HistoryPoint *points, int maxPoints, int &tier);
 void checkTemperatureAlarms(int sensorIndex, float temp);
 void updateDisplay();
 void readTemperatures();
-void connectWiFi();           // 添加WiFi连接函数
-void checkWiFiStatus();       // 添加WiFi状态检查函数
+void handleTemperatureReading(int index, float tempC, unsigned long readTime);  // 采集状态机的读数回调
+void handleSensorReading(int sensorIndex, float tempC, unsigned long currentMillis, int storeSlots);
+void rescanSensors();          // 后台重新扫描传感器
+void setupHistoryStore();      // 初始化历史数据存储并恢复历史
+void appendHistoryFrames(int frames);  // 记录最近的存储间隔
+void flushHistoryFrames();     // 将待写入的帧写入闪存
+void saveHistorySnapshot();    // 保存小时/天层快照
+void serviceConnectivity();   // WiFi/MQTT连接状态机
+void mqttConnectTask(void *parameter);  // 后台MQTT连接任务
+void loadWifiFastCache();     // 读取WiFi快速连接参数
+void saveWifiFastCache();     // 保存当前WiFi连接参数
 void displayWiFiStatus();     // 添加WiFi状态显示函数
 void displayMQTTStatus();     // 添加MQTT状态显示函数
-void connectMQTT();           // 添加MQTT连接函数
-void checkMQTTStatus();       // 添加MQTT状态检查函数
 void mqttCallback(char* topic, byte* payload, unsigned int length);  // MQTT消息回调函数
 void publishTemperatureData();  // 发布温度数据函数
-String createTemperatureJSON(); // 创建温度JSON数据函数
+void publishHistoryQuery();     // 回复历史查询函数
+void writeTemperatureJSON(Print &out, time_t now, bool delta, uint32_t since, int onlySensor); // 输出温度JSON数据函数
+void writeTemperatureMsgPack(Print &out, time_t now, bool delta, uint32_t since, int onlySensor); // 输出温度MessagePack数据函数
+void writeTemperaturePayload(Print &out, time_t now, PayloadFormat format, bool delta, uint32_t since, int onlySensor); // 按格式输出温度数据函数
+void serviceMqttOutbox();       // 发送队列中的MQTT消息函数
+void handlePubAck(uint16_t packetId); // QoS1发布确认回调函数
+PayloadKey makePayloadKey(PayloadFormat format, bool delta, uint32_t since, int sensor); // 负载缓存键
+void rememberOwnPublish(size_t length, uint32_t hash);  // 记录发布到订阅主题上的负载
+void setScreenPower(bool on);   // 开关屏幕函数
+bool sampleDeltaAvailable(uint32_t since); // 增量请求的样本是否仍全部保留
+void checkTelemetryChange(int sensorIndex);  // 检查温度是否超出遥测死区
+void publishTelemetry();        // 定时/变化遥测发布函数
+void drainTelemetryQueue();     // 补发离线缓存的遥测
+bool sendTelemetryEntry(const TelemetryEntry &entry, unsigned long currentMillis); // 发布一个遥测条目
+void writeTelemetryJSON(Print &out, const TelemetryEntry &entry, unsigned long currentMillis); // 输出遥测JSON数据函数
+void publishSensorTopics();     // 发布单传感器保留主题函数
+void invalidateSensorTopics(uint8_t topics); // 标记单传感器主题需要重新发布
 void setupPowerManagement();   // 电源管理设置函数
 void monitorPowerStatus();     // 电源状态监控函数
 void printSystemInfo();        // 打印系统信息函数
 void setupTimeSync();          // 时间同步设置函数
+void setupTasks();             // 注册定时任务函数
 void syncTime();               // 时间同步函数
+uint64_t monotonicMillis();    // 64位单调时间（毫秒）
 time_t getCurrentRealTime();   // 获取当前真实时间函数
+time_t realTimeAtMillis(unsigned long timestamp); // millis()时间戳换算为真实时间函数
 String formatRealTime(time_t timestamp); // 格式化真实时间函数
 
-// 添加全局变量存储传感器序列号
-DeviceAddress sensorAddresses[16];  // 存储传感器序列号
-
 // 辅助函数实现
 String getShortAddress(DeviceAddress deviceAddress) {
   String result;
@@ -223,34 +788,38 @@ String getShortAddress(DeviceAddress deviceAddress) {
 }
 
 static String getSensorTitle(int sensorIndex) {
-  String shortAddr = getShortAddress(sensorAddresses[sensorIndex]);
+  String shortAddr = getShortAddress(sensorRegistry.addresses[sensorIndex]);
   return "T" + String(sensorIndex + 1) + "/" + shortAddr;
 }
 
 bool firstDraw = true;      // 首次绘制标志
-float lastTemps[16] = {0};  // 假设最多16个传感器
 bool screenOn = true;  // 屏幕开关状态
 
 DisplayMode currentMode = MODE_OVERVIEW;
-TempRecord sensorRecords[16];  // 假设最多16个传感器
 GraphState graphState = {0};   // 图表状态
-AlarmState alarmStates[16];  // 每个传感器的报警状态
-DisplayState displayState = {false, -1, MODE_OVERVIEW, {0}, {{false}}};
-
-// 添加新的全局变量
-unsigned long lastScreenCommandTime = 0;
-bool screenCommandPending = false;
-bool screenCommandType = false;  // false = 关闭命令, true = 开启命令
+int graphTier = TIER_FINE;     // 图表显示的汇总层级（长按K1切换）
+const char* const GRAPH_TIER_LABELS[TIER_COUNT] = {"5m", "24h", "7d", "31d"};
+DisplayState displayState = {false, -1, MODE_OVERVIEW};
+
+// 定时任务
+TaskScheduler<10> scheduler;
+int screenTask = -1;       // 屏幕开关（单次任务）
+int temperatureTask = -1;  // 温度采集（单次任务，每次执行后按采集状态重新排期）
+int rescanTask = -1;       // 后台扫描传感器（单次任务，同上）
+bool screenWakePending = false;  // 已发送退出睡眠命令，等待开启显示
 unsigned long lastTempRequestTime = 0;
 bool tempRequestPending = false;
 unsigned long lastTempStoreTime = 0;  // 上次温度存储时间
 unsigned long lastTempUpdateTime = 0;  // 上次温度显示更新时间
 bool displayNeedsUpdate = false;  // 标记是否需要更新显示
 
-// 添加新的全局变量
-unsigned long lastTempReadTime = 0;  // 上次读取温度的时间
-float currentTemps[16] = {0};       // 当前温度值缓存
-bool tempReadPending = false;       // 温度读取状态标志
+// 温度采集：本轮需要写入的存储间隔数（0表示不存储），发起转换时确定
+int tempStoreSlots = 0;
+
+// 传感器热插拔扫描状态
+unsigned long lastSensorRescanTime = 0;      // 上次开始扫描的时间
+bool sensorRescanActive = false;             // 是否正在进行分步扫描
+bool rescanFound[MAX_SENSORS];               // 本轮扫描中已找到的传感器
 
 // 全局对象定义
 TFT_eSPI tft;
@@ -258,17 +827,84 @@ TFT_eSPI tft;
 OneWire oneWire(ONEWIRE_BUS);
 DallasTemperature sensors(&oneWire);
 
+// 温度采集状态机使用的总线：按缓存的序列号直接读取暂存器，避免getTempCByIndex每次重新搜索总线
+class DallasSensorBus : public TempSensorBus {
+ public:
+  explicit DallasSensorBus(DallasTemperature &sensors) : sensors_(sensors) {}
+  void requestConversion() override { sensors_.requestTemperatures(); }  // 已设置为不等待转换完成
+  bool conversionComplete() override { return sensors_.isConversionComplete(); }
+  float readTemperature(const uint8_t *address) override { return sensors_.getTempC(address); }
+
+ private:
+  DallasTemperature &sensors_;
+};
+
+DallasSensorBus sensorBus(sensors);
+TempAcquisition tempAcquisition(sensorBus, millis, TEMP_CONVERSION_MARGIN_MS, TEMP_CONVERSION_MIN_MS, TEMP_READ_BUDGET_MS);
+
 OneButton button1(KEY1_PIN, true);  // 使用内部上拉，启用消抖
 OneButton button2(KEY2_PIN, true);
 OneButton button3(KEY3_PIN, true);
 OneButton button4(KEY4_PIN, true);
 
-WiFiClientSecure espClient;  // 使用SSL客户端
-PubSubClient mqttClient(espClient);
-
 // SSL配置（用于EMQX云服务）
 #define MQTT_USE_SSL true  // 启用SSL连接
 
+WiFiClient netClient;                   // TCP连接
+TlsSessionClient tlsClient(netClient);  // SSL客户端，保存会话供重连时恢复
+MqttAckTap mqttTransport(MQTT_USE_SSL ? (Client&)tlsClient : (Client&)netClient);  // 转发网络读写并取出PUBACK
+PubSubClient mqttClient(mqttTransport);
+MqttOutbox<MQTT_OUTBOX_SIZE, MQTT_OUTBOX_TOPIC, MQTT_OUTBOX_PAYLOAD> mqttOutbox;  // MQTT发送队列
+PublishEchoFilter<MQTT_ECHO_SLOTS> mqttEchoFilter;  // 发布到订阅主题上的消息，收到回送时忽略
+
+// 网络连接状态机，每次loop只执行当前状态的一步
+enum NetState {
+  NET_WIFI_START,      // 发起WiFi连接（立即返回）
+  NET_WIFI_WAIT,       // 等待关联并获取IP
+  NET_WIFI_BACKOFF,    // WiFi连接失败，等待重试
+  NET_MQTT_TRANSPORT,  // 发起MQTT连接（交给后台任务，立即返回）
+  NET_MQTT_CONNECTING, // 后台任务建立网络连接（TCP + TLS握手）、发送CONNECT并等待CONNACK
+  NET_MQTT_SUBSCRIBE,  // 订阅命令主题
+  NET_MQTT_BACKOFF,    // MQTT连接失败，等待重试
+  NET_ONLINE           // 已连接，处理MQTT消息
+};
+NetState netState = NET_WIFI_START;
+
+// 后台MQTT连接任务：网络连接、TLS握手和等待CONNACK都会阻塞，放在独立任务中执行，
+// 主循环只轮询结果，期间照常采集温度、刷新屏幕和响应按键。
+// 任务运行时只有它访问 mqttTransport/mqttClient，主循环要等结果出来后再操作连接
+enum MqttConnectResult {
+  MQTT_CONNECT_IDLE,       // 没有进行中的连接
+  MQTT_CONNECT_RUNNING,    // 任务正在连接
+  MQTT_CONNECT_TRANSPORT_FAILED,  // 网络连接或TLS握手失败
+  MQTT_CONNECT_SESSION_FAILED,    // CONNECT被拒绝或等待CONNACK超时
+  MQTT_CONNECT_OK
+};
+volatile MqttConnectResult mqttConnectResult = MQTT_CONNECT_IDLE;
+TaskHandle_t mqttConnectTaskHandle = NULL;
+unsigned long netStateTime = 0;    // 进入当前状态的时间
+unsigned long netRetryDelay = 0;   // 退避状态需要等待的时间
+ExponentialBackoff wifiBackoff(WIFI_BACKOFF_MIN, WIFI_BACKOFF_MAX);
+unsigned long wifiConnectStartTime = 0;  // 本次WiFi连接开始的时间
+
+// 上次成功连接的WiFi参数（NVS中保存的副本）
+struct WifiFastCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+#define WIFI_FAST_CACHE_MAGIC 0x57464331  // "WFC1"
+WifiFastCache wifiFastCache;
+bool wifiFastCacheValid = false;
+bool wifiFastAttempt = false;  // 当前连接是否为快速连接
+bool wifiFastFailed = false;   // 快速连接失败，下次使用完整扫描
+ExponentialBackoff mqttBackoff(MQTT_BACKOFF_MIN, MQTT_BACKOFF_MAX);
+
 // 函数实现
 void drawGraphBackground(int sensorIndex) {
   // 绘制图表边框
@@ -322,6 +958,150 @@ void updateTempInfo(float minTemp, float maxTemp, float avgTemp, float currentTe
   tft.drawString(String(minTemp, 1), 2 + x_spacing * 3, INFO_TOP);
 }
 
+// 从全速率压缩历史中按步长分组查询（参数同 queryHistory，step 已确定）。
+// 压缩数据只能从最旧的点顺序解码，跳过 fromAge 之前的点；
+// 分组数限制在 maxPoints 以内（只保留最新的部分），结果已按时间顺序排列
+static int queryFullRateHistory(int sensorIndex, unsigned long now, unsigned long fromAge, unsigned long toAge,
+                                unsigned long step, HistoryPoint *points, int maxPoints) {
+  if ((fromAge - toAge) / step >= (unsigned long)maxPoints) {
+    fromAge = toAge + step * maxPoints - 1;
+  }
+  
+  int pointCount = 0;
+  long group = -1;
+  unsigned long groupAge = 0;
+  RollupAccumulator accumulator;
+  accumulator.reset();
+  decltype(fullRateHistory)::Reader reader(fullRateHistory, sensorIndex);
+  uint32_t time;
+  int16_t value;
+  while (reader.next(time, value)) {
+    unsigned long age = now - time * FULLRATE_TIME_UNIT_MS;
+    if (age > fromAge) {
+      continue;
+    }
+    if (age < toAge) {
+      break;
+    }
+    long readingGroup = (long)((age - toAge) / step);
+    if (readingGroup != group) {
+      if (group >= 0) {
+        points[pointCount].age = groupAge;
+        points[pointCount].bucket = accumulator.toBucket();
+        pointCount++;
+      }
+      group = readingGroup;
+      accumulator.reset();
+    }
+    groupAge = age;
+    accumulator.mergeBucket(TempRollup::readingBucket(value));
+  }
+  if (group >= 0) {
+    points[pointCount].age = groupAge;
+    points[pointCount].bucket = accumulator.toBucket();
+    pointCount++;
+  }
+  return pointCount;
+}
+
+// 按时间范围查询历史
+// fromAge/toAge 为距 now 的毫秒数（fromAge >= toAge），step 为结果的时间步长（0表示按层级周期），返回实际使用的步长。
+// 层级取能覆盖 fromAge 的最细层级与周期不超过 step 的最粗层级中较粗的一个，
+// 步长小于层级周期时按层级周期返回，否则多个桶合并为一个点。
+// 但若所请求的范围仍在全速率压缩历史中，且步长（0时取跨度/maxPoints）小于层级周期，
+// 改从压缩历史按步长汇总读数，tier 返回 TIER_FULLRATE。
+// 各层时间戳单调递增，按二分查找定位范围两端，只访问范围内的桶。
+// 结果按时间顺序写入 points，超过 maxPoints 时只保留最新的部分，返回点数，tier 返回所用层级。
+int queryHistory(int sensorIndex, unsigned long now, unsigned long fromAge, unsigned long toAge,
+                 unsigned long &step, HistoryPoint *points, int maxPoints, int &tier) {
+  const TempRollup &rollup = sensorRegistry.rollups[sensorIndex];
+  
+  tier = TempRollup::tierForSpan(fromAge);
+  while (tier < TIER_DAILY && TempRollup::tierPeriod(tier + 1) <= step) {
+    tier++;
+  }
+  
+  if (tier != TIER_RAW && fromAge >= toAge && maxPoints > 0 && fullRateHistory.points(sensorIndex) > 0 &&
+      now - fullRateHistory.oldestTime(sensorIndex) * FULLRATE_TIME_UNIT_MS >= fromAge) {
+    unsigned long fullRateStep = step > 0 ? step : (fromAge - toAge) / maxPoints + 1;
+    fullRateStep = max(fullRateStep, TempRollup::tierPeriod(TIER_RAW));
+    if (fullRateStep < TempRollup::tierPeriod(tier)) {
+      tier = TIER_FULLRATE;
+      step = fullRateStep;
+      return queryFullRateHistory(sensorIndex, now, fromAge, toAge, step, points, maxPoints);
+    }
+  }
+  step = max(step, TempRollup::tierPeriod(tier));
+  
+  int count = rollup.count(tier);
+  if (count == 0 || fromAge < toAge || maxPoints <= 0) {
+    return 0;
+  }
+  
+  // 最后一个 age >= toAge 的点（下标越大越新，age越小）
+  int lo = 0;
+  int hi = count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (now - rollup.timeAt(tier, mid) >= toAge) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  int last = lo - 1;
+  
+  // 第一个 age <= fromAge 的点
+  lo = 0;
+  hi = last + 1;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (now - rollup.timeAt(tier, mid) > fromAge) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  int first = lo;
+  
+  // 从最新的桶开始按步长分组（以 toAge 为起点），写满 maxPoints 后停止
+  int pointCount = 0;
+  long group = -1;
+  unsigned long groupAge = 0;
+  RollupAccumulator accumulator;
+  accumulator.reset();
+  for (int i = last; i >= first; i--) {
+    unsigned long age = now - rollup.timeAt(tier, i);
+    long bucketGroup = (long)((age - toAge) / step);
+    if (bucketGroup != group) {
+      if (group >= 0) {
+        points[pointCount].age = groupAge;
+        points[pointCount].bucket = accumulator.toBucket();
+        if (++pointCount >= maxPoints) {
+          break;
+        }
+      }
+      group = bucketGroup;
+      groupAge = age;
+      accumulator.reset();
+    }
+    accumulator.mergeBucket(rollup.bucketAt(tier, i));
+  }
+  if (group >= 0 && pointCount < maxPoints) {
+    points[pointCount].age = groupAge;
+    points[pointCount].bucket = accumulator.toBucket();
+    pointCount++;
+  }
+  
+  // 转为时间顺序（最旧在前）
+  for (int i = 0, j = pointCount - 1; i < j; i++, j--) {
+    HistoryPoint temp = points[i];
+    points[i] = points[j];
+    points[j] = temp;
+  }
+  return pointCount;
+}
+
 void drawGraph(int sensorIndex) {
   static int lastSensorIndex = -1;
   static float lastMinTemp = -999;
@@ -329,10 +1109,14 @@ void drawGraph(int sensorIndex) {
   static float lastAvgTemp = -999;
   static float lastCurrentTemp = -999;
   static int lastRecordCount = 0;
+  static unsigned long lastRecordTimestamp = 0;
+  static int lastGraphTier = TIER_FINE;
+  static unsigned long lastRawTimestamp = 0;
   
   // 检查是否需要完全重绘
   bool needsFullRedraw = firstDraw || 
                         (lastSensorIndex != sensorIndex) || 
+                        (lastGraphTier != graphTier) ||
                         graphState.needsFullRedraw;
   
   if (needsFullRedraw) {
@@ -349,32 +1133,38 @@ void drawGraph(int sensorIndex) {
     shortAddr.reserve(8);
     for (int i = 4; i < 8; i++) {
       char hex[3];
-      sprintf(hex, "%02X", sensorAddresses[sensorIndex][i]);
+      sprintf(hex, "%02X", sensorRegistry.addresses[sensorIndex][i]);
       shortAddr += hex;
     }
     String title = "T" + String(sensorIndex + 1) + "/" + shortAddr;
+    if (graphTier != TIER_FINE) {
+      title += " ";
+      title += GRAPH_TIER_LABELS[graphTier];
+    }
     tft.drawString(title, SCREEN_WIDTH/2, TITLE_HEIGHT/2);
     
     drawGraphBackground(sensorIndex);
     lastSensorIndex = sensorIndex;
+    lastGraphTier = graphTier;
     graphState.needsFullRedraw = false;
     
     // 使用当前温度值初始化状态变量
-    float currentTemp = currentTemps[sensorIndex];
+    float currentTemp = sensorRegistry.currentTemps[sensorIndex];
     if (currentTemp != DEVICE_DISCONNECTED_C) {
       lastMinTemp = currentTemp;
       lastMaxTemp = currentTemp;
       lastAvgTemp = currentTemp;
       lastCurrentTemp = currentTemp;
     }
-    lastRecordCount = sensorRecords[sensorIndex].recordCount;
+    lastRecordCount = sensorRegistry.records[sensorIndex].count();
+    lastRecordTimestamp = sensorRegistry.records[sensorIndex].lastTimestamp;
   }
   
   // 使用存储的统计数据
-  float minTemp = sensorRecords[sensorIndex].minTemp;
-  float maxTemp = sensorRecords[sensorIndex].maxTemp;
-  float avgTemp = sensorRecords[sensorIndex].avgTemp;
-  float currentTemp = currentTemps[sensorIndex];
+  float minTemp = sensorRegistry.records[sensorIndex].minTemp;
+  float maxTemp = sensorRegistry.records[sensorIndex].maxTemp;
+  float avgTemp = sensorRegistry.records[sensorIndex].avgTemp;
+  float currentTemp = sensorRegistry.currentTemps[sensorIndex];
   
   // 检查是否需要更新温度信息
   bool needsInfoUpdate = needsFullRedraw ||
@@ -393,7 +1183,9 @@ void drawGraph(int sensorIndex) {
   
   // 检查是否需要重绘图表
   bool needsGraphUpdate = needsFullRedraw ||
-                         (sensorRecords[sensorIndex].recordCount != lastRecordCount);
+                         (sensorRegistry.records[sensorIndex].count() != lastRecordCount) ||
+                         (sensorRegistry.records[sensorIndex].lastTimestamp != lastRecordTimestamp) ||  // 缓冲区写满后数量不变，按最新时间戳判断
+                         (graphTier == TIER_RAW && sensorRegistry.rollups[sensorIndex].lastRawTime != lastRawTimestamp);
   
   if (needsGraphUpdate) {
     // 清除旧图表（包括温度刻度值区域）
@@ -404,10 +1196,15 @@ void drawGraph(int sensorIndex) {
     // 重新绘制网格线和刻度值
     drawGraphBackground(sensorIndex);
     
-    // 绘制数据点
-    for (int i = 1; i < sensorRecords[sensorIndex].recordCount; i++) {
-      float temp1 = sensorRecords[sensorIndex].temps[i-1];
-      float temp2 = sensorRecords[sensorIndex].temps[i];
+    // 查询当前层级最近 GRAPH_WIDTH 个周期的数据，每个点占一个像素
+    // 按时间顺序，最旧的点在最左侧
+    int tier;
+    unsigned long period = TempRollup::tierPeriod(graphTier);
+    unsigned long span = min((unsigned long)GRAPH_WIDTH * period, TempRollup::tierSpan(graphTier));
+    int pointCount = queryHistory(sensorIndex, millis(), span, 0, period, historyPoints, GRAPH_WIDTH, tier);
+    for (int i = 1; i < pointCount; i++) {
+      float temp1 = rawToTemp(historyPoints[i - 1].bucket.avgRaw);
+      float temp2 = rawToTemp(historyPoints[i].bucket.avgRaw);
       
       if (temp1 != DEVICE_DISCONNECTED_C && temp2 != DEVICE_DISCONNECTED_C) {
         // 计算坐标 - 现在每个数据点对应一个像素位置
@@ -423,13 +1220,15 @@ void drawGraph(int sensorIndex) {
         if (i % GRID_X_SPACING == 0) {
           tft.fillCircle(x1, y1, 1, TFT_GREEN);
         }
-        if (i == sensorRecords[sensorIndex].recordCount - 1) {
+        if (i == pointCount - 1) {
           tft.fillCircle(x2, y2, 1, TFT_GREEN);
         }
       }
     }
     
-    lastRecordCount = sensorRecords[sensorIndex].recordCount;
+    lastRecordCount = sensorRegistry.records[sensorIndex].count();
+    lastRecordTimestamp = sensorRegistry.records[sensorIndex].lastTimestamp;
+    lastRawTimestamp = sensorRegistry.rollups[sensorIndex].lastRawTime;
   }
   
   firstDraw = false;
@@ -441,12 +1240,12 @@ void displayOverview() {
                     displayState.lastMode != currentMode;
   
   // 检查每个传感器的状态是否发生变化
-  bool tempChanged[16] = {false};  // 记录每个传感器的温度是否变化
-  for (int i = 0; i < totalSensors; i++) {
-    float tempC = currentTemps[i];
-    if (abs(tempC - displayState.lastTemps[i]) >= 0.1 ||
-        alarmStates[i].highAlarm != displayState.lastAlarmStates[i][0] ||
-        alarmStates[i].lowAlarm != displayState.lastAlarmStates[i][1]) {
+  bool tempChanged[MAX_SENSORS] = {false};  // 记录每个传感器的温度是否变化
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    float tempC = sensorRegistry.currentTemps[i];
+    if (abs(tempC - sensorRegistry.displayedTemps[i]) >= 0.1 ||
+        sensorRegistry.highAlarm[i] != sensorRegistry.displayedHighAlarm[i] ||
+        sensorRegistry.lowAlarm[i] != sensorRegistry.displayedLowAlarm[i]) {
       tempChanged[i] = true;
       needsRedraw = true;
     }
@@ -472,8 +1271,8 @@ void displayOverview() {
   int startY = TITLE_HEIGHT + 5;  // 标题下方留出5像素间距
   
   // 显示所有传感器温度
-  for (int i = 0; i < totalSensors; i++) {
-    float tempC = currentTemps[i];
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    float tempC = sensorRegistry.currentTemps[i];
     int rowY = startY + (i * rowHeight);
     
     // 如果温度没有变化且不是首次显示，跳过更新
@@ -485,9 +1284,9 @@ void displayOverview() {
     tft.fillRect(0, rowY, SCREEN_WIDTH, rowHeight, TFT_BLACK);
     
     // 更新状态记录
-    displayState.lastTemps[i] = tempC;
-    displayState.lastAlarmStates[i][0] = alarmStates[i].highAlarm;
-    displayState.lastAlarmStates[i][1] = alarmStates[i].lowAlarm;
+    sensorRegistry.displayedTemps[i] = tempC;
+    sensorRegistry.displayedHighAlarm[i] = sensorRegistry.highAlarm[i];
+    sensorRegistry.displayedLowAlarm[i] = sensorRegistry.lowAlarm[i];
     
     // 显示传感器编号和序列号
     tft.setTextSize(OVERVIEW_SENSOR_SIZE);
@@ -499,7 +1298,7 @@ void displayOverview() {
     shortAddr.reserve(8);
     for (int j = 4; j < 8; j++) {
       char hex[3];
-      sprintf(hex, "%02X", sensorAddresses[i][j]);
+      sprintf(hex, "%02X", sensorRegistry.addresses[i][j]);
       shortAddr += hex;
     }
     String title = "T" + String(i + 1) + ":"; 
@@ -510,9 +1309,9 @@ void displayOverview() {
     if (tempC != DEVICE_DISCONNECTED_C) {
       tft.setTextSize(OVERVIEW_TEMP_SIZE);
       // 根据报警状态设置颜色
-      if (alarmStates[i].highAlarm) {
+      if (sensorRegistry.highAlarm[i]) {
         tft.setTextColor(TFT_RED, TFT_BLACK);
-      } else if (alarmStates[i].lowAlarm) {
+      } else if (sensorRegistry.lowAlarm[i]) {
         tft.setTextColor(TFT_BLUE, TFT_BLACK);
       } else {
         tft.setTextColor(TFT_GREEN, TFT_BLACK);
@@ -531,9 +1330,7 @@ void displayOverview() {
   displayState.needsRedraw = false;
   
   // 显示WiFi状态图标
-  if (wifiConnected) {
-    displayWiFiStatus();
-  }
+  displayWiFiStatus();
   
   // 显示MQTT状态图标
   displayMQTTStatus();
@@ -545,10 +1342,10 @@ void displayDetailView(int sensorIndex) {
                     displayState.lastMode != currentMode ||
                     displayState.lastSelectedSensor != sensorIndex;
   
-  float tempC = currentTemps[sensorIndex];
-  bool tempChanged = abs(tempC - displayState.lastTemps[sensorIndex]) >= 0.1;
-  bool alarmChanged = alarmStates[sensorIndex].highAlarm != displayState.lastAlarmStates[sensorIndex][0] ||
-                     alarmStates[sensorIndex].lowAlarm != displayState.lastAlarmStates[sensorIndex][1];
+  float tempC = sensorRegistry.currentTemps[sensorIndex];
+  bool tempChanged = abs(tempC - sensorRegistry.displayedTemps[sensorIndex]) >= 0.1;
+  bool alarmChanged = sensorRegistry.highAlarm[sensorIndex] != sensorRegistry.displayedHighAlarm[sensorIndex] ||
+                     sensorRegistry.lowAlarm[sensorIndex] != sensorRegistry.displayedLowAlarm[sensorIndex];
   
   if (!needsRedraw && !tempChanged && !alarmChanged) {
     return;  // 如果没有变化，不进行重绘
@@ -568,7 +1365,7 @@ void displayDetailView(int sensorIndex) {
     shortAddr.reserve(8);
     for (int i = 4; i < 8; i++) {
       char hex[3];
-      sprintf(hex, "%02X", sensorAddresses[sensorIndex][i]);
+      sprintf(hex, "%02X", sensorRegistry.addresses[sensorIndex][i]);
       shortAddr += hex;
     }
     String title = "T" + String(sensorIndex + 1) + "/" + shortAddr;
@@ -576,9 +1373,9 @@ void displayDetailView(int sensorIndex) {
   }
   
   // 更新状态记录
-  displayState.lastTemps[sensorIndex] = tempC;
-  displayState.lastAlarmStates[sensorIndex][0] = alarmStates[sensorIndex].highAlarm;
-  displayState.lastAlarmStates[sensorIndex][1] = alarmStates[sensorIndex].lowAlarm;
+  sensorRegistry.displayedTemps[sensorIndex] = tempC;
+  sensorRegistry.displayedHighAlarm[sensorIndex] = sensorRegistry.highAlarm[sensorIndex];
+  sensorRegistry.displayedLowAlarm[sensorIndex] = sensorRegistry.lowAlarm[sensorIndex];
   displayState.lastSelectedSensor = sensorIndex;
   
   if (tempC != DEVICE_DISCONNECTED_C) {
@@ -592,9 +1389,9 @@ void displayDetailView(int sensorIndex) {
     tft.drawString(String(tempC, 1) + "C", SCREEN_WIDTH/2, 40);
     
     // 使用存储的统计数据
-    float minTemp = sensorRecords[sensorIndex].minTemp;
-    float maxTemp = sensorRecords[sensorIndex].maxTemp;
-    float avgTemp = sensorRecords[sensorIndex].avgTemp;
+    float minTemp = sensorRegistry.records[sensorIndex].minTemp;
+    float maxTemp = sensorRegistry.records[sensorIndex].maxTemp;
+    float avgTemp = sensorRegistry.records[sensorIndex].avgTemp;
     
     // 清除统计信息显示区域
     tft.fillRect(0, 80, SCREEN_WIDTH, 60, TFT_BLACK);
@@ -648,6 +1445,23 @@ void onButton1Click() {
   Serial.println(selectedSensor);
 }
 
+// 图表模式下长按K1切换时间跨度：5分钟 -> 24小时 -> 7天 -> 31天
+void onButton1LongPress() {
+  if (currentMode != MODE_GRAPH) {
+    return;
+  }
+  int oldTier = graphTier;
+  graphTier = (graphTier + 1) % TIER_COUNT;
+  displayNeedsUpdate = true;  // 标记需要更新显示
+  
+  Serial.print("[按键1长按] 时间戳: ");
+  Serial.print(millis());
+  Serial.print("ms, 图表跨度切换: ");
+  Serial.print(GRAPH_TIER_LABELS[oldTier]);
+  Serial.print(" -> ");
+  Serial.println(GRAPH_TIER_LABELS[graphTier]);
+}
+
 void onButton2Click() {
   unsigned long clickTime = millis();
   int oldSensor = selectedSensor;
@@ -656,7 +1470,7 @@ void onButton2Click() {
     if (selectedSensor == -1) {
       selectedSensor = 0;
     } else {
-      selectedSensor = (selectedSensor + 1) % totalSensors;
+      selectedSensor = (selectedSensor + 1) % sensorRegistry.count;
     }
     displayNeedsUpdate = true;  // 标记需要更新显示
     
@@ -685,9 +1499,9 @@ void onButton3Click() {
   
   if (currentMode == MODE_DETAIL || currentMode == MODE_GRAPH) {
     if (selectedSensor == -1) {
-      selectedSensor = totalSensors - 1;
+      selectedSensor = sensorRegistry.count - 1;
     } else {
-      selectedSensor = (selectedSensor - 1 + totalSensors) % totalSensors;
+      selectedSensor = (selectedSensor - 1 + sensorRegistry.count) % sensorRegistry.count;
     }
     displayNeedsUpdate = true;  // 标记需要更新显示
     
@@ -710,15 +1524,17 @@ void onButton3Click() {
   }
 }
 
+// 设置屏幕开关，实际的开关操作由屏幕任务在loop中执行
+void setScreenPower(bool on) {
+  screenOn = on;
+  screenWakePending = false;
+  scheduler.schedule(screenTask, 0, millis());
+}
+
 void onButton4Click() {
   unsigned long clickTime = millis();
   bool oldScreenState = screenOn;
-  screenOn = !screenOn;
-  
-  // 设置屏幕命令状态
-  screenCommandPending = true;
-  screenCommandType = screenOn;
-  lastScreenCommandTime = clickTime;
+  setScreenPower(!screenOn);
   
   // 添加详细日志
   Serial.print("[按键4] 时间戳: ");
@@ -732,49 +1548,55 @@ void onButton4Click() {
 void setup() {
   Serial.begin(115200);
   Serial.println("EdenSense 温度监控系统启动...");
+  bootSession = esp_random() & 0x1FFFFF;
 
   // 初始化电源管理
   setupPowerManagement();
 
-  // 初始化WiFi
-  Serial.println("初始化WiFi...");
-  WiFi.mode(WIFI_STA);  // 设置为站点模式
-  WiFi.setAutoReconnect(true);  // 启用自动重连
-  
-  // 设置WiFi发射功率为较低值
-  Serial.print("设置WiFi发射功率为: ");
-  Serial.print(WIFI_POWER_DBM);
-  Serial.println(" dBm");
-  esp_wifi_set_max_tx_power(WIFI_POWER_DBM * 4);  // ESP32使用0.25dBm为单位
-  
-  // 开始WiFi连接
-  connectWiFi();
-  
-  // 初始化时间同步
-  setupTimeSync();
-  
-  // 初始化MQTT（在WiFi连接成功后）
-  Serial.println("初始化MQTT客户端...");
-  mqttClient.setBufferSize(8192);  // 设置缓冲区大小为8KB
-
   // 初始化温度传感器
   sensors.begin();
-  totalSensors = sensors.getDeviceCount();
-  
-  // 获取所有传感器的序列号
-  for (int i = 0; i < totalSensors; i++) {
-    if (sensors.getAddress(sensorAddresses[i], i)) {
-      Serial.print("传感器 ");
-      Serial.print(i);
-      Serial.print(" 序列号: ");
-      for (uint8_t j = 0; j < 8; j++) {
-        Serial.print(sensorAddresses[i][j], HEX);
-        Serial.print(" ");
-      }
-      Serial.println();
+  sensorRegistry.count = 0;
+  
+  // 按当前分辨率计算最长转换时间（9位94ms ... 12位750ms）
+  // 寄生供电时总线始终读到1，无法查询转换完成状态，只能等满转换时间
+  tempAcquisition.configure(sensors.millisToWaitForConversion(sensors.getResolution()), !sensors.isParasitePowerMode());
+  tempAcquisition.onReading(handleTemperatureReading);
+  Serial.print("传感器分辨率: ");
+  Serial.print(sensors.getResolution());
+  Serial.print(" 位, 转换时间: ");
+  Serial.print(tempAcquisition.conversionMs());
+  Serial.println(tempAcquisition.pollConversion() ? " ms" : " ms（寄生供电，等待完整转换时间）");
+  
+  // 单次总线搜索获取所有传感器的序列号（getAddress按索引查找每次都要从头搜索）
+  // 超出注册表容量的传感器被忽略，避免越界写入
+  DeviceAddress address;
+  oneWire.reset_search();
+  while (oneWire.search(address)) {
+    if (!sensors.validAddress(address) || !sensors.validFamily(address)) {
+      continue;
+    }
+    int index = sensorRegistry.add(address);
+    if (index < 0) {
+      Serial.print("传感器数量超过上限 ");
+      Serial.print(MAX_SENSORS);
+      Serial.println("，其余传感器将被忽略");
+      break;
+    }
+    Serial.print("传感器 ");
+    Serial.print(index);
+    Serial.print(" 序列号: ");
+    for (uint8_t j = 0; j < 8; j++) {
+      Serial.print(address[j], HEX);
+      Serial.print(" ");
     }
+    Serial.println();
   }
   
+  // 所有通道共用一次异步转换，转换期间继续初始化显示屏、WiFi和MQTT
+  sensors.setWaitForConversion(false);
+  sensors.requestTemperatures();
+  unsigned long bootConversionStart = millis();
+  
   // 初始化显示屏
   tft.init();
   tft.setRotation(0);
@@ -787,35 +1609,74 @@ void setup() {
   
   // 初始化按键
   button1.attachClick(onButton1Click);
+  button1.attachLongPressStart(onButton1LongPress);
   button2.attachClick(onButton2Click);
   button3.attachClick(onButton3Click);
   button4.attachClick(onButton4Click);
   
-  // 初始化温度记录数组并获取初始温度值
-  for (int i = 0; i < totalSensors; i++) {
-    sensorRecords[i].recordCount = 0;
-    sensorRecords[i].currentIndex = 0;
-    sensorRecords[i].minTemp = DEVICE_DISCONNECTED_C;
-    sensorRecords[i].maxTemp = DEVICE_DISCONNECTED_C;
-    sensorRecords[i].avgTemp = DEVICE_DISCONNECTED_C;
-    sensorRecords[i].lastStatsUpdate = 0;
-    sensorRecords[i].lastRealTime = 0;  // 初始化真实时间戳
-    
-    // 获取初始温度值
-    sensors.requestTemperatures();
-    float initialTemp = sensors.getTempCByIndex(i);
+  // 初始化WiFi
+  Serial.println("初始化WiFi...");
+  WiFi.mode(WIFI_STA);  // 设置为站点模式
+  WiFi.setAutoReconnect(true);  // 启用自动重连
+  
+  // 设置WiFi发射功率为较低值
+  Serial.print("设置WiFi发射功率为: ");
+  Serial.print(WIFI_POWER_DBM);
+  Serial.println(" dBm");
+  esp_wifi_set_max_tx_power(WIFI_POWER_DBM * 4);  // ESP32使用0.25dBm为单位
+  
+  // 开始WiFi连接（立即返回，由loop中的状态机等待连接结果）
+  loadWifiFastCache();
+  serviceConnectivity();
+  
+  // 初始化时间同步
+  setupTimeSync();
+  
+  // 初始化MQTT（连接在WiFi连接成功后由状态机发起）
+  Serial.println("初始化MQTT客户端...");
+  if (MQTT_USE_SSL) {
+    Serial.println("配置SSL连接...");
+    // 不验证证书链（服务器身份由指纹校验）
+    tlsClient.setHandshakeTimeout(MQTT_TLS_TIMEOUT * 1000UL);
+    if (strlen(MQTT_TLS_FINGERPRINT) == 0) {
+      Serial.println("未配置服务器证书指纹，不校验服务器身份");
+    } else if (!tlsClient.setFingerprint(MQTT_TLS_FINGERPRINT)) {
+      Serial.println("服务器证书指纹格式错误（应为64个十六进制数字），不校验服务器身份");
+    }
+  }
+  mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+  mqttClient.setCallback(mqttCallback);
+  mqttClient.setKeepAlive(MQTT_KEEPALIVE);  // 设置保活时间
+  mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  mqttTransport.onPubAck(handlePubAck);
+  if (xTaskCreate(mqttConnectTask, "mqttConnect", MQTT_CONNECT_TASK_STACK, NULL, 1, &mqttConnectTaskHandle) != pdPASS) {
+    mqttConnectTaskHandle = NULL;
+    Serial.println("无法创建MQTT连接任务，改为在主循环中连接（连接期间会阻塞）");
+  }
+  
+  // 恢复持久化的历史数据（同样与温度转换重叠进行）
+  setupHistoryStore();
+  
+  // 等待共用转换的剩余时间（上面的初始化已经占用了其中一部分）
+  unsigned long bootConversionDeadline = bootConversionStart + tempAcquisition.conversionMs() + TEMP_CONVERSION_MARGIN_MS;
+  while ((long)(millis() - bootConversionDeadline) < 0 && !(tempAcquisition.pollConversion() && sensors.isConversionComplete())) {
+    delay(1);
+  }
+  
+  // 初始化温度记录数组并读取初始温度值
+  // 已恢复历史时最新的存储样本就在当前时刻，初始读数只进入原始层，不再额外存储一个样本
+  bool historyRestored = tempSampleSeq > 0;
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    float initialTemp = sensors.getTempC(sensorRegistry.addresses[i]);
+    sensorRegistry.currentTemps[i] = initialTemp;
     if (initialTemp != DEVICE_DISCONNECTED_C) {
-      // 使用初始温度值初始化记录
-      sensorRecords[i].temps[0] = initialTemp;
-      sensorRecords[i].timestamps[0] = millis();
-      sensorRecords[i].recordCount = 1;
-      sensorRecords[i].currentIndex = 1;
-      
-      // 初始化统计数据
-      sensorRecords[i].minTemp = initialTemp;
-      sensorRecords[i].maxTemp = initialTemp;
-      sensorRecords[i].avgTemp = initialTemp;
-      sensorRecords[i].lastStatsUpdate = millis();
+      // 使用初始温度值初始化记录和统计数据
+      if (!historyRestored) {
+        sensorRegistry.records[i].push(initialTemp, millis(), tempSampleSeq + 1);
+      }
+      sensorRegistry.rollups[i].addReading(initialTemp, millis());
+      sensorRegistry.records[i].lastStatsUpdate = millis();
       
       // 打印初始化信息
       Serial.println("\n=== 传感器初始化 ===");
@@ -832,107 +1693,174 @@ void setup() {
       Serial.println("====================\n");
       
       // 初始化显示状态
-      displayState.lastTemps[i] = initialTemp;
+      sensorRegistry.displayedTemps[i] = initialTemp;
       
       // 初始化图表状态
       graphState.lastMinTemp = initialTemp;
       graphState.lastMaxTemp = initialTemp;
       graphState.lastAvgTemp = initialTemp;
       graphState.lastCurrentTemp = initialTemp;
+    } else if (!historyRestored) {
+      // 未连接的传感器写入缺失占位，保证各传感器的样本序号连续
+      sensorRegistry.records[i].push(DEVICE_DISCONNECTED_C, millis(), tempSampleSeq + 1);
     }
   }
+  if (!historyRestored) {
+    tempSampleSeq++;
+  }
+  unsigned long timeToFirstReading = millis();
+  
+  // 下一轮转换从TEMP_UPDATE_INTERVAL之后开始
+  tempAcquisition.restart(millis());
   
   // 初始化显示状态
   displayState.lastMode = currentMode;
   displayState.lastSelectedSensor = -1;
   displayState.needsRedraw = true;
   
-  // 首次显示
+  // 首次显示（清除WiFi连接提示后绘制）
+  tft.fillScreen(TFT_BLACK);
   updateDisplay();
+  unsigned long timeToFirstFrame = millis();
+  
+  // 打印启动耗时
+  Serial.println("=== 启动耗时 ===");
+  Serial.print("首次读数: ");
+  Serial.print(timeToFirstReading);
+  Serial.println(" ms");
+  Serial.print("首帧显示: ");
+  Serial.print(timeToFirstFrame);
+  Serial.println(" ms");
+  Serial.println("================");
+  
+  setupTasks();
 }
 
-void loop() {
-  unsigned long currentMillis = millis();
-  
-  // 更新按键状态
+// 从 since 起经过 interval 后到期，返回距到期的毫秒数（已到期为0）
+static unsigned long msUntil(unsigned long since, unsigned long interval, unsigned long now) {
+  unsigned long elapsed = now - since;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+static void tickButtons() {
   button1.tick();
   button2.tick();
   button3.tick();
   button4.tick();
-  
-  // WiFi连接和状态检查
-  if (!wifiConnected) {
-    connectWiFi();
+}
+
+// 屏幕开启分两步：退出睡眠，等待 SCREEN_WAKE_DELAY 后开启显示和背光
+static void runScreenTask() {
+  if (!screenOn) {
+    tft.writecommand(0x10);
+    digitalWrite(TFT_BL, LOW);
+  } else if (!screenWakePending) {
+    tft.writecommand(0x11);
+    screenWakePending = true;
+    scheduler.schedule(screenTask, SCREEN_WAKE_DELAY, millis());
   } else {
-    checkWiFiStatus();
-    
-    // 时间同步（仅在WiFi连接时）
-    syncTime();
-    
-    // WiFi连接成功后，处理MQTT
-    if (!mqttConnected) {
-      connectMQTT();
-    } else {
-      checkMQTTStatus();
+    tft.writecommand(0x29);
+    digitalWrite(TFT_BL, HIGH);
+    screenWakePending = false;
+  }
+}
+
+// 执行一步温度采集，按状态安排下一步：空闲时等到下次读取时间，
+// 转换中每 TEMP_CONVERSION_MIN_MS 查询一次（寄生供电时直接等到截止时间），读取中下一轮继续
+static void runTemperatureTask() {
+  readTemperatures();
+  unsigned long now = millis();
+  scheduler.schedule(temperatureTask, tempAcquisition.nextDelay(now, tempUpdateInterval), now);
+}
+
+// 后台扫描进行中时每轮扫描一个设备，否则等到下次扫描时间；温度采集期间稍后重试
+static void runRescanTask() {
+  rescanSensors();
+  unsigned long now = millis();
+  unsigned long delayMs = 0;
+  if (!sensorRescanActive) {
+    delayMs = msUntil(lastSensorRescanTime, SENSOR_RESCAN_INTERVAL, now);
+    if (delayMs == 0) {
+      delayMs = TEMP_CONVERSION_MIN_MS;
+    }
+  }
+  scheduler.schedule(rescanTask, delayMs, now);
+}
+
+static void updateStatusIcons() {
+  if (screenOn) {
+    displayWiFiStatus();
+    displayMQTTStatus();
+  }
+}
+
+// 报警闪烁：所有报警中的传感器同步切换
+static void toggleAlarmBlink() {
+  unsigned long currentMillis = millis();
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (sensorRegistry.highAlarm[i] || sensorRegistry.lowAlarm[i]) {
+      sensorRegistry.blinkState[i] = !sensorRegistry.blinkState[i];
+      sensorRegistry.lastBlinkTime[i] = currentMillis;
+      // 仅在屏幕开启时触发显示更新
+      if (screenOn) {
+        displayNeedsUpdate = true;
+      }
     }
   }
+}
+
+// 注册定时任务，在setup()最后调用
+void setupTasks() {
+  unsigned long now = millis();
+  scheduler.every(BUTTON_TICK_INTERVAL, tickButtons, now);
+  scheduler.every(STATUS_ICON_INTERVAL, updateStatusIcons, now);
+  scheduler.every(ALARM_BLINK_INTERVAL, toggleAlarmBlink, now, ALARM_BLINK_INTERVAL);
+  scheduler.every(TELEMETRY_DRAIN_INTERVAL, drainTelemetryQueue, now);
+  scheduler.every(POWER_CHECK_INTERVAL, monitorPowerStatus, now, POWER_CHECK_INTERVAL);
+  scheduler.every(SYSTEM_INFO_INTERVAL, printSystemInfo, now, SYSTEM_INFO_INTERVAL);
+  screenTask = scheduler.once(runScreenTask);
+  temperatureTask = scheduler.once(runTemperatureTask);
+  rescanTask = scheduler.once(runRescanTask);
+  scheduler.schedule(temperatureTask, tempAcquisition.nextDelay(now, tempUpdateInterval), now);
+  scheduler.schedule(rescanTask, SENSOR_RESCAN_INTERVAL, now);
+}
+
+void loop() {
+  // 定时任务：按键、温度采集、传感器扫描、状态图标、报警闪烁、遥测补发、状态打印
+  scheduler.run(millis());
+  
+  // WiFi/MQTT连接状态机
+  serviceConnectivity();
+  
+  // 时间同步（处理SNTP在后台收到的时间，不阻塞）
+  syncTime();
   
   // 处理MQTT数据请求
   if (mqttDataRequested && mqttConnected) {
     publishTemperatureData();
   }
+  if (historyQueryRequested && mqttConnected) {
+    publishHistoryQuery();
+  }
+  if (mqttConnected) {
+    serviceMqttOutbox();
+  }
   
-  // 监控电源状态
-  monitorPowerStatus();
+  // 定时/变化遥测
+  publishTelemetry();
   
-  // 打印系统信息
-  printSystemInfo();
-  
-  // 处理屏幕命令
-  if (screenCommandPending) {
-    if (screenCommandType) {  // 开启屏幕
-      if (currentMillis - lastScreenCommandTime >= 120) {
-        tft.writecommand(0x29);
-        digitalWrite(TFT_BL, HIGH);
-        screenCommandPending = false;
-      } else if (currentMillis - lastScreenCommandTime == 0) {
-        tft.writecommand(0x11);
-      }
-    } else {  // 关闭屏幕
-      tft.writecommand(0x10);
-      digitalWrite(TFT_BL, LOW);
-      screenCommandPending = false;
-    }
-  }
-  
-  // 读取温度数据
-  readTemperatures();
+  // 单传感器保留主题（只发布有变化的内容）
+  if (mqttConnected) {
+    publishSensorTopics();
+  }
   
   // 立即处理显示更新（按键触发）
   updateDisplay();
   
-  // 显示WiFi状态图标（仅在屏幕开启时）
-  if (wifiConnected && screenOn) {
-    displayWiFiStatus();
-  }
-  
-  // 显示MQTT状态图标（仅在屏幕开启时）
-  if (screenOn) {
-    displayMQTTStatus();
-  }
-  
-  // 处理报警闪烁
-  for (int i = 0; i < totalSensors; i++) {
-    if (alarmStates[i].highAlarm || alarmStates[i].lowAlarm) {
-      if (currentMillis - alarmStates[i].lastBlinkTime >= ALARM_BLINK_INTERVAL) {
-        alarmStates[i].blinkState = !alarmStates[i].blinkState;
-        alarmStates[i].lastBlinkTime = currentMillis;
-        // 仅在屏幕开启时触发显示更新
-        if (screenOn) {
-          displayNeedsUpdate = true;
-        }
-      }
-    }
+  // 没有到期的任务和待处理的请求时让出CPU，直到下一个截止时间
+  unsigned long idleMs = scheduler.timeUntilNext(millis(), LOOP_IDLE_MAX_MS);
+  if (idleMs > 0 && !displayNeedsUpdate && !mqttDataRequested && !historyQueryRequested) {
+    delay(min(idleMs, (unsigned long)LOOP_IDLE_MAX_MS));
   }
 }
 
@@ -940,18 +1868,19 @@ void loop() {
 void checkTemperatureAlarms(int sensorIndex, float temp) {
   if (temp == DEVICE_DISCONNECTED_C) return;
   
-  AlarmState &alarm = alarmStates[sensorIndex];
-  alarm.highAlarm = (temp >= TEMP_ALARM_HIGH);
-  alarm.lowAlarm = (temp <= TEMP_ALARM_LOW);
+  bool highAlarm = (temp >= alarmHighTemp);
+  bool lowAlarm = (temp <= alarmLowTemp);
+  sensorRegistry.highAlarm[sensorIndex] = highAlarm;
+  sensorRegistry.lowAlarm[sensorIndex] = lowAlarm;
   
   // 更新闪烁状态
-  if (alarm.highAlarm || alarm.lowAlarm) {
-    if (millis() - alarm.lastBlinkTime >= ALARM_BLINK_INTERVAL) {
-      alarm.blinkState = !alarm.blinkState;
-      alarm.lastBlinkTime = millis();
+  if (highAlarm || lowAlarm) {
+    if (millis() - sensorRegistry.lastBlinkTime[sensorIndex] >= ALARM_BLINK_INTERVAL) {
+      sensorRegistry.blinkState[sensorIndex] = !sensorRegistry.blinkState[sensorIndex];
+      sensorRegistry.lastBlinkTime[sensorIndex] = millis();
     }
   } else {
-    alarm.blinkState = false;
+    sensorRegistry.blinkState[sensorIndex] = false;
   }
 }
 
@@ -972,12 +1901,12 @@ void updateDisplay() {
       displayOverview();
       break;
     case MODE_DETAIL:
-      if (selectedSensor >= 0 && selectedSensor < totalSensors) {
+      if (selectedSensor >= 0 && selectedSensor < sensorRegistry.count) {
         displayDetailView(selectedSensor);
       }
       break;
     case MODE_GRAPH:
-      if (selectedSensor >= 0 && selectedSensor < totalSensors) {
+      if (selectedSensor >= 0 && selectedSensor < sensorRegistry.count) {
         drawGraph(selectedSensor);
       }
       break;
@@ -987,263 +1916,671 @@ void updateDisplay() {
   displayState.needsRedraw = false;  // 清除状态更新标记
 }
 
-// 添加温度读取函数
-void readTemperatures() {
-  unsigned long currentMillis = millis();
-  
-  // 检查是否需要读取温度
-  if (!tempReadPending) {
-    if (currentMillis - lastTempReadTime >= TEMP_UPDATE_INTERVAL) {
-      sensors.requestTemperatures();
-      tempReadPending = true;
-      lastTempReadTime = currentMillis;
+// 处理单个传感器的一次读数（更新缓存、存储记录、检查报警）
+void handleSensorReading(int i, float tempC, unsigned long currentMillis, int storeSlots) {
+  TempRollup &rollup = sensorRegistry.rollups[i];
+  
+  // 检查是否需要存储到记录数组（每12分钟存储一次），未连接时写入缺失占位
+  // 错过的存储点先结束对应的汇总桶，本次读数计入最后一个桶
+  if (storeSlots > 0) {
+    TempRecord &record = sensorRegistry.records[i];
+    unsigned long storeTime = lastTempStoreTime;
+    for (int slot = 1; slot < storeSlots; slot++) {
+      storeTime += TEMP_STORE_INTERVAL;
+      record.push(DEVICE_DISCONNECTED_C, storeTime, tempSampleSeq + slot);
+      rollup.closeInterval(storeTime);
     }
+    storeTime += TEMP_STORE_INTERVAL;
+    record.push(tempC, storeTime, tempSampleSeq + storeSlots);
+    rollup.addReading(tempC, currentMillis);
+    rollup.closeInterval(storeTime);
   } else {
-    // 检查温度是否已经准备好（给传感器100ms的响应时间）
-    if (currentMillis - lastTempReadTime >= 100) {
-      // 读取所有传感器的温度
-      for (int i = 0; i < totalSensors; i++) {
-        float tempC = sensors.getTempCByIndex(i);
-        if (tempC != DEVICE_DISCONNECTED_C) {
-          currentTemps[i] = tempC;  // 更新温度缓存
-          
-          // 检查是否需要存储到记录数组（每12分钟存储一次）
-          if (currentMillis - lastTempStoreTime >= TEMP_STORE_INTERVAL) {
-            // 存储温度数据
-            sensorRecords[i].temps[sensorRecords[i].currentIndex] = tempC;
-            sensorRecords[i].timestamps[sensorRecords[i].currentIndex] = currentMillis;
-            
-            // 记录真实时间戳
-            sensorRecords[i].lastRealTime = getCurrentRealTime();
-            
-            // 更新索引和计数
-            sensorRecords[i].currentIndex = (sensorRecords[i].currentIndex + 1) % MAX_RECORDS;
-            if (sensorRecords[i].recordCount < MAX_RECORDS) {
-              sensorRecords[i].recordCount++;
-            }
-            
-            // 重新计算统计数据
-            float minTemp = 999.0;  // 使用一个较大的初始值
-            float maxTemp = -999.0; // 使用一个较小的初始值
-            float sumTemp = 0.0;
-            int validCount = 0;
-            
-            // 遍历所有记录计算统计数据
-            for (int j = 0; j < sensorRecords[i].recordCount; j++) {
-              float temp = sensorRecords[i].temps[j];
-              if (temp != DEVICE_DISCONNECTED_C) {
-                minTemp = min(minTemp, temp);
-                maxTemp = max(maxTemp, temp);
-                sumTemp += temp;
-                validCount++;
-              }
-            }
-            
-            // 更新统计数据
-            if (validCount > 0) {
-              sensorRecords[i].minTemp = minTemp;
-              sensorRecords[i].maxTemp = maxTemp;
-              sensorRecords[i].avgTemp = sumTemp / validCount;
-              sensorRecords[i].lastStatsUpdate = currentMillis;
-              
-              // 打印详细的统计信息用于调试
-              Serial.println("\n=== 温度统计数据更新 ===");
-              Serial.print("时间戳: ");
-              Serial.println(currentMillis);
-              Serial.print("传感器 ");
-              Serial.print(i);
-              Serial.print(" (T");
-              Serial.print(i + 1);
-              Serial.println(")");
-              Serial.print("当前温度: ");
-              Serial.print(tempC);
-              Serial.println("C");
-              Serial.print("记录数量: ");
-              Serial.println(sensorRecords[i].recordCount);
-              Serial.print("有效数据: ");
-              Serial.println(validCount);
-              Serial.print("最小温度: ");
-              Serial.print(sensorRecords[i].minTemp);
-              Serial.println("C");
-              Serial.print("最大温度: ");
-              Serial.print(sensorRecords[i].maxTemp);
-              Serial.println("C");
-              Serial.print("平均温度: ");
-              Serial.print(sensorRecords[i].avgTemp);
-              Serial.println("C");
-              Serial.print("数据数组: [");
-              for (int j = 0; j < sensorRecords[i].recordCount; j++) {
-                Serial.print(sensorRecords[i].temps[j]);
-                Serial.print(", ");
-              }
-              Serial.println("]");
-              Serial.println("====================\n");
-            } else {
-              // 如果没有有效数据，使用当前温度作为所有统计值
-              sensorRecords[i].minTemp = tempC;
-              sensorRecords[i].maxTemp = tempC;
-              sensorRecords[i].avgTemp = tempC;
-              sensorRecords[i].lastStatsUpdate = currentMillis;
-              
-              Serial.println("\n=== 温度统计数据初始化 ===");
-              Serial.print("传感器 ");
-              Serial.print(i);
-              Serial.print(" 使用当前温度初始化: ");
-              Serial.print(tempC);
-              Serial.println("C");
-              Serial.println("====================\n");
-            }
-          }
-          
-          // 检查报警状态
-          checkTemperatureAlarms(i, tempC);
-          if (alarmStates[i].highAlarm || alarmStates[i].lowAlarm) {
-            // 仅在屏幕开启时触发显示更新
-            if (screenOn) {
-              displayNeedsUpdate = true;
-            }
-          }
-        }
-      }
+    rollup.addReading(tempC, currentMillis);
+  }
+  fullRateHistory.append(i, currentMillis / FULLRATE_TIME_UNIT_MS, tempToRaw(tempC));
+  
+  if (tempC != DEVICE_DISCONNECTED_C) {
+    float previousTemp = sensorRegistry.currentTemps[i];
+    if (previousTemp == DEVICE_DISCONNECTED_C || lround(previousTemp * 10) != lround(tempC * 10)) {
+      payloadDataVersion++;
+    }
+    sensorRegistry.currentTemps[i] = tempC;  // 更新温度缓存
+    
+    if (storeSlots > 0) {
+      TempRecord &record = sensorRegistry.records[i];
+      record.lastStatsUpdate = currentMillis;
       
-      // 如果是存储时间点，更新存储时间
-      if (currentMillis - lastTempStoreTime >= TEMP_STORE_INTERVAL) {
-        lastTempStoreTime = currentMillis;
+      // 打印统计信息用于调试
+      Serial.println("\n=== 温度统计数据更新 ===");
+      Serial.print("时间戳: ");
+      Serial.println(currentMillis);
+      Serial.print("传感器 ");
+      Serial.print(i);
+      Serial.print(" (T");
+      Serial.print(i + 1);
+      Serial.println(")");
+      Serial.print("当前温度: ");
+      Serial.print(tempC);
+      Serial.println("C");
+      Serial.print("记录数量: ");
+      Serial.println(record.count());
+      Serial.print("有效数据: ");
+      Serial.println(record.validCount);
+      Serial.print("最小温度: ");
+      Serial.print(record.minTemp);
+      Serial.println("C");
+      Serial.print("最大温度: ");
+      Serial.print(record.maxTemp);
+      Serial.println("C");
+      Serial.print("平均温度: ");
+      Serial.print(record.avgTemp);
+      Serial.println("C");
+      Serial.println("====================\n");
+    }
+    
+    // 检查报警状态
+    checkTemperatureAlarms(i, tempC);
+    if (sensorRegistry.highAlarm[i] || sensorRegistry.lowAlarm[i]) {
+      // 仅在屏幕开启时触发显示更新
+      if (screenOn) {
+        displayNeedsUpdate = true;
       }
-      
-      tempReadPending = false;
     }
+    
+    checkTelemetryChange(i);
   }
 }
 
-// WiFi连接函数
-void connectWiFi() {
-  if (wifiConnected) {
-    return;  // 如果已经连接，直接返回
+// 采集状态机读到的每个传感器的温度
+void handleTemperatureReading(int index, float tempC, unsigned long readTime) {
+  handleSensorReading(index, tempC, readTime, tempStoreSlots);
+}
+
+// 温度读取（非阻塞状态机：发起转换 -> 等待转换完成 -> 分批读取，见 TempAcquisition.h）
+void readTemperatures() {
+  TempAcquisition::Event event = tempAcquisition.step(tempUpdateInterval, sensorRegistry.addresses, sensorRegistry.count);
+  if (event == TempAcquisition::STARTED) {
+    // 本轮是否为存储时间点，在发起转换时确定，保证所有传感器一致
+    // 若loop曾长时间阻塞错过多个存储点，缺失的间隔以占位样本补齐
+    tempStoreSlots = (tempAcquisition.lastStart() - lastTempStoreTime) / TEMP_STORE_INTERVAL;
+  } else if (event == TempAcquisition::FINISHED && tempStoreSlots > 0) {
+    // 如果是存储时间点，更新存储时间
+    // 存储时间按固定间隔推进而不是取当前时间，样本时间戳不会累积漂移
+    lastTempStoreTime += (unsigned long)tempStoreSlots * TEMP_STORE_INTERVAL;
+    tempSampleSeq += tempStoreSlots;
+    payloadDataVersion++;
+    appendHistoryFrames(tempStoreSlots);
   }
-  
+}
+
+// 后台重新扫描总线（热插拔检测）
+// 每次调用只执行一步ROM搜索，且仅在温度采集空闲时进行，不与转换/读取争用总线
+void rescanSensors() {
   unsigned long currentMillis = millis();
   
-  // 如果是第一次尝试连接或重连
-  if (wifiConnectStartTime == 0) {
-    Serial.println("开始连接WiFi...");
-    Serial.print("SSID: ");
-    Serial.println(WIFI_SSID);
+  if (tempAcquisition.state() != TempAcquisition::IDLE) {
+    return;
+  }
+  
+  if (!sensorRescanActive) {
+    if (currentMillis - lastSensorRescanTime < SENSOR_RESCAN_INTERVAL) {
+      return;
+    }
+    oneWire.reset_search();
+    memset(rescanFound, 0, sizeof(rescanFound));
+    sensorRescanActive = true;
+    lastSensorRescanTime = currentMillis;
+  }
+  
+  DeviceAddress address;
+  if (oneWire.search(address)) {
+    if (!sensors.validAddress(address) || !sensors.validFamily(address)) {
+      return;
+    }
     
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    WiFi.setTxPower(WIFI_POWER_8_5dBm);
-    wifiConnectStartTime = currentMillis;
-    wifiConnectAttempts++;
+    int index = sensorRegistry.find(address);
+    if (index >= 0) {
+      rescanFound[index] = true;
+      return;
+    }
     
-    // 在屏幕上显示连接状态（仅在屏幕开启时）
-    if (screenOn) {
-      tft.fillScreen(TFT_BLACK);
-      tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-      tft.setTextSize(1);
-      tft.setTextDatum(MC_DATUM);
-      tft.drawString("正在连接WiFi...", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 10);
-      tft.drawString(WIFI_SSID, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 10);
+    // 新接入的传感器，追加到末尾，已有传感器的索引保持不变
+    // 新通道的当前温度为未连接，等待下一轮转换后更新
+    index = sensorRegistry.add(address);
+    if (index < 0) {
+      Serial.println("发现新传感器，但传感器数量已达上限");
+      return;
     }
+    rescanFound[index] = true;
+    payloadDataVersion++;
+    
+    Serial.print("发现新传感器 T");
+    Serial.print(sensorRegistry.count);
+    Serial.print(": ");
+    Serial.println(getShortAddress(address));
+    displayState.needsRedraw = true;
+    return;
   }
   
-  // 检查连接状态
-  if (WiFi.status() == WL_CONNECTED) {
-    wifiConnected = true;
-    wifiConnectStartTime = 0;
-    wifiConnectAttempts = 0;
-    
-    Serial.println("WiFi连接成功！");
-    Serial.print("IP地址: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("信号强度: ");
-    Serial.print(WiFi.RSSI());
-    Serial.println(" dBm");
+  // 本轮扫描结束，标记已移除的传感器
+  sensorRescanActive = false;
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (!rescanFound[i] && sensorRegistry.currentTemps[i] != DEVICE_DISCONNECTED_C) {
+      sensorRegistry.currentTemps[i] = DEVICE_DISCONNECTED_C;
+      payloadDataVersion++;
+      Serial.print("传感器 T");
+      Serial.print(i + 1);
+      Serial.println(" 已断开");
+      checkTelemetryChange(i);
+      if (screenOn) {
+        displayNeedsUpdate = true;
+      }
+    }
+  }
+}
+
+// 记录最近 frames 个存储间隔（每个间隔一帧），攒够 HIST_FLUSH_FRAMES 帧后批量写入
+void appendHistoryFrames(int frames) {
+  if (!historyStore.ready() || sensorRegistry.count == 0) {
+    return;
+  }
+  
+  uint16_t sensorCount = sensorRegistry.count;
+  uint32_t failures = historyStore.writeFailures();
+  for (int k = 0; k < frames; k++) {
+    HistFrameEntry *entries = historyStore.addFrame(sensorCount, (uint32_t)getCurrentRealTime());
     
-    // 在屏幕上显示连接成功信息（仅在屏幕开启时）
-    if (screenOn) {
-      tft.fillScreen(TFT_BLACK);
-      tft.setTextColor(TFT_GREEN, TFT_BLACK);
-      tft.setTextSize(1);
-      tft.setTextDatum(MC_DATUM);
-      tft.drawString("WiFi连接成功", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 20);
-      tft.drawString("IP: " + WiFi.localIP().toString(), SCREEN_WIDTH/2, SCREEN_HEIGHT/2);
-      tft.drawString("信号: " + String(WiFi.RSSI()) + " dBm", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 20);
+    for (int i = 0; i < sensorCount; i++) {
+      const TempRecord &record = sensorRegistry.records[i];
+      const TempRollup &rollup = sensorRegistry.rollups[i];
+      int sampleIndex = record.count() - frames + k;
+      int bucketIndex = rollup.fine.buckets.size() - frames + k;
       
-      // 延迟2秒后恢复正常显示
-      delay(2000);
-      displayState.needsRedraw = true;
+      HistFrameEntry &entry = entries[i];
+      memcpy(entry.address, sensorRegistry.addresses[i], sizeof(entry.address));
+      entry.sampleRaw = sampleIndex >= 0 ? record.samples[sampleIndex] : TEMP_RAW_INVALID;
+      if (bucketIndex >= 0) {
+        const RollupBucket &bucket = rollup.fine.buckets[bucketIndex];
+        entry.minRaw = bucket.minRaw;
+        entry.maxRaw = bucket.maxRaw;
+        entry.avgRaw = bucket.avgRaw;
+        entry.count = bucket.count;
+      } else {
+        entry.minRaw = entry.maxRaw = entry.avgRaw = TEMP_RAW_INVALID;
+        entry.count = 0;
+      }
+    }
+  }
+  historyStore.commitFrames();
+  
+  if (historyStore.writeFailures() != failures) {
+    Serial.println("历史数据写入失败");
+  }
+  
+  // 每天保存一次小时/天层快照，启动恢复时无需重放更早的帧
+  if (historyStore.snapshotDue(ROLLUP_DAY_MS / TEMP_STORE_INTERVAL)) {
+    saveHistorySnapshot();
+  }
+}
+
+// 将待写入的帧写入闪存
+void flushHistoryFrames() {
+  if (!historyStore.flush()) {
+    Serial.println("历史数据写入失败");
+  }
+}
+
+// 快照条目：第 index 个传感器的小时/天层
+static void fillSnapshotEntry(int index, uint8_t *data) {
+  HistSnapshotEntry *entry = (HistSnapshotEntry*)data;
+  memcpy(entry->address, sensorRegistry.addresses[index], sizeof(entry->address));
+  entry->hourly = sensorRegistry.rollups[index].hourly;
+  entry->daily = sensorRegistry.rollups[index].daily;
+}
+
+// 快照条目按序列号恢复到对应的传感器
+static void applySnapshotEntry(const uint8_t *data) {
+  const HistSnapshotEntry *entry = (const HistSnapshotEntry*)data;
+  int index = sensorRegistry.find(entry->address);
+  if (index >= 0) {
+    sensorRegistry.rollups[index].hourly = entry->hourly;
+    sensorRegistry.rollups[index].daily = entry->daily;
+  }
+}
+
+static HistSnapshotEntry histSnapshotEntry;  // 较大，避免占用栈空间
+
+// 保存小时/天层快照（先写临时文件再改名，断电时旧快照仍然完整）
+void saveHistorySnapshot() {
+  if (!historyStore.saveSnapshot(sensorRegistry.count, (uint8_t*)&histSnapshotEntry, sizeof(histSnapshotEntry),
+                                 fillSnapshotEntry)) {
+    Serial.println("历史快照保存失败");
+  }
+}
+
+// 重放一帧到各传感器的历史记录
+// fineWindow：是否属于最近 MAX_RECORDS 个间隔；cascade：是否需要并入小时/天层
+void replayHistoryFrame(const HistFrameEntry *entries, uint16_t sensorCount, unsigned long closeTime,
+                        bool fineWindow, bool cascade) {
+  bool seen[MAX_SENSORS] = {false};
+  
+  for (int e = 0; e < sensorCount; e++) {
+    const HistFrameEntry &entry = entries[e];
+    int index = sensorRegistry.find(entry.address);
+    if (index < 0 || seen[index]) {
+      continue;
     }
-  } else if (currentMillis - wifiConnectStartTime > WIFI_TIMEOUT) {
-    // 连接超时
-    Serial.println("WiFi连接超时");
+    seen[index] = true;
     
-    if (wifiConnectAttempts < MAX_WIFI_ATTEMPTS) {
-      Serial.print("重试连接 (");
-      Serial.print(wifiConnectAttempts);
-      Serial.print("/");
-      Serial.print(MAX_WIFI_ATTEMPTS);
-      Serial.println(")");
-      
-      // 在屏幕上显示重试信息（仅在屏幕开启时）
-      if (screenOn) {
-        tft.fillScreen(TFT_BLACK);
-        tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-        tft.setTextSize(1);
-        tft.setTextDatum(MC_DATUM);
-        tft.drawString("WiFi连接超时", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 10);
-        tft.drawString("重试中...", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 10);
+    RollupBucket bucket = {entry.minRaw, entry.maxRaw, entry.avgRaw, entry.count};
+    if (fineWindow) {
+      sensorRegistry.records[index].push(rawToTemp(entry.sampleRaw), closeTime, tempSampleSeq);
+    }
+    if (fineWindow || cascade) {
+      sensorRegistry.rollups[index].restoreInterval(bucket, closeTime, cascade);
+    }
+  }
+  
+  // 该帧中没有的传感器写入缺失占位，保持等间隔
+  RollupBucket empty = {TEMP_RAW_INVALID, TEMP_RAW_INVALID, TEMP_RAW_INVALID, 0};
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (seen[i]) {
+      continue;
+    }
+    if (fineWindow) {
+      sensorRegistry.records[i].push(DEVICE_DISCONNECTED_C, closeTime, tempSampleSeq);
+    }
+    if (fineWindow || cascade) {
+      sensorRegistry.rollups[i].restoreInterval(empty, closeTime, cascade);
+    }
+  }
+}
+
+// 挂载文件系统并恢复历史数据（需在传感器注册之后调用）
+// 只重放快照之后以及最近 MAX_RECORDS 个间隔的帧，按段头直接定位起始帧。
+// 恢复的样本时间戳以当前时间为最新样本往前推算，断电期间的空白不保留。
+void setupHistoryStore() {
+  if (!HIST_PERSIST_ENABLE) {
+    return;
+  }
+  
+  unsigned long recoveryStart = millis();
+  if (!LittleFS.begin(true)) {
+    Serial.println("LittleFS挂载失败，历史数据不会持久化");
+    return;
+  }
+  historyStore.begin();
+  
+  // 启用遥测溢出文件（同时丢弃上次运行未补发的遥测）
+  if (TELEMETRY_SPILL_ENABLE) {
+    telemetrySpool.begin();
+  }
+  
+  // 最新帧序号，最后一段完整时可以继续追加
+  uint32_t lastSeq = historyStore.recover(sensorRegistry.count);
+  
+  bool haveSnapshot = historyStore.loadSnapshot((uint8_t*)&histSnapshotEntry, sizeof(histSnapshotEntry),
+                                                applySnapshotEntry);
+  uint32_t snapshotSeq = historyStore.snapshotSeq();
+  if (!haveSnapshot) {
+    for (int i = 0; i < sensorRegistry.count; i++) {
+      sensorRegistry.rollups[i].hourly.reset();
+      sensorRegistry.rollups[i].daily.reset();
+    }
+  }
+  
+  // 需要重放的第一帧
+  uint32_t fineStart = lastSeq >= MAX_RECORDS ? lastSeq - MAX_RECORDS + 1 : 1;
+  uint32_t startSeq = haveSnapshot ? min(fineStart, snapshotSeq + 1) : fineStart;
+  
+  int replayedFrames = 0;
+  unsigned long now = millis();
+  if (lastSeq > 0) {
+    HistStore::Replay replay(historyStore, startSeq);
+    while (replay.next() && replay.seq() <= lastSeq) {
+      uint32_t seq = replay.seq();
+      unsigned long closeTime = now - (unsigned long)(lastSeq - seq) * TEMP_STORE_INTERVAL;
+      if (seq >= fineStart) {
+        tempSampleSeq++;
       }
-      
-      // 重新开始连接
-      WiFi.disconnect();
-      delay(1000);
-      wifiConnectStartTime = 0;
+      replayHistoryFrame(replay.entries(), replay.sensorCount(), closeTime,
+                         seq >= fineStart, !haveSnapshot || seq > snapshotSeq);
+      replayedFrames++;
+    }
+  }
+  
+  // 最新一帧的结束时间即为当前存储间隔的起点，之后按12分钟网格继续存储
+  if (tempSampleSeq > 0) {
+    lastTempStoreTime = now;
+  }
+  
+  Serial.println("=== 历史数据恢复 ===");
+  Serial.print("段文件: ");
+  Serial.print(historyStore.segmentCount());
+  Serial.print(", 最新帧: ");
+  Serial.print(lastSeq);
+  Serial.print(", 快照: ");
+  Serial.println(haveSnapshot ? String(snapshotSeq) : String("无"));
+  Serial.print("重放帧数: ");
+  Serial.print(replayedFrames);
+  Serial.print(", 耗时: ");
+  Serial.print(millis() - recoveryStart);
+  Serial.println(" ms");
+  Serial.println("====================");
+}
+
+// WiFi连接函数
+// 读取上次成功连接的WiFi参数
+void loadWifiFastCache() {
+  Preferences prefs;
+  if (!prefs.begin("wifi", true)) {
+    return;
+  }
+  wifiFastCacheValid = prefs.getBytes("fast", &wifiFastCache, sizeof(wifiFastCache)) == sizeof(wifiFastCache) &&
+                       wifiFastCache.magic == WIFI_FAST_CACHE_MAGIC;
+  prefs.end();
+  if (wifiFastCacheValid) {
+    Serial.print("已保存WiFi快速连接参数，信道 ");
+    Serial.println(wifiFastCache.channel);
+  }
+}
+
+// 保存当前连接的WiFi参数，与已保存的相同时不写入（减少闪存磨损）
+void saveWifiFastCache() {
+  WifiFastCache cache;
+  memset(&cache, 0, sizeof(cache));
+  cache.magic = WIFI_FAST_CACHE_MAGIC;
+  const uint8_t *bssid = WiFi.BSSID();
+  if (bssid == NULL) {
+    return;
+  }
+  memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+  cache.channel = WiFi.channel();
+  cache.ip = (uint32_t)WiFi.localIP();
+  cache.gateway = (uint32_t)WiFi.gatewayIP();
+  cache.subnet = (uint32_t)WiFi.subnetMask();
+  cache.dns = (uint32_t)WiFi.dnsIP();
+  if (wifiFastCacheValid && memcmp(&cache, &wifiFastCache, sizeof(cache)) == 0) {
+    return;
+  }
+  
+  Preferences prefs;
+  if (!prefs.begin("wifi", false)) {
+    return;
+  }
+  if (prefs.putBytes("fast", &cache, sizeof(cache)) == sizeof(cache)) {
+    wifiFastCache = cache;
+    wifiFastCacheValid = true;
+    Serial.println("已更新WiFi快速连接参数");
+  }
+  prefs.end();
+}
+
+// 进入新的连接状态
+static void enterNetState(NetState state) {
+  netState = state;
+  netStateTime = millis();
+}
+
+// 连接失败：按指数退避加随机抖动等待后重试
+static void scheduleNetRetry(NetState backoffState, ExponentialBackoff &backoff, const char *what) {
+  netRetryDelay = backoff.next(esp_random());
+  Serial.print(what);
+  Serial.print("连接失败（连续");
+  Serial.print(backoff.failures());
+  Serial.print("次），");
+  Serial.print(netRetryDelay);
+  Serial.println(" ms 后重试");
+  enterNetState(backoffState);
+}
+
+// 关闭MQTT连接，未确认的消息在下次连接后重新发送
+static void dropMqttConnection() {
+  mqttConnected = false;
+  mqttTransport.stop();
+  mqttOutbox.requeueInFlight();
+  mqttEchoFilter.clear();
+}
+
+// 建立到MQTT服务器的网络连接（TCP + TLS握手）
+// 有上次保存的TLS会话时先尝试恢复；配置了证书指纹时在完整握手后校验服务器证书
+static bool openMqttTransport() {
+  unsigned long startTime = millis();
+  uint32_t heapBefore = ESP.getFreeHeap();
+  bool offeredSession = MQTT_USE_SSL && tlsClient.hasSession();
+  bool connected = mqttTransport.connect(MQTT_SERVER, MQTT_PORT) == 1;
+  
+  // 连接用时与内存占用，区分完整握手与会话恢复；握手峰值占用 = 握手前可用堆 - 握手期间最低可用堆
+  if (MQTT_USE_SSL) {
+    if (!connected) {
+      Serial.print(tlsClient.lastFingerprintMismatch() ? "服务器证书指纹不匹配，断开连接" :
+                   (offeredSession ? "TLS会话恢复失败（下次完整握手）" : "TLS连接失败"));
     } else {
-      // 达到最大重试次数
-      Serial.println("WiFi连接失败，达到最大重试次数");
-      
-      // 在屏幕上显示连接失败信息
-      tft.fillScreen(TFT_BLACK);
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-      tft.setTextSize(1);
-      tft.setTextDatum(MC_DATUM);
-      tft.drawString("WiFi连接失败", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 10);
-      tft.drawString("请检查网络设置", SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 10);
-      
-      // 延迟3秒后恢复正常显示
-      delay(3000);
-      displayState.needsRedraw = true;
-      
-      // 重置连接状态
-      wifiConnectStartTime = 0;
-      wifiConnectAttempts = 0;
+      Serial.print(tlsClient.lastResumed() ? "TLS会话恢复" : (offeredSession ? "TLS完整握手（服务器未接受会话）" : "TLS完整握手"));
+      Serial.print(": 握手 ");
+      Serial.print(tlsClient.lastHandshakeMs());
+      Serial.print(" ms, 峰值占用 ");
+      Serial.print(heapBefore - tlsClient.lastHandshakeMinHeap());
+      Serial.print(" 字节");
     }
+    Serial.print(", 总用时 ");
+  } else {
+    Serial.print("TCP连接用时 ");
+  }
+  Serial.print(millis() - startTime);
+  Serial.print(" ms, 可用堆 ");
+  Serial.print(heapBefore);
+  Serial.print(" -> ");
+  Serial.println(ESP.getFreeHeap());
+  return connected;
+}
+
+// 一次完整的MQTT连接：网络连接（TCP + TLS握手）后发送CONNECT并等待CONNACK
+static MqttConnectResult runMqttConnect() {
+  if (!openMqttTransport()) {
+    return MQTT_CONNECT_TRANSPORT_FAILED;
+  }
+  Serial.println("MQTT网络连接已建立");
+  // 网络连接已建立时 PubSubClient 只发送CONNECT并等待CONNACK
+  return mqttClient.connect(MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD) ? MQTT_CONNECT_OK : MQTT_CONNECT_SESSION_FAILED;
+}
+
+// 后台连接任务：等待主循环通知，连接完成后写入结果
+void mqttConnectTask(void *parameter) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    mqttConnectResult = runMqttConnect();
   }
 }
 
-// WiFi状态检查函数
-void checkWiFiStatus() {
-  if (wifiConnected && WiFi.status() != WL_CONNECTED) {
-    // WiFi连接丢失
+// WiFi/MQTT连接状态机，每次loop调用一次，不调用delay：
+//   发起WiFi连接 -> 等待获取IP -> 后台任务连接MQTT（网络/TLS连接 + CONNECT） -> 订阅 -> 在线
+// 任一步失败后按指数退避（加随机抖动）等待再试，重试次数不设上限；
+// WiFi断开时回到等待WiFi（驱动会自动重连），MQTT断开时只重连MQTT。
+// 阻塞的连接步骤在后台任务中执行（受 MQTT_TLS_TIMEOUT、MQTT_SOCKET_TIMEOUT 限制），
+// 只有任务创建失败时才退回到在主循环中阻塞连接。
+void serviceConnectivity() {
+  unsigned long currentMillis = millis();
+  
+  // 连接任务运行时不能关闭连接，WiFi断开后任务会因超时或网络错误结束，之后再处理
+  if (wifiConnected && WiFi.status() != WL_CONNECTED && mqttConnectResult != MQTT_CONNECT_RUNNING) {
     Serial.println("WiFi连接丢失");
     wifiConnected = false;
-    // 仅在屏幕开启时触发显示重绘
-    if (screenOn) {
-      displayState.needsRedraw = true;
+    wifiConnectStartTime = currentMillis;
+    wifiFastAttempt = false;  // 由驱动自动重连
+    if (netState >= NET_MQTT_TRANSPORT) {
+      dropMqttConnection();
+    }
+    enterNetState(NET_WIFI_WAIT);
+    return;
+  }
+  
+  switch (netState) {
+    case NET_WIFI_START:
+      Serial.println("开始连接WiFi...");
+      Serial.print("SSID: ");
+      Serial.println(WIFI_SSID);
+      wifiConnectStartTime = currentMillis;
+      wifiFastAttempt = WIFI_FAST_CONNECT && wifiFastCacheValid && !wifiFastFailed;
+      if (wifiFastAttempt) {
+        // 直接关联上次的AP，不扫描信道
+        if (WIFI_REUSE_IP && wifiFastCache.ip != 0) {
+          WiFi.config(IPAddress(wifiFastCache.ip), IPAddress(wifiFastCache.gateway),
+                      IPAddress(wifiFastCache.subnet), IPAddress(wifiFastCache.dns));
+        }
+        Serial.print("快速连接，信道 ");
+        Serial.println(wifiFastCache.channel);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, wifiFastCache.channel, wifiFastCache.bssid);
+      } else {
+        if (WIFI_REUSE_IP) {
+          WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));  // 恢复DHCP
+        }
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+      }
+      WiFi.setTxPower(WIFI_POWER_8_5dBm);
+      enterNetState(NET_WIFI_WAIT);
+      break;
+      
+    case NET_WIFI_WAIT:
+      if (WiFi.status() == WL_CONNECTED) {
+        wifiConnected = true;
+        wifiBackoff.reset();
+        mqttBackoff.reset();
+        wifiFastFailed = false;
+        
+        Serial.print("WiFi连接成功！用时 ");
+        Serial.print(currentMillis - wifiConnectStartTime);
+        Serial.println(wifiFastAttempt ? " ms（快速连接）" : " ms（完整扫描）");
+        saveWifiFastCache();
+        Serial.print("IP地址: ");
+        Serial.println(WiFi.localIP());
+        Serial.print("信号强度: ");
+        Serial.print(WiFi.RSSI());
+        Serial.println(" dBm");
+        enterNetState(NET_MQTT_TRANSPORT);
+      } else if (wifiFastAttempt && currentMillis - netStateTime > WIFI_FAST_TIMEOUT) {
+        // AP可能已更换信道或BSSID，立即改用完整扫描，不计入退避
+        Serial.println("WiFi快速连接超时，改用完整扫描");
+        WiFi.disconnect();
+        wifiFastFailed = true;
+        enterNetState(NET_WIFI_START);
+      } else if (currentMillis - netStateTime > WIFI_TIMEOUT) {
+        Serial.println("WiFi连接超时");
+        WiFi.disconnect();
+        scheduleNetRetry(NET_WIFI_BACKOFF, wifiBackoff, "WiFi");
+      }
+      break;
+      
+    case NET_WIFI_BACKOFF:
+      if (currentMillis - netStateTime >= netRetryDelay) {
+        enterNetState(NET_WIFI_START);
+      }
+      break;
+      
+    case NET_MQTT_TRANSPORT:
+      Serial.println("开始连接MQTT服务器...");
+      Serial.print("服务器: ");
+      Serial.print(MQTT_SERVER);
+      Serial.print(":");
+      Serial.println(MQTT_PORT);
+      mqttConnectStartTime = currentMillis;
+      if (mqttConnectTaskHandle != NULL) {
+        mqttConnectResult = MQTT_CONNECT_RUNNING;
+        xTaskNotifyGive(mqttConnectTaskHandle);
+      } else {
+        mqttConnectResult = runMqttConnect();
+      }
+      enterNetState(NET_MQTT_CONNECTING);
+      break;
+      
+    case NET_MQTT_CONNECTING: {
+      MqttConnectResult result = mqttConnectResult;
+      if (result == MQTT_CONNECT_RUNNING) {
+        break;
+      }
+      mqttConnectResult = MQTT_CONNECT_IDLE;
+      if (result == MQTT_CONNECT_OK) {
+        enterNetState(NET_MQTT_SUBSCRIBE);
+        break;
+      }
+      if (result == MQTT_CONNECT_SESSION_FAILED) {
+        Serial.print("MQTT连接失败，错误代码: ");
+        Serial.println(mqttClient.state());
+      }
+      dropMqttConnection();
+      scheduleNetRetry(NET_MQTT_BACKOFF, mqttBackoff, result == MQTT_CONNECT_TRANSPORT_FAILED ? "MQTT网络" : "MQTT");
+      break;
     }
+      
+    case NET_MQTT_SUBSCRIBE:
+      // 订阅命令主题
+      if (mqttClient.subscribe(MQTT_SUBSCRIBE_TOPIC)) {
+        Serial.print("成功订阅主题: ");
+        Serial.println(MQTT_SUBSCRIBE_TOPIC);
+      } else {
+        Serial.println("订阅主题失败");
+      }
+      if (!mqttClient.connected()) {
+        dropMqttConnection();
+        scheduleNetRetry(NET_MQTT_BACKOFF, mqttBackoff, "MQTT");
+        break;
+      }
+      Serial.print("MQTT连接成功！用时 ");
+      Serial.print(currentMillis - mqttConnectStartTime);
+      Serial.println(" ms");
+      mqttConnected = true;
+      mqttBackoff.reset();
+      
+      // 服务器上的保留消息可能已过期（离线期间的变化、服务器重启），重新发布全部单传感器主题
+      invalidateSensorTopics(0xFF);
+      enterNetState(NET_ONLINE);
+      break;
+      
+    case NET_MQTT_BACKOFF:
+      if (currentMillis - netStateTime >= netRetryDelay) {
+        enterNetState(NET_MQTT_TRANSPORT);
+      }
+      break;
+      
+    case NET_ONLINE:
+      if (!mqttClient.connected()) {
+        Serial.println("MQTT连接丢失");
+        dropMqttConnection();
+        scheduleNetRetry(NET_MQTT_BACKOFF, mqttBackoff, "MQTT");
+      } else {
+        // 处理MQTT消息
+        mqttClient.loop();
+      }
+      break;
   }
 }
 
 // WiFi状态显示函数
 void displayWiFiStatus() {
-  if (!wifiConnected) {
-    return;  // 如果WiFi未连接，不显示状态
-  }
-  
   static int lastRSSI = -100;
   static unsigned long lastUpdateTime = 0;
   unsigned long currentMillis = millis();
   
+  // 在屏幕左上角显示WiFi状态图标
+  int iconX = 15;  // 改为左侧
+  int iconY = 5;
+  
+  // 未连接时显示"W"：连接中为橙色，等待重试为红色
+  if (!wifiConnected) {
+    int state = netState == NET_WIFI_BACKOFF ? 1 : 0;
+    if (lastRSSI == -1000 - state && currentMillis - lastUpdateTime < 5000) {
+      return;
+    }
+    lastRSSI = -1000 - state;
+    lastUpdateTime = currentMillis;
+    tft.fillRect(iconX - 8, iconY, 18, 10, TFT_BLACK);
+    tft.setTextSize(1);
+    tft.setTextDatum(MC_DATUM);
+    tft.setTextColor(state ? TFT_RED : TFT_ORANGE, TFT_BLACK);
+    tft.drawString("W", iconX, iconY + 5);
+    return;
+  }
+  
   // 只在信号强度变化或每5秒更新一次
   int currentRSSI = WiFi.RSSI();
   if (currentRSSI == lastRSSI && currentMillis - lastUpdateTime < 5000) {
@@ -1253,10 +2590,6 @@ void displayWiFiStatus() {
   lastRSSI = currentRSSI;
   lastUpdateTime = currentMillis;
   
-  // 在屏幕左上角显示WiFi状态图标
-  int iconX = 15;  // 改为左侧
-  int iconY = 5;
-  
   // 根据信号强度选择颜色
   uint16_t color;
   
@@ -1276,7 +2609,7 @@ void displayWiFiStatus() {
   else if (currentRSSI >= -80) bars = 1;
   
   // 清除图标区域
-  tft.fillRect(iconX - 8, iconY, 10, 10, TFT_BLACK);
+  tft.fillRect(iconX - 8, iconY, 18, 10, TFT_BLACK);
   
   for (int i = 0; i < bars; i++) {
     int barHeight = (i + 1) * 2;
@@ -1287,16 +2620,20 @@ void displayWiFiStatus() {
 
 // MQTT状态显示函数
 void displayMQTTStatus() {
-  static bool lastMQTTStatus = false;
+  static int lastMQTTStatus = -1;
   static unsigned long lastUpdateTime = 0;
   unsigned long currentMillis = millis();
   
+  // 0 已连接，1 正在连接，2 未连接（等待WiFi或等待重试）
+  int status = mqttConnected ? 0 :
+               (netState >= NET_MQTT_TRANSPORT && netState <= NET_MQTT_SUBSCRIBE) ? 1 : 2;
+  
   // 只在状态变化或每3秒更新一次
-  if (mqttConnected == lastMQTTStatus && currentMillis - lastUpdateTime < 3000) {
+  if (status == lastMQTTStatus && currentMillis - lastUpdateTime < 3000) {
     return;
   }
   
-  lastMQTTStatus = mqttConnected;
+  lastMQTTStatus = status;
   lastUpdateTime = currentMillis;
   
   // 在屏幕右上角显示MQTT状态
@@ -1310,117 +2647,347 @@ void displayMQTTStatus() {
   tft.setTextSize(1);
   tft.setTextDatum(MC_DATUM);
   
-  if (mqttConnected) {
+  if (status == 0) {
     // 显示绿色"M"表示MQTT已连接
     tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    tft.drawString("M", iconX, iconY + 5);
+  } else if (status == 1) {
+    // 显示橙色"M"表示正在连接
+    tft.setTextColor(TFT_ORANGE, TFT_BLACK);
   } else {
     // 显示红色"M"表示MQTT未连接
     tft.setTextColor(TFT_RED, TFT_BLACK);
-    tft.drawString("M", iconX, iconY + 5);
   }
+  tft.drawString("M", iconX, iconY + 5);
 }
 
-void connectMQTT() {
-  if (mqttConnected || !wifiConnected) {
-    return;  // 如果已经连接或WiFi未连接，直接返回
+// ---- MQTT命令处理函数 ----
+// 每个处理函数只校验参数并修改状态（耗时固定，不访问网络和闪存），
+// 把简短的结果写入 message（只含ASCII，不含引号），返回是否执行成功
+
+// refresh [fmt=json|msgpack] [since=<seq>] [sensor=<n>]
+//   fmt=msgpack 使用MessagePack格式（默认JSON）
+//   since=<seq> 只发送序号之后的样本，seq 为上次收到的负载中的 "seq"
+//   sensor=<n>  只发送第n个传感器
+bool handleRefreshCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  PayloadFormat format = PAYLOAD_JSON;
+  bool delta = false;
+  uint32_t since = 0;
+  int onlySensor = -1;
+  
+  for (int i = 0; i < command.argCount(); i++) {
+    const CommandToken &arg = command.arg(i);
+    CommandToken value;
+    if (arg.keyValue("fmt", value)) {
+      if (value.equals("msgpack")) {
+        format = PAYLOAD_MSGPACK;
+      } else if (!value.equals("json")) {
+        snprintf(message, messageSize, "fmt must be json or msgpack");
+        return false;
+      }
+    } else if (arg.keyValue("since", value)) {
+      uint64_t seq;
+      if (!value.toUInt64(seq)) {
+        snprintf(message, messageSize, "invalid since");
+        return false;
+      }
+      // 会话号不同说明序号来自上次启动，只能发送全部历史
+      if ((uint32_t)(seq >> 32) == bootSession) {
+        delta = true;
+        since = (uint32_t)seq;
+      } else {
+        Serial.println("refresh since 的序号不属于本次启动，发送全部历史");
+      }
+    } else if (arg.keyValue("sensor", value)) {
+      long sensorNumber;
+      if (!value.toLong(sensorNumber, 1, sensorRegistry.count)) {
+        snprintf(message, messageSize, "sensor must be 1-%d", sensorRegistry.count);
+        return false;
+      }
+      onlySensor = sensorNumber - 1;
+    } else {
+      snprintf(message, messageSize, "unknown option");
+      return false;
+    }
   }
   
-  unsigned long currentMillis = millis();
+  // 相同的请求已在等待发布：合并为一次发布，各请求方都会收到这次发布的最新数据
+  // 已经发布完成的请求不再合并，数据未变化时由负载缓存直接重发
+  if (mqttDataRequested && mqttDataFormat == format && mqttDataDelta == delta &&
+      mqttDataSince == since && mqttDataSensor == onlySensor) {
+    Serial.println("收到refresh命令，与待发布的相同请求合并");
+    snprintf(message, messageSize, "merged into pending publish on %s", MQTT_PUBLISH_TOPIC);
+    return true;
+  }
   
-  // 如果是第一次尝试连接或重连
-  if (mqttConnectStartTime == 0) {
-    Serial.println("开始连接MQTT服务器...");
-    Serial.print("服务器: ");
-    Serial.print(MQTT_SERVER);
-    Serial.print(":");
-    Serial.println(MQTT_PORT);
-    
-    // 配置SSL（用于EMQX云服务）
-    if (MQTT_USE_SSL) {
-      Serial.println("配置SSL连接...");
-      espClient.setCACert(NULL);  // 不验证服务器证书
-      espClient.setInsecure();    // 允许不安全的连接
-    }
-    
-    mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
-    mqttClient.setCallback(mqttCallback);
-    mqttClient.setKeepAlive(MQTT_KEEPALIVE);  // 设置保活时间
-    
-    mqttConnectStartTime = currentMillis;
-    mqttConnectAttempts++;
+  mqttDataFormat = format;
+  mqttDataDelta = delta;
+  mqttDataSince = since;
+  mqttDataSensor = onlySensor;
+  mqttDataRequested = true;  // 标记需要发送数据（发送前收到的请求合并为一次发布）
+  
+  Serial.print("收到refresh命令，准备发送温度数据");
+  Serial.print(format == PAYLOAD_MSGPACK ? "(MessagePack)" : "(JSON)");
+  Serial.print(delta ? "(增量)" : "");
+  if (onlySensor >= 0) {
+    Serial.print("(T");
+    Serial.print(onlySensor + 1);
+    Serial.print(")");
+  }
+  Serial.println();
+  snprintf(message, messageSize, "data queued on %s", MQTT_PUBLISH_TOPIC);
+  return true;
+}
+
+// 秒数参数，换算为毫秒后不溢出
+static bool parseSecondsArg(const CommandToken &token, unsigned long &seconds) {
+  long value;
+  if (!token.toLong(value, 0, 0x7fffffffL)) {
+    return false;
+  }
+  seconds = (unsigned long)value;
+  return true;
+}
+
+// query <传感器编号> <起点> [终点] [步长]
+// 起点/终点为距现在的秒数（如 "query 1 3600" 查询T1最近一小时），
+// 时间已同步时也可以使用Unix时间戳；步长单位为秒，省略时按时间跨度自动选择层级
+bool handleQueryCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  long sensorNumber;
+  unsigned long from = 0;
+  unsigned long to = 0;
+  unsigned long step = 0;
+  if (!command.arg(0).toLong(sensorNumber, 1, sensorRegistry.count)) {
+    snprintf(message, messageSize, "sensor must be 1-%d", sensorRegistry.count);
+    return false;
+  }
+  if (!parseSecondsArg(command.arg(1), from) ||
+      (command.argCount() > 2 && !parseSecondsArg(command.arg(2), to)) ||
+      (command.argCount() > 3 && !parseSecondsArg(command.arg(3), step))) {
+    snprintf(message, messageSize, "invalid time argument");
+    return false;
   }
   
-  // 尝试连接MQTT服务器
-  if (mqttClient.connect(MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD)) {
-    mqttConnected = true;
-    mqttConnectStartTime = 0;
-    mqttConnectAttempts = 0;
-    
-    Serial.println("MQTT连接成功！");
-    
-    // 订阅命令主题
-    if (mqttClient.subscribe(MQTT_SUBSCRIBE_TOPIC)) {
-      Serial.print("成功订阅主题: ");
-      Serial.println(MQTT_SUBSCRIBE_TOPIC);
-    } else {
-      Serial.println("订阅主题失败");
+  // 大于2000年的值视为Unix时间戳，换算为距现在的秒数
+  time_t realNow = getCurrentRealTime();
+  if (timeSynced && from > 946684800UL) {
+    from = from < (unsigned long)realNow ? realNow - from : 0;
+  }
+  if (timeSynced && to > 946684800UL) {
+    to = to < (unsigned long)realNow ? realNow - to : 0;
+  }
+  if (from < to) {
+    Serial.println("query命令起点晚于终点");
+    snprintf(message, messageSize, "from is later than to");
+    return false;
+  }
+  
+  // 超出毫秒计数范围的时长按最大值处理（早于所有层级的历史）
+  const unsigned long maxSeconds = 0xffffffffUL / 1000;
+  historyQuerySensor = sensorNumber - 1;
+  historyQueryFrom = min(from, maxSeconds) * 1000UL;
+  historyQueryTo = min(to, maxSeconds) * 1000UL;
+  historyQueryStep = min(step, maxSeconds) * 1000UL;
+  historyQueryRequested = true;
+  Serial.println("收到query命令，准备发送历史数据");
+  snprintf(message, messageSize, "history queued on %s", MQTT_PUBLISH_TOPIC);
+  return true;
+}
+
+// interval <秒>：设置温度读取间隔，从下一次读取开始生效
+bool handleIntervalCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  long seconds;
+  if (!command.arg(0).toLong(seconds, TEMP_UPDATE_INTERVAL_MIN / 1000, TEMP_UPDATE_INTERVAL_MAX / 1000)) {
+    snprintf(message, messageSize, "interval must be %d-%d s", TEMP_UPDATE_INTERVAL_MIN / 1000, TEMP_UPDATE_INTERVAL_MAX / 1000);
+    return false;
+  }
+  tempUpdateInterval = seconds * 1000UL;
+  scheduler.schedule(temperatureTask, 0, millis());  // 按新间隔重新计算下次读取时间
+  Serial.print("温度读取间隔设置为: ");
+  Serial.print(seconds);
+  Serial.println(" 秒");
+  snprintf(message, messageSize, "interval=%lds", seconds);
+  return true;
+}
+
+// alarm <高温> <低温>：设置报警阈值（°C），从下一次读取开始生效
+bool handleAlarmCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  float high;
+  float low;
+  // DS18B20 的测量范围为 -55~125°C
+  if (!command.arg(0).toFloat(high) || !command.arg(1).toFloat(low) ||
+      high > 125 || low < -55 || low >= high) {
+    snprintf(message, messageSize, "need -55 <= low < high <= 125");
+    return false;
+  }
+  alarmHighTemp = high;
+  alarmLowTemp = low;
+  invalidateSensorTopics(SENSOR_TOPIC_ALARM);  // alarm 主题中带有阈值
+  Serial.print("报警阈值设置为: 高温 ");
+  Serial.print(high, 1);
+  Serial.print("°C, 低温 ");
+  Serial.print(low, 1);
+  Serial.println("°C");
+  snprintf(message, messageSize, "alarm high=%.1f low=%.1f", high, low);
+  return true;
+}
+
+// screen on|off：开关屏幕，与按键4效果相同
+bool handleScreenCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  const CommandToken &state = command.arg(0);
+  if (!state.equals("on") && !state.equals("off")) {
+    snprintf(message, messageSize, "screen must be on or off");
+    return false;
+  }
+  bool on = state.equals("on");
+  setScreenPower(on);
+  Serial.print("[MQTT] 屏幕状态切换: ");
+  Serial.println(on ? "开启" : "关闭");
+  snprintf(message, messageSize, "screen=%s", on ? "on" : "off");
+  return true;
+}
+
+bool handleHelpCommand(const MqttCommandLine &command, char *message, size_t messageSize);
+
+// 命令表：名称、参数个数范围、处理函数、用法
+const MqttCommand MQTT_COMMANDS[] = {
+  {"refresh", 0, 3, handleRefreshCommand, "refresh [fmt=json|msgpack] [since=<seq>] [sensor=<n>]"},
+  {"query", 2, 4, handleQueryCommand, "query <n> <from> [to] [step]"},
+  {"interval", 1, 1, handleIntervalCommand, "interval <seconds>"},
+  {"alarm", 2, 2, handleAlarmCommand, "alarm <high> <low>"},
+  {"screen", 1, 1, handleScreenCommand, "screen on|off"},
+  {"help", 0, 0, handleHelpCommand, "help"},
+};
+const int MQTT_COMMAND_COUNT = sizeof(MQTT_COMMANDS) / sizeof(MQTT_COMMANDS[0]);
+
+// help：列出所有命令名
+bool handleHelpCommand(const MqttCommandLine &command, char *message, size_t messageSize) {
+  size_t used = snprintf(message, messageSize, "commands:");
+  for (int i = 0; i < MQTT_COMMAND_COUNT && used < messageSize; i++) {
+    used += snprintf(message + used, messageSize - used, " %s", MQTT_COMMANDS[i].name);
+  }
+  return true;
+}
+
+// 命令应答进入发送队列（QoS1），由loop发送
+void queueMqttReply(const char *commandName, bool ok, const char *message) {
+  char reply[MQTT_OUTBOX_PAYLOAD];
+  int length = snprintf(reply, sizeof(reply), "{\"cmd\":\"%s\",\"ok\":%s,\"msg\":\"%s\"}",
+                        commandName, ok ? "true" : "false", message);
+  if (!mqttOutbox.push(MQTT_RESPONSE_TOPIC, (const uint8_t*)reply, min(length, (int)sizeof(reply) - 1), 1, false)) {
+    Serial.println("MQTT发送队列已满，丢弃命令应答");
+  }
+}
+
+// 发送队列中的消息：每次最多 MQTT_SEND_BATCH 条，QoS1 消息在途数量受窗口限制，
+// 超时未确认的消息带 DUP 标志重发，超过最大次数后丢弃
+void serviceMqttOutbox() {
+  unsigned long currentMillis = millis();
+  for (int sent = 0; sent < MQTT_SEND_BATCH; sent++) {
+    bool retransmit;
+    auto *message = mqttOutbox.nextToSend(currentMillis, MQTT_INFLIGHT_WINDOW, MQTT_RETRY_MS, retransmit);
+    if (message == NULL) {
+      return;
+    }
+    if (retransmit && message->attempts >= MQTT_MAX_ATTEMPTS) {
+      Serial.print("MQTT消息多次发送未确认，丢弃: ");
+      Serial.println(message->topic);
+      mqttOutbox.drop(*message);
+      continue;
     }
     
-  } else {
-    // 连接失败
-    Serial.print("MQTT连接失败，错误代码: ");
-    Serial.println(mqttClient.state());
+    // 按MQTT 3.1.1格式组装PUBLISH报文，一次写入连接（TLS下只产生一个记录）
+    size_t topicLength = strlen(message->topic);
+    size_t remaining = 2 + topicLength + (message->qos > 0 ? 2 : 0) + message->length;
+    uint8_t packet[5 + 2 + MQTT_OUTBOX_TOPIC + 2 + MQTT_OUTBOX_PAYLOAD];
+    size_t length = 0;
+    packet[length++] = 0x30 | (retransmit ? 0x08 : 0) | (message->qos << 1) | (message->retain ? 0x01 : 0);
+    do {
+      uint8_t digit = remaining & 0x7f;
+      remaining >>= 7;
+      packet[length++] = remaining > 0 ? (digit | 0x80) : digit;
+    } while (remaining > 0);
+    packet[length++] = topicLength >> 8;
+    packet[length++] = topicLength & 0xff;
+    memcpy(packet + length, message->topic, topicLength);
+    length += topicLength;
+    if (message->qos > 0) {
+      packet[length++] = message->packetId >> 8;
+      packet[length++] = message->packetId & 0xff;
+    }
+    memcpy(packet + length, message->payload, message->length);
+    length += message->length;
     
-    if (currentMillis - mqttConnectStartTime > 5000) {  // 5秒超时
-      if (mqttConnectAttempts < MAX_MQTT_ATTEMPTS) {
-        Serial.print("重试MQTT连接 (");
-        Serial.print(mqttConnectAttempts);
-        Serial.print("/");
-        Serial.print(MAX_MQTT_ATTEMPTS);
-        Serial.println(")");
-        
-        mqttConnectStartTime = 0;  // 重置时间，准备重试
-      } else {
-        Serial.println("MQTT连接失败，达到最大重试次数");
-        mqttConnectStartTime = 0;
-        mqttConnectAttempts = 0;
-      }
+    if (mqttTransport.write(packet, length) != length) {
+      Serial.println("MQTT消息写入失败");
+      return;  // 连接异常，留给 serviceConnectivity 处理
     }
+    mqttOutbox.markSent(*message, currentMillis);
   }
 }
 
-void checkMQTTStatus() {
-  if (mqttConnected) {
-    // 检查MQTT连接状态
-    if (!mqttClient.connected()) {
-      Serial.println("MQTT连接丢失");
-      mqttConnected = false;
-      mqttConnectStartTime = 0;  // 重置连接时间，准备重连
-    } else {
-      // 处理MQTT消息
-      mqttClient.loop();
-    }
+// 收到PUBACK（在 mqttClient.loop() 中调用）
+void handlePubAck(uint16_t packetId) {
+  mqttOutbox.acknowledge(packetId);
+}
+
+// 记录发布到 MQTT_PUBLISH_TOPIC 的负载，服务器回送时在 mqttCallback 中忽略。
+// 超出接收缓冲区的消息会被 PubSubClient 直接丢弃、不会进入回调，不占用记录
+void rememberOwnPublish(size_t length, uint32_t hash) {
+  if (length + strlen(MQTT_PUBLISH_TOPIC) + 7 <= MQTT_BUFFER_SIZE) {
+    mqttEchoFilter.record(length, hash, millis());
   }
 }
 
+// 在 mqttClient.loop() 中调用：直接在接收缓冲区中解析，不分配堆内存；
+// 解析与处理的耗时只取决于消息长度上限，发布等耗时操作留给loop执行
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  // 将接收到的消息转换为字符串
-  String message = "";
-  for (int i = 0; i < length; i++) {
-    message += (char)payload[i];
+  // 发布主题与订阅主题相同时会收到自己发布的数据（JSON、MessagePack等），按长度和哈希识别后忽略
+  if (strcmp(topic, MQTT_PUBLISH_TOPIC) == 0 && mqttEchoFilter.consume(payload, length, millis(), MQTT_ECHO_TIMEOUT)) {
+    return;
   }
   
   Serial.print("收到MQTT消息 [");
   Serial.print(topic);
   Serial.print("]: ");
-  Serial.println(message);
+  Serial.write(payload, min(length, (unsigned int)MQTT_COMMAND_MAX_LENGTH));
+  Serial.println(length > MQTT_COMMAND_MAX_LENGTH ? "..." : "");
   
-  // 检查是否是refresh命令
-  if (message == "refresh") {
-    Serial.println("收到refresh命令，准备发送温度数据");
-    mqttDataRequested = true;  // 标记需要发送数据
+  MqttCommandLine command;
+  if (!command.parse(payload, length)) {
+    return;
+  }
+  
+  const MqttCommand *entry = NULL;
+  for (int i = 0; i < MQTT_COMMAND_COUNT; i++) {
+    if (command.name().equals(MQTT_COMMANDS[i].name)) {
+      entry = &MQTT_COMMANDS[i];
+      break;
+    }
   }
+  if (entry == NULL) {
+    Serial.println("未知的MQTT命令");
+    queueMqttReply("", false, "unknown command, send help");
+    return;
+  }
+  
+  if (command.argCount() < entry->minArgs || command.argCount() > entry->maxArgs) {
+    Serial.print(entry->name);
+    Serial.println("命令参数个数错误");
+    char usage[96];
+    snprintf(usage, sizeof(usage), "usage: %s", entry->usage);
+    queueMqttReply(entry->name, false, usage);
+    return;
+  }
+  
+  char message[96];
+  message[0] = '\0';
+  bool ok = entry->handler(command, message, sizeof(message));
+  if (!ok) {
+    Serial.print(entry->name);
+    Serial.print("命令参数无效: ");
+    Serial.println(message);
+  }
+  queueMqttReply(entry->name, ok, message);
 }
 
 void publishTemperatureData() {
@@ -1433,18 +3000,43 @@ void publishTemperatureData() {
     return;  // 如果没有请求数据，不发送
   }
   
-  Serial.println("开始创建温度数据JSON...");
-  
-  // 创建JSON数据
-  String jsonData = createTemperatureJSON();
-  
-  Serial.print("JSON数据长度: ");
-  Serial.println(jsonData.length());
-  Serial.println("JSON数据内容:");
-  Serial.println(jsonData);
+  // 请求的序号之后的样本已被覆盖时，退回发送全部历史
+  bool delta = mqttDataDelta && sampleDeltaAvailable(mqttDataSince);
+  PayloadKey key = makePayloadKey(mqttDataFormat, delta, mqttDataSince, mqttDataSensor);
+  
+  // 流式发布：先计算负载长度写入MQTT报头，再分块直接写入连接，两遍使用同一时间戳，输出完全一致。
+  // 数据与请求参数都未变化时沿用上次的时间戳与长度，只需输出一遍
+  time_t now;
+  size_t length;
+  if (payloadCache.lookup(key, now, length)) {
+    Serial.print("数据未变化，沿用上次的负载长度: ");
+    Serial.println(length);
+  } else {
+    now = getCurrentRealTime();
+    CountingPrint counter;
+    writeTemperaturePayload(counter, now, mqttDataFormat, delta, mqttDataSince, mqttDataSensor);
+    length = counter.length();
+    payloadCache.store(key, now, length);
+    
+    Serial.print(mqttDataFormat == PAYLOAD_MSGPACK ? "MessagePack数据长度: " : "JSON数据长度: ");
+    Serial.println(length);
+  }
   
-  // 发布数据到MQTT主题
-  if (mqttClient.publish(MQTT_PUBLISH_TOPIC, jsonData.c_str())) {
+  bool published = false;
+  if (mqttClient.beginPublish(MQTT_PUBLISH_TOPIC, length, false)) {
+    HashingPrint hashing(mqttClient);
+    BufferedPrint<MQTT_STREAM_CHUNK> stream(hashing);
+    writeTemperaturePayload(stream, now, mqttDataFormat, delta, mqttDataSince, mqttDataSensor);
+    stream.flush();
+    if (stream.written() != length) {
+      payloadCache.invalidate();
+    }
+    published = mqttClient.endPublish() && !stream.failed() && stream.written() == length;
+    if (published) {
+      rememberOwnPublish(length, hashing.hash());
+    }
+  }
+  if (published) {
     Serial.print("成功发布数据到主题: ");
     Serial.println(MQTT_PUBLISH_TOPIC);
   } else {
@@ -1455,61 +3047,361 @@ void publishTemperatureData() {
   mqttDataRequested = false;
 }
 
-String createTemperatureJSON() {
-  DynamicJsonDocument doc(8192);  // 分配8KB内存用于JSON文档
+// 负载缓存键；未使用增量时 since 不影响负载
+PayloadKey makePayloadKey(PayloadFormat format, bool delta, uint32_t since, int sensor) {
+  PayloadKey key;
+  key.version = payloadDataVersion;
+  key.format = format;
+  key.delta = delta;
+  key.since = delta ? since : 0;
+  key.sensor = sensor;
+  return key;
+}
+
+// 回复历史查询：只序列化查询范围内的点
+// t 为各点距现在的秒数，avg/min/max 为该步长内的汇总值（无有效数据时为0）
+void publishHistoryQuery() {
+  historyQueryRequested = false;
+  
+  int tier;
+  unsigned long step = historyQueryStep;
+  int pointCount = queryHistory(historyQuerySensor, millis(), historyQueryFrom, historyQueryTo, step,
+                                historyPoints, HISTORY_QUERY_MAX_POINTS, tier);
+  
+  DynamicJsonDocument doc(1024 + pointCount * 64);
+  doc["query"] = "T" + String(historyQuerySensor + 1) + "-" + getShortAddress(sensorRegistry.addresses[historyQuerySensor]);
+  doc["tier"] = tier == TIER_FULLRATE ? "full" : GRAPH_TIER_LABELS[tier];
+  doc["step"] = step / 1000;
+  
+  JsonArray times = doc.createNestedArray("t");
+  JsonArray avgs = doc.createNestedArray("avg");
+  JsonArray mins = doc.createNestedArray("min");
+  JsonArray maxs = doc.createNestedArray("max");
+  for (int i = 0; i < pointCount; i++) {
+    const RollupBucket &bucket = historyPoints[i].bucket;
+    times.add(historyPoints[i].age / 1000);
+    if (bucket.count > 0) {
+      avgs.add(round(rawToTemp(bucket.avgRaw) * 10) / 10.0);
+      mins.add(round(rawToTemp(bucket.minRaw) * 10) / 10.0);
+      maxs.add(round(rawToTemp(bucket.maxRaw) * 10) / 10.0);
+    } else {
+      avgs.add(0.0);
+      mins.add(0.0);
+      maxs.add(0.0);
+    }
+  }
   
-  // 添加系统时间信息
-  doc["system_time"] = formatRealTime(getCurrentRealTime());
-  doc["time_synced"] = timeSynced;
+  size_t length = measureJson(doc);
+  Serial.print("历史查询结果: ");
+  Serial.print(pointCount);
+  Serial.print(" 点, JSON长度 ");
+  Serial.println(length);
+  
+  // 与温度数据相同，直接序列化到连接，不受MQTT缓冲区大小限制
+  bool published = false;
+  if (mqttClient.beginPublish(MQTT_PUBLISH_TOPIC, length, false)) {
+    HashingPrint hashing(mqttClient);
+    BufferedPrint<MQTT_STREAM_CHUNK> stream(hashing);
+    serializeJson(doc, stream);
+    stream.flush();
+    published = mqttClient.endPublish() && !stream.failed() && stream.written() == length;
+    if (published) {
+      rememberOwnPublish(length, hashing.hash());
+    }
+  }
+  if (published) {
+    Serial.print("成功发布历史数据到主题: ");
+    Serial.println(MQTT_PUBLISH_TOPIC);
+  } else {
+    Serial.println("发布历史数据失败");
+  }
+}
+
+// 发布的样本序号（高位为启动会话号）
+uint64_t publicSampleSeq(uint32_t seq) {
+  return ((uint64_t)bootSession << 32) | seq;
+}
+
+// 增量请求可用：序号不晚于最新样本，且其后的样本在所有传感器中均未被覆盖
+// （之后才接入的传感器没有更早的样本，不影响增量）
+bool sampleDeltaAvailable(uint32_t since) {
+  if ((int32_t)(tempSampleSeq - since) < 0) {
+    return false;
+  }
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    const TempRecord &record = sensorRegistry.records[i];
+    uint32_t oldestSeq = record.lastSeq - (record.count() - 1);
+    if (record.samples.full() && (int32_t)(oldestSeq - since) > 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 逐字段输出温度JSON数据（格式见 TemperatureJson.h）
+// 格式：{"system_time":"...","time_synced":true,"seq":N,"T1-序列号":{"c_t":"28.5","last_time":"...","l_t":[...]},...}
+// seq 为最新样本的序号；增量数据另有 "since"，l_t 只包含序号大于 since 的样本
+// onlySensor 不小于0时只输出该传感器（refresh sensor=<n>）
+void writeTemperatureJSON(Print &out, time_t now, bool delta, uint32_t since, int onlySensor) {
+  writeJsonHeader(out, formatRealTime(now).c_str(), timeSynced, publicSampleSeq(tempSampleSeq), delta,
+                  publicSampleSeq(since));
   
-  // 为每个传感器创建数据
-  for (int i = 0; i < totalSensors; i++) {
-    // 生成序列号显示
-    String shortAddr;
-    shortAddr.reserve(8);
-    for (int j = 4; j < 8; j++) {
-      char hex[3];
-      sprintf(hex, "%02X", sensorAddresses[i][j]);
-      shortAddr += hex;
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (onlySensor >= 0 && i != onlySensor) {
+      continue;
     }
-    
-    // 创建传感器标识符：T1-序列号格式
-    String sensorKey = "T" + String(i + 1) + "-" + shortAddr;
-    
-    // 创建传感器对象
-    JsonObject sensorObj = doc.createNestedObject(sensorKey);
-    
-    // 添加当前温度
-    float currentTemp = currentTemps[i];
-    if (currentTemp != DEVICE_DISCONNECTED_C) {
-      sensorObj["c_t"] = String(currentTemp, 1);  // 保留1位小数
+    // 传感器标识符：T1-序列号格式
+    char sensorKey[16];
+    const uint8_t *address = sensorRegistry.addresses[i];
+    snprintf(sensorKey, sizeof(sensorKey), "T%d-%02X%02X%02X%02X", i + 1, address[4], address[5], address[6], address[7]);
+    
+    // 分批读取过程中已写入下一间隔的样本留到下次发送，与 seq 保持一致
+    const TempRecord &record = sensorRegistry.records[i];
+    int start = delta ? record.indexAfterSeq(since) : 0;
+    int end = record.indexAfterSeq(tempSampleSeq);
+    writeJsonSensor(out, sensorKey, sensorRegistry.currentTemps[i],
+                    formatRealTime(realTimeAtMillis(record.lastStatsUpdate)).c_str(), record, start, end);
+  }
+  
+  out.print('}');
+}
+
+// 输出MessagePack格式的温度数据（格式见 TemperatureMsgPack.h），参数与 writeTemperatureJSON 相同
+void writeTemperatureMsgPack(Print &out, time_t now, bool delta, uint32_t since, int onlySensor) {
+  MsgPackWriter writer(out);
+  writeMsgPackHeader(writer, formatRealTime(now).c_str(), timeSynced, publicSampleSeq(tempSampleSeq), delta,
+                     publicSampleSeq(since), onlySensor >= 0 ? 1 : sensorRegistry.count);
+  
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (onlySensor >= 0 && i != onlySensor) {
+      continue;
+    }
+    char sensorKey[16];
+    const uint8_t *address = sensorRegistry.addresses[i];
+    snprintf(sensorKey, sizeof(sensorKey), "T%d-%02X%02X%02X%02X", i + 1, address[4], address[5], address[6], address[7]);
+    
+    const TempRecord &record = sensorRegistry.records[i];
+    int start = delta ? record.indexAfterSeq(since) : 0;
+    int end = record.indexAfterSeq(tempSampleSeq);
+    writeMsgPackSensor(writer, sensorKey, sensorRegistry.currentTemps[i],
+                       formatRealTime(realTimeAtMillis(record.lastStatsUpdate)).c_str(), record, start, end);
+  }
+}
+
+void writeTemperaturePayload(Print &out, time_t now, PayloadFormat format, bool delta, uint32_t since, int onlySensor) {
+  if (format == PAYLOAD_MSGPACK) {
+    writeTemperatureMsgPack(out, now, delta, since, onlySensor);
+  } else {
+    writeTemperatureJSON(out, now, delta, since, onlySensor);
+  }
+}
+
+// 检查传感器当前温度与上次发布的值，超出死区或连接状态变化时加入合并窗口
+void checkTelemetryChange(int sensorIndex) {
+  if (!TELEMETRY_ENABLE || sensorRegistry.telemetryDirty[sensorIndex]) {
+    return;
+  }
+  float current = sensorRegistry.currentTemps[sensorIndex];
+  if (!telemetryTrigger.changed(current, sensorRegistry.publishedTemps[sensorIndex])) {
+    return;
+  }
+  
+  sensorRegistry.telemetryDirty[sensorIndex] = true;
+  telemetryTrigger.markChanged(millis());
+}
+
+// 定时/变化遥测发布：
+//   距上次全量发布超过 TELEMETRY_INTERVAL 时发布全部传感器；
+//   否则合并窗口结束（且距上次发布超过最小间隔）时只发布变化的传感器
+// 采集的快照在已连接且没有积压时直接发布，否则进入离线缓存
+void publishTelemetry() {
+  if (!TELEMETRY_ENABLE || sensorRegistry.count == 0) {
+    return;
+  }
+  
+  unsigned long currentMillis = millis();
+  TelemetryTrigger::Due due = telemetryTrigger.due(currentMillis);
+  if (due == TelemetryTrigger::DUE_NONE) {
+    return;
+  }
+  bool full = due == TelemetryTrigger::DUE_FULL;
+  
+  // 采集快照；进入缓存的值同样视为已发布，死区以其为基准
+  TelemetryEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.capturedAt = currentMillis;
+  entry.realTime = (uint32_t)getCurrentRealTime();
+  entry.seq = tempSampleSeq;
+  entry.full = full;
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (full || sensorRegistry.telemetryDirty[i]) {
+      entry.include(i);
+      entry.raw[i] = tempToRaw(sensorRegistry.currentTemps[i]);
+      sensorRegistry.publishedTemps[i] = sensorRegistry.currentTemps[i];
+      sensorRegistry.telemetryDirty[i] = false;
+    }
+  }
+  telemetryTrigger.published(currentMillis, full);
+  
+  if (!telemetrySpool.submit(entry, mqttConnected, sendTelemetryEntry, currentMillis)) {
+    Serial.print("遥测缓存已满，丢弃最旧条目，累计丢弃: ");
+    Serial.println(telemetrySpool.dropped());
+  }
+}
+
+// 发布一个遥测条目
+bool sendTelemetryEntry(const TelemetryEntry &entry, unsigned long currentMillis) {
+  CountingPrint counter;
+  writeTelemetryJSON(counter, entry, currentMillis);
+  
+  if (!mqttClient.beginPublish(TELEMETRY_TOPIC, counter.length(), false)) {
+    return false;
+  }
+  BufferedPrint<MQTT_STREAM_CHUNK> stream(mqttClient);
+  writeTelemetryJSON(stream, entry, currentMillis);
+  stream.flush();
+  return mqttClient.endPublish() && !stream.failed() && stream.written() == counter.length();
+}
+
+// 补发离线缓存：每批最多 TELEMETRY_DRAIN_BATCH 条，批间隔 TELEMETRY_DRAIN_INTERVAL，
+// 先补发闪存中的（较旧）条目，再补发内存队列；发布失败时停止，下批重试
+void drainTelemetryQueue() {
+  if (!mqttConnected || telemetrySpool.empty()) {
+    return;
+  }
+  telemetrySpool.drain(TELEMETRY_DRAIN_BATCH, sendTelemetryEntry, millis());
+  if (telemetrySpool.empty()) {
+    Serial.println("离线缓存的遥测已全部补发");
+  }
+}
+
+// 遥测JSON：{"time":"...","seq":N,"full":true,"T1-序列号":28.5,"T2-序列号":null,...}
+// full 为 false 时只包含超出死区的传感器；补发的条目另有 "age"（采集距今的秒数）
+void writeTelemetryJSON(Print &out, const TelemetryEntry &entry, unsigned long currentMillis) {
+  out.print("{\"time\":\"");
+  out.print(formatRealTime(entry.realTime));
+  out.print("\",\"seq\":");
+  out.print((unsigned long long)publicSampleSeq(entry.seq));
+  out.print(",\"full\":");
+  out.print(entry.full ? "true" : "false");
+  unsigned long age = (currentMillis - entry.capturedAt) / 1000;
+  if (age > 0) {
+    out.print(",\"age\":");
+    out.print(age);
+  }
+  
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    if (!entry.includes(i)) {
+      continue;
+    }
+    char sensorKey[16];
+    const uint8_t *address = sensorRegistry.addresses[i];
+    snprintf(sensorKey, sizeof(sensorKey), "T%d-%02X%02X%02X%02X", i + 1, address[4], address[5], address[6], address[7]);
+    out.print(",\"");
+    out.print(sensorKey);
+    out.print("\":");
+    if (entry.raw[i] != TEMP_RAW_INVALID) {
+      printJsonTemp(out, rawToTemp(entry.raw[i]));
     } else {
-      sensorObj["c_t"] = "null";
+      out.print("null");
+    }
+  }
+  
+  out.print('}');
+}
+
+void invalidateSensorTopics(uint8_t topics) {
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    sensorRegistry.retainedTopics[i] &= ~topics;
+  }
+}
+
+// 以 retain 标志发布一个单传感器主题（进入发送队列，QoS1）：<SENSOR_TOPIC_BASE>/<完整序列号>/<name>
+static bool publishSensorTopic(int sensorIndex, const char *name, const JsonDocument &doc) {
+  const uint8_t *address = sensorRegistry.addresses[sensorIndex];
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%02X%02X%02X%02X%02X%02X%02X%02X/%s", SENSOR_TOPIC_BASE,
+           address[0], address[1], address[2], address[3], address[4], address[5], address[6], address[7], name);
+  char payload[128];
+  size_t length = serializeJson(doc, payload, sizeof(payload));
+  return mqttOutbox.push(topic, (const uint8_t*)payload, length, 1, true);
+}
+
+// 温度保留1位小数，无效数据为null
+static void setJsonTemp(JsonDocument &doc, const char *key, float temp) {
+  if (temp != DEVICE_DISCONNECTED_C) {
+    doc[key] = round(temp * 10) / 10.0;
+  } else {
+    doc[key] = nullptr;
+  }
+}
+
+// 轮询各传感器，内容与上次发布的不同时重新发布；每次最多发布 SENSOR_TOPIC_BATCH 条，
+// 发送队列已满时主题保持未发布状态，下次重试
+// current: {"temp":28.5,"time":"..."}（按显示精度0.1°C比较）
+// stats:   {"min":21.9,"max":28.5,"avg":24.3,"samples":240,"seq":N}（最近48小时，seq 与 refresh 负载相同）
+// alarm:   {"state":"normal|high|low","high":30.0,"low":10.0}
+void publishSensorTopics() {
+  if (!SENSOR_TOPICS_ENABLE || sensorRegistry.count == 0) {
+    return;
+  }
+  
+  int published = 0;
+  for (int checked = 0; checked < sensorRegistry.count && published < SENSOR_TOPIC_BATCH; checked++) {
+    int i = sensorTopicCursor;
+    sensorTopicCursor = (sensorTopicCursor + 1) % sensorRegistry.count;
+    uint8_t &retained = sensorRegistry.retainedTopics[i];
+    
+    float temp = sensorRegistry.currentTemps[i];
+    int16_t tenths = temp != DEVICE_DISCONNECTED_C ? (int16_t)lround(temp * 10) : INT16_MIN;
+    if (!(retained & SENSOR_TOPIC_CURRENT) || sensorRegistry.retainedTenths[i] != tenths) {
+      StaticJsonDocument<128> doc;
+      setJsonTemp(doc, "temp", temp);
+      doc["time"] = formatRealTime(getCurrentRealTime());
+      if (publishSensorTopic(i, "current", doc)) {
+        sensorRegistry.retainedTenths[i] = tenths;
+        retained |= SENSOR_TOPIC_CURRENT;
+      } else {
+        retained &= ~SENSOR_TOPIC_CURRENT;
+      }
+      published++;
     }
     
-    // 添加真实时间戳
-    sensorObj["last_time"] = formatRealTime(sensorRecords[i].lastRealTime);
-    
-    // 添加历史温度数组
-    JsonArray historyArray = sensorObj.createNestedArray("l_t");
+    const TempRecord &record = sensorRegistry.records[i];
+    if (published < SENSOR_TOPIC_BATCH && record.count() > 0 &&
+        (!(retained & SENSOR_TOPIC_STATS) || sensorRegistry.retainedStatsSeq[i] != record.lastSeq)) {
+      StaticJsonDocument<128> doc;
+      setJsonTemp(doc, "min", record.minTemp);
+      setJsonTemp(doc, "max", record.maxTemp);
+      setJsonTemp(doc, "avg", record.avgTemp);
+      doc["samples"] = record.validCount;
+      doc["seq"] = publicSampleSeq(record.lastSeq);
+      if (publishSensorTopic(i, "stats", doc)) {
+        sensorRegistry.retainedStatsSeq[i] = record.lastSeq;
+        retained |= SENSOR_TOPIC_STATS;
+      } else {
+        retained &= ~SENSOR_TOPIC_STATS;
+      }
+      published++;
+    }
     
-    // 获取历史温度数据
-    TempRecord& record = sensorRecords[i];
-    for (int j = 0; j < record.recordCount; j++) {
-      float temp = record.temps[j];
-      if (temp != DEVICE_DISCONNECTED_C) {
-        historyArray.add(round(temp * 10) / 10.0);  // 保留1位小数
+    uint8_t alarm = sensorRegistry.highAlarm[i] ? SENSOR_ALARM_HIGH :
+                    sensorRegistry.lowAlarm[i] ? SENSOR_ALARM_LOW : SENSOR_ALARM_NORMAL;
+    if (published < SENSOR_TOPIC_BATCH &&
+        (!(retained & SENSOR_TOPIC_ALARM) || sensorRegistry.retainedAlarm[i] != alarm)) {
+      StaticJsonDocument<128> doc;
+      doc["state"] = SENSOR_ALARM_LABELS[alarm];
+      doc["high"] = alarmHighTemp;
+      doc["low"] = alarmLowTemp;
+      if (publishSensorTopic(i, "alarm", doc)) {
+        sensorRegistry.retainedAlarm[i] = alarm;
+        retained |= SENSOR_TOPIC_ALARM;
       } else {
-        historyArray.add(0.0);  // 对于无效数据使用0
+        retained &= ~SENSOR_TOPIC_ALARM;
       }
+      published++;
     }
   }
-  
-  // 序列化JSON为字符串
-  String jsonString;
-  serializeJson(doc, jsonString);
-  
-  return jsonString;
 }
 
 void setupPowerManagement() {
@@ -1534,157 +3426,187 @@ void setupPowerManagement() {
 }
 
 void monitorPowerStatus() {
-  static unsigned long lastPowerCheck = 0;
   static int powerCheckCount = 0;
   unsigned long currentMillis = millis();
+  powerCheckCount++;
   
-  // 每30秒检查一次电源状态
-  if (currentMillis - lastPowerCheck >= 30000) {
-    lastPowerCheck = currentMillis;
-    powerCheckCount++;
-    
-    // 获取当前电压（如果使用电池供电）
-    // float voltage = analogRead(1) * 2 * 3.3 / 4095.0;  // 分压电路
-    
-    // 检查WiFi连接状态
-    if (WiFi.status() != WL_CONNECTED) {
-      Serial.println("警告: WiFi连接丢失");
-    }
-    
-    // 检查MQTT连接状态
-    if (!mqttConnected) {
-      Serial.println("警告: MQTT连接丢失");
-    }
-    
-    // 每5分钟输出一次状态信息
-    if (powerCheckCount % 10 == 0) {
-      Serial.println("=== 电源状态监控 ===");
-      Serial.print("运行时间: ");
-      Serial.print(currentMillis / 1000);
-      Serial.println(" 秒");
-      Serial.print("CPU频率: ");
-      Serial.print(ESP.getCpuFreqMHz());
-      Serial.println(" MHz");
-      Serial.print("WiFi状态: ");
-      Serial.println(WiFi.status() == WL_CONNECTED ? "已连接" : "未连接");
-      Serial.print("MQTT状态: ");
-      Serial.println(mqttConnected ? "已连接" : "未连接");
-      Serial.print("可用内存: ");
-      Serial.print(ESP.getFreeHeap());
-      Serial.println(" 字节");
-      Serial.println("==================");
-    }
+  // 获取当前电压（如果使用电池供电）
+  // float voltage = analogRead(1) * 2 * 3.3 / 4095.0;  // 分压电路
+  
+  // 检查WiFi连接状态
+  if (WiFi.status() != WL_CONNECTED) {
+    Serial.println("警告: WiFi连接丢失");
   }
-}
-
-void printSystemInfo() {
-  static unsigned long lastPrintTime = 0;
-  unsigned long currentMillis = millis();
   
-  // 每秒打印一次
-  if (currentMillis - lastPrintTime >= 10000) {
-    lastPrintTime = currentMillis;
-    
-    Serial.println("\n=== 系统信息 ===");
+  // 检查MQTT连接状态
+  if (!mqttConnected) {
+    Serial.println("警告: MQTT连接丢失");
+  }
+  
+  // 每5分钟输出一次状态信息
+  if (powerCheckCount % 10 == 0) {
+    Serial.println("=== 电源状态监控 ===");
     Serial.print("运行时间: ");
     Serial.print(currentMillis / 1000);
     Serial.println(" 秒");
-    
-    // 内存信息
-    Serial.print("可用内存: ");
-    Serial.print(ESP.getFreeHeap());
-    Serial.println(" 字节");
-    Serial.print("最小可用内存: ");
-    Serial.print(ESP.getMinFreeHeap());
-    Serial.println(" 字节");
-    Serial.print("最大分配块: ");
-    Serial.print(ESP.getMaxAllocHeap());
-    Serial.println(" 字节");
-    
-    // CPU信息
     Serial.print("CPU频率: ");
     Serial.print(ESP.getCpuFreqMHz());
     Serial.println(" MHz");
-    
-    // WiFi信息
     Serial.print("WiFi状态: ");
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.println("已连接");
-      Serial.print("IP地址: ");
-      Serial.println(WiFi.localIP());
-      Serial.print("信号强度: ");
-      Serial.print(WiFi.RSSI());
-      Serial.println(" dBm");
-    } else {
-      Serial.println("未连接");
-    }
-    
-    // MQTT信息
+    Serial.println(WiFi.status() == WL_CONNECTED ? "已连接" : "未连接");
     Serial.print("MQTT状态: ");
     Serial.println(mqttConnected ? "已连接" : "未连接");
-    
-    // 时间同步信息
-    Serial.print("时间同步状态: ");
-    Serial.println(timeSynced ? "已同步" : "未同步");
-    if (timeSynced) {
-      Serial.print("当前时间: ");
-      Serial.println(formatRealTime(getCurrentRealTime()));
-    }
-    
-    // 屏幕信息
-    Serial.print("屏幕状态: ");
-    Serial.println(screenOn ? "开启" : "关闭");
-    
-    // 传感器信息
-    Serial.print("传感器数量: ");
-    Serial.println(totalSensors);
-    for (int i = 0; i < totalSensors; i++) {
-      Serial.print("T");
-      Serial.print(i + 1);
-      Serial.print(": ");
-      if (currentTemps[i] != DEVICE_DISCONNECTED_C) {
-        Serial.print(currentTemps[i], 1);
-        Serial.println("°C");
-      } else {
-        Serial.println("未连接");
-      }
+    Serial.print("可用内存: ");
+    Serial.print(ESP.getFreeHeap());
+    Serial.println(" 字节");
+    Serial.println("==================");
+  }
+}
+
+void printSystemInfo() {
+  unsigned long currentMillis = millis();
+  
+  Serial.println("\n=== 系统信息 ===");
+  Serial.print("运行时间: ");
+  Serial.print(currentMillis / 1000);
+  Serial.println(" 秒");
+  
+  // 内存信息
+  Serial.print("可用内存: ");
+  Serial.print(ESP.getFreeHeap());
+  Serial.println(" 字节");
+  Serial.print("最小可用内存: ");
+  Serial.print(ESP.getMinFreeHeap());
+  Serial.println(" 字节");
+  Serial.print("最大分配块: ");
+  Serial.print(ESP.getMaxAllocHeap());
+  Serial.println(" 字节");
+  
+  // CPU信息
+  Serial.print("CPU频率: ");
+  Serial.print(ESP.getCpuFreqMHz());
+  Serial.println(" MHz");
+  
+  // WiFi信息
+  Serial.print("WiFi状态: ");
+  if (WiFi.status() == WL_CONNECTED) {
+    Serial.println("已连接");
+    Serial.print("IP地址: ");
+    Serial.println(WiFi.localIP());
+    Serial.print("信号强度: ");
+    Serial.print(WiFi.RSSI());
+    Serial.println(" dBm");
+  } else {
+    Serial.println("未连接");
+  }
+  
+  // MQTT信息
+  Serial.print("MQTT状态: ");
+  Serial.println(mqttConnected ? "已连接" : "未连接");
+  
+  // 时间同步信息
+  Serial.print("时间同步状态: ");
+  Serial.println(timeSynced ? "已同步" : "未同步");
+  if (timeSynced) {
+    Serial.print("当前时间: ");
+    Serial.println(formatRealTime(getCurrentRealTime()));
+  }
+  
+  // 屏幕信息
+  Serial.print("屏幕状态: ");
+  Serial.println(screenOn ? "开启" : "关闭");
+  
+  // 传感器信息
+  Serial.print("传感器数量: ");
+  Serial.println(sensorRegistry.count);
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    Serial.print("T");
+    Serial.print(i + 1);
+    Serial.print(": ");
+    if (sensorRegistry.currentTemps[i] != DEVICE_DISCONNECTED_C) {
+      Serial.print(sensorRegistry.currentTemps[i], 1);
+      Serial.println("°C");
+    } else {
+      Serial.println("未连接");
     }
-    
-    // 显示模式信息
-    Serial.print("显示模式: ");
-    switch (currentMode) {
-      case MODE_OVERVIEW:
-        Serial.println("概览模式");
-        break;
-      case MODE_DETAIL:
-        Serial.println("详情模式");
-        break;
-      case MODE_GRAPH:
-        Serial.println("图表模式");
-        break;
+  }
+  
+  // 遥测离线缓存
+  Serial.print("遥测缓存: 内存 ");
+  Serial.print(telemetrySpool.queued());
+  Serial.print(", 闪存 ");
+  Serial.print(telemetrySpool.spilled());
+  Serial.print(", 已丢弃 ");
+  Serial.println(telemetrySpool.dropped());
+  
+  // 全速率历史压缩情况
+  Serial.print("全速率历史: 空闲块 ");
+  Serial.print(fullRateHistory.freeBlocks());
+  Serial.print("/");
+  Serial.println(fullRateHistory.blockCount());
+  for (int i = 0; i < sensorRegistry.count; i++) {
+    uint32_t points = fullRateHistory.points(i);
+    if (points == 0) {
+      continue;
     }
-    
-    // 按键状态
-    Serial.print("按键状态: K1=");
-    Serial.print(digitalRead(KEY1_PIN));
-    Serial.print(" K2=");
-    Serial.print(digitalRead(KEY2_PIN));
-    Serial.print(" K3=");
-    Serial.print(digitalRead(KEY3_PIN));
-    Serial.print(" K4=");
-    Serial.println(digitalRead(KEY4_PIN));
-    
-    // 背光状态
-    Serial.print("背光引脚(GPIO");
-    Serial.print(TFT_BL);
-    Serial.print(")状态: ");
-    Serial.println(digitalRead(TFT_BL) ? "HIGH" : "LOW");
-    
-    Serial.println("================\n");
+    Serial.print("T");
+    Serial.print(i + 1);
+    Serial.print(": ");
+    Serial.print(points);
+    Serial.print(" 点, ");
+    Serial.print((float)fullRateHistory.encodedBits(i) / points, 2);
+    Serial.print(" 位/点, 覆盖 ");
+    Serial.print((fullRateHistory.newestTime(i) - fullRateHistory.oldestTime(i)) / (60000 / FULLRATE_TIME_UNIT_MS));
+    Serial.println(" 分钟");
   }
+  
+  // 显示模式信息
+  Serial.print("显示模式: ");
+  switch (currentMode) {
+    case MODE_OVERVIEW:
+      Serial.println("概览模式");
+      break;
+    case MODE_DETAIL:
+      Serial.println("详情模式");
+      break;
+    case MODE_GRAPH:
+      Serial.println("图表模式");
+      break;
+  }
+  
+  // 按键状态
+  Serial.print("按键状态: K1=");
+  Serial.print(digitalRead(KEY1_PIN));
+  Serial.print(" K2=");
+  Serial.print(digitalRead(KEY2_PIN));
+  Serial.print(" K3=");
+  Serial.print(digitalRead(KEY3_PIN));
+  Serial.print(" K4=");
+  Serial.println(digitalRead(KEY4_PIN));
+  
+  // 背光状态
+  Serial.print("背光引脚(GPIO");
+  Serial.print(TFT_BL);
+  Serial.print(")状态: ");
+  Serial.println(digitalRead(TFT_BL) ? "HIGH" : "LOW");
+  
+  Serial.println("================\n");
+}
+
+// SNTP同步完成回调，在网络任务中执行
+static void onNtpSync(struct timeval *tv) {
+  portENTER_CRITICAL(&ntpSampleMux);
+  ntpSampleTime = *tv;
+  ntpSampleMillis = millis();
+  ntpSamplePending = true;
+  portEXIT_CRITICAL(&ntpSampleMux);
 }
 
 void setupTimeSync() {
+  // SNTP在后台按间隔同步，每次同步完成后通过回调通知
+  sntp_set_time_sync_notification_cb(onNtpSync);
+  sntp_set_sync_interval(NTP_UPDATE_INTERVAL);
+  
   // 配置时区
   configTime(NTP_GMT_OFFSET * 3600, NTP_DAYLIGHT_OFFSET * 3600, NTP_SERVER);
   
@@ -1695,77 +3617,86 @@ void setupTimeSync() {
   Serial.println(NTP_GMT_OFFSET);
 }
 
+uint64_t monotonicMillis() {
+  return monotonicClock.extend(millis());
+}
+
 void syncTime() {
-  if (!wifiConnected) {
-    return;  // WiFi未连接时无法同步时间
+  uint32_t nowMillis = millis();
+  uint64_t now = monotonicClock.extend(nowMillis);  // 每次循环调用，保证不错过 millis() 回绕
+  if (!ntpSamplePending) {
+    return;
   }
   
-  unsigned long currentMillis = millis();
+  portENTER_CRITICAL(&ntpSampleMux);
+  struct timeval sample = ntpSampleTime;
+  uint32_t sampleMillis = ntpSampleMillis;
+  ntpSamplePending = false;
+  portEXIT_CRITICAL(&ntpSampleMux);
   
-  // 检查是否需要更新时间
-  if (!timeSynced || (currentMillis - lastNTPUpdate >= NTP_UPDATE_INTERVAL)) {
-    Serial.println("开始同步时间...");
-    
-    // 等待时间同步
-    int retryCount = 0;
-    while (!timeSynced && retryCount < 10) {
-      time_t now = time(nullptr);
-      if (now > 24 * 3600) {  // 时间同步成功（时间戳大于1天）
-        timeSynced = true;
-        lastNTPUpdate = currentMillis;
-        lastRealTime = now;
-        
-        // 格式化并打印当前时间
-        struct tm timeinfo;
-        if (gmtime_r(&now, &timeinfo)) {
-          Serial.print("时间同步成功: ");
-          Serial.printf("%04d-%02d-%02d %02d:%02d:%02d\n",
-                       timeinfo.tm_year + 1900,
-                       timeinfo.tm_mon + 1,
-                       timeinfo.tm_mday,
-                       timeinfo.tm_hour,
-                       timeinfo.tm_min,
-                       timeinfo.tm_sec);
-        }
-        break;
-      }
-      delay(1000);
-      retryCount++;
-      Serial.print("等待时间同步... ");
-      Serial.println(retryCount);
-    }
-    
-    if (!timeSynced) {
-      Serial.println("时间同步失败");
-    }
+  uint64_t sampleMono = now - (uint32_t)(nowMillis - sampleMillis);
+  int64_t sampleEpoch = (int64_t)sample.tv_sec * 1000 + sample.tv_usec / 1000;
+  if (sampleEpoch < 24LL * 3600 * 1000) {
+    return;  // 无效时间
+  }
+  int64_t error = sampleEpoch - wallClock.epochMillis(sampleMono);
+  bool stepped = wallClock.discipline(sampleMono, sampleEpoch);
+  
+  if (!timeSynced) {
+    timeSynced = true;
+    payloadDataVersion++;
+    Serial.print("时间同步成功: ");
+    Serial.println(formatRealTime(getCurrentRealTime()));
+  } else {
+    Serial.print("NTP校准: 偏差 ");
+    Serial.print((long)error);
+    Serial.println(stepped ? " ms，直接跳变" : " ms，缓慢调整");
   }
 }
 
 time_t getCurrentRealTime() {
   if (timeSynced) {
-    return time(nullptr);
+    return (time_t)(wallClock.epochMillis(monotonicMillis()) / 1000);
   } else {
     return 0;  // 时间未同步时返回0
   }
 }
 
+time_t realTimeAtMillis(unsigned long timestamp) {
+  if (!timeSynced || timestamp == 0) {
+    return 0;
+  }
+  uint64_t now = monotonicMillis();
+  return (time_t)(wallClock.epochMillis(now - (uint32_t)((uint32_t)now - timestamp)) / 1000);
+}
+
 String formatRealTime(time_t timestamp) {
   if (timestamp == 0) {
     return "未同步";
   }
+  if (timestamp < 0) {
+    return "格式化失败";
+  }
   
-  struct tm timeinfo;
-  if (gmtime_r(&timestamp, &timeinfo)) {
-    char timeStr[32];
-    snprintf(timeStr, sizeof(timeStr), "%04d-%02d-%02d %02d:%02d:%02d",
+  // 日期部分只在跨天时用 gmtime_r 重新计算，时分秒直接由当天的秒数得出
+  static long cachedDay = -1;
+  static char cachedDate[12];
+  long day = (long)(timestamp / 86400);
+  if (day != cachedDay) {
+    struct tm timeinfo;
+    if (!gmtime_r(&timestamp, &timeinfo)) {
+      return "格式化失败";
+    }
+    snprintf(cachedDate, sizeof(cachedDate), "%04d-%02d-%02d",
              timeinfo.tm_year + 1900,
              timeinfo.tm_mon + 1,
-             timeinfo.tm_mday,
-             timeinfo.tm_hour,
-             timeinfo.tm_min,
-             timeinfo.tm_sec);
-    return String(timeStr);
-  } else {
-    return "格式化失败";
+             timeinfo.tm_mday);
+    cachedDay = day;
   }
-} 
\ No newline at end of file
+  
+  long secondOfDay = (long)(timestamp % 86400);
+  char timeStr[32];
+  snprintf(timeStr, sizeof(timeStr), "%s %02ld:%02ld:%02ld",
+           cachedDate, secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60);
+  return String(timeStr);
+}
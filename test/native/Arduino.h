@@ -0,0 +1,108 @@
+#pragma once
+
+// 主机单元测试用的最小 Arduino.h：只提供 include/ 中输出流相关头文件
+// （StreamPrint.h、MsgPackWriter.h、TemperatureJson.h）用到的 Print 接口与 dtostrf，
+// 由 [env:native] 的 -Itest/native 引入
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+ public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t value) = 0;
+
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written])) {
+      written++;
+    }
+    return written;
+  }
+
+  // 与 Arduino 的 Print::print 相同：十进制输出，不带结束符
+  size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t print(char value) { return write((uint8_t)value); }
+  size_t print(int value) { return print((long long)value); }
+  size_t print(long value) { return print((long long)value); }
+  size_t print(unsigned int value) { return print((unsigned long long)value); }
+  size_t print(unsigned long value) { return print((unsigned long long)value); }
+  size_t print(long long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%lld", value);
+    return print(text);
+  }
+  size_t print(unsigned long long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%llu", value);
+    return print(text);
+  }
+};
+
+// ESP32 Arduino 核心 stdlib_noniso.c 中 dtostrf 的移植（String(value, decimals) 也使用它）：
+// 先加上 0.5 个末位再逐位截断，与 printf 的舍入方式不同（0.25 保留1位为 "0.3"），
+// -0.0 不带负号
+inline char* dtostrf(double number, signed int width, unsigned int prec, char* s) {
+  bool negative = false;
+  if (number != number) {
+    strcpy(s, "nan");
+    return s;
+  }
+  if (number > 1.7976931348623157e308 || number < -1.7976931348623157e308) {
+    strcpy(s, "inf");
+    return s;
+  }
+
+  char* out = s;
+  int fillme = width;
+  if (prec > 0) {
+    fillme -= (prec + 1);
+  }
+  if (number < 0.0) {
+    negative = true;
+    fillme--;
+    number = -number;
+  }
+
+  double rounding = 2.0;
+  for (unsigned int i = 0; i < prec; ++i) {
+    rounding *= 10.0;
+  }
+  rounding = 1.0 / rounding;
+  number += rounding;
+
+  double tenpow = 1.0;
+  int digitcount = 1;
+  while (number >= 10.0 * tenpow) {
+    tenpow *= 10.0;
+    digitcount++;
+  }
+  number /= tenpow;
+  fillme -= digitcount;
+
+  while (fillme-- > 0) {
+    *out++ = ' ';
+  }
+  if (negative) {
+    *out++ = '-';
+  }
+
+  digitcount += prec;
+  int8_t digit = 0;
+  while (digitcount-- > 0) {
+    digit = (int8_t)number;
+    if (digit > 9) {
+      digit = 9;
+    }
+    *out++ = (char)('0' | digit);
+    if ((digitcount == (int)prec) && (prec > 0)) {
+      *out++ = '.';
+    }
+    number -= digit;
+    number *= 10.0;
+  }
+  *out = 0;
+  return s;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// 主机单元测试用的最小 Client.h：只提供 MqttAckTap.h 用到的 Client 接口（与 Arduino 核心相同的虚函数），
+// IPAddress 只作为 connect() 的参数类型
+#include <Arduino.h>
+
+class IPAddress {
+ public:
+  IPAddress() : value_(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : value_(((uint32_t)a << 24) | (b << 16) | (c << 8) | d) {}
+
+ private:
+  uint32_t value_;
+};
+
+class Client : public Print {
+ public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char* host, uint16_t port) = 0;
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t* buffer, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
@@ -0,0 +1,156 @@
+#include <unity.h>
+
+#include "Backoff.h"
+
+// 与固件相同的参数（MQTT_BACKOFF_MIN / MQTT_BACKOFF_MAX）
+static const unsigned long BASE_MS = 2000;
+static const unsigned long MAX_MS = 120000;
+
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState;
+}
+
+void setUp() { randomState = 99; }
+void tearDown() {}
+
+// 第n次失败的等待时间在 [cap/2, cap] 内，cap = min(base * 2^n, max)
+void test_delay_bounds() {
+  ExponentialBackoff backoff(BASE_MS, MAX_MS);
+  for (int failure = 0; failure < 40; failure++) {
+    unsigned long cap = BASE_MS;
+    for (int i = 0; i < failure && cap < MAX_MS; i++) {
+      cap *= 2;
+    }
+    if (cap > MAX_MS) {
+      cap = MAX_MS;
+    }
+    unsigned long delay = backoff.next(nextRandom());
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(cap / 2, delay);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(cap, delay);
+    TEST_ASSERT_EQUAL_UINT16(failure + 1, backoff.failures());
+  }
+}
+
+// 随机数取极值时恰好落在区间两端
+void test_random_extremes() {
+  ExponentialBackoff low(BASE_MS, MAX_MS);
+  ExponentialBackoff high(BASE_MS, MAX_MS);
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS / 2, low.next(0));
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS, high.next(BASE_MS / 2));
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS, low.next(0));
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS * 2, high.next(BASE_MS));
+}
+
+// 失败次数计数饱和，不会回绕到最短等待时间
+void test_failure_count_saturates() {
+  ExponentialBackoff backoff(BASE_MS, MAX_MS);
+  for (long i = 0; i < 70000; i++) {
+    backoff.next(0);
+  }
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, backoff.failures());
+  TEST_ASSERT_EQUAL_UINT32(MAX_MS / 2, backoff.next(0));
+  backoff.reset();
+  TEST_ASSERT_EQUAL_UINT32(BASE_MS / 2, backoff.next(0));
+}
+
+// 模拟反复掉线的AP：可用 upMs、不可用 downMs 交替出现，设备按状态机的方式重连
+// （每次连接尝试耗时 attemptMs，失败后按退避等待，成功后重置退避，在线时掉线立即重连）。
+// 返回AP恢复后直到重新连上的最长等待（不超过一次退避上限加两次尝试），并统计连接尝试次数
+struct FlapResult {
+  unsigned long worstRecoveryMs;
+  long attempts;
+  long connects;
+};
+
+static FlapResult simulateFlappingAp(unsigned long upMs, unsigned long downMs, unsigned long attemptMs,
+                                     unsigned long durationMs, uint32_t seed) {
+  randomState = seed;
+  ExponentialBackoff backoff(BASE_MS, MAX_MS);
+  FlapResult result = {0, 0, 0};
+  unsigned long period = upMs + downMs;
+  unsigned long now = 0;
+  unsigned long apUpSince = 0;
+  bool waitingForRecovery = false;
+  while (now < durationMs) {
+    bool apUp = now % period < upMs;
+    unsigned long phaseStart = now - now % period;
+    result.attempts++;
+    now += attemptMs;
+    if (apUp && now % period < upMs && now - now % period == phaseStart) {
+      // 连接成功，在线直到本轮AP掉线
+      result.connects++;
+      if (waitingForRecovery) {
+        unsigned long recovery = now - apUpSince;
+        if (recovery > result.worstRecoveryMs) {
+          result.worstRecoveryMs = recovery;
+        }
+        waitingForRecovery = false;
+      }
+      backoff.reset();
+      now = phaseStart + upMs;
+      apUpSince = phaseStart + period;
+      waitingForRecovery = true;
+      continue;
+    }
+    now += backoff.next(nextRandom());
+  }
+  return result;
+}
+
+// AP每隔一段时间掉线时，恢复后的重连等待受退避上限约束，且成功连接后退避从头开始
+void test_flapping_ap_recovery_is_bounded() {
+  // 掉线时间短于退避上限：恢复后很快重连
+  FlapResult shortOutage = simulateFlappingAp(60000, 20000, 500, 24UL * 3600 * 1000, 1);
+  TEST_ASSERT_GREATER_THAN(0, shortOutage.connects);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_MS + 2 * 500, shortOutage.worstRecoveryMs);
+
+  // 长时间掉线：退避达到上限，恢复后最多再等一个上限周期
+  FlapResult longOutage = simulateFlappingAp(300000, 1800000, 500, 7UL * 24 * 3600 * 1000, 2);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(MAX_MS + 2 * 500, longOutage.worstRecoveryMs);
+
+  // 退避使尝试次数远少于固定间隔重试（每个掉线周期约 log2(max/base) + downMs/max 次）
+  long fixedIntervalAttempts = (7L * 24 * 3600 * 1000) / 2100;
+  TEST_ASSERT_LESS_THAN(fixedIntervalAttempts / 10, longOutage.attempts);
+}
+
+// 多台设备在同一时刻失去连接（如路由器重启），抖动使它们的重试时间分散开
+void test_jitter_spreads_simultaneous_retries() {
+  const int devices = 50;
+  unsigned long retryAt[devices];
+  for (int d = 0; d < devices; d++) {
+    ExponentialBackoff backoff(BASE_MS, MAX_MS);
+    randomState = 1000 + d * 7919;
+    unsigned long now = 0;
+    for (int failure = 0; failure < 6; failure++) {
+      now += backoff.next(nextRandom());
+    }
+    retryAt[d] = now;
+  }
+  // 按1秒分桶统计，任意一秒内的设备数不超过总数的五分之一
+  int worst = 0;
+  for (int d = 0; d < devices; d++) {
+    int same = 0;
+    for (int e = 0; e < devices; e++) {
+      if (retryAt[e] / 1000 == retryAt[d] / 1000) {
+        same++;
+      }
+    }
+    if (same > worst) {
+      worst = same;
+    }
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(devices / 5, worst);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_delay_bounds);
+  RUN_TEST(test_random_extremes);
+  RUN_TEST(test_failure_count_saturates);
+  RUN_TEST(test_flapping_ap_recovery_is_bounded);
+  RUN_TEST(test_jitter_spreads_simultaneous_retries);
+  return UNITY_END();
+}
@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <unity.h>
+
+#include "CommandParser.h"
+
+typedef CommandLine<8, 128> Parser;
+
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+static bool parseText(Parser& parser, const char* text) {
+  return parser.parse((const uint8_t*)text, strlen(text));
+}
+
+static CommandToken token(const char* text) {
+  CommandToken result = {text, strlen(text)};
+  return result;
+}
+
+void setUp() { randomState = 7; }
+void tearDown() {}
+
+void test_positional_and_options() {
+  Parser parser;
+  TEST_ASSERT_TRUE(parseText(parser, "refresh?fmt=msgpack&since=42 sensor=3"));
+  TEST_ASSERT_TRUE(parser.name().equals("refresh"));
+  TEST_ASSERT_EQUAL_INT(3, parser.argCount());
+  CommandToken value;
+  TEST_ASSERT_TRUE(parser.option("fmt", value));
+  TEST_ASSERT_TRUE(value.equals("msgpack"));
+  TEST_ASSERT_TRUE(parser.option("since", value));
+  TEST_ASSERT_TRUE(value.equals("42"));
+  TEST_ASSERT_FALSE(parser.option("sens", value));
+  TEST_ASSERT_FALSE(parser.option("missing", value));
+
+  TEST_ASSERT_TRUE(parseText(parser, "  query\t1  3600 0 300\r\n"));
+  TEST_ASSERT_TRUE(parser.name().equals("query"));
+  TEST_ASSERT_EQUAL_INT(4, parser.argCount());
+  TEST_ASSERT_TRUE(parser.arg(3).equals("300"));
+}
+
+void test_malformed_input_rejected() {
+  Parser parser;
+  TEST_ASSERT_FALSE(parser.parse((const uint8_t*)"", 0));
+  TEST_ASSERT_FALSE(parseText(parser, "   ?&& "));
+  TEST_ASSERT_FALSE(parseText(parser, "\r\n"));
+  TEST_ASSERT_FALSE(parseText(parser, "alarm 30\r 10"));          // 行尾之外的控制字符
+  TEST_ASSERT_FALSE(parseText(parser, "interval\x7f" "5"));
+  TEST_ASSERT_FALSE(parseText(parser, "a b c d e f g h i"));       // 记号过多
+  TEST_ASSERT_EQUAL_INT(0, parser.argCount());
+
+  const uint8_t withNul[] = {'s', 't', 'a', 't', 'u', 's', 0, 'x'};
+  TEST_ASSERT_FALSE(parser.parse(withNul, sizeof(withNul)));
+
+  char tooLong[130];
+  memset(tooLong, 'a', sizeof(tooLong));
+  TEST_ASSERT_FALSE(parser.parse((const uint8_t*)tooLong, sizeof(tooLong)));
+  TEST_ASSERT_TRUE(parser.parse((const uint8_t*)tooLong, 128));
+}
+
+void test_number_parsing() {
+  int64_t i64;
+  uint64_t u64;
+  long value;
+  float f;
+  TEST_ASSERT_TRUE(token("-9223372036854775807").toInt64(i64));
+  TEST_ASSERT_EQUAL_INT64(-9223372036854775807LL, i64);
+  TEST_ASSERT_FALSE(token("9223372036854775808").toInt64(i64));
+  TEST_ASSERT_TRUE(token("18446744073709551615").toUInt64(u64));
+  TEST_ASSERT_TRUE(u64 == UINT64_MAX);
+  TEST_ASSERT_FALSE(token("18446744073709551616").toUInt64(u64));
+  TEST_ASSERT_FALSE(token("-1").toUInt64(u64));
+  TEST_ASSERT_FALSE(token("+").toUInt64(u64));
+  TEST_ASSERT_FALSE(token("-").toInt64(i64));
+  TEST_ASSERT_FALSE(token("12a").toInt64(i64));
+  TEST_ASSERT_FALSE(token("").toInt64(i64));
+
+  TEST_ASSERT_TRUE(token("300").toLong(value, 2, 300));
+  TEST_ASSERT_EQUAL_INT(300, value);
+  TEST_ASSERT_FALSE(token("301").toLong(value, 2, 300));
+  TEST_ASSERT_FALSE(token("1").toLong(value, 2, 300));
+
+  TEST_ASSERT_TRUE(token("-12.5").toFloat(f));
+  TEST_ASSERT_EQUAL_FLOAT(-12.5f, f);
+  TEST_ASSERT_TRUE(token(".5").toFloat(f));
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, f);
+  TEST_ASSERT_FALSE(token(".").toFloat(f));
+  TEST_ASSERT_FALSE(token("1.2.3").toFloat(f));
+  TEST_ASSERT_FALSE(token("1e5").toFloat(f));
+  TEST_ASSERT_FALSE(token("99999999999").toFloat(f));
+}
+
+// 随机输入：解析不越界（输入放在恰好等长的堆内存中，可配合 AddressSanitizer），
+// 成功时记号都在输入范围内、非空且不含分隔符和控制字符
+void test_fuzz_random_input() {
+  static const char alphabet[] = "ab=1-.?& \t\r\n\x01\x7f\x80\xff";
+  Parser parser;
+  for (int round = 0; round < 20000; round++) {
+    size_t length = nextRandom() % 140;
+    uint8_t* input = (uint8_t*)malloc(length > 0 ? length : 1);
+    for (size_t i = 0; i < length; i++) {
+      input[i] = nextRandom() % 4 == 0 ? (uint8_t)nextRandom() : (uint8_t)alphabet[nextRandom() % (sizeof(alphabet) - 1)];
+    }
+    bool ok = parser.parse(input, length);
+    if (ok) {
+      TEST_ASSERT_TRUE(length <= 128);
+      TEST_ASSERT_TRUE(parser.argCount() < 8);
+      for (int t = -1; t < parser.argCount(); t++) {
+        const CommandToken& tok = t < 0 ? parser.name() : parser.arg(t);
+        TEST_ASSERT_TRUE(tok.length > 0);
+        TEST_ASSERT_TRUE((const uint8_t*)tok.text >= input && (const uint8_t*)tok.text + tok.length <= input + length);
+        for (size_t k = 0; k < tok.length; k++) {
+          uint8_t c = (uint8_t)tok.text[k];
+          TEST_ASSERT_TRUE(c >= 0x20 && c != 0x7f && c != ' ' && c != '?' && c != '&');
+        }
+        int64_t i64;
+        float f;
+        CommandToken value;
+        tok.toInt64(i64);
+        tok.toFloat(f);
+        tok.keyValue("a", value);
+      }
+    } else {
+      TEST_ASSERT_EQUAL_INT(0, parser.argCount());
+    }
+    free(input);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_positional_and_options);
+  RUN_TEST(test_malformed_input_rejected);
+  RUN_TEST(test_number_parsing);
+  RUN_TEST(test_fuzz_random_input);
+  return UNITY_END();
+}
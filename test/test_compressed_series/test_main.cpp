@@ -0,0 +1,292 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "CompressedSeries.h"
+
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+void setUp() { randomState = 2024; }
+void tearDown() {}
+
+// 差值编码：各档边界及极值写入后原样读出，位数与 varBits 一致
+void test_var_encoding_boundaries() {
+  using namespace compressed_series;
+  const int32_t deltas[] = {0, 1, -1, 2, -2, 3, 4, -4, 5, 64, -64, 65, 4096, -4097, 70000, -70000,
+                            INT32_MAX, INT32_MIN};
+  const int count = sizeof(deltas) / sizeof(deltas[0]);
+  uint8_t data[128] = {0};
+  BitWriter writer(data, 0);
+  int expectedBits = 0;
+  for (int i = 0; i < count; i++) {
+    writeVar(writer, deltas[i], TIME_WIDTHS);
+    expectedBits += varBits(deltas[i], TIME_WIDTHS);
+    TEST_ASSERT_EQUAL_INT(expectedBits, writer.position());
+  }
+  BitReader reader(data, 0);
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL_INT32(deltas[i], readVar(reader, TIME_WIDTHS));
+  }
+  TEST_ASSERT_EQUAL_INT(expectedBits, reader.position());
+
+  // 值的最后一档（17位）能容纳 int16 的任意差值
+  BitWriter valueWriter(data, 0);
+  writeVar(valueWriter, 32767 - (-32768), VALUE_WIDTHS);
+  writeVar(valueWriter, -32768 - 32767, VALUE_WIDTHS);
+  BitReader valueReader(data, 0);
+  TEST_ASSERT_EQUAL_INT32(65535, readVar(valueReader, VALUE_WIDTHS));
+  TEST_ASSERT_EQUAL_INT32(-65535, readVar(valueReader, VALUE_WIDTHS));
+}
+
+// 带抖动的等间隔读数、温度随机游走、偶尔的大跳变和时间戳回绕，解码结果与写入一致
+void test_round_trip_single_channel() {
+  typedef CompressedSeriesPool<64, 64, 1> Pool;
+  static Pool pool;
+  static uint32_t times[2000];
+  static int16_t values[2000];
+  pool.clear();
+  uint32_t time = 0xFFFFF000u;
+  int16_t value = 400;
+  for (int i = 0; i < 2000; i++) {
+    time += 50 + (nextRandom() % 5 == 0 ? (int)(nextRandom() % 5) - 2 : 0);
+    if (i % 500 == 499) {
+      time += 100000;  // 长时间没有读数
+    }
+    value = (int16_t)(value + (int)(nextRandom() % 7) - 3);
+    if (i % 333 == 0) {
+      value = i % 666 == 0 ? INT16_MIN : 1200;  // 未连接哨兵值与突变
+    }
+    times[i] = time;
+    values[i] = value;
+    pool.append(0, time, value);
+  }
+  TEST_ASSERT_EQUAL_UINT32(2000, pool.points(0));
+  TEST_ASSERT_EQUAL_UINT32(times[0], pool.oldestTime(0));
+  TEST_ASSERT_EQUAL_UINT32(times[1999], pool.newestTime(0));
+
+  Pool::Reader reader(pool, 0);
+  uint32_t decodedTime;
+  int16_t decodedValue;
+  for (int i = 0; i < 2000; i++) {
+    TEST_ASSERT_TRUE(reader.next(decodedTime, decodedValue));
+    TEST_ASSERT_EQUAL_UINT32(times[i], decodedTime);
+    TEST_ASSERT_EQUAL_INT16(values[i], decodedValue);
+  }
+  TEST_ASSERT_FALSE(reader.next(decodedTime, decodedValue));
+}
+
+// 稳定温度、等间隔读数时每点只需几位
+void test_steady_readings_compress_well() {
+  typedef CompressedSeriesPool<240, 16, 1> Pool;
+  static Pool pool;
+  pool.clear();
+  for (int i = 0; i < 1000; i++) {
+    pool.append(0, (uint32_t)i * 50, (int16_t)(400 + (i / 40) % 3));
+  }
+  double bitsPerPoint = (double)pool.encodedBits(0) / pool.points(0);
+  TEST_ASSERT_TRUE(bitsPerPoint < 3.0);
+}
+
+// 池满后回收全局最旧的块：保留的点是各通道写入序列的最新部分，且时间连续
+void test_eviction_keeps_newest_suffix() {
+  typedef CompressedSeriesPool<16, 12, 3> Pool;
+  static Pool pool;
+  pool.clear();
+  const int perChannel = 600;
+  for (int i = 0; i < perChannel; i++) {
+    for (int channel = 0; channel < 3; channel++) {
+      pool.append(channel, (uint32_t)i * 10, (int16_t)(channel * 1000 + i % 50 * (i % 3)));
+    }
+  }
+  int totalBlocks = 0;
+  for (int channel = 0; channel < 3; channel++) {
+    totalBlocks += pool.blocks(channel);
+    uint32_t points = pool.points(channel);
+    TEST_ASSERT_TRUE(points > 0 && points < (uint32_t)perChannel);
+
+    // 按写入顺序保留最后 points 个点
+    Pool::Reader reader(pool, channel);
+    uint32_t time;
+    int16_t value;
+    uint32_t decoded = 0;
+    int i = perChannel - (int)points;
+    while (reader.next(time, value)) {
+      TEST_ASSERT_EQUAL_UINT32((uint32_t)i * 10, time);
+      TEST_ASSERT_EQUAL_INT16((int16_t)(channel * 1000 + i % 50 * (i % 3)), value);
+      decoded++;
+      i++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(points, decoded);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(perChannel - 1) * 10, pool.newestTime(channel));
+  }
+  TEST_ASSERT_EQUAL_INT(Pool::blockCount(), totalBlocks + pool.freeBlocks());
+  TEST_ASSERT_EQUAL_INT(0, pool.freeBlocks());
+}
+
+// 通道写入速率不同时，各通道保留的时长趋于一致
+void test_eviction_balances_retention_by_time() {
+  typedef CompressedSeriesPool<16, 24, 2> Pool;
+  static Pool pool;
+  pool.clear();
+  for (int i = 0; i < 4000; i++) {
+    pool.append(0, (uint32_t)i * 10, (int16_t)(i % 17 * 3));
+    if (i % 4 == 0) {
+      pool.append(1, (uint32_t)i * 10, (int16_t)(i % 13 * 5));
+    }
+  }
+  uint32_t span0 = pool.newestTime(0) - pool.oldestTime(0);
+  uint32_t span1 = pool.newestTime(1) - pool.oldestTime(1);
+  TEST_ASSERT_TRUE(pool.blocks(0) > pool.blocks(1));
+  TEST_ASSERT_TRUE(span0 * 2 > span1 && span1 * 2 > span0);
+}
+
+// 清空一个通道后块归还空闲链表，其他通道不受影响，之后可重新写入
+void test_clear_channel_returns_blocks() {
+  typedef CompressedSeriesPool<16, 8, 2> Pool;
+  static Pool pool;
+  pool.clear();
+  for (int i = 0; i < 40; i++) {
+    pool.append(0, (uint32_t)i, (int16_t)(i * 37));
+    pool.append(1, (uint32_t)i, (int16_t)i);
+  }
+  int blocks1 = pool.blocks(1);
+  uint32_t points1 = pool.points(1);
+  int freeBefore = pool.freeBlocks();
+  int blocks0 = pool.blocks(0);
+  pool.clearChannel(0);
+  TEST_ASSERT_EQUAL_UINT32(0, pool.points(0));
+  TEST_ASSERT_EQUAL_INT(freeBefore + blocks0, pool.freeBlocks());
+  TEST_ASSERT_EQUAL_INT(blocks1, pool.blocks(1));
+  TEST_ASSERT_EQUAL_UINT32(points1, pool.points(1));
+
+  pool.append(0, 1000, -5);
+  Pool::Reader reader(pool, 0);
+  uint32_t time;
+  int16_t value;
+  TEST_ASSERT_TRUE(reader.next(time, value));
+  TEST_ASSERT_EQUAL_UINT32(1000, time);
+  TEST_ASSERT_EQUAL_INT16(-5, value);
+  TEST_ASSERT_FALSE(reader.next(time, value));
+}
+
+// 池中只剩各通道正在写入的末块时，回收本通道的末块重新开始
+void test_tail_only_pool_restarts_channel() {
+  typedef CompressedSeriesPool<4, 2, 2> Pool;
+  static Pool pool;
+  pool.clear();
+  pool.append(0, 0, 0);
+  pool.append(1, 0, 0);
+  for (int i = 1; i < 100; i++) {
+    pool.append(0, (uint32_t)i * 1000, (int16_t)(i * 500));
+  }
+  TEST_ASSERT_EQUAL_INT(1, pool.blocks(0));
+  TEST_ASSERT_EQUAL_INT(1, pool.blocks(1));
+  TEST_ASSERT_EQUAL_UINT32(99000, pool.newestTime(0));
+  Pool::Reader reader(pool, 0);
+  uint32_t time;
+  int16_t value;
+  uint32_t last = 0;
+  while (reader.next(time, value)) {
+    last = time;
+  }
+  TEST_ASSERT_EQUAL_UINT32(99000, last);
+}
+
+// 压缩率与编解码吞吐量：固件参数（240字节块，192块，时间单位100ms），5秒读数间隔，
+// 单通道写入 20000 个点（约28小时）。未压缩的对照为原始层的 6 字节/点（int16 读数 + uint32 时间）
+typedef CompressedSeriesPool<240, 192, 1> FirmwarePool;
+static FirmwarePool benchPool;
+static const int BENCH_POINTS = 20000;
+static uint32_t benchTimes[BENCH_POINTS];
+static int16_t benchValues[BENCH_POINTS];
+
+// 读数间隔 5 秒（50 个时间单位），约五分之一的读数有 ±100ms 的调度抖动；值为 1/16°C
+static void makeTrace(int kind) {
+  uint32_t time = 1000;
+  int32_t value = 21 * 16;
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    time += 50 + (nextRandom() % 5 == 0 ? (int)(nextRandom() % 3) - 1 : 0);
+    if (kind == 0) {
+      // 稳定：室温，量化抖动 ±1
+      value = 21 * 16 + (int)(nextRandom() % 3) - 1;
+    } else if (kind == 1) {
+      // 缓慢漂移：日变化 ±5°C 的正弦近似（三角波），加量化抖动
+      int phase = i % 17280;
+      int tri = phase < 8640 ? phase : 17280 - phase;
+      value = 16 * 16 + tri * 160 / 8640 + (int)(nextRandom() % 3) - 1;
+    } else {
+      // 噪声：每次读数 ±0.5°C 的随机波动
+      value = 21 * 16 + (int)(nextRandom() % 17) - 8;
+    }
+    benchTimes[i] = time;
+    benchValues[i] = (int16_t)value;
+  }
+}
+
+static void benchTrace(const char* name, int kind) {
+  makeTrace(kind);
+  benchPool.clear();
+  clock_t begin = clock();
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    benchPool.append(0, benchTimes[i], benchValues[i]);
+  }
+  double encodeSeconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+  TEST_ASSERT_EQUAL_UINT32(BENCH_POINTS, benchPool.points(0));
+
+  begin = clock();
+  FirmwarePool::Reader reader(benchPool, 0);
+  uint32_t time;
+  int16_t value;
+  int decoded = 0;
+  bool match = true;
+  while (reader.next(time, value)) {
+    match = match && time == benchTimes[decoded] && value == benchValues[decoded];
+    decoded++;
+  }
+  double decodeSeconds = (double)(clock() - begin) / CLOCKS_PER_SEC;
+  TEST_ASSERT_EQUAL_INT(BENCH_POINTS, decoded);
+  TEST_ASSERT_TRUE(match);
+
+  // 压缩后的大小：数据位加上每块的块头（首个点、点数、链表等）
+  double bitsPerPoint = (double)benchPool.encodedBits(0) / BENCH_POINTS;
+  size_t headerBytes = sizeof(FirmwarePool::Block) - 240;
+  double compressedBytes = benchPool.encodedBits(0) / 8.0 + benchPool.blocks(0) * headerBytes;
+  double ratio = BENCH_POINTS * 6.0 / compressedBytes;
+  // 整个池（约48KB）在 16 个通道时每个通道能保留的小时数
+  double pointsPerPool = 192 * 240 * 8 / bitsPerPoint;
+  double hours16 = pointsPerPool / 16 * 5 / 3600;
+
+  char message[220];
+  snprintf(message, sizeof(message),
+           "%-7s %.2f bits/point, ratio x%.1f vs 6 B/point, %2d blocks; encode %.1f M points/s, decode %.1f M points/s; "
+           "16 sensors keep %.0f h",
+           name, bitsPerPoint, ratio, benchPool.blocks(0), BENCH_POINTS / encodeSeconds / 1e6,
+           BENCH_POINTS / decodeSeconds / 1e6, hours16);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_TRUE(ratio > 2.0);
+}
+
+void test_compression_benchmark() {
+  benchTrace("steady", 0);
+  benchTrace("drift", 1);
+  benchTrace("noisy", 2);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_var_encoding_boundaries);
+  RUN_TEST(test_round_trip_single_channel);
+  RUN_TEST(test_steady_readings_compress_well);
+  RUN_TEST(test_eviction_keeps_newest_suffix);
+  RUN_TEST(test_eviction_balances_retention_by_time);
+  RUN_TEST(test_clear_channel_returns_blocks);
+  RUN_TEST(test_tail_only_pool_restarts_channel);
+  RUN_TEST(test_compression_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,581 @@
+#include <unity.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HistoryStore.h"
+
+// 用临时目录中的真实文件模拟 LittleFS（与 fs::FS / fs::File 相同的接口子集）。
+//
+// 断电模拟：powerBudget 为剩余可写入的字节数，用完后本次写入只写入一部分，之后的写入、
+// 改名、删除全部失败，相当于写到一半时掉电；restart() 模拟重新上电。
+//
+// 写放大按 LittleFS 的写时复制估算：块大小 4096 字节，追加写入时末尾未写满的块需要整块
+// 复制到新块，programmed 统计实际编程到闪存的字节数（不含元数据块）。
+class FileFlash;
+
+class FlashFile {
+ public:
+  FlashFile() : flash_(0), fp_(0), dir_(0), append_(false), copiedTail_(false) { name_[0] = 0; }
+
+  operator bool() const { return fp_ != 0 || dir_ != 0; }
+  size_t read(uint8_t* buffer, size_t size) { return fp_ ? fread(buffer, 1, size, fp_) : 0; }
+  size_t write(const uint8_t* buffer, size_t size);
+  bool seek(uint32_t position) { return fp_ && fseek(fp_, position, SEEK_SET) == 0; }
+  size_t size() {
+    if (!fp_) {
+      return 0;
+    }
+    long position = ftell(fp_);
+    fseek(fp_, 0, SEEK_END);
+    long end = ftell(fp_);
+    fseek(fp_, position, SEEK_SET);
+    return end;
+  }
+  void close() {
+    if (fp_) {
+      fclose(fp_);
+    }
+    if (dir_) {
+      closedir(dir_);
+    }
+    fp_ = 0;
+    dir_ = 0;
+  }
+  const char* name() const { return name_; }
+  bool isDirectory() const { return dir_ != 0; }
+  FlashFile openNextFile();
+
+ private:
+  friend class FileFlash;
+  FileFlash* flash_;
+  FILE* fp_;
+  DIR* dir_;
+  bool append_;
+  bool copiedTail_;
+  char name_[64];
+};
+
+class FileFlash {
+ public:
+  static const size_t BLOCK_SIZE = 4096;
+
+  FileFlash() : powerBudget(-1), powerLost(false), written(0), programmed(0) {
+    strcpy(root_, "/tmp/histstoreXXXXXX");
+    if (!mkdtemp(root_)) {
+      root_[0] = 0;
+    }
+  }
+  ~FileFlash() {
+    char command[96];
+    snprintf(command, sizeof(command), "rm -rf %s", root_);
+    if (system(command) != 0) {
+    }
+  }
+
+  FlashFile open(const char* path, const char* mode) {
+    FlashFile file;
+    file.flash_ = this;
+    snprintf(file.name_, sizeof(file.name_), "%s", path);
+    char full[128];
+    hostPath(full, path);
+    struct stat info;
+    if (mode[0] == 'r' && stat(full, &info) == 0 && S_ISDIR(info.st_mode)) {
+      file.dir_ = opendir(full);
+      return file;
+    }
+    if (mode[0] != 'r' && powerLost) {
+      return file;
+    }
+    file.append_ = mode[0] == 'a';
+    file.fp_ = fopen(full, mode[0] == 'r' ? "rb" : (mode[0] == 'a' ? "ab" : "wb"));
+    return file;
+  }
+  bool exists(const char* path) {
+    char full[128];
+    return access(hostPath(full, path), F_OK) == 0;
+  }
+  bool remove(const char* path) {
+    char full[128];
+    return !powerLost && ::remove(hostPath(full, path)) == 0;
+  }
+  bool rename(const char* from, const char* to) {
+    char fullFrom[128];
+    char fullTo[128];
+    return !powerLost && ::rename(hostPath(fullFrom, from), hostPath(fullTo, to)) == 0;
+  }
+  bool mkdir(const char* path) {
+    char full[128];
+    return ::mkdir(hostPath(full, path), 0755) == 0;
+  }
+
+  void restart() {
+    powerBudget = -1;
+    powerLost = false;
+  }
+
+  long fileSize(const char* path) {
+    char full[128];
+    struct stat info;
+    return stat(hostPath(full, path), &info) == 0 ? info.st_size : -1;
+  }
+
+  void truncate(const char* path, long size) {
+    char full[128];
+    if (::truncate(hostPath(full, path), size) != 0) {
+      TEST_FAIL_MESSAGE("truncate failed");
+    }
+  }
+
+  // 写入时按剩余电量截断
+  size_t consume(size_t size) {
+    if (powerLost) {
+      return 0;
+    }
+    if (powerBudget >= 0 && (long)size >= powerBudget) {
+      size = powerBudget;
+      powerLost = true;
+    } else if (powerBudget >= 0) {
+      powerBudget -= size;
+    }
+    return size;
+  }
+
+  long powerBudget;
+  bool powerLost;
+  size_t written;     // 文件内容的字节数
+  size_t programmed;  // 估算的闪存编程字节数
+
+ private:
+  const char* hostPath(char* full, const char* path) {
+    snprintf(full, 128, "%s%s", root_, path);
+    return full;
+  }
+
+  char root_[32];
+};
+
+size_t FlashFile::write(const uint8_t* buffer, size_t size) {
+  if (!fp_) {
+    return 0;
+  }
+  if (append_ && !copiedTail_) {
+    // 追加会话的第一次写入：末尾不满的块整块复制
+    flash_->programmed += this->size() % FileFlash::BLOCK_SIZE;
+    copiedTail_ = true;
+  }
+  size_t allowed = flash_->consume(size);
+  size_t done = fwrite(buffer, 1, allowed, fp_);
+  fflush(fp_);
+  flash_->written += done;
+  flash_->programmed += done;
+  return done;
+}
+
+FlashFile FlashFile::openNextFile() {
+  FlashFile file;
+  if (!dir_) {
+    return file;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir_)) != 0) {
+    if (entry->d_name[0] != '.') {
+      char path[320];
+      snprintf(path, sizeof(path), "%s/%s", name_, entry->d_name);
+      return flash_->open(path, "r");
+    }
+  }
+  return file;
+}
+
+// 与固件相同：16个传感器，每段64KB，最多16段，5帧写入一次
+static const int SENSORS = 16;
+static const int MAX_SEGMENTS = 16;
+static const int FLUSH_FRAMES = 5;
+static const uint32_t SEGMENT_SIZE = 65536;
+static const int FRAMES_PER_DAY = 120;       // 每天120个12分钟间隔
+static const uint32_t FINE_FRAMES = 240;     // MAX_RECORDS
+static const uint32_t SNAPSHOT_ENTRY = 1650;  // 约为固件中 HistSnapshotEntry 的大小（小时层168桶 + 天层31桶）
+
+typedef HistoryStore<FileFlash, FlashFile, SENSORS, MAX_SEGMENTS, FLUSH_FRAMES> Store;
+
+static FileFlash* flash;
+
+static Store* makeStore(uint32_t segmentSize = SEGMENT_SIZE) {
+  Store* store = new Store(*flash, "/hist", "/hist/snapshot.bin", "/hist/snapshot.tmp", segmentSize);
+  store->begin();
+  return store;
+}
+
+// 帧内容由序号和传感器下标决定，重放时逐字段核对
+static void fillFrame(HistFrameEntry* entries, int sensorCount, uint32_t seq) {
+  for (int i = 0; i < sensorCount; i++) {
+    memset(entries[i].address, 0, sizeof(entries[i].address));
+    entries[i].address[0] = 0x28;
+    entries[i].address[1] = (uint8_t)i;
+    entries[i].sampleRaw = (int16_t)(seq * 3 + i);
+    entries[i].minRaw = (int16_t)(seq * 3 + i - 1);
+    entries[i].maxRaw = (int16_t)(seq * 3 + i + 1);
+    entries[i].avgRaw = (int16_t)(seq * 3 + i);
+    entries[i].count = (uint16_t)seq;
+  }
+}
+
+static void appendFrames(Store& store, int frames, int sensorCount = SENSORS) {
+  for (int k = 0; k < frames; k++) {
+    HistFrameEntry* entries = store.addFrame(sensorCount, 1700000000u + store.frameSeq());
+    TEST_ASSERT_NOT_NULL(entries);
+    fillFrame(entries, sensorCount, store.frameSeq());
+    store.commitFrames();
+  }
+}
+
+// 从 startSeq 重放，检查序号连续、内容正确，最后一帧为 expectLast
+static void replayAndCheck(Store& store, uint32_t startSeq, uint32_t expectLast) {
+  Store::Replay replay(store, startSeq);
+  uint32_t expected = startSeq;
+  int frames = 0;
+  while (replay.next()) {
+    TEST_ASSERT_EQUAL_UINT32(expected, replay.seq());
+    TEST_ASSERT_EQUAL_UINT32(replay.seq(), replay.header().seq);
+    HistFrameEntry check[SENSORS];
+    fillFrame(check, replay.sensorCount(), replay.seq());
+    TEST_ASSERT_EQUAL_MEMORY(check, replay.entries(), replay.sensorCount() * sizeof(HistFrameEntry));
+    expected++;
+    frames++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(expectLast + 1, expected);
+  TEST_ASSERT_EQUAL_INT(expectLast - startSeq + 1, frames);
+}
+
+static uint8_t snapshotEntry[SNAPSHOT_ENTRY];
+static int snapshotTag;      // 写入快照条目的内容标记
+static int appliedEntries;
+static int appliedTag;
+
+static void fillSnapshot(int index, uint8_t* entry) { memset(entry, snapshotTag + index, SNAPSHOT_ENTRY); }
+
+static void applySnapshot(const uint8_t* entry) {
+  appliedTag = entry[0] - appliedEntries;
+  for (uint32_t i = 1; i < SNAPSHOT_ENTRY; i++) {
+    TEST_ASSERT_EQUAL_UINT8(entry[0], entry[i]);
+  }
+  appliedEntries++;
+}
+
+static bool loadSnapshot(Store& store) {
+  appliedEntries = 0;
+  appliedTag = -1;
+  return store.loadSnapshot(snapshotEntry, SNAPSHOT_ENTRY, applySnapshot);
+}
+
+void setUp() { flash = new FileFlash(); }
+void tearDown() { delete flash; }
+
+// 写入后重新启动：找到最新帧，从任意序号开始的重放内容与写入一致
+void test_round_trip() {
+  Store* store = makeStore();
+  appendFrames(*store, 100);
+  TEST_ASSERT_EQUAL_INT(0, store->pendingFrames());
+  delete store;
+
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(100, store->recover(SENSORS));
+  replayAndCheck(*store, 1, 100);
+  replayAndCheck(*store, 80, 100);
+  delete store;
+}
+
+// 段满时新建段，超出数量上限删除最旧的段；重放跨段连续
+void test_segment_rollover_and_retention() {
+  const uint32_t frameSize = HIST_FRAME_SIZE(4);
+  uint32_t segmentSize = sizeof(HistSegmentHeader) + 10 * frameSize;  // 每段10帧
+  Store* store = makeStore(segmentSize);
+  appendFrames(*store, 300, 4);
+  delete store;
+
+  store = makeStore(segmentSize);
+  TEST_ASSERT_EQUAL_UINT32(300, store->recover(4));
+  TEST_ASSERT_EQUAL_INT(MAX_SEGMENTS, store->segmentCount());
+  // 最旧的段被删除，从第1帧开始重放也只能读到保留的 16 × 10 帧
+  Store::Replay replay(*store, 1);
+  TEST_ASSERT_TRUE(replay.next());
+  TEST_ASSERT_EQUAL_UINT32(300 - MAX_SEGMENTS * 10 + 1, replay.seq());
+  replayAndCheck(*store, 300 - MAX_SEGMENTS * 10 + 1, 300);
+  delete store;
+}
+
+// 追加写到一半断电：只恢复完整的帧，之后的帧写入新段，不会接在残缺数据后面错位
+void test_torn_append_recovers_complete_frames() {
+  Store* store = makeStore();
+  appendFrames(*store, 10);
+  // 第11~15帧批量写入时只写入了两帧半
+  flash->powerBudget = (long)(2.5 * HIST_FRAME_SIZE(SENSORS));
+  appendFrames(*store, 5);
+  TEST_ASSERT_TRUE(flash->powerLost);
+  delete store;
+
+  flash->restart();
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(12, store->recover(SENSORS));
+  appendFrames(*store, 20);
+  TEST_ASSERT_EQUAL_UINT32(32, store->frameSeq());
+  delete store;
+
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(32, store->recover(SENSORS));
+  TEST_ASSERT_EQUAL_INT(2, store->segmentCount());
+  replayAndCheck(*store, 1, 32);
+  delete store;
+}
+
+// 文件系统层面截断了段末尾（帧中间）：同样只恢复完整帧
+void test_truncated_segment_tail() {
+  Store* store = makeStore();
+  appendFrames(*store, 20);
+  delete store;
+
+  long size = flash->fileSize("/hist/00000001.seg");
+  flash->truncate("/hist/00000001.seg", size - 7);
+
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(19, store->recover(SENSORS));
+  replayAndCheck(*store, 1, 19);
+  delete store;
+}
+
+// 新建段时段头只写入一部分：该段被忽略，最新数据来自上一段，之后用同一文件名重建
+void test_torn_segment_header() {
+  uint32_t segmentSize = sizeof(HistSegmentHeader) + 10 * HIST_FRAME_SIZE(SENSORS);
+  Store* store = makeStore(segmentSize);
+  appendFrames(*store, 10);
+  flash->powerBudget = 5;  // 第二段的段头只写入5字节
+  appendFrames(*store, 5);
+  delete store;
+
+  flash->restart();
+  store = makeStore(segmentSize);
+  TEST_ASSERT_EQUAL_UINT32(10, store->recover(SENSORS));
+  appendFrames(*store, 5);
+  delete store;
+
+  store = makeStore(segmentSize);
+  TEST_ASSERT_EQUAL_UINT32(15, store->recover(SENSORS));
+  replayAndCheck(*store, 1, 15);
+  delete store;
+}
+
+// 未写入的帧（不足 FLUSH_FRAMES）断电后丢失，已写入的最新帧全部恢复
+void test_recovers_newest_flushed_data() {
+  Store* store = makeStore();
+  appendFrames(*store, 23);
+  TEST_ASSERT_EQUAL_INT(3, store->pendingFrames());
+  delete store;  // 未调用 flush() 即断电
+
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(20, store->recover(SENSORS));
+  replayAndCheck(*store, 16, 20);
+  delete store;
+}
+
+// 写快照临时文件时断电：旧快照保持完整；之后残留的临时文件不影响下一次保存
+void test_torn_snapshot_keeps_previous() {
+  Store* store = makeStore();
+  appendFrames(*store, 10);
+  snapshotTag = 10;
+  TEST_ASSERT_TRUE(store->saveSnapshot(4, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+  TEST_ASSERT_EQUAL_UINT32(10, store->snapshotSeq());
+
+  appendFrames(*store, 10);
+  snapshotTag = 50;
+  flash->powerBudget = 3000;  // 临时文件写到第二个条目时断电
+  TEST_ASSERT_FALSE(store->saveSnapshot(4, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+  delete store;
+
+  flash->restart();
+  TEST_ASSERT_TRUE(flash->exists("/hist/snapshot.tmp"));
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(20, store->recover(SENSORS));
+  TEST_ASSERT_TRUE(loadSnapshot(*store));
+  TEST_ASSERT_EQUAL_INT(4, appliedEntries);
+  TEST_ASSERT_EQUAL_INT(10, appliedTag);
+  TEST_ASSERT_EQUAL_UINT32(10, store->snapshotSeq());
+
+  snapshotTag = 90;
+  TEST_ASSERT_TRUE(store->saveSnapshot(4, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+  TEST_ASSERT_TRUE(loadSnapshot(*store));
+  TEST_ASSERT_EQUAL_INT(90, appliedTag);
+  delete store;
+}
+
+// 临时文件写完、改名之前断电：仍使用旧快照
+void test_snapshot_rename_lost() {
+  Store* store = makeStore();
+  appendFrames(*store, 10);
+  snapshotTag = 10;
+  TEST_ASSERT_TRUE(store->saveSnapshot(2, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+
+  appendFrames(*store, 5);
+  snapshotTag = 30;
+  flash->powerBudget = (long)(sizeof(HistSnapshotHeader) + 2 * SNAPSHOT_ENTRY);  // 临时文件写完时电量耗尽
+  TEST_ASSERT_FALSE(store->saveSnapshot(2, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+  TEST_ASSERT_EQUAL_UINT32(10, store->snapshotSeq());
+  delete store;
+
+  flash->restart();
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(15, store->recover(SENSORS));
+  TEST_ASSERT_TRUE(loadSnapshot(*store));
+  TEST_ASSERT_EQUAL_INT(10, appliedTag);
+  delete store;
+}
+
+// 快照比日志新（日志最后几帧丢失）或条目大小变化时作废，不应用任何条目
+void test_snapshot_rejected_when_inconsistent() {
+  Store* store = makeStore();
+  appendFrames(*store, 10);
+  snapshotTag = 1;
+  TEST_ASSERT_TRUE(store->saveSnapshot(3, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot));
+  delete store;
+
+  flash->truncate("/hist/00000001.seg", sizeof(HistSegmentHeader) + 3 * HIST_FRAME_SIZE(SENSORS));
+  store = makeStore();
+  TEST_ASSERT_EQUAL_UINT32(3, store->recover(SENSORS));
+  TEST_ASSERT_FALSE(loadSnapshot(*store));
+  TEST_ASSERT_EQUAL_INT(0, appliedEntries);
+  TEST_ASSERT_EQUAL_UINT32(3, store->snapshotSeq());
+  TEST_ASSERT_FALSE(store->loadSnapshot(snapshotEntry, SNAPSHOT_ENTRY - 2, applySnapshot));
+  delete store;
+}
+
+// 写放大：16个传感器连续写入一周（840帧），每天一次快照，
+// 比较每帧写入一次与 FLUSH_FRAMES 帧写入一次
+struct WriteCost {
+  size_t payload;    // 帧数据
+  size_t snapshots;  // 快照文件
+  size_t written;    // 写入文件的总字节数（含段头）
+  size_t programmed;
+};
+
+template <int Flush>
+static WriteCost measureWriteAmplification() {
+  FileFlash local;
+  HistoryStore<FileFlash, FlashFile, SENSORS, MAX_SEGMENTS, Flush> store(local, "/hist", "/hist/snapshot.bin",
+                                                                         "/hist/snapshot.tmp", SEGMENT_SIZE);
+  store.begin();
+  WriteCost cost = {0, 0, 0, 0};
+  for (int k = 0; k < 7 * FRAMES_PER_DAY; k++) {
+    HistFrameEntry* entries = store.addFrame(SENSORS, 0);
+    fillFrame(entries, SENSORS, store.frameSeq());
+    store.commitFrames();
+    cost.payload += HIST_FRAME_SIZE(SENSORS);
+    if (store.snapshotDue(FRAMES_PER_DAY)) {
+      store.flush();
+      size_t before = local.written;
+      store.saveSnapshot(SENSORS, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot);
+      cost.snapshots += local.written - before;
+    }
+  }
+  store.flush();
+  cost.written = local.written;
+  cost.programmed = local.programmed;
+  return cost;
+}
+
+static void reportWriteCost(const char* label, const WriteCost& cost) {
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%s: frames %u B + snapshots %u B, file writes %u B, programmed %u B (x%.2f of frame+snapshot bytes)",
+           label, (unsigned)cost.payload, (unsigned)cost.snapshots, (unsigned)cost.written,
+           (unsigned)cost.programmed, (double)cost.programmed / (cost.payload + cost.snapshots));
+  TEST_MESSAGE(message);
+}
+
+void test_benchmark_write_amplification() {
+  WriteCost single = measureWriteAmplification<1>();
+  WriteCost batched = measureWriteAmplification<FLUSH_FRAMES>();
+  reportWriteCost("flush every frame", single);
+  reportWriteCost("flush every 5 frames", batched);
+  TEST_ASSERT_EQUAL_UINT32(single.written, batched.written);
+  TEST_ASSERT_LESS_THAN(single.programmed / 2, batched.programmed);
+}
+
+// 恢复耗时：写满16段（约1MB）后重新启动，只读取快照之后及最近 MAX_RECORDS 帧
+void test_benchmark_recovery_1mb() {
+  Store* store = makeStore();
+  // 按 FLUSH_FRAMES 帧整批写入，放不下一批时新建段
+  int framesPerSegment =
+      (SEGMENT_SIZE - sizeof(HistSegmentHeader)) / (FLUSH_FRAMES * HIST_FRAME_SIZE(SENSORS)) * FLUSH_FRAMES;
+  int total = framesPerSegment * MAX_SEGMENTS;
+  for (int k = 0; k < total; k++) {
+    appendFrames(*store, 1);
+    if (store->snapshotDue(FRAMES_PER_DAY)) {
+      snapshotTag = 1;
+      store->saveSnapshot(SENSORS, snapshotEntry, SNAPSHOT_ENTRY, fillSnapshot);
+    }
+  }
+  store->flush();
+  delete store;
+
+  clock_t begin = clock();
+  store = makeStore();
+  uint32_t lastSeq = store->recover(SENSORS);
+  bool haveSnapshot = loadSnapshot(*store);
+  uint32_t fineStart = lastSeq >= FINE_FRAMES ? lastSeq - FINE_FRAMES + 1 : 1;
+  uint32_t startSeq = haveSnapshot && store->snapshotSeq() + 1 < fineStart ? store->snapshotSeq() + 1 : fineStart;
+  Store::Replay replay(*store, startSeq);
+  int replayed = 0;
+  while (replay.next()) {
+    replayed++;
+  }
+  double partialMs = (clock() - begin) * 1000.0 / CLOCKS_PER_SEC;
+  TEST_ASSERT_TRUE(haveSnapshot);
+  TEST_ASSERT_EQUAL_INT(MAX_SEGMENTS, store->segmentCount());
+  TEST_ASSERT_EQUAL_UINT32(lastSeq - startSeq + 1, replayed);
+  size_t partialBytes = replay.bytesRead();
+
+  begin = clock();
+  Store::Replay full(*store, 1);
+  int fullFrames = 0;
+  while (full.next()) {
+    fullFrames++;
+  }
+  double fullMs = (clock() - begin) * 1000.0 / CLOCKS_PER_SEC;
+
+  long storeBytes = 0;
+  char message[200];
+  for (int s = 0; s < MAX_SEGMENTS; s++) {
+    char path[32];
+    snprintf(path, sizeof(path), "/hist/%08lx.seg", (unsigned long)(1 + s * framesPerSegment));
+    storeBytes += flash->fileSize(path);
+  }
+  snprintf(message, sizeof(message),
+           "%ld B in %d segments: recovery replays %d frames, reads %u B (%.1f%%), host %.2f ms; full replay %d "
+           "frames %u B, host %.2f ms",
+           storeBytes, MAX_SEGMENTS, replayed, (unsigned)partialBytes, 100.0 * partialBytes / storeBytes, partialMs,
+           fullFrames, (unsigned)full.bytesRead(), fullMs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_INT(total, fullFrames);
+  TEST_ASSERT_LESS_THAN(storeBytes / 4, (long)partialBytes);
+  delete store;
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_segment_rollover_and_retention);
+  RUN_TEST(test_torn_append_recovers_complete_frames);
+  RUN_TEST(test_truncated_segment_tail);
+  RUN_TEST(test_torn_segment_header);
+  RUN_TEST(test_recovers_newest_flushed_data);
+  RUN_TEST(test_torn_snapshot_keeps_previous);
+  RUN_TEST(test_snapshot_rename_lost);
+  RUN_TEST(test_snapshot_rejected_when_inconsistent);
+  RUN_TEST(test_benchmark_write_amplification);
+  RUN_TEST(test_benchmark_recovery_1mb);
+  return UNITY_END();
+}
@@ -0,0 +1,527 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "MqttAckTap.h"
+#include "MqttOutbox.h"
+
+// 与固件相同的参数
+#define MQTT_OUTBOX_SIZE 16
+#define MQTT_OUTBOX_TOPIC 64
+#define MQTT_OUTBOX_PAYLOAD 192
+#define MQTT_INFLIGHT_WINDOW 4
+#define MQTT_RETRY_MS 5000
+#define MQTT_SEND_BATCH 4
+#define LOOP_TICK_MS 10  // 模拟的loop周期（与 LOOP_IDLE_MAX_MS 相同）
+
+typedef MqttOutbox<MQTT_OUTBOX_SIZE, MQTT_OUTBOX_TOPIC, MQTT_OUTBOX_PAYLOAD> Outbox;
+
+static unsigned long simNow;  // 模拟时间（毫秒）
+
+// 确定性的伪随机数
+static uint32_t randomState;
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+// 回环的MQTT服务器：解析客户端写入的 PUBLISH 报文，对 QoS1 回复 PUBACK。
+// 发往客户端的字节按时间排队，到时才可读；maxChunk > 0 时每次 read() 只返回随机的 1~maxChunk 字节，
+// 报文在任意位置被拆开。noiseEvery > 0 时每收到 noiseEvery 条发布，在 PUBACK 之前插入一条
+// 负载中含有 PUBACK 样式字节的入站 PUBLISH（剩余长度为2字节）和一个 PINGRESP
+class LoopbackBroker : public Client {
+ public:
+  LoopbackBroker() { reset(0, 0); }
+
+  void reset(unsigned long linkDelay, int maxChunk) {
+    linkDelay_ = linkDelay;
+    maxChunk_ = maxChunk;
+    open_ = true;
+    inLength_ = 0;
+    outLength_ = 0;
+    outRead_ = 0;
+    delivered = 0;
+    duplicates = 0;
+    noise = 0;
+    dropAcks = 0;
+    noiseEvery = 0;
+  }
+
+  // 发往客户端的字节，at 之后可读
+  void inject(const uint8_t* data, size_t size, unsigned long at) {
+    if (outRead_ == outLength_) {
+      outRead_ = outLength_ = 0;
+    }
+    TEST_ASSERT_TRUE(outLength_ + size <= sizeof(out_));
+    for (size_t i = 0; i < size; i++) {
+      out_[outLength_] = data[i];
+      outAt_[outLength_++] = at;
+    }
+  }
+
+  int connect(IPAddress, uint16_t) override { return connect("", 0); }
+  int connect(const char*, uint16_t) override {
+    open_ = true;
+    return 1;
+  }
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (!open_ || inLength_ + size > sizeof(in_)) {
+      return 0;
+    }
+    memcpy(in_ + inLength_, buffer, size);
+    inLength_ += size;
+    parsePackets();
+    return size;
+  }
+
+  int available() override {
+    size_t count = 0;
+    while (outRead_ + count < outLength_ && (long)(simNow - outAt_[outRead_ + count]) >= 0) {
+      count++;
+    }
+    return count;
+  }
+
+  int read() override {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+  }
+
+  int read(uint8_t* buffer, size_t size) override {
+    if (maxChunk_ > 0 && size > (size_t)maxChunk_) {
+      size = 1 + nextRandom() % maxChunk_;
+    }
+    size_t count = 0;
+    while (count < size && outRead_ < outLength_ && (long)(simNow - outAt_[outRead_]) >= 0) {
+      buffer[count++] = out_[outRead_++];
+    }
+    return count;
+  }
+
+  int peek() override { return available() > 0 ? out_[outRead_] : -1; }
+  void flush() override {}
+
+  // 断开：丢弃未读的字节和未解析完的报文
+  void stop() override {
+    open_ = false;
+    inLength_ = 0;
+    outRead_ = outLength_ = 0;
+  }
+
+  uint8_t connected() override { return open_; }
+  operator bool() override { return open_; }
+
+  // 收到的发布（含重发）：负载前2字节的序号、报文标识符与 DUP 标志
+  uint16_t deliveredSeq[1024];
+  uint16_t deliveredId[1024];
+  bool deliveredDup[1024];
+  int delivered;
+  int duplicates;
+  int noise;       // 插入的入站 PUBLISH 数
+  int dropAcks;    // 丢弃接下来的 n 个 PUBACK（模拟丢包）
+  int noiseEvery;
+
+ private:
+  // 按剩余长度取出完整的报文（客户端可能分多次写入一个报文）
+  void parsePackets() {
+    for (;;) {
+      uint32_t remaining = 0;
+      size_t header = 1;
+      int shift = 0;
+      while (true) {
+        if (header >= inLength_) {
+          return;
+        }
+        uint8_t digit = in_[header++];
+        remaining |= (uint32_t)(digit & 0x7f) << shift;
+        shift += 7;
+        if (!(digit & 0x80)) {
+          break;
+        }
+      }
+      if (header + remaining > inLength_) {
+        return;
+      }
+      if ((in_[0] >> 4) == 3) {
+        handlePublish(in_[0], in_ + header);
+      }
+      memmove(in_, in_ + header + remaining, inLength_ - header - remaining);
+      inLength_ -= header + remaining;
+    }
+  }
+
+  void handlePublish(uint8_t flags, const uint8_t* body) {
+    uint8_t qos = (flags >> 1) & 0x03;
+    size_t topicLength = (body[0] << 8) | body[1];
+    const uint8_t* rest = body + 2 + topicLength;
+    uint16_t packetId = 0;
+    if (qos > 0) {
+      packetId = (rest[0] << 8) | rest[1];
+      rest += 2;
+    }
+    TEST_ASSERT_TRUE(delivered < 1024);
+    deliveredSeq[delivered] = (rest[0] << 8) | rest[1];
+    deliveredId[delivered] = packetId;
+    deliveredDup[delivered] = (flags & 0x08) != 0;
+    duplicates += deliveredDup[delivered] ? 1 : 0;
+    delivered++;
+
+    // 服务器收到报文需要单程时延，应答再经过单程时延到达
+    unsigned long at = simNow + 2 * linkDelay_;
+    if (noiseEvery > 0 && delivered % noiseEvery == 0) {
+      injectNoise(at);
+    }
+    if (qos > 0) {
+      if (dropAcks > 0) {
+        dropAcks--;
+        return;
+      }
+      const uint8_t ack[] = {0x40, 0x02, (uint8_t)(packetId >> 8), (uint8_t)packetId};
+      inject(ack, sizeof(ack), at);
+    }
+  }
+
+  void injectNoise(unsigned long at) {
+    uint8_t packet[320];
+    size_t length = buildNoise(packet);
+    inject(packet, length, at);
+    const uint8_t pingResp[] = {0xd0, 0x00};
+    inject(pingResp, sizeof(pingResp), at);
+    noise++;
+  }
+
+ public:
+  // 入站 QoS1 PUBLISH：报文标识符为 0x4002，负载 300 字节全部为 40 02 12 34（与 PUBACK 0x1234 相同的字节）
+  static size_t buildNoise(uint8_t* packet) {
+    const char topic[] = "testtopic";
+    size_t remaining = 2 + 9 + 2 + 300;
+    size_t length = 0;
+    packet[length++] = 0x32;
+    packet[length++] = (remaining & 0x7f) | 0x80;
+    packet[length++] = remaining >> 7;
+    packet[length++] = 0;
+    packet[length++] = 9;
+    memcpy(packet + length, topic, 9);
+    length += 9;
+    packet[length++] = 0x40;
+    packet[length++] = 0x02;
+    for (int i = 0; i < 300; i += 4) {
+      const uint8_t pattern[] = {0x40, 0x02, 0x12, 0x34};
+      memcpy(packet + length + i, pattern, 4);
+    }
+    return length + 300;
+  }
+
+ private:
+  unsigned long linkDelay_;
+  int maxChunk_;
+  bool open_;
+  uint8_t in_[4096];
+  size_t inLength_;
+  uint8_t out_[65536];
+  unsigned long outAt_[65536];
+  size_t outLength_;
+  size_t outRead_;
+};
+
+static LoopbackBroker broker;
+static MqttAckTap tap(broker);
+static Outbox outbox;
+
+// 收到的 PUBACK 与对应消息从入队到确认的时间
+static uint16_t ackLog[1024];
+static int ackCount;
+static int unknownAcks;
+static uint16_t packetSeq[65536];  // 报文标识符 -> 消息序号
+static unsigned long pushedAt[1024];
+static unsigned long maxLatency;
+static unsigned long latencySum;
+static int acked;
+
+static void handlePubAck(uint16_t packetId) {
+  if (ackCount < 1024) {
+    ackLog[ackCount++] = packetId;
+  }
+  if (!outbox.acknowledge(packetId)) {
+    unknownAcks++;
+    return;
+  }
+  unsigned long latency = simNow - pushedAt[packetSeq[packetId]];
+  latencySum += latency;
+  if (latency > maxLatency) {
+    maxLatency = latency;
+  }
+  acked++;
+}
+
+// 负载：2字节序号，补足到40字节（与命令应答的长度相近）
+static bool pushMessage(uint16_t seq) {
+  uint8_t payload[40];
+  memset(payload, 'x', sizeof(payload));
+  payload[0] = seq >> 8;
+  payload[1] = seq & 0xff;
+  pushedAt[seq] = simNow;
+  return outbox.push("testtopic/response", payload, sizeof(payload), 1, false);
+}
+
+// 与 serviceMqttOutbox() 相同：组装 PUBLISH 报文，一次写入连接
+static int sendPending(int window, int batch) {
+  int sent = 0;
+  for (; sent < batch; sent++) {
+    bool retransmit;
+    Outbox::Message* message = outbox.nextToSend(simNow, window, MQTT_RETRY_MS, retransmit);
+    if (message == NULL) {
+      break;
+    }
+    size_t topicLength = strlen(message->topic);
+    size_t remaining = 2 + topicLength + (message->qos > 0 ? 2 : 0) + message->length;
+    uint8_t packet[5 + 2 + MQTT_OUTBOX_TOPIC + 2 + MQTT_OUTBOX_PAYLOAD];
+    size_t length = 0;
+    packet[length++] = 0x30 | (retransmit ? 0x08 : 0) | (message->qos << 1) | (message->retain ? 0x01 : 0);
+    do {
+      uint8_t digit = remaining & 0x7f;
+      remaining >>= 7;
+      packet[length++] = remaining > 0 ? (digit | 0x80) : digit;
+    } while (remaining > 0);
+    packet[length++] = topicLength >> 8;
+    packet[length++] = topicLength & 0xff;
+    memcpy(packet + length, message->topic, topicLength);
+    length += topicLength;
+    if (message->qos > 0) {
+      packet[length++] = message->packetId >> 8;
+      packet[length++] = message->packetId & 0xff;
+      packetSeq[message->packetId] = (message->payload[0] << 8) | message->payload[1];
+    }
+    memcpy(packet + length, message->payload, message->length);
+    length += message->length;
+    if (tap.write(packet, length) != length) {
+      break;
+    }
+    outbox.markSent(*message, simNow);
+  }
+  return sent;
+}
+
+// 与 mqttClient.loop() 读取连接的方式相近：逐字节或按缓冲区读取，读到的数据丢弃
+static void pollTap() {
+  uint8_t buffer[64];
+  while (tap.available() > 0) {
+    if (nextRandom() % 4 == 0) {
+      tap.read();
+    } else {
+      tap.read(buffer, 1 + nextRandom() % sizeof(buffer));
+    }
+  }
+}
+
+void setUp() {
+  simNow = 1;
+  randomState = 12345;
+  broker.reset(0, 0);
+  tap.onPubAck(handlePubAck);
+  tap.connect("broker", 1883);
+  outbox.clear();
+  ackCount = 0;
+  unknownAcks = 0;
+  maxLatency = 0;
+  latencySum = 0;
+  acked = 0;
+}
+void tearDown() {}
+
+// 固定的字节流在每个位置拆成两次读取、逐字节读取：只取出真正的 PUBACK，
+// 负载与报文标识符中 PUBACK 样式的字节、PINGRESP、SUBACK 都不触发回调
+void test_puback_split_at_every_boundary() {
+  uint8_t stream[400];
+  size_t length = LoopbackBroker::buildNoise(stream);
+  const uint8_t tail[] = {0x40, 0x02, 0x12, 0x34, 0xd0, 0x00, 0x90, 0x03, 0x00, 0x01, 0x00,
+                          0x40, 0x02, 0x00, 0xff, 0x40, 0x02, 0xff, 0x00};
+  memcpy(stream + length, tail, sizeof(tail));
+  length += sizeof(tail);
+  const uint16_t expected[] = {0x1234, 0x00ff, 0xff00};
+  uint8_t buffer[400];
+
+  for (size_t split = 0; split <= length; split++) {
+    ackCount = 0;
+    broker.inject(stream, length, 0);
+    TEST_ASSERT_EQUAL_INT((int)split, tap.read(buffer, split));
+    TEST_ASSERT_EQUAL_INT((int)(length - split), tap.read(buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_INT(3, ackCount);
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, ackLog, 3);
+  }
+
+  ackCount = 0;
+  unknownAcks = 0;
+  broker.inject(stream, length, 0);
+  for (size_t i = 0; i < length; i++) {
+    TEST_ASSERT_EQUAL_INT(stream[i], tap.read());
+  }
+  TEST_ASSERT_EQUAL_INT(3, ackCount);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, ackLog, 3);
+  TEST_ASSERT_EQUAL_INT(3, unknownAcks);  // 队列中没有这些报文标识符
+}
+
+// 连接在报文中途断开：重新连接后从报文边界开始解析
+void test_reconnect_resyncs_parser() {
+  uint8_t packet[400];
+  size_t length = LoopbackBroker::buildNoise(packet);
+  uint8_t buffer[16];
+  broker.inject(packet, length, 0);
+  TEST_ASSERT_EQUAL_INT(10, tap.read(buffer, 10));
+  tap.stop();
+  tap.connect("broker", 1883);
+
+  const uint8_t ack[] = {0x40, 0x02, 0x00, 0x07};
+  broker.inject(ack, sizeof(ack), 0);
+  TEST_ASSERT_EQUAL_INT(4, tap.read(buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_INT(1, ackCount);
+  TEST_ASSERT_EQUAL_UINT16(7, ackLog[0]);
+}
+
+// 回环服务器：200 条 QoS1 消息，单程时延 20 ms，读取拆成 1~7 字节的随机片段，
+// 中间穿插入站 PUBLISH 与 PINGRESP。全部按顺序送达一次并得到确认，在途数量不超过窗口
+void test_loopback_delivery_in_order() {
+  broker.reset(20, 7);
+  broker.noiseEvery = 3;
+  int pushed = 0;
+  while ((pushed < 200 || outbox.size() > 0) && simNow < 60000) {
+    while (pushed < 200 && pushMessage(pushed)) {
+      pushed++;
+    }
+    pollTap();
+    sendPending(MQTT_INFLIGHT_WINDOW, MQTT_SEND_BATCH);
+    TEST_ASSERT_TRUE(outbox.inFlight() <= MQTT_INFLIGHT_WINDOW);
+    simNow += LOOP_TICK_MS;
+  }
+  TEST_ASSERT_EQUAL_INT(200, acked);
+  TEST_ASSERT_EQUAL_INT(0, unknownAcks);
+  TEST_ASSERT_EQUAL_INT(200, broker.delivered);
+  TEST_ASSERT_EQUAL_INT(0, broker.duplicates);
+  TEST_ASSERT_TRUE(broker.noise >= 60);
+  for (int i = 0; i < 200; i++) {
+    TEST_ASSERT_EQUAL_UINT16(i, broker.deliveredSeq[i]);
+  }
+}
+
+// PUBACK 丢失：超过重发间隔后以相同的报文标识符带 DUP 标志重发，确认后移出队列
+void test_lost_puback_retransmits_with_dup() {
+  broker.reset(20, 7);
+  broker.dropAcks = 2;
+  for (int i = 0; i < 6; i++) {
+    pushMessage(i);
+  }
+  while (outbox.size() > 0 && simNow < 30000) {
+    pollTap();
+    sendPending(MQTT_INFLIGHT_WINDOW, MQTT_SEND_BATCH);
+    simNow += LOOP_TICK_MS;
+  }
+  TEST_ASSERT_EQUAL_INT(6, acked);
+  TEST_ASSERT_EQUAL_INT(8, broker.delivered);
+  TEST_ASSERT_EQUAL_INT(2, broker.duplicates);
+  for (int i = 6; i < 8; i++) {
+    int original = broker.deliveredSeq[i];
+    TEST_ASSERT_TRUE(broker.deliveredDup[i]);
+    TEST_ASSERT_FALSE(broker.deliveredDup[original]);
+    TEST_ASSERT_EQUAL_UINT16(broker.deliveredId[original], broker.deliveredId[i]);
+  }
+  TEST_ASSERT_TRUE(maxLatency >= MQTT_RETRY_MS);
+}
+
+struct LinkStats {
+  int acked;
+  int dropped;               // 队列已满而未能入队
+  unsigned long maxLatency;  // 入队到收到 PUBACK 的最长时间
+  double meanLatency;
+  unsigned long maxStall;    // 单次loop中等待网络的最长时间
+  double hostUs;             // 主机上每次loop（读取+发送）的CPU时间
+};
+
+// 每秒一批 8 条 QoS1 消息（如8个传感器的保留主题），持续 30 秒，单程时延 20 ms。
+// blocking：每条消息写入后在loop中等待 PUBACK 再继续（同步的 QoS1 发布）；
+// 否则：发送队列按窗口发送，loop 只读取已到达的数据，不等待网络
+static LinkStats runBursts(bool blocking, int window) {
+  broker.reset(20, 7);
+  broker.noiseEvery = 5;
+  LinkStats stats = {0, 0, 0, 0, 0, 0};
+  int pushed = 0;
+  long passes = 0;
+  unsigned long nextBurst = 1;
+  clock_t start = clock();
+  while (simNow < 35000 && (simNow < 30000 || outbox.size() > 0)) {
+    if (simNow >= nextBurst && simNow < 30000) {
+      for (int i = 0; i < 8; i++) {
+        if (pushMessage(pushed)) {
+          pushed++;
+        } else {
+          stats.dropped++;
+        }
+      }
+      nextBurst += 1000;
+    }
+    pollTap();
+    unsigned long passStart = simNow;
+    if (blocking) {
+      while (sendPending(1, 1) > 0) {
+        while (outbox.inFlight() > 0) {
+          simNow++;
+          pollTap();
+        }
+      }
+    } else {
+      sendPending(window, MQTT_SEND_BATCH);
+    }
+    if (simNow - passStart > stats.maxStall) {
+      stats.maxStall = simNow - passStart;
+    }
+    passes++;
+    simNow += LOOP_TICK_MS;
+  }
+  stats.hostUs = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / passes;
+  stats.acked = acked;
+  stats.maxLatency = maxLatency;
+  stats.meanLatency = acked > 0 ? (double)latencySum / acked : 0;
+  return stats;
+}
+
+static void reportLink(const char* name, const LinkStats& stats) {
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%-10s acked %3d, dropped %3d, latency mean %6.1f ms max %5lu ms, max loop stall %4lu ms, "
+           "%.2f us host CPU per loop",
+           name, stats.acked, stats.dropped, stats.meanLatency, stats.maxLatency, stats.maxStall, stats.hostUs);
+  TEST_MESSAGE(message);
+}
+
+// 之前/之后：同步等待确认时每批阻塞loop约 8 x 40 ms；发送队列不阻塞loop，窗口内的消息同时在途
+void test_latency_blocking_vs_outbox() {
+  LinkStats blocking = runBursts(true, 1);
+  reportLink("blocking", blocking);
+  setUp();
+  LinkStats window1 = runBursts(false, 1);
+  reportLink("window 1", window1);
+  setUp();
+  LinkStats window4 = runBursts(false, MQTT_INFLIGHT_WINDOW);
+  reportLink("window 4", window4);
+
+  TEST_ASSERT_EQUAL_INT(240, blocking.acked);
+  TEST_ASSERT_EQUAL_INT(240, window4.acked);
+  TEST_ASSERT_EQUAL_INT(0, window4.dropped);
+  TEST_ASSERT_TRUE(blocking.maxStall >= 8 * 40);
+  TEST_ASSERT_EQUAL_UINT32(0, window4.maxStall);
+  TEST_ASSERT_TRUE(window4.maxLatency < blocking.maxLatency);
+  TEST_ASSERT_TRUE(window4.maxLatency < window1.maxLatency);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_puback_split_at_every_boundary);
+  RUN_TEST(test_reconnect_resyncs_parser);
+  RUN_TEST(test_loopback_delivery_in_order);
+  RUN_TEST(test_lost_puback_retransmits_with_dup);
+  RUN_TEST(test_latency_blocking_vs_outbox);
+  return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <unity.h>
+
+#include "MqttOutbox.h"
+
+typedef MqttOutbox<4, 16, 8> Outbox;
+
+static const unsigned long RETRY_MS = 5000;
+
+static bool pushText(Outbox& outbox, const char* topic, const char* payload, uint8_t qos) {
+  return outbox.push(topic, (const uint8_t*)payload, strlen(payload), qos, false);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_push_rejects_oversized_and_full() {
+  static Outbox outbox;
+  outbox.clear();
+  TEST_ASSERT_FALSE(pushText(outbox, "topic/that/is/too/long", "x", 0));
+  TEST_ASSERT_FALSE(pushText(outbox, "t", "123456789", 0));
+  TEST_ASSERT_TRUE(pushText(outbox, "t", "12345678", 0));
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(pushText(outbox, "t", "x", 1));
+  }
+  TEST_ASSERT_TRUE(outbox.full());
+  TEST_ASSERT_FALSE(pushText(outbox, "t", "x", 1));
+}
+
+// 按入队顺序发送，QoS0 消息写入后即移出队列
+void test_fifo_order_and_qos0_release() {
+  static Outbox outbox;
+  outbox.clear();
+  pushText(outbox, "a", "1", 0);
+  pushText(outbox, "b", "2", 0);
+  pushText(outbox, "c", "3", 0);
+  const char* expected[] = {"a", "b", "c"};
+  bool retransmit;
+  for (int i = 0; i < 3; i++) {
+    Outbox::Message* message = outbox.nextToSend(0, 2, RETRY_MS, retransmit);
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_FALSE(retransmit);
+    TEST_ASSERT_EQUAL_STRING(expected[i], message->topic);
+    TEST_ASSERT_EQUAL_UINT16(0, message->packetId);
+    outbox.markSent(*message, 0);
+  }
+  TEST_ASSERT_EQUAL_INT(0, outbox.size());
+  TEST_ASSERT_NULL(outbox.nextToSend(0, 2, RETRY_MS, retransmit));
+}
+
+// 在途的 QoS1 消息不超过窗口，确认后才发送下一条；窗口满时排在后面的 QoS0 消息也按顺序等待
+void test_inflight_window() {
+  static Outbox outbox;
+  outbox.clear();
+  pushText(outbox, "q1", "1", 1);
+  pushText(outbox, "q2", "2", 1);
+  pushText(outbox, "q3", "3", 1);
+  pushText(outbox, "z", "0", 0);
+  bool retransmit;
+  Outbox::Message* first = outbox.nextToSend(0, 2, RETRY_MS, retransmit);
+  outbox.markSent(*first, 0);
+  Outbox::Message* second = outbox.nextToSend(10, 2, RETRY_MS, retransmit);
+  outbox.markSent(*second, 10);
+  TEST_ASSERT_EQUAL_INT(2, outbox.inFlight());
+  TEST_ASSERT_TRUE(first->packetId != 0 && second->packetId != 0 && first->packetId != second->packetId);
+  TEST_ASSERT_NULL(outbox.nextToSend(20, 2, RETRY_MS, retransmit));
+
+  TEST_ASSERT_FALSE(outbox.acknowledge(0xBEEF));
+  TEST_ASSERT_TRUE(outbox.acknowledge(first->packetId));
+  TEST_ASSERT_FALSE(outbox.acknowledge(first->packetId));  // 重复的 PUBACK
+  TEST_ASSERT_EQUAL_INT(1, outbox.inFlight());
+  Outbox::Message* third = outbox.nextToSend(30, 2, RETRY_MS, retransmit);
+  TEST_ASSERT_NOT_NULL(third);
+  TEST_ASSERT_EQUAL_STRING("q3", third->topic);
+  outbox.markSent(*third, 30);
+
+  // QoS0 消息不占用窗口，排到队首后即可发送
+  Outbox::Message* last = outbox.nextToSend(40, 2, RETRY_MS, retransmit);
+  TEST_ASSERT_NOT_NULL(last);
+  TEST_ASSERT_EQUAL_STRING("z", last->topic);
+  outbox.markSent(*last, 40);
+  TEST_ASSERT_EQUAL_INT(2, outbox.inFlight());
+  TEST_ASSERT_NULL(outbox.nextToSend(50, 2, RETRY_MS, retransmit));
+}
+
+// 超时未确认的消息以同一报文标识符重发（调用方据 retransmit 设置 DUP 标志），优先于新消息
+void test_retry_after_timeout_keeps_packet_id() {
+  static Outbox outbox;
+  outbox.clear();
+  pushText(outbox, "q", "1", 1);
+  pushText(outbox, "n", "2", 1);
+  bool retransmit;
+  Outbox::Message* message = outbox.nextToSend(1000, 1, RETRY_MS, retransmit);
+  uint16_t packetId = message->packetId;
+  outbox.markSent(*message, 1000);
+  TEST_ASSERT_EQUAL_UINT8(1, message->attempts);
+
+  TEST_ASSERT_NULL(outbox.nextToSend(1000 + RETRY_MS - 1, 1, RETRY_MS, retransmit));
+  for (int attempt = 2; attempt <= 4; attempt++) {
+    unsigned long now = 1000 + (attempt - 1) * RETRY_MS;
+    Outbox::Message* retry = outbox.nextToSend(now, 1, RETRY_MS, retransmit);
+    TEST_ASSERT_TRUE(retry == message);
+    TEST_ASSERT_TRUE(retransmit);
+    TEST_ASSERT_EQUAL_UINT16(packetId, retry->packetId);
+    outbox.markSent(*retry, now);
+    TEST_ASSERT_EQUAL_UINT8(attempt, retry->attempts);
+    TEST_ASSERT_EQUAL_INT(1, outbox.inFlight());
+  }
+
+  // 超过最大次数由调用方丢弃，窗口随之释放
+  outbox.drop(*message);
+  TEST_ASSERT_EQUAL_INT(0, outbox.inFlight());
+  Outbox::Message* next = outbox.nextToSend(50000, 1, RETRY_MS, retransmit);
+  TEST_ASSERT_EQUAL_STRING("n", next->topic);
+  TEST_ASSERT_FALSE(retransmit);
+}
+
+// millis() 回绕时重发间隔仍按差值计算
+void test_retry_across_millis_wrap() {
+  static Outbox outbox;
+  outbox.clear();
+  pushText(outbox, "q", "1", 1);
+  bool retransmit;
+  unsigned long sentAt = (unsigned long)-1 - 1000;
+  Outbox::Message* message = outbox.nextToSend(sentAt, 1, RETRY_MS, retransmit);
+  outbox.markSent(*message, sentAt);
+  TEST_ASSERT_NULL(outbox.nextToSend(sentAt + RETRY_MS - 1, 1, RETRY_MS, retransmit));
+  TEST_ASSERT_TRUE(outbox.nextToSend(sentAt + RETRY_MS, 1, RETRY_MS, retransmit) == message);
+  TEST_ASSERT_TRUE(retransmit);
+}
+
+// 断线后在途消息回到队列，按原顺序作为新消息发送（新的报文标识符，不带 DUP）
+void test_requeue_after_disconnect() {
+  static Outbox outbox;
+  outbox.clear();
+  pushText(outbox, "a", "1", 1);
+  pushText(outbox, "b", "2", 1);
+  bool retransmit;
+  for (int i = 0; i < 2; i++) {
+    outbox.markSent(*outbox.nextToSend(0, 4, RETRY_MS, retransmit), 0);
+  }
+  outbox.requeueInFlight();
+  TEST_ASSERT_EQUAL_INT(0, outbox.inFlight());
+  TEST_ASSERT_EQUAL_INT(2, outbox.size());
+  Outbox::Message* message = outbox.nextToSend(RETRY_MS * 3, 4, RETRY_MS, retransmit);
+  TEST_ASSERT_FALSE(retransmit);
+  TEST_ASSERT_EQUAL_STRING("a", message->topic);
+  TEST_ASSERT_TRUE(message->packetId != 0);
+}
+
+// 报文标识符在 65535 后回到 1，跳过 0 和仍在使用中的标识符
+void test_packet_id_wraps_and_skips_in_use() {
+  static Outbox outbox;
+  outbox.clear();
+  bool retransmit;
+  pushText(outbox, "held", "x", 1);
+  Outbox::Message* held = outbox.nextToSend(0, 4, RETRY_MS, retransmit);
+  outbox.markSent(*held, 0);
+  TEST_ASSERT_EQUAL_UINT16(1, held->packetId);
+  for (long i = 0; i < 70000; i++) {
+    pushText(outbox, "t", "x", 1);
+    Outbox::Message* message = outbox.nextToSend(0, 4, RETRY_MS, retransmit);
+    TEST_ASSERT_TRUE(message->packetId != 0 && message->packetId != held->packetId);
+    outbox.markSent(*message, 0);
+    TEST_ASSERT_TRUE(outbox.acknowledge(message->packetId));
+  }
+  TEST_ASSERT_EQUAL_INT(1, outbox.size());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_rejects_oversized_and_full);
+  RUN_TEST(test_fifo_order_and_qos0_release);
+  RUN_TEST(test_inflight_window);
+  RUN_TEST(test_retry_after_timeout_keeps_packet_id);
+  RUN_TEST(test_retry_across_millis_wrap);
+  RUN_TEST(test_requeue_after_disconnect);
+  RUN_TEST(test_packet_id_wraps_and_skips_in_use);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <unity.h>
+
+#include "MsgPackWriter.h"
+#include "StreamPrint.h"
+
+static uint8_t buffer[512];
+static FixedBufferPrint out(buffer, sizeof(buffer));
+static MsgPackWriter writer(out);
+
+// 清空输出，从缓冲区开头重新写入
+static void restart() { out = FixedBufferPrint(buffer, sizeof(buffer)); }
+
+void setUp() { restart(); }
+void tearDown() {}
+
+static void assertBytes(const uint8_t* expected, size_t length) {
+  TEST_ASSERT_EQUAL_size_t(length, out.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, length);
+}
+
+#define ASSERT_BYTES(...)                                    \
+  do {                                                       \
+    const uint8_t expected[] = {__VA_ARGS__};                \
+    assertBytes(expected, sizeof(expected));                 \
+  } while (0)
+
+// 整数在各编码形式的边界处选用最短编码
+void test_int_boundaries() {
+  writer.writeInt(0);
+  writer.writeInt(127);
+  ASSERT_BYTES(0x00, 0x7f);
+  restart();
+  writer.writeInt(128);
+  writer.writeInt(255);
+  ASSERT_BYTES(0xcc, 0x80, 0xcc, 0xff);
+  restart();
+  writer.writeInt(256);
+  writer.writeInt(65535);
+  ASSERT_BYTES(0xcd, 0x01, 0x00, 0xcd, 0xff, 0xff);
+  restart();
+  writer.writeInt(65536);
+  writer.writeInt(INT32_MAX);
+  ASSERT_BYTES(0xce, 0x00, 0x01, 0x00, 0x00, 0xce, 0x7f, 0xff, 0xff, 0xff);
+  restart();
+  writer.writeInt(-1);
+  writer.writeInt(-32);
+  ASSERT_BYTES(0xff, 0xe0);
+  restart();
+  writer.writeInt(-33);
+  writer.writeInt(-128);
+  ASSERT_BYTES(0xd0, 0xdf, 0xd0, 0x80);
+  restart();
+  writer.writeInt(-129);
+  writer.writeInt(-32768);
+  ASSERT_BYTES(0xd1, 0xff, 0x7f, 0xd1, 0x80, 0x00);
+  restart();
+  writer.writeInt(-32769);
+  writer.writeInt(INT32_MIN);
+  ASSERT_BYTES(0xd2, 0xff, 0xff, 0x7f, 0xff, 0xd2, 0x80, 0x00, 0x00, 0x00);
+}
+
+// 负载中的温度（0.1°C）：28.5°C、-12.7°C、125.0°C
+void test_temperature_values() {
+  writer.writeInt(285);
+  writer.writeInt(-127);
+  writer.writeInt(1250);
+  ASSERT_BYTES(0xcd, 0x01, 0x1d, 0xd0, 0x81, 0xcd, 0x04, 0xe2);
+}
+
+void test_uint_boundaries() {
+  writer.writeUInt(200);
+  writer.writeUInt(0x7fffffffULL);
+  ASSERT_BYTES(0xcc, 0xc8, 0xce, 0x7f, 0xff, 0xff, 0xff);
+  restart();
+  writer.writeUInt(0x80000000ULL);
+  writer.writeUInt(0xffffffffULL);
+  ASSERT_BYTES(0xce, 0x80, 0x00, 0x00, 0x00, 0xce, 0xff, 0xff, 0xff, 0xff);
+  restart();
+  writer.writeUInt(0x100000000ULL);
+  ASSERT_BYTES(0xcf, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00);
+}
+
+// 字符串长度 31/32/255/256 处切换 fixstr、str8、str16
+void test_string_length_boundaries() {
+  static char text[300];
+  memset(text, 's', sizeof(text));
+  const size_t lengths[] = {0, 31, 32, 255, 256};
+  const uint8_t headers[][3] = {{0xa0}, {0xbf}, {0xd9, 32}, {0xd9, 255}, {0xda, 0x01, 0x00}};
+  const size_t headerSizes[] = {1, 1, 2, 2, 3};
+  for (int i = 0; i < 5; i++) {
+    restart();
+    writer.writeString(text, lengths[i]);
+    TEST_ASSERT_EQUAL_size_t(headerSizes[i] + lengths[i], out.length());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(headers[i], buffer, headerSizes[i]);
+    TEST_ASSERT_EQUAL_MEMORY(text, buffer + headerSizes[i], lengths[i]);
+  }
+  restart();
+  writer.writeString("c_t");
+  ASSERT_BYTES(0xa3, 'c', '_', 't');
+}
+
+// 只保存开头若干字节、统计总长度的目标流
+class HeadPrint : public Print {
+ public:
+  HeadPrint() : length(0) {}
+  size_t write(uint8_t value) override {
+    if (length < sizeof(head)) {
+      head[length] = value;
+    }
+    length++;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    for (size_t i = 0; i < size; i++) {
+      write(data[i]);
+    }
+    return size;
+  }
+  uint8_t head[8];
+  size_t length;
+};
+
+// 长度 65535/65536 处切换 str16 与 str32（此前 65536 以上的长度被截断为16位）
+void test_string_length_str32() {
+  static char text[70000];
+  memset(text, 's', sizeof(text));
+  const size_t lengths[] = {65535, 65536, 70000};
+  const uint8_t headers[][5] = {{0xda, 0xff, 0xff}, {0xdb, 0x00, 0x01, 0x00, 0x00}, {0xdb, 0x00, 0x01, 0x11, 0x70}};
+  const size_t headerSizes[] = {3, 5, 5};
+  for (int i = 0; i < 3; i++) {
+    HeadPrint head;
+    MsgPackWriter large(head);
+    large.writeString(text, lengths[i]);
+    TEST_ASSERT_EQUAL_size_t(headerSizes[i] + lengths[i], head.length);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(headers[i], head.head, headerSizes[i]);
+  }
+}
+
+// map/array 元素个数 15/16 处切换 fix 与 16 位编码
+void test_container_size_boundaries() {
+  writer.writeMap(0);
+  writer.writeMap(15);
+  writer.writeMap(16);
+  writer.writeMap(65535);
+  ASSERT_BYTES(0x80, 0x8f, 0xde, 0x00, 0x10, 0xde, 0xff, 0xff);
+  restart();
+  writer.writeArray(0);
+  writer.writeArray(15);
+  writer.writeArray(16);
+  writer.writeArray(240);
+  ASSERT_BYTES(0x90, 0x9f, 0xdc, 0x00, 0x10, 0xdc, 0x00, 0xf0);
+}
+
+void test_bool_and_nil() {
+  writer.writeBool(true);
+  writer.writeBool(false);
+  writer.writeNil();
+  ASSERT_BYTES(0xc3, 0xc2, 0xc0);
+}
+
+// 与负载结构相同的小文档：{"id":3,"c_t":[285,nil]}
+void test_nested_document() {
+  writer.writeMap(2);
+  writer.writeString("id");
+  writer.writeInt(3);
+  writer.writeString("c_t");
+  writer.writeArray(2);
+  writer.writeInt(285);
+  writer.writeNil();
+  ASSERT_BYTES(0x82, 0xa2, 'i', 'd', 0x03, 0xa3, 'c', '_', 't', 0x92, 0xcd, 0x01, 0x1d, 0xc0);
+}
+
+// CountingPrint 统计的长度与实际写入的字节数一致，可用于预先计算负载长度
+void test_counting_matches_output() {
+  CountingPrint counter;
+  MsgPackWriter counted(counter);
+  const int32_t values[] = {0, 127, 128, 255, 256, 65535, 65536, -32, -33, -129, -32769};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    counted.writeInt(values[i]);
+    writer.writeInt(values[i]);
+  }
+  counted.writeString("temperature");
+  writer.writeString("temperature");
+  TEST_ASSERT_EQUAL_size_t(out.length(), counter.length());
+  TEST_ASSERT_FALSE(out.overflowed());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_int_boundaries);
+  RUN_TEST(test_temperature_values);
+  RUN_TEST(test_uint_boundaries);
+  RUN_TEST(test_string_length_boundaries);
+  RUN_TEST(test_string_length_str32);
+  RUN_TEST(test_container_size_boundaries);
+  RUN_TEST(test_bool_and_nil);
+  RUN_TEST(test_nested_document);
+  RUN_TEST(test_counting_matches_output);
+  return UNITY_END();
+}
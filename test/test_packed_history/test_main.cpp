@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <unity.h>
+
+#include "TempRecord.h"
+
+// 与固件相同的参数：240个样本，12分钟间隔
+typedef TempRecordT<240, 720000> FirmwareRecord;
+
+void setUp() {}
+void tearDown() {}
+
+// DS18B20的全部量程（-55~125°C）按1/16°C量化，转换后原样还原
+void test_fixed_point_round_trip() {
+  for (int raw = -55 * TEMP_RAW_SCALE; raw <= 125 * TEMP_RAW_SCALE; raw++) {
+    float temp = (float)raw / TEMP_RAW_SCALE;
+    TEST_ASSERT_EQUAL_INT16(raw, tempToRaw(temp));
+    TEST_ASSERT_EQUAL_FLOAT(temp, rawToTemp(tempToRaw(temp)));
+  }
+}
+
+// 未连接读数使用哨兵值，不会与任何有效温度混淆
+void test_disconnected_sentinel() {
+  TEST_ASSERT_EQUAL_INT16(TEMP_RAW_INVALID, tempToRaw(DEVICE_DISCONNECTED_C));
+  TEST_ASSERT_EQUAL_FLOAT(DEVICE_DISCONNECTED_C, rawToTemp(TEMP_RAW_INVALID));
+  TEST_ASSERT_TRUE(tempToRaw(-55.0f) != TEMP_RAW_INVALID);
+}
+
+// 写满并回绕后，每个样本的温度、推算的时间戳和序号与写入时一致
+void test_record_round_trip_after_wrap() {
+  static FirmwareRecord record;
+  record.reset();
+  const int total = 240 * 2 + 37;
+  const unsigned long start = 4294000000UL;  // 中途发生 millis() 回绕
+  for (int i = 0; i < total; i++) {
+    float temp = i % 13 == 0 ? DEVICE_DISCONNECTED_C : (float)((i * 7) % 800 - 200) / TEMP_RAW_SCALE;
+    record.push(temp, start + (unsigned long)i * 720000UL, (uint32_t)i + 1);
+  }
+  TEST_ASSERT_EQUAL_INT(240, record.count());
+  for (int index = 0; index < record.count(); index++) {
+    int i = total - record.count() + index;
+    float expected = i % 13 == 0 ? DEVICE_DISCONNECTED_C : (float)((i * 7) % 800 - 200) / TEMP_RAW_SCALE;
+    TEST_ASSERT_EQUAL_FLOAT(expected, record.tempAt(index));
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(start + (unsigned long)i * 720000UL), (uint32_t)record.timestampAt(index));
+  }
+  TEST_ASSERT_EQUAL_UINT32(total, record.lastSeq);
+  TEST_ASSERT_EQUAL_INT(record.count() - 10, record.indexAfterSeq(total - 10));
+  TEST_ASSERT_EQUAL_INT(0, record.indexAfterSeq(1));
+  TEST_ASSERT_EQUAL_INT(record.count(), record.indexAfterSeq(total));
+}
+
+// 每样本占用：历史数据2字节 + 统计队列2字节，固定字段分摊后不到4.5字节
+// （固件上约4.2字节，主机上 unsigned long 为8字节，固定字段略大）
+void test_bytes_per_sample() {
+  double perSample = (double)sizeof(FirmwareRecord) / 240;
+  char message[96];
+  snprintf(message, sizeof(message), "TempRecord<240>: %u bytes, %.2f bytes/sample (float+timestamp format: 8)",
+           (unsigned)sizeof(FirmwareRecord), perSample);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_INT(1, sizeof(FirmwareRecord::RecordIndex));
+  TEST_ASSERT_TRUE(perSample < 4.5);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fixed_point_round_trip);
+  RUN_TEST(test_disconnected_sentinel);
+  RUN_TEST(test_record_round_trip_after_wrap);
+  RUN_TEST(test_bytes_per_sample);
+  return UNITY_END();
+}
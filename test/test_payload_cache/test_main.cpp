@@ -0,0 +1,263 @@
+#include <unity.h>
+
+#include <new>
+#include <stdlib.h>
+#include <time.h>
+
+#include "PayloadCache.h"
+#include "StreamPrint.h"
+#include "TemperatureJson.h"
+
+// 统计堆分配：测试期间所有 operator new 的次数
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* p = malloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// 与固件的 PayloadKey 相同的结构
+struct Key {
+  uint32_t version;
+  int format;
+  bool delta;
+  uint32_t since;
+  int sensor;
+
+  bool operator==(const Key& other) const {
+    return version == other.version && format == other.format && delta == other.delta && since == other.since &&
+           sensor == other.sensor;
+  }
+};
+
+// 模拟的 MQTT 连接：只统计写入的字节
+class NullSocket : public Print {
+ public:
+  NullSocket() : bytes(0) {}
+  size_t write(uint8_t) override {
+    bytes++;
+    return 1;
+  }
+  size_t write(const uint8_t*, size_t size) override {
+    bytes += size;
+    return size;
+  }
+  size_t bytes;
+};
+
+// 保存写入内容的目标流
+class CapturePrint : public Print {
+ public:
+  CapturePrint() : length(0) {}
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    memcpy(data + length, buffer, size);
+    length += size;
+    return size;
+  }
+  uint8_t data[8192];
+  size_t length;
+};
+
+// 4个传感器、每个240个样本的完整历史（refresh 的典型负载，约5KB）
+static const int SENSORS = 4;
+typedef TempRecordT<240, 720000> Record;
+static Record records[SENSORS];
+static float currentTemps[SENSORS];
+static uint32_t sampleSeq;
+
+static void fillRecords() {
+  for (int i = 0; i < SENSORS; i++) {
+    records[i].reset();
+    for (int k = 0; k < 240; k++) {
+      records[i].push(20.0f + ((k * 7 + i * 13) % 120) / 16.0f, k * 720000UL, k + 1);
+    }
+    currentTemps[i] = 21.5f + i;
+  }
+  sampleSeq = 240;
+}
+
+// 与 formatRealTime 相同的定长格式
+static void formatTime(char* text, time_t now) {
+  struct tm parts;
+  gmtime_r(&now, &parts);
+  strftime(text, 20, "%Y-%m-%d %H:%M:%S", &parts);
+}
+
+static void writePayload(Print& out, time_t now) {
+  char systemTime[20];
+  formatTime(systemTime, now);
+  writeJsonHeader(out, systemTime, true, ((uint64_t)1 << 32) | sampleSeq, false, 0);
+  for (int i = 0; i < SENSORS; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "T%d-28FF%04X", i + 1, 0x1234 + i);
+    char lastTime[20];
+    formatTime(lastTime, now - 5);
+    writeJsonSensor(out, key, currentTemps[i], lastTime, records[i], 0, records[i].count());
+  }
+  out.print('}');
+}
+
+void setUp() { fillRecords(); }
+void tearDown() {}
+
+// 命中时沿用上次的生成时间重新输出，内容与长度和第一次逐字节相同
+void test_hit_reproduces_identical_payload() {
+  PayloadCache<Key> cache;
+  Key key = {7, 0, false, 0, -1};
+  time_t now;
+  size_t length;
+  TEST_ASSERT_FALSE(cache.lookup(key, now, length));
+
+  static CapturePrint first;
+  static CapturePrint second;
+  first.length = 0;
+  second.length = 0;
+  time_t generated = 1792224000;
+  writePayload(first, generated);
+  cache.store(key, generated, first.length);
+
+  TEST_ASSERT_TRUE(cache.lookup(key, now, length));
+  TEST_ASSERT_EQUAL_INT64(generated, now);
+  writePayload(second, now);
+  TEST_ASSERT_EQUAL_size_t(first.length, length);
+  TEST_ASSERT_EQUAL_size_t(first.length, second.length);
+  TEST_ASSERT_EQUAL_MEMORY(first.data, second.data, first.length);
+}
+
+// 数据版本或任一请求参数变化时不命中；作废后不命中
+void test_key_change_misses() {
+  PayloadCache<Key> cache;
+  Key key = {7, 0, true, 100, -1};
+  cache.store(key, 1000, 512);
+  time_t now;
+  size_t length;
+
+  Key other = key;
+  other.version = 8;
+  TEST_ASSERT_FALSE(cache.lookup(other, now, length));
+  other = key;
+  other.format = 1;
+  TEST_ASSERT_FALSE(cache.lookup(other, now, length));
+  other = key;
+  other.since = 101;
+  TEST_ASSERT_FALSE(cache.lookup(other, now, length));
+  other = key;
+  other.sensor = 2;
+  TEST_ASSERT_FALSE(cache.lookup(other, now, length));
+
+  TEST_ASSERT_TRUE(cache.lookup(key, now, length));
+  TEST_ASSERT_EQUAL_size_t(512, length);
+  cache.invalidate();
+  TEST_ASSERT_FALSE(cache.lookup(key, now, length));
+}
+
+// 三种发布方式，每次 refresh 都发布一次（不计请求合并，最坏情况）：
+//   不缓存：计算长度一遍 + 流式输出一遍（引入缓存之前）
+//   8KB 负载缓存：未命中时计算长度并序列化到缓存，命中时分块发送缓存内容（上一版）
+//   PayloadCache：未命中时两遍，命中时沿用时间与长度只输出一遍（本版）
+enum Strategy { NO_CACHE, BYTE_CACHE, LENGTH_CACHE };
+
+static uint8_t byteCache[8192];
+static size_t byteCacheLength;
+static bool byteCacheValid;
+static Key byteCacheKey;
+
+static void publish(Strategy strategy, PayloadCache<Key>& cache, const Key& key, time_t now, NullSocket& socket,
+                    uint32_t& hash) {
+  if (strategy == BYTE_CACHE) {
+    if (!byteCacheValid || !(key == byteCacheKey)) {
+      CountingPrint counter;
+      writePayload(counter, now);
+      FixedBufferPrint buffer(byteCache, sizeof(byteCache));
+      writePayload(buffer, now);
+      byteCacheLength = buffer.length();
+      byteCacheKey = key;
+      byteCacheValid = true;
+    }
+    for (size_t written = 0; written < byteCacheLength; written += 256) {
+      size_t chunk = byteCacheLength - written < 256 ? byteCacheLength - written : 256;
+      socket.write(byteCache + written, chunk);
+    }
+    hash = HashingPrint::update(HashingPrint::SEED, byteCache, byteCacheLength);
+    return;
+  }
+
+  size_t length;
+  if (strategy == NO_CACHE || !cache.lookup(key, now, length)) {
+    CountingPrint counter;
+    writePayload(counter, now);
+    length = counter.length();
+    if (strategy == LENGTH_CACHE) {
+      cache.store(key, now, length);
+    }
+  }
+  HashingPrint hashing(socket);
+  BufferedPrint<256> stream(hashing);
+  writePayload(stream, now);
+  stream.flush();
+  TEST_ASSERT_EQUAL_size_t(length, stream.written());
+  hash = hashing.hash();
+}
+
+// 每秒100次 refresh，持续60秒；每5秒一次新读数使数据版本加一
+static double runLoad(Strategy strategy, size_t& allocations, size_t& bytes) {
+  PayloadCache<Key> cache;
+  NullSocket socket;
+  byteCacheValid = false;
+  Key key = {1, 0, false, 0, -1};
+  time_t start = 1792224000;
+  size_t allocationsBefore = heapAllocations;
+  clock_t begin = clock();
+  for (int second = 0; second < 60; second++) {
+    if (second % 5 == 0) {
+      key.version++;
+      currentTemps[0] += 0.125f;
+    }
+    for (int k = 0; k < 100; k++) {
+      uint32_t hash;
+      publish(strategy, cache, key, start + second, socket, hash);
+    }
+  }
+  double cpuMs = (clock() - begin) * 1000.0 / CLOCKS_PER_SEC;
+  allocations = heapAllocations - allocationsBefore;
+  bytes = socket.bytes;
+  return cpuMs;
+}
+
+void test_load_100_refresh_per_second() {
+  const char* names[] = {"no cache", "8 KB payload cache", "PayloadCache"};
+  const size_t staticBytes[] = {0, sizeof(byteCache) + sizeof(byteCacheLength) + sizeof(byteCacheKey) + 1,
+                                sizeof(PayloadCache<Key>)};
+  double cpu[3];
+  char message[200];
+  for (int s = 0; s < 3; s++) {
+    fillRecords();
+    size_t allocations;
+    size_t bytes;
+    cpu[s] = runLoad((Strategy)s, allocations, bytes);
+    TEST_ASSERT_EQUAL_size_t(0, allocations);
+    snprintf(message, sizeof(message),
+             "%-18s: 6000 refreshes in 60 s, %u B sent, CPU %.1f ms (%.1f us/refresh), heap allocations %u, "
+             "static RAM %u B",
+             names[s], (unsigned)bytes, cpu[s], cpu[s] * 1000.0 / 6000, (unsigned)allocations,
+             (unsigned)staticBytes[s]);
+    TEST_MESSAGE(message);
+  }
+  // 命中时省去计算长度的一遍
+  TEST_ASSERT_TRUE(cpu[LENGTH_CACHE] < cpu[NO_CACHE]);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hit_reproduces_identical_payload);
+  RUN_TEST(test_key_change_misses);
+  RUN_TEST(test_load_100_refresh_per_second);
+  return UNITY_END();
+}
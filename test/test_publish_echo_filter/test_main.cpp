@@ -0,0 +1,117 @@
+#include <unity.h>
+
+#include "MsgPackWriter.h"
+#include "PublishEchoFilter.h"
+
+static const unsigned long TIMEOUT_MS = 30000;
+
+// 把写入内容保存下来的目标流，模拟服务器回送的消息
+class CapturePrint : public Print {
+ public:
+  CapturePrint() : length(0) {}
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    memcpy(data + length, buffer, size);
+    length += size;
+    return size;
+  }
+  uint8_t data[256];
+  size_t length;
+};
+
+static PublishEchoFilter<4> filter;
+
+void setUp() { filter.clear(); }
+void tearDown() {}
+
+static void publish(const char* text, unsigned long now) {
+  filter.record(strlen(text), HashingPrint::update(HashingPrint::SEED, (const uint8_t*)text, strlen(text)), now);
+}
+
+static bool receive(const char* text, unsigned long now) {
+  return filter.consume((const uint8_t*)text, strlen(text), now, TIMEOUT_MS);
+}
+
+// 流式发布时边写边算的哈希与整体计算的一致
+void test_hashing_print_matches_whole_buffer() {
+  CapturePrint target;
+  HashingPrint hashing(target);
+  hashing.write((const uint8_t*)"refresh", 7);
+  hashing.write(' ');
+  hashing.write((const uint8_t*)"sensor=2", 8);
+  TEST_ASSERT_EQUAL_size_t(16, target.length);
+  TEST_ASSERT_EQUAL_UINT32(HashingPrint::update(HashingPrint::SEED, target.data, target.length), hashing.hash());
+}
+
+// 自己发布的 MessagePack 负载（首字节不是 '{'）回送时被识别，每条只消耗一次
+void test_ignores_own_msgpack_payload() {
+  CapturePrint target;
+  HashingPrint hashing(target);
+  MsgPackWriter writer(hashing);
+  writer.writeMap(1);
+  writer.writeString("c_t");
+  writer.writeInt(285);
+  filter.record(target.length, hashing.hash(), 1000);
+  TEST_ASSERT_EQUAL_INT(1, filter.pending());
+  TEST_ASSERT_TRUE(filter.consume(target.data, target.length, 1200, TIMEOUT_MS));
+  TEST_ASSERT_EQUAL_INT(0, filter.pending());
+  TEST_ASSERT_FALSE(filter.consume(target.data, target.length, 1300, TIMEOUT_MS));
+}
+
+// 其他客户端发来的命令不受影响，即使长度与自己发布的消息相同
+void test_commands_pass_through() {
+  publish("{\"a\":1}", 0);
+  TEST_ASSERT_FALSE(receive("refresh", 10));
+  TEST_ASSERT_FALSE(receive("help", 10));
+  TEST_ASSERT_TRUE(receive("{\"a\":1}", 20));
+}
+
+// 与自己发布过的内容相同的命令：只忽略与发布次数相同的回送，之后的照常处理
+void test_same_text_consumed_once_per_publish() {
+  publish("refresh", 0);
+  TEST_ASSERT_TRUE(receive("refresh", 5));
+  TEST_ASSERT_FALSE(receive("refresh", 6));
+}
+
+// 回送按任意顺序到达均可识别；超时的记录失效
+void test_out_of_order_and_timeout() {
+  publish("one", 0);
+  publish("two", 10);
+  publish("three", 20);
+  TEST_ASSERT_TRUE(receive("three", 30));
+  TEST_ASSERT_TRUE(receive("one", 40));
+  TEST_ASSERT_FALSE(receive("two", 10 + TIMEOUT_MS + 1));
+  TEST_ASSERT_EQUAL_INT(0, filter.pending());
+}
+
+// 容量满时覆盖最旧的记录
+void test_capacity_overwrites_oldest() {
+  publish("m1", 0);
+  publish("m2", 0);
+  publish("m3", 0);
+  publish("m4", 0);
+  publish("m5", 0);
+  TEST_ASSERT_EQUAL_INT(4, filter.pending());
+  TEST_ASSERT_FALSE(receive("m1", 1));
+  TEST_ASSERT_TRUE(receive("m5", 1));
+  TEST_ASSERT_TRUE(receive("m2", 1));
+}
+
+// millis() 回绕时按差值计算过期
+void test_timeout_across_millis_wrap() {
+  unsigned long start = (unsigned long)-1 - 100;
+  publish("wrap", start);
+  TEST_ASSERT_TRUE(receive("wrap", start + 1000));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hashing_print_matches_whole_buffer);
+  RUN_TEST(test_ignores_own_msgpack_payload);
+  RUN_TEST(test_commands_pass_through);
+  RUN_TEST(test_same_text_consumed_once_per_publish);
+  RUN_TEST(test_out_of_order_and_timeout);
+  RUN_TEST(test_capacity_overwrites_oldest);
+  RUN_TEST(test_timeout_across_millis_wrap);
+  return UNITY_END();
+}
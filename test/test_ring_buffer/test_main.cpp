@@ -0,0 +1,190 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "RingBuffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 下标、迭代器与 segments() 给出的顺序一致，且都是写入顺序的最后 size() 个元素
+template <typename Buffer>
+static void checkOrder(const Buffer& buffer, int lastValue) {
+  int first = lastValue - buffer.size() + 1;
+  for (int i = 0; i < buffer.size(); i++) {
+    TEST_ASSERT_EQUAL_INT(first + i, buffer[i]);
+  }
+
+  int expected = first;
+  for (typename Buffer::const_iterator it = buffer.begin(); it != buffer.end(); ++it) {
+    TEST_ASSERT_EQUAL_INT(expected++, *it);
+  }
+  TEST_ASSERT_EQUAL_INT(lastValue + 1, expected);
+
+  const int* firstPart;
+  const int* secondPart;
+  int firstLen;
+  int secondLen;
+  buffer.segments(firstPart, firstLen, secondPart, secondLen);
+  TEST_ASSERT_EQUAL_INT(buffer.size(), firstLen + secondLen);
+  expected = first;
+  for (int i = 0; i < firstLen; i++) {
+    TEST_ASSERT_EQUAL_INT(expected++, firstPart[i]);
+  }
+  for (int i = 0; i < secondLen; i++) {
+    TEST_ASSERT_EQUAL_INT(expected++, secondPart[i]);
+  }
+
+  if (buffer.size() > 0) {
+    TEST_ASSERT_EQUAL_INT(first, buffer.oldest());
+    TEST_ASSERT_EQUAL_INT(lastValue, buffer.newest());
+  }
+}
+
+void test_empty_buffer() {
+  RingBuffer<int, 5> buffer;
+  TEST_ASSERT_TRUE(buffer.empty());
+  TEST_ASSERT_FALSE(buffer.full());
+  TEST_ASSERT_TRUE(buffer.begin() == buffer.end());
+  buffer.pop();
+  TEST_ASSERT_EQUAL_INT(0, buffer.size());
+}
+
+// 连续写入多圈，每次写入后顺序都正确，写满后覆盖最旧的元素
+void test_push_wraps_in_order() {
+  RingBuffer<int, 5> buffer;
+  for (int value = 1; value <= 23; value++) {
+    buffer.push(value);
+    TEST_ASSERT_EQUAL_INT(value < 5 ? value : 5, buffer.size());
+    TEST_ASSERT_EQUAL(value >= 5, buffer.full());
+    checkOrder(buffer, value);
+  }
+}
+
+// 写入位置：返回值等于写入前的 nextSlot()，写满后即为被覆盖的最旧元素的位置
+void test_slots_track_physical_position() {
+  RingBuffer<int, 4> buffer;
+  for (int value = 1; value <= 11; value++) {
+    int expectedSlot = buffer.nextSlot();
+    if (buffer.full()) {
+      TEST_ASSERT_EQUAL_INT(buffer.oldest(), buffer.slot(expectedSlot));
+    }
+    int slot = buffer.push(value);
+    TEST_ASSERT_EQUAL_INT(expectedSlot, slot);
+    TEST_ASSERT_EQUAL_INT(value, buffer.slot(slot));
+  }
+}
+
+// 交替写入与移除，缓冲区在任意起点回绕时顺序都正确
+void test_pop_and_push_interleaved() {
+  RingBuffer<int, 6> buffer;
+  int last = 0;
+  for (int round = 0; round < 40; round++) {
+    int pushes = round % 4 + 1;
+    for (int i = 0; i < pushes; i++) {
+      buffer.push(++last);
+    }
+    checkOrder(buffer, last);
+    int pops = round % 3;
+    for (int i = 0; i < pops; i++) {
+      buffer.pop();
+    }
+    checkOrder(buffer, last);
+  }
+  buffer.clear();
+  TEST_ASSERT_TRUE(buffer.empty());
+  buffer.push(++last);
+  checkOrder(buffer, last);
+}
+
+// 迭代开销基准：按时间顺序求和一周的1分钟样本（10080 个 int16），缓冲区已回绕到中间位置。
+// 对照为原实现的裸循环（temps[0..recordCount) 直接遍历数组，回绕后顺序错误）
+static const int BENCH_SAMPLES = 10080;
+static const int BENCH_ROUNDS = 2000;
+static RingBuffer<int16_t, BENCH_SAMPLES> benchBuffer;
+static int16_t rawSamples[BENCH_SAMPLES];
+static volatile long benchSink;
+
+static double nsPerSample(clock_t begin) {
+  return (clock() - begin) * 1e9 / CLOCKS_PER_SEC / ((double)BENCH_SAMPLES * BENCH_ROUNDS);
+}
+
+void test_iteration_benchmark() {
+  for (int i = 0; i < BENCH_SAMPLES + BENCH_SAMPLES / 2; i++) {
+    benchBuffer.push((int16_t)(i % 1000));
+  }
+  for (int i = 0; i < BENCH_SAMPLES; i++) {
+    rawSamples[i] = benchBuffer.slot(i);
+  }
+
+  clock_t begin = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    long sum = 0;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+      sum += rawSamples[i];
+    }
+    benchSink = sum;
+  }
+  double raw = nsPerSample(begin);
+  long expected = benchSink;
+
+  begin = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    long sum = 0;
+    for (RingBuffer<int16_t, BENCH_SAMPLES>::const_iterator it = benchBuffer.begin(); it != benchBuffer.end(); ++it) {
+      sum += *it;
+    }
+    benchSink = sum;
+  }
+  double iterator = nsPerSample(begin);
+  TEST_ASSERT_EQUAL_INT32(expected, benchSink);
+
+  begin = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    long sum = 0;
+    for (int i = 0; i < benchBuffer.size(); i++) {
+      sum += benchBuffer[i];
+    }
+    benchSink = sum;
+  }
+  double indexed = nsPerSample(begin);
+  TEST_ASSERT_EQUAL_INT32(expected, benchSink);
+
+  begin = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    const int16_t* first;
+    const int16_t* second;
+    int firstLen;
+    int secondLen;
+    benchBuffer.segments(first, firstLen, second, secondLen);
+    long sum = 0;
+    for (int i = 0; i < firstLen; i++) {
+      sum += first[i];
+    }
+    for (int i = 0; i < secondLen; i++) {
+      sum += second[i];
+    }
+    benchSink = sum;
+  }
+  double segments = nsPerSample(begin);
+  TEST_ASSERT_EQUAL_INT32(expected, benchSink);
+
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%d samples: raw loop %.2f ns, segments() %.2f ns, iterator %.2f ns, operator[] %.2f ns per sample",
+           BENCH_SAMPLES, raw, segments, iterator, indexed);
+  TEST_MESSAGE(message);
+  // 两段连续内存与裸循环是同样的顺序访问（留出计时误差）
+  TEST_ASSERT_TRUE(segments < raw * 3);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_buffer);
+  RUN_TEST(test_push_wraps_in_order);
+  RUN_TEST(test_slots_track_physical_position);
+  RUN_TEST(test_pop_and_push_interleaved);
+  RUN_TEST(test_iteration_benchmark);
+  return UNITY_END();
+}
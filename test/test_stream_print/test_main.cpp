@@ -0,0 +1,104 @@
+#include <unity.h>
+
+#include "StreamPrint.h"
+
+// 记录每次写入调用的目标流，可限制单次写入的字节数以模拟连接写入不完整
+class RecordingPrint : public Print {
+ public:
+  RecordingPrint() : length(0), calls(0), largestWrite(0), writeLimit(0) {}
+
+  size_t write(uint8_t value) override { return write(&value, 1); }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    calls++;
+    if (size > largestWrite) {
+      largestWrite = size;
+    }
+    size_t take = writeLimit > 0 && size > writeLimit ? writeLimit : size;
+    memcpy(data + length, buffer, take);
+    length += take;
+    return take;
+  }
+
+  uint8_t data[4096];
+  size_t length;
+  int calls;
+  size_t largestWrite;
+  size_t writeLimit;
+};
+
+static uint8_t pattern[1000];
+
+void setUp() {
+  for (size_t i = 0; i < sizeof(pattern); i++) {
+    pattern[i] = (uint8_t)(i * 31 + 7);
+  }
+}
+void tearDown() {}
+
+void test_counting_print() {
+  CountingPrint counter;
+  counter.write('x');
+  counter.write(pattern, 100);
+  counter.write(pattern, 0);
+  TEST_ASSERT_EQUAL_size_t(101, counter.length());
+}
+
+// 固定缓冲区写满后丢弃超出部分并标记溢出
+void test_fixed_buffer_overflow() {
+  uint8_t buffer[16];
+  FixedBufferPrint out(buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_size_t(10, out.write(pattern, 10));
+  TEST_ASSERT_FALSE(out.overflowed());
+  TEST_ASSERT_EQUAL_size_t(6, out.write(pattern + 10, 10));
+  TEST_ASSERT_TRUE(out.overflowed());
+  TEST_ASSERT_EQUAL_size_t(0, out.write('z'));
+  TEST_ASSERT_EQUAL_size_t(16, out.length());
+  TEST_ASSERT_EQUAL_MEMORY(pattern, buffer, 16);
+}
+
+// 分块写入：目标流收到的内容与写入顺序一致，每次写入不超过缓冲区大小，
+// 只有缓冲区写满或 flush() 时才写入目标流
+void test_buffered_print_chunks_in_order() {
+  RecordingPrint target;
+  BufferedPrint<64> out(target);
+  size_t offset = 0;
+  const size_t pieces[] = {1, 5, 63, 64, 65, 200, 1, 1, 300, 0, 7};
+  for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+    if (pieces[i] == 1) {
+      out.write(pattern[offset]);
+    } else {
+      TEST_ASSERT_EQUAL_size_t(pieces[i], out.write(pattern + offset, pieces[i]));
+    }
+    offset += pieces[i];
+  }
+  TEST_ASSERT_TRUE(target.length < offset);
+  out.flush();
+  out.flush();  // 没有剩余数据时不写入
+  TEST_ASSERT_EQUAL_size_t(offset, target.length);
+  TEST_ASSERT_EQUAL_size_t(offset, out.written());
+  TEST_ASSERT_EQUAL_MEMORY(pattern, target.data, offset);
+  TEST_ASSERT_EQUAL_size_t(64, target.largestWrite);
+  TEST_ASSERT_EQUAL_INT((int)((offset + 63) / 64), target.calls);
+  TEST_ASSERT_FALSE(out.failed());
+}
+
+// 目标流写入不完整时记为失败，written() 只统计实际写入的字节
+void test_buffered_print_reports_short_write() {
+  RecordingPrint target;
+  target.writeLimit = 40;
+  BufferedPrint<64> out(target);
+  out.write(pattern, 100);
+  out.flush();
+  TEST_ASSERT_TRUE(out.failed());
+  TEST_ASSERT_EQUAL_size_t(40 + 36, out.written());  // 64 字节块只写入 40，剩余 36 字节完整写入
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counting_print);
+  RUN_TEST(test_fixed_buffer_overflow);
+  RUN_TEST(test_buffered_print_chunks_in_order);
+  RUN_TEST(test_buffered_print_reports_short_write);
+  return UNITY_END();
+}
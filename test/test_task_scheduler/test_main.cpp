@@ -0,0 +1,268 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "TaskScheduler.h"
+
+typedef TaskScheduler<8> Scheduler;
+
+// 任务执行记录
+static char runLog[64];
+static int runCount;
+static Scheduler* activeScheduler;
+static int selfTask;
+static unsigned long selfNow;
+
+static void record(char name) {
+  if (runCount < (int)sizeof(runLog) - 1) {
+    runLog[runCount++] = name;
+    runLog[runCount] = '\0';
+  }
+}
+
+static void taskA() { record('A'); }
+static void taskB() { record('B'); }
+static void taskC() { record('C'); }
+static void taskD() { record('D'); }
+
+// 把自己重新排到当前时间，应留到下一轮执行
+static void taskSelf() {
+  record('S');
+  activeScheduler->schedule(selfTask, 0, selfNow);
+}
+
+void setUp() {
+  runCount = 0;
+  runLog[0] = '\0';
+}
+void tearDown() {}
+
+// 按截止时间顺序执行，与注册顺序无关
+void test_runs_in_deadline_order() {
+  Scheduler scheduler;
+  int a = scheduler.once(taskA);
+  int b = scheduler.once(taskB);
+  int c = scheduler.once(taskC);
+  int d = scheduler.once(taskD);
+  scheduler.schedule(a, 40, 0);
+  scheduler.schedule(b, 10, 0);
+  scheduler.schedule(c, 30, 0);
+  scheduler.schedule(d, 20, 0);
+  TEST_ASSERT_EQUAL_UINT32(10, scheduler.timeUntilNext(0, 999));
+  TEST_ASSERT_EQUAL_INT(0, scheduler.run(9));
+  TEST_ASSERT_EQUAL_INT(2, scheduler.run(25));
+  TEST_ASSERT_EQUAL_STRING("BD", runLog);
+  TEST_ASSERT_EQUAL_INT(2, scheduler.run(100));
+  TEST_ASSERT_EQUAL_STRING("BDCA", runLog);
+  TEST_ASSERT_FALSE(scheduler.scheduled(a));
+  TEST_ASSERT_EQUAL_UINT32(999, scheduler.timeUntilNext(100, 999));
+}
+
+// 重新排期会移动任务在堆中的位置
+void test_reschedule_and_cancel() {
+  Scheduler scheduler;
+  int a = scheduler.once(taskA);
+  int b = scheduler.once(taskB);
+  int c = scheduler.once(taskC);
+  scheduler.schedule(a, 10, 0);
+  scheduler.schedule(b, 20, 0);
+  scheduler.schedule(c, 30, 0);
+  scheduler.schedule(a, 50, 0);  // 推后
+  scheduler.schedule(c, 5, 0);   // 提前
+  scheduler.cancel(b);
+  scheduler.cancel(b);  // 重复取消不影响其他任务
+  TEST_ASSERT_FALSE(scheduler.scheduled(b));
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler.timeUntilNext(0, 999));
+  scheduler.run(100);
+  TEST_ASSERT_EQUAL_STRING("CA", runLog);
+}
+
+// 周期任务按固定节拍执行；落后超过一个周期时不补执行，从当前时间重新计时
+void test_periodic_no_catch_up() {
+  Scheduler scheduler;
+  int a = scheduler.every(100, taskA, 0, 0);
+  for (unsigned long now = 0; now <= 300; now += 50) {
+    scheduler.run(now);
+  }
+  TEST_ASSERT_EQUAL_STRING("AAAA", runLog);  // 0, 100, 200, 300
+  TEST_ASSERT_EQUAL_UINT32(50, scheduler.timeUntilNext(350, 0));
+
+  // 停顿了 1000 ms：只执行一次，下一次在 1350 + 100
+  TEST_ASSERT_EQUAL_INT(1, scheduler.run(1350));
+  TEST_ASSERT_EQUAL_UINT32(100, scheduler.timeUntilNext(1350, 0));
+  TEST_ASSERT_TRUE(scheduler.scheduled(a));
+
+  // 小于一个周期的延迟保持原来的节拍
+  scheduler.run(1480);
+  TEST_ASSERT_EQUAL_UINT32(70, scheduler.timeUntilNext(1480, 0));
+}
+
+// 任务在执行中把自己排到当前时间：每轮最多执行一次，不会死循环
+void test_self_reschedule_runs_once_per_pass() {
+  Scheduler scheduler;
+  activeScheduler = &scheduler;
+  selfTask = scheduler.once(taskSelf);
+  int b = scheduler.once(taskB);
+  selfNow = 10;
+  scheduler.schedule(selfTask, 0, 10);
+  scheduler.schedule(b, 0, 10);
+  TEST_ASSERT_EQUAL_INT(2, scheduler.run(10));
+  TEST_ASSERT_EQUAL_INT(2, runCount);
+  TEST_ASSERT_EQUAL_INT(1, scheduler.run(10));
+  TEST_ASSERT_EQUAL_INT(3, runCount);
+  TEST_ASSERT_EQUAL_INT('S', runLog[2]);
+}
+
+// millis() 回绕时按差值比较截止时间
+void test_deadlines_across_millis_wrap() {
+  Scheduler scheduler;
+  unsigned long start = (unsigned long)-1 - 50;
+  int a = scheduler.once(taskA);
+  int b = scheduler.once(taskB);
+  scheduler.schedule(a, 100, start);  // 回绕之后
+  scheduler.schedule(b, 20, start);   // 回绕之前
+  TEST_ASSERT_EQUAL_UINT32(20, scheduler.timeUntilNext(start, 999));
+  scheduler.run(start + 30);
+  TEST_ASSERT_EQUAL_STRING("B", runLog);
+  TEST_ASSERT_EQUAL_UINT32(70, scheduler.timeUntilNext(start + 30, 999));
+  scheduler.run(start + 100);
+  TEST_ASSERT_EQUAL_STRING("BA", runLog);
+}
+
+void test_capacity_limit() {
+  TaskScheduler<2> scheduler;
+  TEST_ASSERT_EQUAL_INT(0, scheduler.once(taskA));
+  TEST_ASSERT_EQUAL_INT(1, scheduler.every(10, taskB, 0));
+  TEST_ASSERT_EQUAL_INT(-1, scheduler.once(taskC));
+  scheduler.schedule(5, 0, 0);  // 无效的任务号被忽略
+  scheduler.cancel(-1);
+  TEST_ASSERT_EQUAL_INT(1, scheduler.run(0));
+  TEST_ASSERT_EQUAL_STRING("B", runLog);
+}
+
+// 空闲开销对比：固件的周期任务（与 setupTasks() 的周期相同），模拟 60 秒。
+// 之前：loop 不让出CPU，每轮对每个任务检查一次 now - last >= period（按每毫秒只转一轮计，是下限）；
+// 之后：每轮 run() 只比较堆顶，再按 timeUntilNext() 让出CPU到下一个截止时间（最长 LOOP_IDLE_MAX_MS）
+static const unsigned long BENCH_PERIODS[] = {10, 500, 500, 200, 30000, 10000, 5000, 60000};
+static const int BENCH_TASKS = sizeof(BENCH_PERIODS) / sizeof(BENCH_PERIODS[0]);
+static const unsigned long BENCH_MS = 60000;
+static const unsigned long LOOP_IDLE_MAX_MS = 10;
+static const int BENCH_ROUNDS = 200;
+static long benchRuns[BENCH_TASKS];
+
+template <int Index>
+static void benchTask() {
+  benchRuns[Index]++;
+}
+
+static Scheduler::TaskFunction benchFunctions[] = {benchTask<0>, benchTask<1>, benchTask<2>, benchTask<3>,
+                                                   benchTask<4>, benchTask<5>, benchTask<6>, benchTask<7>};
+
+struct LoopStats {
+  long iterations;  // loop 轮数
+  long idle;        // 没有执行任何任务的轮数
+  long checks;      // 没有到期的时间比较次数
+  double seconds;   // 主机CPU时间（全部轮次）
+};
+
+static LoopStats pollingLoop() {
+  LoopStats stats = {0, 0, 0, 0};
+  clock_t start = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    unsigned long last[BENCH_TASKS];
+    for (int i = 0; i < BENCH_TASKS; i++) {
+      last[i] = 1;  // 与 setupTasks() 相同，从启动时刻开始计时
+    }
+    for (unsigned long now = 1; now <= BENCH_MS; now++) {
+      bool ran = false;
+      for (int i = 0; i < BENCH_TASKS; i++) {
+        if (now - last[i] >= BENCH_PERIODS[i]) {
+          last[i] = now;
+          benchFunctions[i]();
+          ran = true;
+        } else {
+          stats.checks++;
+        }
+      }
+      stats.iterations++;
+      stats.idle += ran ? 0 : 1;
+    }
+  }
+  stats.seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return stats;
+}
+
+static LoopStats schedulerLoop() {
+  LoopStats stats = {0, 0, 0, 0};
+  clock_t start = clock();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    Scheduler scheduler;
+    for (int i = 0; i < BENCH_TASKS; i++) {
+      scheduler.every(BENCH_PERIODS[i], benchFunctions[i], 1, BENCH_PERIODS[i]);
+    }
+    unsigned long now = 1;
+    while (now <= BENCH_MS) {
+      int ran = scheduler.run(now);
+      stats.iterations++;
+      stats.idle += ran ? 0 : 1;
+      stats.checks++;  // 堆顶未到期的一次比较
+      unsigned long idleMs = scheduler.timeUntilNext(now, LOOP_IDLE_MAX_MS);
+      now += idleMs > LOOP_IDLE_MAX_MS ? LOOP_IDLE_MAX_MS : (idleMs > 0 ? idleMs : 1);
+    }
+  }
+  stats.seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return stats;
+}
+
+static void reportLoop(const char* name, const LoopStats& stats) {
+  double simSeconds = BENCH_ROUNDS * (BENCH_MS / 1000.0);
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%-9s %7.0f iterations/s (%6.0f idle), %7.0f no-op checks/s, %5.1f ns/iteration, "
+           "%6.1f us CPU per simulated second",
+           name, stats.iterations / simSeconds, stats.idle / simSeconds, stats.checks / simSeconds,
+           stats.seconds * 1e9 / stats.iterations, stats.seconds * 1e6 / simSeconds);
+  TEST_MESSAGE(message);
+}
+
+void test_idle_benchmark() {
+  for (int i = 0; i < BENCH_TASKS; i++) {
+    benchRuns[i] = 0;
+  }
+  LoopStats polling = pollingLoop();
+  long pollingRuns[BENCH_TASKS];
+  for (int i = 0; i < BENCH_TASKS; i++) {
+    pollingRuns[i] = benchRuns[i];
+    benchRuns[i] = 0;
+  }
+  LoopStats scheduled = schedulerLoop();
+  reportLoop("polling", polling);
+  reportLoop("scheduler", scheduled);
+
+  // 两种方式执行的任务次数相同
+  for (int i = 0; i < BENCH_TASKS; i++) {
+    TEST_ASSERT_EQUAL_INT32(pollingRuns[i], benchRuns[i]);
+  }
+  // 最短周期 10 ms：之后每秒约 100 轮，每轮一次空比较
+  TEST_ASSERT_TRUE(scheduled.iterations * 9 < polling.iterations);
+  TEST_ASSERT_TRUE(scheduled.checks * 50 < polling.checks);
+
+  // 不让出CPU时主机上每秒空转的轮数（固件上同样占满CPU）
+  char message[120];
+  snprintf(message, sizeof(message), "polling loop without delay: %.1f M iterations/s, %.0f M no-op checks/s",
+           polling.iterations / polling.seconds / 1e6, polling.checks / polling.seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_runs_in_deadline_order);
+  RUN_TEST(test_reschedule_and_cancel);
+  RUN_TEST(test_periodic_no_catch_up);
+  RUN_TEST(test_self_reschedule_runs_once_per_pass);
+  RUN_TEST(test_deadlines_across_millis_wrap);
+  RUN_TEST(test_capacity_limit);
+  RUN_TEST(test_idle_benchmark);
+  return UNITY_END();
+}
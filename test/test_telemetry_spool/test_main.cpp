@@ -0,0 +1,300 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "TelemetrySpool.h"
+
+// 内存模拟的文件系统（与 fs::FS / fs::File 相同的接口子集），只有一个文件槽
+class MemFs;
+
+class MemFile {
+ public:
+  MemFile() : fs_(0), position_(0), append_(false) {}
+  operator bool() const { return fs_ != 0; }
+  size_t write(const uint8_t* buffer, size_t size);
+  size_t read(uint8_t* buffer, size_t size);
+  bool seek(uint32_t position) {
+    position_ = position;
+    return true;
+  }
+  void close() { fs_ = 0; }
+
+ private:
+  friend class MemFs;
+  MemFs* fs_;
+  size_t position_;
+  bool append_;
+};
+
+class MemFs {
+ public:
+  MemFs() { reset(); }
+  void reset() {
+    exists_ = false;
+    length = 0;
+    writeFails = false;
+    opens = 0;
+  }
+
+  MemFile open(const char* path, const char* mode) {
+    MemFile file;
+    bool append = mode[0] == 'a';
+    if (strcmp(path, "/outbox.bin") != 0 || (!append && !exists_)) {
+      return file;
+    }
+    exists_ = true;
+    opens++;
+    file.fs_ = this;
+    file.append_ = append;
+    file.position_ = append ? length : 0;
+    return file;
+  }
+  bool exists(const char* path) { return exists_ && strcmp(path, "/outbox.bin") == 0; }
+  bool remove(const char*) {
+    exists_ = false;
+    length = 0;
+    return true;
+  }
+
+  uint8_t data[4096];
+  size_t length;
+  bool writeFails;  // 模拟闪存写满/写入失败
+  int opens;        // 打开文件的次数
+
+ private:
+  bool exists_;
+};
+
+size_t MemFile::write(const uint8_t* buffer, size_t size) {
+  if (!fs_ || fs_->writeFails || fs_->length + size > sizeof(fs_->data)) {
+    return 0;
+  }
+  memcpy(fs_->data + fs_->length, buffer, size);
+  fs_->length += size;
+  return size;
+}
+
+size_t MemFile::read(uint8_t* buffer, size_t size) {
+  if (!fs_ || position_ >= fs_->length) {
+    return 0;
+  }
+  if (position_ + size > fs_->length) {
+    size = fs_->length - position_;
+  }
+  memcpy(buffer, fs_->data + position_, size);
+  position_ += size;
+  return size;
+}
+
+// 与固件的 TelemetryEntry 相近的定长条目
+struct Entry {
+  uint32_t seq;
+  uint32_t capturedAt;
+  int16_t raw[8];
+};
+
+// 模拟的MQTT服务器：记录收到的条目序号，offline 时发布失败，failAfter 次后发布失败
+static struct {
+  bool online;
+  int failAfter;  // 小于0表示不限制
+  uint32_t received[256];
+  int count;
+} broker;
+
+static bool sendToBroker(const Entry& entry, unsigned long) {
+  if (!broker.online || broker.failAfter == 0) {
+    return false;
+  }
+  if (broker.failAfter > 0) {
+    broker.failAfter--;
+  }
+  broker.received[broker.count++] = entry.seq;
+  return true;
+}
+
+static MemFs flash;
+typedef TelemetrySpool<Entry, 4, MemFs, MemFile> Spool;
+
+static uint32_t nextSeq;
+
+static void submit(Spool& spool, int n) {
+  for (int i = 0; i < n; i++) {
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.seq = nextSeq++;
+    spool.submit(entry, broker.online, sendToBroker, 0);
+  }
+}
+
+// 每批2条补发直到缓存为空，返回批数
+static int drainAll(Spool& spool) {
+  int batches = 0;
+  while (!spool.empty() && batches < 1000) {
+    spool.drain(2, sendToBroker, 0);
+    batches++;
+  }
+  return batches;
+}
+
+static void assertReceived(const uint32_t* expected, int count) {
+  TEST_ASSERT_EQUAL_INT(count, broker.count);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, broker.received, count);
+}
+
+void setUp() {
+  flash.reset();
+  broker.online = false;
+  broker.failAfter = -1;
+  broker.count = 0;
+  nextSeq = 1;
+}
+void tearDown() {}
+
+// 在线且没有积压时直接发布，不经过缓存
+void test_online_sends_directly() {
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  broker.online = true;
+  submit(spool, 3);
+  TEST_ASSERT_TRUE(spool.empty());
+  const uint32_t expected[] = {1, 2, 3};
+  assertReceived(expected, 3);
+  TEST_ASSERT_EQUAL_INT(0, flash.opens);
+}
+
+// 离线期间的条目留在内存队列中（未满时不写闪存），重连后按顺序补发
+void test_offline_buffering() {
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  submit(spool, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, spool.queued());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.spilled());
+  TEST_ASSERT_EQUAL_INT(0, broker.count);
+  TEST_ASSERT_EQUAL_INT(0, flash.opens);
+
+  // 离线时补发失败，条目保留
+  TEST_ASSERT_EQUAL_INT(0, spool.drain(2, sendToBroker, 0));
+  TEST_ASSERT_EQUAL_UINT32(3, spool.queued());
+
+  broker.online = true;
+  TEST_ASSERT_EQUAL_INT(2, drainAll(spool));
+  const uint32_t expected[] = {1, 2, 3};
+  assertReceived(expected, 3);
+}
+
+// 内存队列满后最旧的条目转存到闪存
+void test_spill_to_flash() {
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  submit(spool, 10);
+  TEST_ASSERT_EQUAL_UINT32(4, spool.queued());
+  TEST_ASSERT_EQUAL_UINT32(6, spool.spilled());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.dropped());
+  TEST_ASSERT_EQUAL_size_t(6 * sizeof(Entry), flash.length);
+  // 闪存中为最旧的6条
+  for (int i = 0; i < 6; i++) {
+    Entry entry;
+    memcpy(&entry, flash.data + i * sizeof(Entry), sizeof(entry));
+    TEST_ASSERT_EQUAL_UINT32(i + 1, entry.seq);
+  }
+}
+
+// 跨越闪存/内存边界按顺序补发：发布中途失败、补发期间又有新条目时顺序不变，
+// 补发完成后删除溢出文件
+void test_in_order_drain_across_boundary() {
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  submit(spool, 9);  // 闪存 1~5，内存 6~9
+
+  broker.online = true;
+  broker.failAfter = 3;
+  TEST_ASSERT_EQUAL_INT(2, spool.drain(2, sendToBroker, 0));
+  TEST_ASSERT_EQUAL_INT(1, spool.drain(2, sendToBroker, 0));  // 第4条失败，下批重试
+  TEST_ASSERT_EQUAL_UINT32(2, spool.spilled());
+
+  // 重连期间新采集的条目排在积压之后，不插队
+  broker.failAfter = -1;
+  submit(spool, 2);
+  TEST_ASSERT_EQUAL_INT(3, broker.count);
+
+  drainAll(spool);
+  const uint32_t expected[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  assertReceived(expected, 11);
+  TEST_ASSERT_FALSE(flash.exists("/outbox.bin"));
+  TEST_ASSERT_EQUAL_UINT32(0, spool.dropped());
+
+  // 文件删除后可以再次转存
+  broker.online = false;
+  submit(spool, 6);
+  TEST_ASSERT_EQUAL_UINT32(2, spool.spilled());
+  broker.online = true;
+  drainAll(spool);
+  TEST_ASSERT_EQUAL_INT(17, broker.count);
+  TEST_ASSERT_EQUAL_UINT32(17, broker.received[16]);
+}
+
+// 闪存达到上限后丢弃内存队列中最旧的条目，计数准确，补发的是保留下来的条目
+void test_drop_counter_at_spill_cap() {
+  Spool spool(flash, "/outbox.bin", 5);
+  spool.begin();
+  submit(spool, 20);  // 内存 4 条，闪存 5 条，其余 11 条丢弃
+  TEST_ASSERT_EQUAL_UINT32(4, spool.queued());
+  TEST_ASSERT_EQUAL_UINT32(5, spool.spilled());
+  TEST_ASSERT_EQUAL_UINT32(11, spool.dropped());
+
+  broker.online = true;
+  drainAll(spool);
+  const uint32_t expected[] = {1, 2, 3, 4, 5, 17, 18, 19, 20};
+  assertReceived(expected, 9);
+}
+
+// 闪存不可用（未 begin 或写入失败）时直接丢弃最旧条目
+void test_drop_without_flash() {
+  Spool spool(flash, "/outbox.bin", 16);
+  submit(spool, 6);
+  TEST_ASSERT_EQUAL_UINT32(4, spool.queued());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.spilled());
+  TEST_ASSERT_EQUAL_UINT32(2, spool.dropped());
+
+  spool.begin();
+  flash.writeFails = true;
+  submit(spool, 1);
+  TEST_ASSERT_EQUAL_UINT32(3, spool.dropped());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.spilled());
+}
+
+// 溢出文件丢失时放弃其中剩余的条目并计入丢弃数，继续补发内存队列
+void test_lost_spill_file() {
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  submit(spool, 7);  // 闪存 1~3，内存 4~7
+  flash.remove("/outbox.bin");
+
+  broker.online = true;
+  drainAll(spool);
+  TEST_ASSERT_EQUAL_UINT32(3, spool.dropped());
+  const uint32_t expected[] = {4, 5, 6, 7};
+  assertReceived(expected, 4);
+}
+
+// 启动时丢弃上次运行留下的溢出文件
+void test_begin_discards_stale_file() {
+  flash.open("/outbox.bin", "a").write((const uint8_t*)"stale", 5);
+  Spool spool(flash, "/outbox.bin", 16);
+  spool.begin();
+  TEST_ASSERT_FALSE(flash.exists("/outbox.bin"));
+  TEST_ASSERT_TRUE(spool.empty());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_online_sends_directly);
+  RUN_TEST(test_offline_buffering);
+  RUN_TEST(test_spill_to_flash);
+  RUN_TEST(test_in_order_drain_across_boundary);
+  RUN_TEST(test_drop_counter_at_spill_cap);
+  RUN_TEST(test_drop_without_flash);
+  RUN_TEST(test_lost_spill_file);
+  RUN_TEST(test_begin_discards_stale_file);
+  return UNITY_END();
+}
@@ -0,0 +1,226 @@
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+
+#include "TelemetryTrigger.h"
+
+// 与固件相同的参数
+#define TELEMETRY_INTERVAL 300000
+#define TELEMETRY_DEADBAND 0.3
+#define TELEMETRY_COALESCE_MS 2000
+#define TELEMETRY_MIN_INTERVAL 10000
+#define TEMP_UPDATE_INTERVAL 5000
+
+// 模拟 1 小时：8 个传感器每 5 秒读取一轮，一轮内分批读取，相邻传感器间隔 150ms；
+// loop 每 50ms 调用一次发布检查。检查与发布的逻辑与 checkTelemetryChange/publishTelemetry 相同
+static const int SENSORS = 8;
+static const unsigned long SIM_MS = 3600000UL;
+static const unsigned long TICK_MS = 50;
+static const unsigned long READ_SPACING_MS = 150;
+
+struct Stats {
+  int full;           // 全量发布次数
+  int changes;        // 变化发布次数
+  int sensorUpdates;  // 变化发布中包含的通道总数
+  int crossings;      // 通道超出死区的次数（未合并时每次各发一条消息）
+  unsigned long minGap;      // 相邻两次变化发布的最小间隔
+  unsigned long maxLatency;  // 通道超出死区到被发布的最长时间
+  float maxError;            // 未发布期间当前值与上次发布值的最大偏差
+};
+
+static float currentTemps[SENSORS];
+static float publishedTemps[SENSORS];
+static bool telemetryDirty[SENSORS];
+static unsigned long dirtySince[SENSORS];
+
+// 确定性的伪随机数，[-1, 1)
+static uint32_t randomState;
+static float noise() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return (randomState >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+typedef float (*Trace)(int sensor, unsigned long now);
+
+// 稳定：室温附近 ±0.06°C 的量化抖动
+static float steadyTrace(int sensor, unsigned long) { return 21.0f + sensor * 0.5f + roundf(noise()) / 16.0f; }
+
+// 缓慢漂移：所有通道以 0.1°C/分钟同向升温（按 1/16°C 量化）
+static float driftTrace(int sensor, unsigned long now) {
+  return roundf((18.0f + sensor * 0.5f + now / 600000.0f) * 16) / 16.0f;
+}
+
+// 噪声：每次读数 ±0.5°C 的随机波动（接触不良或靠近热源），不时断开
+static float noisyTrace(int sensor, unsigned long now) {
+  if ((now / TEMP_UPDATE_INTERVAL + sensor) % 97 == 0) {
+    return DEVICE_DISCONNECTED_C;
+  }
+  return 21.0f + sensor * 0.5f + roundf(noise() * 8) / 16.0f;
+}
+
+static Stats simulate(Trace trace) {
+  TelemetryTrigger trigger(TELEMETRY_INTERVAL, TELEMETRY_COALESCE_MS, TELEMETRY_MIN_INTERVAL, TELEMETRY_DEADBAND);
+  Stats stats = {0, 0, 0, 0, SIM_MS, 0, 0};
+  randomState = 12345;
+  for (int i = 0; i < SENSORS; i++) {
+    currentTemps[i] = DEVICE_DISCONNECTED_C;
+    publishedTemps[i] = DEVICE_DISCONNECTED_C;
+    telemetryDirty[i] = false;
+  }
+  unsigned long lastChange = 0;
+  bool anyChange = false;
+
+  // 从 1ms 开始，与固件中 millis() 不为0一致
+  for (unsigned long now = 1; now < SIM_MS; now += TICK_MS) {
+    // 分批读取：本 tick 内到期的传感器
+    for (int i = 0; i < SENSORS; i++) {
+      unsigned long offset = i * READ_SPACING_MS;
+      if (now >= offset && (now - offset) % TEMP_UPDATE_INTERVAL < TICK_MS) {
+        currentTemps[i] = trace(i, now);
+        // checkTelemetryChange
+        if (!telemetryDirty[i] && trigger.changed(currentTemps[i], publishedTemps[i])) {
+          telemetryDirty[i] = true;
+          dirtySince[i] = now;
+          stats.crossings++;
+          trigger.markChanged(now);
+        }
+      }
+    }
+
+    // publishTelemetry
+    TelemetryTrigger::Due due = trigger.due(now);
+    if (due == TelemetryTrigger::DUE_NONE) {
+      for (int i = 0; i < SENSORS; i++) {
+        bool valid = currentTemps[i] != DEVICE_DISCONNECTED_C && publishedTemps[i] != DEVICE_DISCONNECTED_C;
+        if (valid && fabsf(currentTemps[i] - publishedTemps[i]) > stats.maxError) {
+          stats.maxError = fabsf(currentTemps[i] - publishedTemps[i]);
+        }
+      }
+      continue;
+    }
+    bool full = due == TelemetryTrigger::DUE_FULL;
+    if (full) {
+      stats.full++;
+    } else {
+      stats.changes++;
+      if (anyChange && now - lastChange < stats.minGap) {
+        stats.minGap = now - lastChange;
+      }
+      lastChange = now;
+      anyChange = true;
+    }
+    for (int i = 0; i < SENSORS; i++) {
+      if (full || telemetryDirty[i]) {
+        if (telemetryDirty[i]) {
+          if (!full) {
+            stats.sensorUpdates++;
+          }
+          if (now - dirtySince[i] > stats.maxLatency) {
+            stats.maxLatency = now - dirtySince[i];
+          }
+        }
+        publishedTemps[i] = currentTemps[i];
+        telemetryDirty[i] = false;
+      }
+    }
+    trigger.published(now, full);
+  }
+  return stats;
+}
+
+static void report(const char* name, const Stats& stats) {
+  char message[220];
+  snprintf(message, sizeof(message),
+           "%-8s 1 h, %d sensors: full %d, change messages %d (%d sensor updates, %d deadband crossings), "
+           "min gap %lu ms, max latency %lu ms, max unpublished error %.2f C",
+           name, SENSORS, stats.full, stats.changes, stats.sensorUpdates, stats.crossings, stats.minGap,
+           stats.maxLatency, stats.maxError);
+  TEST_MESSAGE(message);
+}
+
+void setUp() {}
+void tearDown() {}
+
+// 死区：恰好 0.3°C 时发布，连接状态变化时发布
+void test_deadband_and_connection() {
+  TelemetryTrigger trigger(TELEMETRY_INTERVAL, TELEMETRY_COALESCE_MS, TELEMETRY_MIN_INTERVAL, TELEMETRY_DEADBAND);
+  TEST_ASSERT_FALSE(trigger.changed(21.0f, 21.0f));
+  TEST_ASSERT_FALSE(trigger.changed(21.25f, 21.0f));
+  TEST_ASSERT_TRUE(trigger.changed(21.3125f, 21.0f));
+  TEST_ASSERT_TRUE(trigger.changed(20.6875f, 21.0f));
+  TEST_ASSERT_TRUE(trigger.changed(DEVICE_DISCONNECTED_C, 21.0f));
+  TEST_ASSERT_TRUE(trigger.changed(21.0f, DEVICE_DISCONNECTED_C));
+  TEST_ASSERT_FALSE(trigger.changed(DEVICE_DISCONNECTED_C, DEVICE_DISCONNECTED_C));
+}
+
+// 首次调用即全量发布；合并窗口与最小间隔都满足后才发布变化；到周期时全量发布
+void test_timing() {
+  TelemetryTrigger trigger(TELEMETRY_INTERVAL, TELEMETRY_COALESCE_MS, TELEMETRY_MIN_INTERVAL, TELEMETRY_DEADBAND);
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_FULL, trigger.due(0));
+  trigger.published(0, true);
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_NONE, trigger.due(1));
+
+  trigger.markChanged(5000);
+  trigger.markChanged(6000);  // 窗口已打开，不重新计时
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_NONE, trigger.due(6999));
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_NONE, trigger.due(9999));  // 窗口已结束，但距上次发布不足10秒
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_CHANGES, trigger.due(10000));
+  trigger.published(10000, false);
+  TEST_ASSERT_FALSE(trigger.windowOpen());
+
+  trigger.markChanged(30000);
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_NONE, trigger.due(31999));
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_CHANGES, trigger.due(32000));
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_FULL, trigger.due(300000));
+  trigger.published(300000, true);
+  TEST_ASSERT_EQUAL_INT(TelemetryTrigger::DUE_NONE, trigger.due(300001));
+}
+
+// 稳定读数：只有定时全量发布（第0、5、…、55分钟）
+void test_steady_trace() {
+  Stats stats = simulate(steadyTrace);
+  report("steady", stats);
+  TEST_ASSERT_EQUAL_INT(12, stats.full);
+  // 首次全量发布时只有第1个通道已读取，其余通道在同一轮中由未连接变为有效，合并为一条变化消息
+  TEST_ASSERT_EQUAL_INT(1, stats.changes);
+  TEST_ASSERT_EQUAL_INT(SENSORS - 1, stats.sensorUpdates);
+  TEST_ASSERT_TRUE(stats.maxError < TELEMETRY_DEADBAND);
+}
+
+// 缓慢漂移：各通道在同一轮读取中先后超出死区，合并为一条消息
+void test_drift_trace() {
+  Stats stats = simulate(driftTrace);
+  report("drift", stats);
+  TEST_ASSERT_EQUAL_INT(12, stats.full);
+  // 每 3 分钟漂移 0.3°C，1 小时约 20 次超出死区，部分由全量发布顺带发布
+  TEST_ASSERT_TRUE(stats.changes >= 10 && stats.changes <= 21);
+  // 合并：同一轮读取中先后超出死区的通道合并为一条消息（不合并时每次超出死区各发一条）。
+  // 除第一条（首次连接，7个通道）外每条消息都包含全部通道；第1个通道的首次读数随首次全量发布
+  TEST_ASSERT_EQUAL_INT(stats.changes * SENSORS - 1, stats.sensorUpdates);
+  TEST_ASSERT_EQUAL_INT(stats.sensorUpdates + 1, stats.crossings);
+  TEST_ASSERT_TRUE(stats.minGap >= TELEMETRY_MIN_INTERVAL);
+  TEST_ASSERT_TRUE(stats.maxError < TELEMETRY_DEADBAND + 0.2f);
+}
+
+// 噪声：每次读数都可能超出死区，由最小间隔限制消息速率
+void test_noisy_trace() {
+  Stats stats = simulate(noisyTrace);
+  report("noisy", stats);
+  TEST_ASSERT_EQUAL_INT(12, stats.full);
+  TEST_ASSERT_TRUE(stats.minGap >= TELEMETRY_MIN_INTERVAL);
+  TEST_ASSERT_TRUE(stats.changes <= (int)(SIM_MS / TELEMETRY_MIN_INTERVAL));
+  TEST_ASSERT_TRUE(stats.changes < stats.crossings);
+  // 超出死区的通道最迟在最小间隔加一轮读取后发布
+  TEST_ASSERT_TRUE(stats.maxLatency <= TELEMETRY_MIN_INTERVAL + TEMP_UPDATE_INTERVAL);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_deadband_and_connection);
+  RUN_TEST(test_timing);
+  RUN_TEST(test_steady_trace);
+  RUN_TEST(test_drift_trace);
+  RUN_TEST(test_noisy_trace);
+  return UNITY_END();
+}
@@ -0,0 +1,364 @@
+#include <unity.h>
+
+#include "TempAcquisition.h"
+
+// 与固件相同的参数（TEMP_CONVERSION_MARGIN_MS / TEMP_CONVERSION_MIN_MS / TEMP_READ_BUDGET_MS / TEMP_UPDATE_INTERVAL）
+static const unsigned long MARGIN_MS = 20;
+static const unsigned long MIN_POLL_MS = 10;
+static const unsigned long BUDGET_MS = 20;
+static const unsigned long INTERVAL_MS = 5000;
+
+static const int MAX_SIM_SENSORS = 64;
+
+// 模拟时钟：总线操作按实际耗时推进
+static unsigned long simNow;
+static unsigned long simClock() { return simNow; }
+
+// 模拟的 DS18B20 总线。耗时按标准速度估算：复位约1ms，每位约70us；
+// 发起转换（复位 + Skip ROM + Convert T）约2ms，按序列号读取（复位 + Match ROM + 9字节暂存器）约12ms
+class SimulatedBus : public TempSensorBus {
+ public:
+  SimulatedBus() : conversionActualMs(600), requestCostMs(2), pollCostMs(0), readCostMs(12), neverCompletes(false),
+                   conversionStart(0), conversions(0), polls(0), reads(0), readsBeforeComplete(0) {}
+
+  void requestConversion() override {
+    simNow += requestCostMs;
+    conversionStart = simNow;
+    conversions++;
+  }
+
+  bool conversionComplete() override {
+    simNow += pollCostMs;
+    polls++;
+    return !neverCompletes && simNow - conversionStart >= conversionActualMs;
+  }
+
+  float readTemperature(const uint8_t* address) override {
+    if (simNow - conversionStart < conversionActualMs) {
+      readsBeforeComplete++;
+    }
+    simNow += readCostMs;
+    reads++;
+    return address[1] + 0.5f;  // 读数由序列号决定，便于核对
+  }
+
+  unsigned long conversionActualMs;
+  unsigned long requestCostMs;
+  unsigned long pollCostMs;
+  unsigned long readCostMs;
+  bool neverCompletes;
+  unsigned long conversionStart;
+  int conversions;
+  int polls;
+  int reads;
+  int readsBeforeComplete;
+};
+
+static uint8_t addresses[MAX_SIM_SENSORS][8];
+
+// 读数回调的记录
+static int readingCount;
+static bool readingOrderOk;
+static bool readingValueOk;
+static int expectedIndex;
+
+static void recordReading(int index, float tempC, unsigned long) {
+  if (index != expectedIndex) {
+    readingOrderOk = false;
+  }
+  if (tempC != addresses[index][1] + 0.5f) {
+    readingValueOk = false;
+  }
+  expectedIndex = index + 1;
+  readingCount++;
+}
+
+// 模拟 loop()：调度器按 nextDelay() 安排下一次 step()，其余工作每轮占用 1ms。
+// 返回单次 step() 的最长耗时，并统计完成的采集轮数
+struct LoopResult {
+  unsigned long worstStepMs;
+  int finished;
+  int started;
+};
+
+static LoopResult runLoop(TempAcquisition& acquisition, int count, unsigned long durationMs) {
+  LoopResult result = {0, 0, 0};
+  unsigned long end = simNow + durationMs;
+  unsigned long nextStep = simNow;
+  while ((long)(simNow - end) < 0) {
+    if ((long)(simNow - nextStep) >= 0) {
+      unsigned long before = simNow;
+      TempAcquisition::Event event = acquisition.step(INTERVAL_MS, addresses, count);
+      unsigned long took = simNow - before;
+      if (took > result.worstStepMs) {
+        result.worstStepMs = took;
+      }
+      if (event == TempAcquisition::STARTED) {
+        result.started++;
+        expectedIndex = 0;
+      } else if (event == TempAcquisition::FINISHED) {
+        result.finished++;
+        if (expectedIndex != count) {
+          readingOrderOk = false;
+        }
+      }
+      nextStep = simNow + acquisition.nextDelay(simNow, INTERVAL_MS);
+    }
+    simNow += 1;
+  }
+  return result;
+}
+
+void setUp() {
+  simNow = 1000;
+  readingCount = 0;
+  readingOrderOk = true;
+  readingValueOk = true;
+  expectedIndex = 0;
+  for (int i = 0; i < MAX_SIM_SENSORS; i++) {
+    addresses[i][0] = 0x28;
+    addresses[i][1] = (uint8_t)(i + 10);
+  }
+}
+void tearDown() {}
+
+// 16个传感器、12位分辨率：单次 step() 不超过预算，每轮读完所有传感器且顺序正确
+void test_step_stays_within_budget() {
+  SimulatedBus bus;
+  TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+  acquisition.configure(750, true);
+  acquisition.onReading(recordReading);
+  acquisition.restart(simNow);
+
+  // 每 INTERVAL_MS 一轮，转换与读取不影响节拍（多模拟1秒让最后一轮读完）
+  LoopResult result = runLoop(acquisition, 16, 60000 + 1000);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(BUDGET_MS, result.worstStepMs);
+  TEST_ASSERT_EQUAL_INT(12, result.started);
+  TEST_ASSERT_EQUAL_INT(12, result.finished);
+  TEST_ASSERT_EQUAL_INT(12 * 16, readingCount);
+  TEST_ASSERT_TRUE(readingOrderOk);
+  TEST_ASSERT_TRUE(readingValueOk);
+  TEST_ASSERT_EQUAL_INT(0, bus.readsBeforeComplete);
+
+  char message[96];
+  snprintf(message, sizeof(message), "16 sensors, 12-bit, 12 ms per read, budget %lu ms: worst step() %lu ms",
+           BUDGET_MS, result.worstStepMs);
+  TEST_MESSAGE(message);
+}
+
+// 不同的预算与单次读取耗时：单次调用不超过两者中的较大者
+void test_budget_matrix() {
+  const unsigned long budgets[] = {5, 20, 50, 100};
+  const unsigned long readCosts[] = {1, 3, 12, 30};
+  char message[96];
+  for (int b = 0; b < 4; b++) {
+    for (int r = 0; r < 4; r++) {
+      setUp();
+      SimulatedBus bus;
+      bus.readCostMs = readCosts[r];
+      TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, budgets[b]);
+      acquisition.configure(750, true);
+      acquisition.onReading(recordReading);
+      acquisition.restart(simNow);
+      LoopResult result = runLoop(acquisition, 64, 30000);
+      unsigned long limit = budgets[b] > readCosts[r] ? budgets[b] : readCosts[r];
+      snprintf(message, sizeof(message), "budget %lu ms, read %lu ms: worst step %lu ms", budgets[b], readCosts[r],
+               result.worstStepMs);
+      TEST_ASSERT_TRUE_MESSAGE(result.worstStepMs <= limit, message);
+      TEST_ASSERT_TRUE_MESSAGE(result.finished >= 5, message);
+      // 最后一轮可能在模拟结束时仍在读取
+      TEST_ASSERT_GREATER_OR_EQUAL(result.finished * 64, readingCount);
+      TEST_ASSERT_LESS_THAN((result.finished + 1) * 64, readingCount);
+      TEST_ASSERT_TRUE(readingOrderOk);
+    }
+  }
+  TEST_MESSAGE("64 sensors, read cost 1..30 ms, budget 5..100 ms: every step() within max(budget, read cost)");
+}
+
+// 能查询完成状态时，转换完成后最多再等一个查询间隔（加一轮loop）即开始读取，不等满750ms
+void test_reads_start_soon_after_conversion_completes() {
+  SimulatedBus bus;
+  bus.conversionActualMs = 400;
+  TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+  acquisition.configure(750, true);
+  acquisition.onReading(recordReading);
+  acquisition.restart(simNow - INTERVAL_MS);
+
+  runLoop(acquisition, 1, 500);
+  TEST_ASSERT_EQUAL_INT(1, readingCount);
+  TEST_ASSERT_EQUAL_INT(0, bus.readsBeforeComplete);
+  // 转换期间每 MIN_POLL_MS 查询一次，不是每轮loop都查询
+  TEST_ASSERT_LESS_OR_EQUAL(400 / MIN_POLL_MS + 2, bus.polls);
+}
+
+// 寄生供电：不查询完成状态，等到 转换时间 + 余量 后读取
+void test_parasite_power_waits_for_deadline() {
+  SimulatedBus bus;
+  bus.conversionActualMs = 94;
+  TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+  acquisition.configure(94, false);  // 9位分辨率
+  acquisition.onReading(recordReading);
+  acquisition.restart(simNow - INTERVAL_MS);
+
+  TEST_ASSERT_EQUAL_INT(TempAcquisition::STARTED, acquisition.step(INTERVAL_MS, addresses, 1));
+  unsigned long started = acquisition.lastStart();
+  TEST_ASSERT_EQUAL_UINT32(started + 94 + MARGIN_MS - simNow, acquisition.nextDelay(simNow, INTERVAL_MS));
+  simNow = started + 94 + MARGIN_MS - 1;
+  acquisition.step(INTERVAL_MS, addresses, 1);
+  TEST_ASSERT_EQUAL_INT(TempAcquisition::CONVERTING, acquisition.state());
+  simNow++;
+  acquisition.step(INTERVAL_MS, addresses, 1);
+  TEST_ASSERT_EQUAL_INT(TempAcquisition::READING, acquisition.state());
+  TEST_ASSERT_EQUAL_INT(TempAcquisition::FINISHED, acquisition.step(INTERVAL_MS, addresses, 1));
+  TEST_ASSERT_EQUAL_INT(0, bus.polls);
+  TEST_ASSERT_EQUAL_INT(1, readingCount);
+}
+
+// 完成状态一直不置位（如总线故障）时在截止时间后照常读取，不会卡在转换状态
+void test_conversion_never_completes_times_out() {
+  SimulatedBus bus;
+  bus.neverCompletes = true;
+  bus.conversionActualMs = 0;
+  TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+  acquisition.configure(750, true);
+  acquisition.onReading(recordReading);
+  acquisition.restart(simNow);
+
+  LoopResult result = runLoop(acquisition, 4, 20000 + 1000);
+  TEST_ASSERT_EQUAL_INT(4, result.finished);
+  TEST_ASSERT_EQUAL_INT(16, readingCount);
+}
+
+// 没有传感器时一轮立即结束；间隔内不重复发起转换
+void test_no_sensors_and_interval() {
+  SimulatedBus bus;
+  TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+  acquisition.configure(750, true);
+  acquisition.restart(simNow);
+  TEST_ASSERT_EQUAL_INT(TempAcquisition::NONE, acquisition.step(INTERVAL_MS, addresses, 0));
+  TEST_ASSERT_EQUAL_UINT32(INTERVAL_MS, acquisition.nextDelay(simNow, INTERVAL_MS));
+  LoopResult result = runLoop(acquisition, 0, 10000 + 1000);
+  TEST_ASSERT_EQUAL_INT(2, result.started);
+  TEST_ASSERT_EQUAL_INT(2, result.finished);
+  TEST_ASSERT_EQUAL_INT(2, bus.conversions);
+}
+
+// 按 OneWire 时序统计总线事务（以复位脉冲开始的一次命令序列）与时隙数。
+// 复位约960us，每个时隙约70us：
+//   发起转换   复位 + Skip ROM + Convert T                        16 时隙
+//   按序列号读 复位 + Match ROM + 64位序列号 + 读暂存器 + 9字节      152 时隙
+//   ROM搜索一步 复位 + Search ROM + 64位 ×（两个读时隙 + 一个写时隙） 200 时隙
+class CountingOneWire {
+ public:
+  explicit CountingOneWire(int devices) : devices(devices), transactions(0), slots(0), searchNext(0) {}
+
+  void transaction(int bitSlots) {
+    transactions++;
+    slots += bitSlots;
+  }
+
+  void convert() { transaction(16); }
+  void readScratchpad() { transaction(152); }
+  void resetSearch() { searchNext = 0; }
+
+  // 与 OneWire::search() 相同：找到最后一个设备后再调用直接返回 false，不占用总线
+  bool search() {
+    if (searchNext >= devices) {
+      return false;
+    }
+    transaction(200);
+    searchNext++;
+    return true;
+  }
+
+  unsigned long busMicros() const { return transactions * 960UL + slots * 70UL; }
+
+  int devices;
+  unsigned long transactions;
+  unsigned long slots;
+  int searchNext;
+};
+
+// 按缓存序列号读取的总线实现（对应固件中的 DallasSensorBus）
+class CountingSensorBus : public TempSensorBus {
+ public:
+  explicit CountingSensorBus(CountingOneWire& wire) : wire(wire) {}
+  void requestConversion() override { wire.convert(); }
+  bool conversionComplete() override {
+    wire.slots++;  // 只读一个时隙，不复位
+    return true;
+  }
+  float readTemperature(const uint8_t* address) override {
+    wire.readScratchpad();
+    return address[1] + 0.5f;
+  }
+  CountingOneWire& wire;
+};
+
+// 原来的做法：requestTemperatures() 后逐个 getTempCByIndex(i)。
+// DallasTemperature::getAddress(i) 每次从头搜索 i+1 步，再读一次暂存器
+static void legacyCycle(CountingOneWire& wire) {
+  wire.convert();
+  for (int i = 0; i < wire.devices; i++) {
+    wire.resetSearch();
+    for (int depth = 0; depth <= i && wire.search(); depth++) {
+    }
+    wire.readScratchpad();
+  }
+}
+
+// 每轮采集的总线事务数：缓存序列号 1 + n，原做法 1 + n(n+1)/2 + n。
+// 后台扫描每 SENSOR_RESCAN_INTERVAL 完整搜索一遍（n 步），按每轮均摊计入
+void test_bus_transactions_per_cycle() {
+  const int sensorCounts[] = {4, 16, 64};
+  const unsigned long RESCAN_INTERVAL_MS = 60000;
+  const int cyclesPerRescan = (int)(RESCAN_INTERVAL_MS / INTERVAL_MS);
+  char message[160];
+  for (int c = 0; c < 3; c++) {
+    int n = sensorCounts[c];
+    setUp();
+
+    CountingOneWire legacyWire(n);
+    legacyCycle(legacyWire);
+    TEST_ASSERT_EQUAL_UINT32(1 + n * (n + 1) / 2 + n, legacyWire.transactions);
+
+    CountingOneWire cachedWire(n);
+    CountingSensorBus bus(cachedWire);
+    TempAcquisition acquisition(bus, simClock, MARGIN_MS, MIN_POLL_MS, BUDGET_MS);
+    acquisition.configure(750, true);
+    acquisition.onReading(recordReading);
+    acquisition.restart(simNow - INTERVAL_MS);
+    while (acquisition.step(INTERVAL_MS, addresses, n) != TempAcquisition::FINISHED) {
+      simNow++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(1 + n, cachedWire.transactions);
+    TEST_ASSERT_EQUAL_INT(n, readingCount);
+
+    CountingOneWire rescanWire(n);
+    rescanWire.resetSearch();
+    while (rescanWire.search()) {
+    }
+    TEST_ASSERT_EQUAL_UINT32(n, rescanWire.transactions);
+
+    double cachedPerCycle = cachedWire.transactions + (double)rescanWire.transactions / cyclesPerRescan;
+    double cachedMs = (cachedWire.busMicros() + (double)rescanWire.busMicros() / cyclesPerRescan) / 1000.0;
+    snprintf(message, sizeof(message),
+             "%2d sensors: getTempCByIndex %4lu transactions (%6.1f ms bus), cached %3lu + rescan %.2f = %6.2f "
+             "transactions (%5.1f ms bus)",
+             n, legacyWire.transactions, legacyWire.busMicros() / 1000.0, cachedWire.transactions,
+             (double)rescanWire.transactions / cyclesPerRescan, cachedPerCycle, cachedMs);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_step_stays_within_budget);
+  RUN_TEST(test_budget_matrix);
+  RUN_TEST(test_reads_start_soon_after_conversion_completes);
+  RUN_TEST(test_parasite_power_waits_for_deadline);
+  RUN_TEST(test_conversion_never_completes_times_out);
+  RUN_TEST(test_no_sensors_and_interval);
+  RUN_TEST(test_bus_transactions_per_cycle);
+  return UNITY_END();
+}
@@ -0,0 +1,217 @@
+#include <unity.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "TempRecord.h"
+
+// 测试用的小容量记录：窗口内容经常整体替换，覆盖环形缓冲区回绕
+typedef TempRecordT<16, 1000> SmallRecord;
+// 与固件相同的参数
+typedef TempRecordT<240, 720000> FirmwareRecord;
+
+static uint32_t randomState;
+
+static uint32_t nextRandom() {
+  randomState = randomState * 1664525u + 1013904223u;
+  return randomState >> 8;
+}
+
+// 随机温度：约十分之一为未连接，其余为 -10~50°C 的1/16°C量化值
+static float randomTemp() {
+  if (nextRandom() % 10 == 0) {
+    return DEVICE_DISCONNECTED_C;
+  }
+  return (float)((int)(nextRandom() % 960) - 160) / TEMP_RAW_SCALE;
+}
+
+// 重新扫描窗口内全部样本计算统计值，与增量维护的结果比较
+template <typename Record>
+static void checkAgainstRescan(const Record& record) {
+  float minTemp = DEVICE_DISCONNECTED_C;
+  float maxTemp = DEVICE_DISCONNECTED_C;
+  double sum = 0;
+  int valid = 0;
+  for (int i = 0; i < record.count(); i++) {
+    float temp = record.tempAt(i);
+    if (temp == DEVICE_DISCONNECTED_C) {
+      continue;
+    }
+    if (valid == 0 || temp < minTemp) {
+      minTemp = temp;
+    }
+    if (valid == 0 || temp > maxTemp) {
+      maxTemp = temp;
+    }
+    sum += temp;
+    valid++;
+  }
+  TEST_ASSERT_EQUAL_INT(valid, record.validCount);
+  TEST_ASSERT_EQUAL_FLOAT(minTemp, record.minTemp);
+  TEST_ASSERT_EQUAL_FLOAT(maxTemp, record.maxTemp);
+  if (valid == 0) {
+    TEST_ASSERT_EQUAL_FLOAT(DEVICE_DISCONNECTED_C, record.avgTemp);
+  } else {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, sum / valid, record.avgTemp);
+  }
+}
+
+void setUp() { randomState = 12345; }
+void tearDown() {}
+
+void test_empty_record_has_no_stats() {
+  static SmallRecord record;
+  record.reset();
+  TEST_ASSERT_EQUAL_INT(0, record.count());
+  TEST_ASSERT_EQUAL_FLOAT(DEVICE_DISCONNECTED_C, record.minTemp);
+  TEST_ASSERT_EQUAL_FLOAT(DEVICE_DISCONNECTED_C, record.maxTemp);
+  TEST_ASSERT_EQUAL_FLOAT(DEVICE_DISCONNECTED_C, record.avgTemp);
+}
+
+void test_random_stats_match_rescan() {
+  static SmallRecord record;
+  record.reset();
+  for (uint32_t seq = 1; seq <= 2000; seq++) {
+    record.push(randomTemp(), seq * 1000, seq);
+    checkAgainstRescan(record);
+  }
+}
+
+// 单调序列让单调队列达到最长（递增时最小值队列只有一个元素、最大值队列为全部，递减时相反）
+void test_monotonic_runs_match_rescan() {
+  static SmallRecord record;
+  record.reset();
+  uint32_t seq = 0;
+  for (int run = 0; run < 8; run++) {
+    for (int i = 0; i < 40; i++) {
+      float temp = (run % 2 == 0 ? i : 40 - i) / 4.0f;
+      seq++;
+      record.push(temp, seq * 1000, seq);
+      checkAgainstRescan(record);
+    }
+  }
+}
+
+// 窗口内全部为未连接样本时统计值恢复为无效，之后重新出现有效样本
+void test_all_invalid_window_resets_stats() {
+  static SmallRecord record;
+  record.reset();
+  uint32_t seq = 0;
+  for (int i = 0; i < 10; i++) {
+    seq++;
+    record.push(20.0f + i, seq * 1000, seq);
+  }
+  for (int i = 0; i < 16; i++) {
+    seq++;
+    record.push(DEVICE_DISCONNECTED_C, seq * 1000, seq);
+    checkAgainstRescan(record);
+  }
+  TEST_ASSERT_EQUAL_INT(0, record.validCount);
+  seq++;
+  record.push(25.5f, seq * 1000, seq);
+  checkAgainstRescan(record);
+  TEST_ASSERT_EQUAL_FLOAT(25.5f, record.minTemp);
+}
+
+void test_firmware_capacity_matches_rescan() {
+  static FirmwareRecord record;
+  record.reset();
+  for (uint32_t seq = 1; seq <= 1000; seq++) {
+    record.push(randomTemp(), seq * 720000UL, seq);
+    if (seq % 7 == 0) {
+      checkAgainstRescan(record);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(240, record.count());
+  checkAgainstRescan(record);
+}
+
+// 插入开销基准：增量维护（push）与原实现（每次插入后重新扫描全部记录）对比，
+// 后者的计时包含 push 本身，与重新扫描相比可以忽略。
+// 容量 120（原 MAX_RECORDS）、1440（1天的1分钟样本）、10080（1周的1分钟样本）
+template <typename Record>
+static void rescanStats(Record& record) {
+  float minTemp = DEVICE_DISCONNECTED_C;
+  float maxTemp = DEVICE_DISCONNECTED_C;
+  float sum = 0;
+  int valid = 0;
+  for (int i = 0; i < record.count(); i++) {
+    float temp = record.tempAt(i);
+    if (temp == DEVICE_DISCONNECTED_C) {
+      continue;
+    }
+    if (valid == 0 || temp < minTemp) {
+      minTemp = temp;
+    }
+    if (valid == 0 || temp > maxTemp) {
+      maxTemp = temp;
+    }
+    sum += temp;
+    valid++;
+  }
+  record.minTemp = minTemp;
+  record.maxTemp = maxTemp;
+  record.avgTemp = valid > 0 ? sum / valid : DEVICE_DISCONNECTED_C;
+}
+
+static const int BENCH_INSERTS = 4000;
+
+// 记录写满后再计时，每次插入都要移出最旧的记录；返回每次插入的纳秒数
+template <int Capacity>
+static double benchInsert(TempRecordT<Capacity, 60000>& record, bool rescan) {
+  randomState = 12345;
+  record.reset();
+  uint32_t seq = 0;
+  for (int i = 0; i < Capacity; i++) {
+    seq++;
+    record.push(randomTemp(), seq * 60000UL, seq);
+  }
+  float temps[BENCH_INSERTS];
+  for (int i = 0; i < BENCH_INSERTS; i++) {
+    temps[i] = randomTemp();
+  }
+  clock_t begin = clock();
+  for (int i = 0; i < BENCH_INSERTS; i++) {
+    seq++;
+    record.push(temps[i], seq * 60000UL, seq);
+    if (rescan) {
+      rescanStats(record);
+    }
+  }
+  return (clock() - begin) * 1e9 / CLOCKS_PER_SEC / BENCH_INSERTS;
+}
+
+template <int Capacity>
+static void reportInsertCost(double& incremental, double& rescan) {
+  static TempRecordT<Capacity, 60000> record;
+  incremental = benchInsert(record, false);
+  checkAgainstRescan(record);
+  rescan = benchInsert(record, true);
+  char message[160];
+  snprintf(message, sizeof(message), "%5d records: incremental %7.1f ns/insert, rescan %9.1f ns/insert (x%.0f)",
+           Capacity, incremental, rescan, rescan / incremental);
+  TEST_MESSAGE(message);
+}
+
+void test_insert_cost_benchmark() {
+  double incremental120, rescan120;
+  double incremental1440, rescan1440;
+  double incremental10080, rescan10080;
+  reportInsertCost<120>(incremental120, rescan120);
+  reportInsertCost<1440>(incremental1440, rescan1440);
+  reportInsertCost<10080>(incremental10080, rescan10080);
+  // 增量维护的开销与记录数无关，重新扫描随记录数线性增长
+  TEST_ASSERT_TRUE(incremental10080 < rescan10080 / 10);
+  TEST_ASSERT_TRUE(rescan10080 > rescan120 * 10);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_record_has_no_stats);
+  RUN_TEST(test_random_stats_match_rescan);
+  RUN_TEST(test_monotonic_runs_match_rescan);
+  RUN_TEST(test_all_invalid_window_resets_stats);
+  RUN_TEST(test_firmware_capacity_matches_rescan);
+  RUN_TEST(test_insert_cost_benchmark);
+  return UNITY_END();
+}
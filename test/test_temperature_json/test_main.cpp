@@ -0,0 +1,233 @@
+#include <unity.h>
+
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+
+#include "StreamPrint.h"
+#include "TemperatureJson.h"
+
+// 写入内容保存为字符串的目标流
+class StringPrint : public Print {
+ public:
+  StringPrint() : length(0) { text[0] = 0; }
+  size_t write(uint8_t value) override {
+    if (length + 1 < sizeof(text)) {
+      text[length++] = (char)value;
+      text[length] = 0;
+    }
+    return 1;
+  }
+  void clear() {
+    length = 0;
+    text[0] = 0;
+  }
+  char text[2048];
+  size_t length;
+};
+
+// 统计堆分配：测试期间所有 operator new 的次数与字节数
+static size_t heapAllocations = 0;
+static size_t heapBytes = 0;
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  heapBytes += size;
+  void* p = malloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// ArduinoJson 6.21 序列化 double 的方式（TextFormatter::writeFloat 与 FloatParts），
+// 原先的 createTemperatureJSON 用 historyArray.add(round(temp * 10) / 10.0) 写入 l_t。
+// 温度范围内不涉及指数形式，只移植定点部分。
+static void arduinoJsonWriteFloat(char* out, double value) {
+  if (value < 0.0) {
+    *out++ = '-';
+    value = -value;
+  }
+  uint32_t maxDecimalPart = 1000000000;
+  int decimalPlaces = 9;
+  uint32_t integral = (uint32_t)value;
+  for (uint32_t tmp = integral; tmp >= 10; tmp /= 10) {
+    maxDecimalPart /= 10;
+    decimalPlaces--;
+  }
+  double remainder = (value - (double)integral) * (double)maxDecimalPart;
+  uint32_t decimal = (uint32_t)remainder;
+  remainder = remainder - (double)decimal;
+  decimal += (uint32_t)(remainder * 2);
+  if (decimal >= maxDecimalPart) {
+    decimal = 0;
+    integral++;
+  }
+  while (decimal % 10 == 0 && decimalPlaces > 0) {
+    decimal /= 10;
+    decimalPlaces--;
+  }
+  out += sprintf(out, "%u", (unsigned)integral);
+  if (decimalPlaces) {
+    sprintf(out, ".%0*u", decimalPlaces, (unsigned)decimal);
+  }
+}
+
+// 原实现写入 l_t 的值：有效温度为 round(temp * 10) / 10.0，无效数据为 0.0
+static void legacyHistoryValue(char* out, float temp) {
+  double value = temp != DEVICE_DISCONNECTED_C ? round(temp * 10) / 10.0 : 0.0;
+  arduinoJsonWriteFloat(out, value);
+}
+
+static StringPrint output;
+
+void setUp() { output.clear(); }
+void tearDown() {}
+
+// 记录下来的 ArduinoJson 输出：l_t 元素
+void test_history_values_match_recorded() {
+  struct {
+    float temp;
+    const char* json;
+  } cases[] = {
+      {28.5f, "28.5"},     {28.0f, "28"},       {28.0625f, "28.1"},  {-0.04f, "0"},     {-0.0f, "0"},
+      {0.04f, "0"},        {0.05f, "0.1"},      {-0.05f, "-0.1"},    {0.25f, "0.3"},    {-0.25f, "-0.3"},
+      {-10.0625f, "-10.1"}, {99.95f, "100"},    {125.0f, "125"},     {-55.0f, "-55"},   {0.1f, "0.1"},
+      {DEVICE_DISCONNECTED_C, "0"},
+  };
+  char legacy[32];
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    output.clear();
+    printJsonTemp(output, cases[i].temp);
+    TEST_ASSERT_EQUAL_STRING(cases[i].json, output.text);
+    legacyHistoryValue(legacy, cases[i].temp);
+    TEST_ASSERT_EQUAL_STRING(cases[i].json, legacy);
+  }
+}
+
+// DS18B20 全量程（-55 ~ 125°C）的每个 1/16°C 读数，以及其间的每个 0.01°C
+void test_history_values_sweep() {
+  char legacy[32];
+  int checked = 0;
+  for (int raw = -55 * TEMP_RAW_SCALE; raw <= 125 * TEMP_RAW_SCALE; raw++) {
+    float temp = rawToTemp((int16_t)raw);
+    output.clear();
+    printJsonTemp(output, temp);
+    legacyHistoryValue(legacy, temp);
+    TEST_ASSERT_EQUAL_STRING(legacy, output.text);
+    checked++;
+  }
+  for (int hundredths = -5500; hundredths <= 12500; hundredths++) {
+    float temp = hundredths / 100.0f;
+    output.clear();
+    printJsonTemp(output, temp);
+    legacyHistoryValue(legacy, temp);
+    TEST_ASSERT_EQUAL_STRING(legacy, output.text);
+    checked++;
+  }
+  TEST_ASSERT_EQUAL_INT(2881 + 18001, checked);
+}
+
+// c_t：原实现为 String(currentTemp, 1)，未连接时为字符串 "null"。
+// dtostrf 加上 0.05 后逐位截断，28.75 + 0.05 在 double 中略小于 28.8，因此为 "28.7"
+void test_current_temp_matches_recorded() {
+  struct {
+    float temp;
+    const char* json;
+  } cases[] = {
+      {28.5f, "28.5"}, {28.75f, "28.7"}, {28.25f, "28.3"}, {28.0f, "28.0"}, {-0.04f, "-0.0"},
+      {-0.0f, "0.0"},  {0.0f, "0.0"},    {-10.0625f, "-10.1"}, {125.0f, "125.0"}, {DEVICE_DISCONNECTED_C, "null"},
+  };
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    output.clear();
+    printJsonCurrentTemp(output, cases[i].temp);
+    TEST_ASSERT_EQUAL_STRING(cases[i].json, output.text);
+  }
+}
+
+typedef TempRecordT<8, 720000> SmallRecord;
+
+// 完整文档与记录的 ArduinoJson 输出逐字节相同（字段顺序、无空白、数值格式）
+void test_document_matches_recorded() {
+  static SmallRecord first;
+  static SmallRecord second;
+  first.reset();
+  second.reset();
+  const float samples[] = {28.5f, 28.0625f, DEVICE_DISCONNECTED_C, -0.25f, 0.0f, 125.0f};
+  for (int i = 0; i < 6; i++) {
+    first.push(samples[i], 1000 + i * 720000, i + 1);
+  }
+
+  writeJsonHeader(output, "2026-10-17 12:00:00", true, ((uint64_t)1 << 32) | 6, false, 0);
+  writeJsonSensor(output, "T1-0A0B0C0D", 28.5625f, "2026-10-17 11:59:55", first, 0, first.count());
+  writeJsonSensor(output, "T2-01020304", DEVICE_DISCONNECTED_C, "1970-01-01 00:00:00", second, 0, 0);
+  output.print('}');
+
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"system_time\":\"2026-10-17 12:00:00\",\"time_synced\":true,\"seq\":4294967302,"
+      "\"T1-0A0B0C0D\":{\"c_t\":\"28.6\",\"last_time\":\"2026-10-17 11:59:55\",\"l_t\":[28.5,28.1,0,-0.3,0,125]},"
+      "\"T2-01020304\":{\"c_t\":\"null\",\"last_time\":\"1970-01-01 00:00:00\",\"l_t\":[]}}",
+      output.text);
+
+  // 增量请求只输出 since 之后的样本
+  output.clear();
+  writeJsonHeader(output, "2026-10-17 12:00:00", false, 6, true, 4);
+  writeJsonSensor(output, "T1-0A0B0C0D", -0.04f, "2026-10-17 11:59:55", first, first.indexAfterSeq(4),
+                  first.count());
+  output.print('}');
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"system_time\":\"2026-10-17 12:00:00\",\"time_synced\":false,\"seq\":6,\"since\":4,"
+      "\"T1-0A0B0C0D\":{\"c_t\":\"-0.0\",\"last_time\":\"2026-10-17 11:59:55\",\"l_t\":[0,125]}}",
+      output.text);
+}
+
+// 峰值堆占用：流式输出不分配堆内存。原实现为 DynamicJsonDocument(8192) 加上序列化得到的
+// String（至少为负载长度 + 1），即 8192 + 负载长度 字节以上
+typedef TempRecordT<240, 720000> FullRecord;
+static FullRecord fullRecords[16];
+
+static void reportHeap(int sensors, int samples) {
+  for (int i = 0; i < sensors; i++) {
+    fullRecords[i].reset();
+    for (int k = 0; k < samples; k++) {
+      fullRecords[i].push(20.0f + ((k * 7 + i) % 100) / 16.0f, k * 720000UL, k + 1);
+    }
+  }
+
+  size_t allocationsBefore = heapAllocations;
+  size_t bytesBefore = heapBytes;
+  CountingPrint counter;
+  writeJsonHeader(counter, "2026-10-17 12:00:00", true, ((uint64_t)1 << 32) | samples, false, 0);
+  for (int i = 0; i < sensors; i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "T%d-%08X", (i + 1) % 100, 0x10203040 + i);
+    writeJsonSensor(counter, key, 21.5f, "2026-10-17 11:59:55", fullRecords[i], 0, fullRecords[i].count());
+  }
+  counter.print('}');
+  TEST_ASSERT_EQUAL_UINT32(0, heapAllocations - allocationsBefore);
+  TEST_ASSERT_EQUAL_UINT32(0, heapBytes - bytesBefore);
+
+  char message[200];
+  snprintf(message, sizeof(message),
+           "%2d sensors x %3d samples: payload %5u B; streaming heap 0 B (stack chunk 256 B); "
+           "ArduinoJson path >= %u B (8192 B document + String)",
+           sensors, samples, (unsigned)counter.length(), (unsigned)(8192 + counter.length() + 1));
+  TEST_MESSAGE(message);
+}
+
+void test_peak_heap() {
+  reportHeap(4, 120);
+  reportHeap(16, 240);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_history_values_match_recorded);
+  RUN_TEST(test_history_values_sweep);
+  RUN_TEST(test_current_temp_matches_recorded);
+  RUN_TEST(test_document_matches_recorded);
+  RUN_TEST(test_peak_heap);
+  return UNITY_END();
+}
@@ -0,0 +1,323 @@
+#include <unity.h>
+
+#include <string.h>
+
+#include "StreamPrint.h"
+#include "TemperatureJson.h"
+#include "TemperatureMsgPack.h"
+
+// 主机端MessagePack解码器：独立于 MsgPackWriter 按规范解析各类型的所有编码形式
+// （fixint/int8~int64/uint8~uint64、fixstr/str8/str16/str32、fixmap/map16/map32、
+// fixarray/array16/array32、nil、bool），用于检查编码结果能被通用解码器读回
+class MsgPackReader {
+ public:
+  MsgPackReader(const uint8_t* data, size_t length) : data_(data), length_(length), pos_(0), error_(false) {}
+
+  bool error() const { return error_; }
+  bool done() const { return pos_ == length_; }
+
+  bool peekNil() { return pos_ < length_ && data_[pos_] == 0xc0; }
+
+  void readNil() {
+    if (byte() != 0xc0) {
+      error_ = true;
+    }
+  }
+
+  bool readBool() {
+    uint8_t type = byte();
+    if (type != 0xc2 && type != 0xc3) {
+      error_ = true;
+    }
+    return type == 0xc3;
+  }
+
+  int64_t readInt() {
+    uint8_t type = byte();
+    if (type < 0x80) {
+      return type;
+    }
+    if (type >= 0xe0) {
+      return (int8_t)type;
+    }
+    switch (type) {
+      case 0xcc:
+        return (uint8_t)bigEndian(1);
+      case 0xcd:
+        return (uint16_t)bigEndian(2);
+      case 0xce:
+        return (uint32_t)bigEndian(4);
+      case 0xcf:
+        return (int64_t)bigEndian(8);
+      case 0xd0:
+        return (int8_t)bigEndian(1);
+      case 0xd1:
+        return (int16_t)bigEndian(2);
+      case 0xd2:
+        return (int32_t)bigEndian(4);
+      case 0xd3:
+        return (int64_t)bigEndian(8);
+    }
+    error_ = true;
+    return 0;
+  }
+
+  uint64_t readUInt() {
+    uint8_t type = peek();
+    if (type == 0xcf) {
+      byte();
+      return bigEndian(8);
+    }
+    return (uint64_t)readInt();
+  }
+
+  // 读取字符串到 text（以0结尾），返回长度
+  size_t readString(char* text, size_t size) {
+    uint8_t type = byte();
+    size_t length;
+    if ((type & 0xe0) == 0xa0) {
+      length = type & 0x1f;
+    } else if (type == 0xd9) {
+      length = bigEndian(1);
+    } else if (type == 0xda) {
+      length = bigEndian(2);
+    } else if (type == 0xdb) {
+      length = bigEndian(4);
+    } else {
+      error_ = true;
+      return 0;
+    }
+    if (length >= size || pos_ + length > length_) {
+      error_ = true;
+      return 0;
+    }
+    memcpy(text, data_ + pos_, length);
+    text[length] = 0;
+    pos_ += length;
+    return length;
+  }
+
+  size_t readMap() { return readContainer(0x80, 0xde, 0xdf); }
+  size_t readArray() { return readContainer(0x90, 0xdc, 0xdd); }
+
+ private:
+  size_t readContainer(uint8_t fixType, uint8_t type16, uint8_t type32) {
+    uint8_t type = byte();
+    if ((type & 0xf0) == fixType) {
+      return type & 0x0f;
+    }
+    if (type == type16) {
+      return bigEndian(2);
+    }
+    if (type == type32) {
+      return bigEndian(4);
+    }
+    error_ = true;
+    return 0;
+  }
+
+  uint8_t peek() {
+    if (pos_ >= length_) {
+      error_ = true;
+      return 0xc1;  // 规范中未使用的类型
+    }
+    return data_[pos_];
+  }
+
+  uint8_t byte() {
+    uint8_t value = peek();
+    if (!error_) {
+      pos_++;
+    }
+    return value;
+  }
+
+  uint64_t bigEndian(int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+      value = (value << 8) | byte();
+    }
+    return value;
+  }
+
+  const uint8_t* data_;
+  size_t length_;
+  size_t pos_;
+  bool error_;
+};
+
+// 写入内容保存到缓冲区的目标流
+class CapturePrint : public Print {
+ public:
+  CapturePrint() : length(0) {}
+  size_t write(uint8_t value) override { return write(&value, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (length + size > sizeof(data)) {
+      size = sizeof(data) - length;
+    }
+    memcpy(data + length, buffer, size);
+    length += size;
+    return size;
+  }
+  uint8_t data[16384];
+  size_t length;
+};
+
+typedef TempRecordT<240, 720000> Record;
+static const int MAX_TEST_SENSORS = 16;
+static Record records[MAX_TEST_SENSORS];
+static float currentTemps[MAX_TEST_SENSORS];
+static CapturePrint output;
+
+// 全量程的温度（含负温度、0、未连接与各整数编码边界附近的值），每个传感器不同
+static void fillRecords(int sensors, int samples) {
+  for (int i = 0; i < sensors; i++) {
+    records[i].reset();
+    for (int k = 0; k < samples; k++) {
+      float temp = ((k * 37 + i * 11) % (180 * TEMP_RAW_SCALE)) / (float)TEMP_RAW_SCALE - 55.0f;
+      if ((k + i) % 29 == 0) {
+        temp = DEVICE_DISCONNECTED_C;
+      }
+      records[i].push(temp, k * 720000UL, k + 1);
+    }
+    currentTemps[i] = i == 2 ? DEVICE_DISCONNECTED_C : -10.0625f + i * 8.5f;
+  }
+}
+
+static void sensorKey(char* key, int index) {
+  snprintf(key, 16, "T%d-28FF%04X", index % 100 + 1, 0x1234 + index % 256);
+}
+
+static void writeDocument(Print& out, int sensors, bool delta, uint64_t since, int start) {
+  MsgPackWriter writer(out);
+  writeMsgPackHeader(writer, "2026-10-17 12:00:00", true, ((uint64_t)7 << 32) | 240, delta, since, sensors);
+  for (int i = 0; i < sensors; i++) {
+    char key[16];
+    sensorKey(key, i);
+    writeMsgPackSensor(writer, key, currentTemps[i], "2026-10-17 11:59:55", records[i], start, records[i].count());
+  }
+}
+
+void setUp() { output.length = 0; }
+void tearDown() {}
+
+// 编码后用主机解码器读回，所有字段与原始数据一致：温度为 lround(temp * 10)，无效为 nil
+static void checkRoundTrip(int sensors, bool delta, int start) {
+  output.length = 0;
+  writeDocument(output, sensors, delta, 1000, start);
+  MsgPackReader reader(output.data, output.length);
+  char text[64];
+
+  TEST_ASSERT_EQUAL_size_t(3 + (delta ? 1 : 0) + sensors, reader.readMap());
+  reader.readString(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("system_time", text);
+  reader.readString(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("2026-10-17 12:00:00", text);
+  reader.readString(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("time_synced", text);
+  TEST_ASSERT_TRUE(reader.readBool());
+  reader.readString(text, sizeof(text));
+  TEST_ASSERT_EQUAL_STRING("seq", text);
+  TEST_ASSERT_TRUE((((uint64_t)7 << 32) | 240) == reader.readUInt());
+  if (delta) {
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("since", text);
+    TEST_ASSERT_TRUE(1000 == reader.readUInt());
+  }
+
+  for (int i = 0; i < sensors; i++) {
+    char key[16];
+    sensorKey(key, i);
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING(key, text);
+    TEST_ASSERT_EQUAL_size_t(3, reader.readMap());
+
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("c_t", text);
+    if (currentTemps[i] == DEVICE_DISCONNECTED_C) {
+      TEST_ASSERT_TRUE(reader.peekNil());
+      reader.readNil();
+    } else {
+      TEST_ASSERT_EQUAL_INT(lroundf(currentTemps[i] * 10), (int)reader.readInt());
+    }
+
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("last_time", text);
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("2026-10-17 11:59:55", text);
+
+    reader.readString(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("l_t", text);
+    TEST_ASSERT_EQUAL_size_t(records[i].count() - start, reader.readArray());
+    for (int j = start; j < records[i].count(); j++) {
+      float temp = records[i].tempAt(j);
+      if (temp == DEVICE_DISCONNECTED_C) {
+        TEST_ASSERT_TRUE(reader.peekNil());
+        reader.readNil();
+      } else {
+        TEST_ASSERT_EQUAL_INT(lroundf(temp * 10), (int)reader.readInt());
+      }
+    }
+  }
+  TEST_ASSERT_FALSE(reader.error());
+  TEST_ASSERT_TRUE(reader.done());
+}
+
+void test_round_trip_full() {
+  fillRecords(8, 240);
+  checkRoundTrip(8, false, 0);
+}
+
+// 增量负载（带 since），以及 map 超过15个键时的 map16
+void test_round_trip_delta_and_map16() {
+  fillRecords(16, 240);
+  checkRoundTrip(16, true, 200);
+}
+
+// 空历史与单个传感器
+void test_round_trip_empty_history() {
+  fillRecords(1, 0);
+  checkRoundTrip(1, false, 0);
+}
+
+// 与JSON负载的大小对比（完整历史，每个传感器240个样本，16~40°C 的室温范围）
+void test_size_vs_json() {
+  const int sensorCounts[] = {1, 8, 16};
+  char message[200];
+  for (int c = 0; c < 3; c++) {
+    int sensors = sensorCounts[c];
+    for (int i = 0; i < sensors; i++) {
+      records[i].reset();
+      for (int k = 0; k < 240; k++) {
+        records[i].push(16.0f + ((k * 7 + i * 13) % 384) / 16.0f, k * 720000UL, k + 1);
+      }
+      currentTemps[i] = 21.5f + i;
+    }
+
+    CountingPrint json;
+    writeJsonHeader(json, "2026-10-17 12:00:00", true, ((uint64_t)7 << 32) | 240, false, 0);
+    for (int i = 0; i < sensors; i++) {
+      char key[16];
+      sensorKey(key, i);
+      writeJsonSensor(json, key, currentTemps[i], "2026-10-17 11:59:55", records[i], 0, records[i].count());
+    }
+    json.print('}');
+
+    CountingPrint msgpack;
+    writeDocument(msgpack, sensors, false, 0, 0);
+    TEST_ASSERT_TRUE(msgpack.length() < json.length());
+
+    snprintf(message, sizeof(message), "%2d sensors x 240 samples: JSON %6u B, MessagePack %6u B (%.0f%%)", sensors,
+             (unsigned)json.length(), (unsigned)msgpack.length(), msgpack.length() * 100.0 / json.length());
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_full);
+  RUN_TEST(test_round_trip_delta_and_map16);
+  RUN_TEST(test_round_trip_empty_history);
+  RUN_TEST(test_size_vs_json);
+  return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include <unity.h>
+
+#include "TimeBase.h"
+
+// 与固件相同的参数（NTP_STEP_THRESHOLD / NTP_SLEW_PPM）
+static const int64_t STEP_MS = 2000;
+static const uint32_t SLEW_PPM = 500;
+static const int64_t EPOCH = 1760000000000LL;  // 2025年的某个时刻（毫秒）
+
+void setUp() {}
+void tearDown() {}
+
+// 32位计数回绕时扩展出的64位时间连续递增
+void test_monotonic_extends_across_wrap() {
+  MonotonicClock clock;
+  TEST_ASSERT_EQUAL_UINT32(100, (uint32_t)clock.extend(100));
+  uint64_t before = clock.extend(0xFFFFFF00u);
+  uint64_t after = clock.extend(0x10u);
+  TEST_ASSERT_TRUE(after > before);
+  TEST_ASSERT_EQUAL_UINT32(0x110, (uint32_t)(after - before));
+  uint64_t twice = clock.extend(0x20u);
+  clock.extend(0xFFFFFFFFu);
+  uint64_t third = clock.extend(5);
+  TEST_ASSERT_EQUAL_UINT32(1, (uint32_t)(twice >> 32));
+  TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)(third >> 32));
+}
+
+void test_unsynced_clock_reports_zero() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  TEST_ASSERT_FALSE(clock.valid());
+  TEST_ASSERT_EQUAL_INT64(0, clock.epochMillis(12345));
+}
+
+// 首次同步直接跳变
+void test_first_sync_steps() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  TEST_ASSERT_TRUE(clock.discipline(1000, EPOCH));
+  TEST_ASSERT_TRUE(clock.valid());
+  TEST_ASSERT_EQUAL_INT64(EPOCH, clock.epochMillis(1000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 5000, clock.epochMillis(6000));
+  TEST_ASSERT_EQUAL_INT64(0, clock.pendingSlew(6000));
+}
+
+// 小偏差按不超过 slewPpm 的速率补偿：补偿期间单调递增，补偿完后与新样本一致
+void test_small_error_slews_monotonically() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  clock.discipline(0, EPOCH);
+  // 60秒后NTP显示本地时间快了1秒
+  TEST_ASSERT_FALSE(clock.discipline(60000, EPOCH + 60000 - 1000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 60000, clock.epochMillis(60000));
+  TEST_ASSERT_EQUAL_INT64(-1000, clock.pendingSlew(60000));
+
+  int64_t previous = clock.epochMillis(60000);
+  for (uint64_t mono = 61000; mono <= 60000 + 2100000; mono += 1000) {
+    int64_t now = clock.epochMillis(mono);
+    TEST_ASSERT_TRUE(now > previous);
+    // 每秒最多调整 0.5 ms
+    TEST_ASSERT_TRUE(now - previous >= 1000 - 1 && now - previous <= 1000);
+    previous = now;
+  }
+  // 1秒偏差在 500ppm 下 2000 秒补偿完
+  TEST_ASSERT_EQUAL_INT64(0, clock.pendingSlew(60000 + 2000000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 60000 + 2000000 - 1000, clock.epochMillis(60000 + 2000000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 60000 + 2100000 - 1000, clock.epochMillis(60000 + 2100000));
+}
+
+// 本地时间慢了时同样缓慢追上
+void test_slew_forward() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  clock.discipline(0, EPOCH);
+  clock.discipline(10000, EPOCH + 10000 + 500);
+  TEST_ASSERT_EQUAL_INT64(500, clock.pendingSlew(10000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 10000 + 100000 + 50, clock.epochMillis(10000 + 100000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 10000 + 1000000 + 500, clock.epochMillis(10000 + 1000000));
+}
+
+// 补偿过程中再次同步：从当前已调整的位置继续，不回跳
+void test_resync_during_slew_is_continuous() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  clock.discipline(0, EPOCH);
+  clock.discipline(1000, EPOCH + 1000 - 1500);
+  int64_t before = clock.epochMillis(601000);
+  TEST_ASSERT_FALSE(clock.discipline(601000, EPOCH + 601000 - 1500));
+  TEST_ASSERT_EQUAL_INT64(before, clock.epochMillis(601000));
+  TEST_ASSERT_EQUAL_INT64(-1200, clock.pendingSlew(601000));
+}
+
+// 超过阈值的偏差直接跳变
+void test_large_error_steps() {
+  DisciplinedClock clock(STEP_MS, SLEW_PPM);
+  clock.discipline(0, EPOCH);
+  TEST_ASSERT_TRUE(clock.discipline(5000, EPOCH + 5000 + STEP_MS + 1));
+  TEST_ASSERT_EQUAL_INT64(EPOCH + 5000 + STEP_MS + 1, clock.epochMillis(5000));
+  TEST_ASSERT_TRUE(clock.discipline(6000, EPOCH - 3600000));
+  TEST_ASSERT_EQUAL_INT64(EPOCH - 3600000, clock.epochMillis(6000));
+  TEST_ASSERT_FALSE(clock.discipline(7000, EPOCH - 3600000 + 1000 + STEP_MS));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_monotonic_extends_across_wrap);
+  RUN_TEST(test_unsynced_clock_reports_zero);
+  RUN_TEST(test_first_sync_steps);
+  RUN_TEST(test_small_error_slews_monotonically);
+  RUN_TEST(test_slew_forward);
+  RUN_TEST(test_resync_during_slew_is_continuous);
+  RUN_TEST(test_large_error_steps);
+  return UNITY_END();
+}